@@ -0,0 +1,115 @@
+/**
+ * Shared setup for the benchmark suites
+ *
+ * The target is picked with BENCH_TARGET:
+ * - 'local' (default): LocalBackend on a temporary workspace root
+ * - 'remote': RemoteBackend against the remote/docker-compose.yml container
+ *   (see bench/README.md); BENCH_REMOTE_HOST, BENCH_REMOTE_PORT,
+ *   BENCH_REMOTE_USER, BENCH_REMOTE_PASSWORD and BENCH_WORKSPACE_ROOT
+ *   default to the compose file's values
+ *
+ * Both backends read the workspace root from the library config, so one run
+ * benchmarks one target.
+ */
+import { mkdtempSync, rmSync } from 'fs'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import type { BackendConfig } from '../src/backends/types.js'
+import { ConstellationFS } from '../src/config/Config.js'
+import { FileSystem } from '../src/FileSystem.js'
+import type { Workspace } from '../src/workspace/Workspace.js'
+
+export type BenchTarget = 'local' | 'remote'
+
+export const TARGET: BenchTarget = process.env.BENCH_TARGET === 'remote' ? 'remote' : 'local'
+
+let localRoot: string | null = null
+
+/**
+ * Point the library at the target's workspace root (idempotent)
+ */
+export function configureTarget(): void {
+  if (TARGET === 'remote') {
+    ConstellationFS.setConfig({ workspaceRoot: process.env.BENCH_WORKSPACE_ROOT ?? '/constellationfs' })
+    return
+  }
+  localRoot ??= mkdtempSync(join(tmpdir(), 'constellation-bench-'))
+  ConstellationFS.setConfig({ workspaceRoot: localRoot })
+}
+
+/**
+ * Backend configuration of the target for one user
+ */
+export function backendConfig(userId: string): Partial<BackendConfig> {
+  if (TARGET === 'remote') {
+    return {
+      type: 'remote',
+      userId,
+      host: process.env.BENCH_REMOTE_HOST ?? 'localhost',
+      sshPort: Number(process.env.BENCH_REMOTE_PORT ?? 2222),
+      sshAuth: {
+        type: 'password',
+        credentials: {
+          username: process.env.BENCH_REMOTE_USER ?? 'dev',
+          password: process.env.BENCH_REMOTE_PASSWORD ?? 'devpassword',
+        },
+      },
+      sshConnections: 2,
+      sftpSessions: 2,
+    }
+  }
+  return { type: 'local', userId, shell: 'auto', validateUtils: false }
+}
+
+/**
+ * A filesystem and workspace on the target, with a cleanup function
+ */
+export async function openWorkspace(name: string): Promise<{ fs: FileSystem; workspace: Workspace; close: () => Promise<void> }> {
+  configureTarget()
+  const fs = new FileSystem(backendConfig('bench-user'))
+  const workspace = await fs.getWorkspace(name)
+  return {
+    fs,
+    workspace,
+    close: async () => {
+      await workspace.exec(`rm -rf ./*`).catch(() => {})
+      await fs.destroy()
+    },
+  }
+}
+
+/**
+ * Create `files` files spread over nested directories, `filesPerDirectory` per directory
+ * @returns Paths of the created files
+ */
+export async function createTree(workspace: Workspace, root: string, files: number, filesPerDirectory = 20): Promise<string[]> {
+  const paths: string[] = []
+  const writes: Array<Promise<void>> = []
+  for (let i = 0; i < files; i++) {
+    const directory = Math.floor(i / filesPerDirectory)
+    // Two levels of nesting, ten directories wide
+    const path = `${root}/d${directory % 10}/d${Math.floor(directory / 10)}/file-${i}.txt`
+    paths.push(path)
+    writes.push(workspace.writeFile(path, `content of file ${i}\n`))
+    if (writes.length >= 32) await Promise.all(writes.splice(0))
+  }
+  await Promise.all(writes)
+  return paths
+}
+
+/**
+ * Remove the local workspace root once the suites are done
+ */
+export function removeLocalRoot(): void {
+  if (localRoot) {
+    rmSync(localRoot, { recursive: true, force: true })
+    localRoot = null
+  }
+}
+
+/** Payload sizes for read/write benchmarks */
+export const FILE_SIZES = [
+  { label: '1 KiB', bytes: 1024 },
+  { label: '64 KiB', bytes: 64 * 1024 },
+  { label: '1 MiB', bytes: 1024 * 1024 },
+] as const
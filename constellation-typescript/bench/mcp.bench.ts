@@ -0,0 +1,62 @@
+import type { McpServer } from '@modelcontextprotocol/sdk/server/mcp.js'
+import { afterAll, beforeAll, bench, describe } from 'vitest'
+import { registerTools } from '../src/mcp/tools.js'
+import type { Workspace } from '../src/workspace/Workspace.js'
+import { createTree, openWorkspace, removeLocalRoot, TARGET } from './fixtures.js'
+
+type ToolHandler = (args: Record<string, unknown>, extra: { sessionId?: string }) => Promise<unknown>
+
+/** Synthetic tree sizes for directory_tree */
+const TREE_SIZES = [100, 1000, 5000]
+
+const handlers = new Map<string, ToolHandler>()
+let workspace: Workspace
+let close: () => Promise<void>
+
+/** Call a tool handler directly, without a transport */
+function callTool(name: string, args: Record<string, unknown>): Promise<unknown> {
+  return handlers.get(name)!(args, {})
+}
+
+beforeAll(async () => {
+  ;({ workspace, close } = await openWorkspace('bench-mcp'))
+  for (const files of TREE_SIZES) {
+    await createTree(workspace, `tree-${files}`, files)
+  }
+  await workspace.mkdir('tree-1000/node_modules/pkg', { recursive: true })
+  await createTree(workspace, 'tree-1000/node_modules/pkg', 500)
+
+  const server = {
+    registerTool: (name: string, _config: unknown, handler: ToolHandler) => {
+      handlers.set(name, handler)
+    },
+  } as unknown as McpServer
+  registerTools(server, () => workspace)
+})
+
+afterAll(async () => {
+  await close()
+  removeLocalRoot()
+})
+
+describe(`directory_tree (${TARGET})`, () => {
+  for (const files of TREE_SIZES) {
+    bench(`${files} files`, async () => {
+      await callTool('directory_tree', { path: `tree-${files}`, excludePatterns: null })
+    })
+  }
+
+  bench('1000 files, node_modules excluded', async () => {
+    await callTool('directory_tree', { path: 'tree-1000', excludePatterns: ['node_modules'] })
+  })
+})
+
+describe(`list_directory and search_files (${TARGET})`, () => {
+  bench('list_directory', async () => {
+    await callTool('list_directory', { path: 'tree-1000/d0' })
+  })
+
+  bench('search_files', async () => {
+    await callTool('search_files', { path: 'tree-1000', pattern: '**/file-9*.txt', excludePatterns: null })
+  })
+})
@@ -0,0 +1,57 @@
+import { afterAll, beforeAll, bench, describe } from 'vitest'
+import { FileSystem } from '../src/FileSystem.js'
+import { FileSystemPoolManager } from '../src/FileSystemPoolManager.js'
+import { backendConfig, configureTarget, removeLocalRoot, TARGET } from './fixtures.js'
+
+/** Distinct users in the pool */
+const USERS = 200
+/** Concurrent acquire/release pairs per iteration */
+const CONCURRENCY = 100
+
+let pool: FileSystemPoolManager
+
+beforeAll(async () => {
+  configureTarget()
+  pool = new FileSystemPoolManager({ enablePeriodicCleanup: false, maxFileSystems: USERS })
+  // The pool loads FileSystem lazily through require(), which ESM test runs
+  // don't provide; build the same managed entries from the imported class
+  ;(pool as any).createManagedFileSystem = (userId: string) => ({
+    fs: new FileSystem(backendConfig(userId)),
+    userId,
+    activeReferences: 0,
+    lastAccessTime: Date.now(),
+  })
+  await pool.prewarm(Array.from({ length: USERS }, (_, i) => ({ userId: `user-${i}` })))
+})
+
+afterAll(async () => {
+  await pool.destroyAll()
+  removeLocalRoot()
+})
+
+describe(`pool acquire/release (${TARGET}, ${CONCURRENCY} concurrent)`, () => {
+  let round = 0
+
+  bench('one hot user', async () => {
+    await Promise.all(Array.from({ length: CONCURRENCY }, async () => {
+      const { release } = await pool.acquireFileSystem({ userId: 'user-0' })
+      release()
+    }))
+  })
+
+  bench('spread over users', async () => {
+    const base = round++ * CONCURRENCY
+    await Promise.all(Array.from({ length: CONCURRENCY }, async (_, i) => {
+      const { release } = await pool.acquireFileSystem({ userId: `user-${(base + i) % USERS}` })
+      release()
+    }))
+  })
+
+  bench('with workspace', async () => {
+    const base = round++ * CONCURRENCY
+    await Promise.all(Array.from({ length: CONCURRENCY }, async (_, i) => {
+      const { release } = await pool.acquireWorkspace({ userId: `user-${(base + i) % USERS}`, workspace: 'default' })
+      release()
+    }))
+  })
+})
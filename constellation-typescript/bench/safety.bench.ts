@@ -0,0 +1,29 @@
+import { bench, describe } from 'vitest'
+import { analyzeCommand } from '../src/safety.js'
+
+/** Commands shaped like what agents run: plain, piped, chained and quoted */
+const COMMANDS = [
+  'ls -la',
+  'cat src/index.ts | grep -n "export" | head -20',
+  'npm install && npm run build && npm test',
+  'find . -name "*.ts" -not -path "./node_modules/*" -exec wc -l {} +',
+  `python3 -c 'import json,sys; print(json.load(sys.stdin)["name"])' < package.json`,
+  'git log --oneline -n 20 -- src/',
+]
+
+describe('analyzeCommand', () => {
+  let counter = 0
+
+  // A fresh suffix defeats the verdict cache, so every call pays for tokenizing and checking
+  bench('uncached', () => {
+    analyzeCommand(`${COMMANDS[counter % COMMANDS.length]} # ${counter++}`)
+  })
+
+  bench('cached', () => {
+    analyzeCommand(COMMANDS[counter++ % COMMANDS.length]!)
+  })
+
+  bench('uncached, long pipeline', () => {
+    analyzeCommand(`${Array.from({ length: 20 }, (_, i) => `grep -v pattern-${i}`).join(' | ')} # ${counter++}`)
+  })
+})
@@ -0,0 +1,99 @@
+#!/usr/bin/env node
+
+/**
+ * Startup budget check
+ *
+ * Spawns fresh Node processes against the build in dist/ and measures:
+ * - importing each entry point
+ * - a stdio MCP server, from spawn until it reports it is ready
+ *
+ * Times are medians over STARTUP_RUNS processes, minus the median start of an
+ * empty Node process, so they measure what ConstellationFS adds. Exits with 1
+ * when one is over its budget.
+ *
+ * Usage: npm run build && npm run bench:startup
+ */
+
+import { spawn } from 'child_process'
+import { existsSync, mkdtempSync, rmSync } from 'fs'
+import { tmpdir } from 'os'
+import { dirname, join } from 'path'
+import { fileURLToPath } from 'url'
+
+const PACKAGE_ROOT = join(dirname(fileURLToPath(import.meta.url)), '..')
+const RUNS = Number(process.env.STARTUP_RUNS ?? 10)
+
+/** Budgets in milliseconds on top of an empty Node process */
+const BUDGETS = {
+  'import constellationfs/local': Number(process.env.STARTUP_BUDGET_LOCAL_MS ?? 120),
+  'import constellationfs/remote': Number(process.env.STARTUP_BUDGET_REMOTE_MS ?? 120),
+  'import constellationfs': Number(process.env.STARTUP_BUDGET_INDEX_MS ?? 200),
+  'stdio MCP server ready': Number(process.env.STARTUP_BUDGET_MCP_MS ?? 250),
+}
+
+/** Run a process and resolve with the milliseconds until `ready` says it is ready */
+function time(args, ready = (_stderr) => false) {
+  return new Promise((resolve, reject) => {
+    const started = process.hrtime.bigint()
+    const child = spawn(process.execPath, args, { stdio: ['pipe', 'ignore', 'pipe'] })
+    const elapsed = () => Number(process.hrtime.bigint() - started) / 1e6
+    let stderr = ''
+    let result = null
+    child.stderr.on('data', (chunk) => {
+      stderr += chunk
+      if (result === null && ready(stderr)) {
+        result = elapsed()
+        child.kill()
+      }
+    })
+    child.on('error', reject)
+    child.on('exit', (code) => {
+      if (result !== null) resolve(result)
+      else if (code === 0) resolve(elapsed())
+      else reject(new Error(`${args.join(' ')} exited with ${code}:\n${stderr}`))
+    })
+  })
+}
+
+async function median(args, ready) {
+  const times = []
+  for (let i = 0; i < RUNS; i++) {
+    times.push(await time(args, ready))
+  }
+  times.sort((a, b) => a - b)
+  return times[Math.floor(times.length / 2)]
+}
+
+if (!existsSync(join(PACKAGE_ROOT, 'dist', 'mcp', 'server.js'))) {
+  console.error('dist/ not found, run `npm run build` first')
+  process.exit(1)
+}
+
+const workspaceRoot = mkdtempSync(join(tmpdir(), 'constellation-startup-'))
+const importEntry = (file) => ['--input-type=module', '-e', `await import(${JSON.stringify(join(PACKAGE_ROOT, 'dist', file))})`]
+
+const scenarios = {
+  'import constellationfs/local': [importEntry('local.js')],
+  'import constellationfs/remote': [importEntry('remote.js')],
+  'import constellationfs': [importEntry('index.js')],
+  'stdio MCP server ready': [
+    [join(PACKAGE_ROOT, 'bin', 'constellation-fs-mcp.js'), '--workspaceRoot', workspaceRoot, '--userId', 'startup', '--workspace', 'default'],
+    (stderr) => stderr.includes('MCP server connected and ready'),
+  ],
+}
+
+let failed = false
+try {
+  const baseline = await median(['-e', ''])
+  console.log(`empty Node process: ${baseline.toFixed(1)} ms (subtracted below)\n`)
+  for (const [name, [args, ready]] of Object.entries(scenarios)) {
+    const added = (await median(args, ready)) - baseline
+    const over = added > BUDGETS[name]
+    failed ||= over
+    console.log(`${over ? '✗' : '✓'} ${name.padEnd(32)} ${added.toFixed(1).padStart(7)} ms  (budget ${BUDGETS[name]} ms)`)
+  }
+} finally {
+  rmSync(workspaceRoot, { recursive: true, force: true })
+}
+
+process.exit(failed ? 1 : 0)
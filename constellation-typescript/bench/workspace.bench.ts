@@ -0,0 +1,99 @@
+import { afterAll, beforeAll, bench, describe } from 'vitest'
+import type { Workspace } from '../src/workspace/Workspace.js'
+import { createTree, FILE_SIZES, openWorkspace, removeLocalRoot, TARGET } from './fixtures.js'
+
+/** Concurrent calls per storm iteration */
+const STORM_WIDTH = 64
+
+let workspace: Workspace
+let pooled: Workspace
+let close: () => Promise<void>
+let treeFiles: string[]
+
+beforeAll(async () => {
+  let fs
+  ;({ fs, workspace, close } = await openWorkspace('bench-workspace'))
+  // Warm shell workers; remote workspaces ignore the option
+  pooled = await fs.getWorkspace('bench-workspace', { shellWorkers: 4 })
+  for (const { bytes } of FILE_SIZES) {
+    await workspace.writeFile(`payload-${bytes}.bin`, Buffer.alloc(bytes, 0x61))
+  }
+  treeFiles = await createTree(workspace, 'tree', 1000)
+})
+
+afterAll(async () => {
+  await close()
+  removeLocalRoot()
+})
+
+describe(`exec (${TARGET})`, () => {
+  bench('true', async () => {
+    await workspace.exec('true')
+  })
+
+  bench('echo with output', async () => {
+    await workspace.exec('echo hello')
+  })
+
+  bench('pipeline', async () => {
+    await workspace.exec('ls tree | wc -l')
+  })
+
+  bench('true (shell workers)', async () => {
+    await pooled.exec('true')
+  })
+
+  bench('pipeline (shell workers)', async () => {
+    await pooled.exec('ls tree | wc -l')
+  })
+})
+
+describe(`readFile (${TARGET})`, () => {
+  for (const { label, bytes } of FILE_SIZES) {
+    bench(label, async () => {
+      await workspace.readFile(`payload-${bytes}.bin`, null)
+    })
+  }
+})
+
+describe(`writeFile (${TARGET})`, () => {
+  for (const { label, bytes } of FILE_SIZES) {
+    const content = Buffer.alloc(bytes, 0x62)
+    bench(label, async () => {
+      await workspace.writeFile(`written-${bytes}.bin`, content)
+    })
+  }
+})
+
+describe(`metadata storms (${TARGET}, ${STORM_WIDTH} concurrent)`, () => {
+  let offset = 0
+  // A different slice each iteration so the storms aren't served from one cache entry
+  const nextSlice = () => {
+    const slice = Array.from({ length: STORM_WIDTH }, (_, i) => treeFiles[(offset + i) % treeFiles.length]!)
+    offset = (offset + STORM_WIDTH) % treeFiles.length
+    return slice
+  }
+
+  bench('stat', async () => {
+    await Promise.all(nextSlice().map(path => workspace.stat(path)))
+  })
+
+  bench('exists', async () => {
+    await Promise.all(nextSlice().map(path => workspace.exists(path)))
+  })
+
+  bench('readdir', async () => {
+    const directories = [...new Set(nextSlice().map(path => path.slice(0, path.lastIndexOf('/'))))]
+    await Promise.all(directories.map(path => workspace.readdir(path)))
+  })
+})
+
+describe(`walk (${TARGET}, 1000 files)`, () => {
+  bench('names', async () => {
+    await workspace.walk({ path: 'tree' })
+  })
+
+  bench('with stats', async () => {
+    await workspace.walk({ path: 'tree', withStats: true })
+  })
+})
@@ -0,0 +1,22 @@
+/**
+ * ConstellationFS Remote Agent CLI
+ *
+ * Runs the agent daemon that RemoteBackend talks to over SSH.
+ * Exported as startAgent for use as a subcommand.
+ */
+
+import { dirname, join } from 'path'
+import { fileURLToPath } from 'url'
+
+const __filename = fileURLToPath(import.meta.url)
+const __dirname = dirname(__filename)
+
+/**
+ * Start the agent with the given arguments.
+ * Called from CLI dispatcher.
+ */
+export async function startAgent(args) {
+  // Dynamically import the compiled agent module
+  const agentModule = await import(join(__dirname, '..', 'dist', 'agent', 'main.js'))
+  await agentModule.main(args)
+}
@@ -0,0 +1,50 @@
+/**
+ * ConstellationFS Native Library Build
+ *
+ * Compiles the LD_PRELOAD intercept library (native/intercept.c) with the
+ * system C compiler. Linux only.
+ */
+
+import { spawn } from 'child_process'
+import { mkdirSync } from 'fs'
+import { dirname, join, resolve } from 'path'
+import { fileURLToPath } from 'url'
+
+const __filename = fileURLToPath(import.meta.url)
+const __dirname = dirname(__filename)
+const PACKAGE_ROOT = join(__dirname, '..')
+
+/**
+ * Build libintercept.so
+ * @param {Object} options - Build options
+ * @param {string} [options.output] - Output directory (default: <package>/dist-native)
+ * @returns {Promise<string>} Path to the built library
+ */
+export async function buildNative(options = {}) {
+  if (process.platform !== 'linux') {
+    throw new Error(`The intercept library is Linux-only (current: ${process.platform})`)
+  }
+
+  const outputDir = resolve(options.output ?? join(PACKAGE_ROOT, 'dist-native'))
+  const target = join(outputDir, 'libintercept.so')
+  const source = join(PACKAGE_ROOT, 'native', 'intercept.c')
+  const cc = process.env.CC || 'cc'
+
+  mkdirSync(outputDir, { recursive: true })
+
+  await new Promise((resolvePromise, reject) => {
+    const child = spawn(cc, ['-O2', '-Wall', '-Wextra', '-shared', '-fPIC', '-o', target, source, '-ldl'], {
+      stdio: 'inherit'
+    })
+    child.on('error', (error) => reject(new Error(`Failed to run ${cc}: ${error.message}`)))
+    child.on('close', (code) => {
+      if (code === 0) {
+        resolvePromise()
+      } else {
+        reject(new Error(`${cc} exited with code ${code}`))
+      }
+    })
+  })
+
+  return target
+}
@@ -1,11 +1,10 @@
 /**
  * ConstellationFS CLI Main Dispatcher
+ *
+ * Subcommand modules are imported when their command runs, so e.g. the agent
+ * or a stdio MCP server doesn't load the Docker helpers at startup.
  */
 
-import { dockerRun } from './docker-run.js'
-import { startMcpServer } from './mcp-server.js'
-import { startRemote, stopRemote } from './remote.js'
-
 export async function main(args) {
   const command = args[0]
   
@@ -27,9 +26,19 @@ export async function main(args) {
       await handleStopRemote()
       break
 
-    case 'mcp-server':
+    case 'mcp-server': {
+      const { startMcpServer } = await import('./mcp-server.js')
       await startMcpServer(args.slice(1))
       break
+    }
+
+    case 'agent':
+      await handleAgent(args.slice(1))
+      break
+
+    case 'build-native':
+      await handleBuildNative(args.slice(1))
+      break
 
     case 'help':
     case '--help':
@@ -51,6 +60,7 @@ async function handleDockerRun(args) {
     process.exit(1)
   }
   
+  const { dockerRun } = await import('./docker-run.js')
   try {
     await dockerRun(args.join(' '))
   } catch (error) {
@@ -62,6 +72,7 @@ async function handleDockerRun(args) {
 async function handleStartRemote(args) {
   const shouldBuild = args.includes('--build')
   
+  const { startRemote } = await import('./remote.js')
   try {
     await startRemote({ build: shouldBuild })
   } catch (error) {
@@ -70,7 +81,33 @@ async function handleStartRemote(args) {
   }
 }
 
+async function handleAgent(args) {
+  const { startAgent } = await import('./agent.js')
+  try {
+    await startAgent(args)
+  } catch (error) {
+    // stdout may carry protocol frames, so report on stderr only
+    console.error(`❌ Agent failed: ${error.message}`)
+    process.exit(1)
+  }
+}
+
+async function handleBuildNative(args) {
+  const outputIndex = args.indexOf('--output')
+  const output = outputIndex !== -1 ? args[outputIndex + 1] : undefined
+
+  const { buildNative } = await import('./build-native.js')
+  try {
+    const libraryPath = await buildNative({ output })
+    console.log(`✅ Built intercept library: ${libraryPath}`)
+  } catch (error) {
+    console.error(`❌ Failed to build native library: ${error.message}`)
+    process.exit(1)
+  }
+}
+
 async function handleStopRemote() {
+  const { stopRemote } = await import('./remote.js')
   try {
     await stopRemote()
   } catch (error) {
@@ -102,12 +139,21 @@ Commands:
                                   --port <port>        HTTP port (default: 3000)
                                   --authToken <tok>    Auth token (required)
 
+  agent --socket PATH | --stdio Run the remote agent daemon (used by the remote backend)
+                                Answers filesystem RPCs over a unix socket or stdio
+                                --root <path>: Reject paths outside this directory
+
   start-remote [--build]        Start ConstellationFS remote backend service
                                 (Docker-based SSH filesystem service)
                                 --build: Force rebuild the Docker image
 
   stop-remote                   Stop ConstellationFS remote backend service
 
+  build-native [--output DIR]   Build the LD_PRELOAD intercept library (Linux only)
+                                Confines every process started by exec() to its
+                                workspace. Enable with USE_LD_PRELOAD=true
+                                --output: Output directory (default: dist-native/)
+
   docker-run "COMMAND"          Run command with ConstellationFS Docker setup
                                 (Experimental - for advanced usage)
 
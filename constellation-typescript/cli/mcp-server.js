@@ -21,11 +21,11 @@ export async function startMcpServer(args) {
   await serverModule.main(args)
 }
 
-// Auto-run when this module is imported directly from bin/constellation-fs-mcp.js
-// The bin script imports this file, which triggers the auto-run
-const args = process.argv.slice(2)
-if (args.length > 0 || process.argv[1]?.includes('constellation-fs-mcp')) {
-  startMcpServer(args).catch((err) => {
+// Auto-run when this module is imported from bin/constellation-fs-mcp.js (or
+// run directly), but not when the `constellationfs` dispatcher imports it
+const entry = process.argv[1] ?? ''
+if (/constellation-fs-mcp(\.js)?$/.test(entry) || entry === __filename) {
+  startMcpServer(process.argv.slice(2)).catch((err) => {
     console.error('[constellation-fs-mcp] Fatal error:', err.message || err)
     process.exit(1)
   })
@@ -0,0 +1,1264 @@
+/*
+ * ConstellationFS LD_PRELOAD intercept library
+ *
+ * Keeps every process in a command's process tree inside its workspace by
+ * checking and rewriting the paths handed to libc's filesystem entry points.
+ * This is the in-process counterpart of resolvePathSafely() in
+ * src/utils/pathValidator.ts:
+ *
+ *   - Paths inside the workspace root are used as-is (after a symlink check)
+ *   - Absolute paths outside the workspace are treated as workspace-relative,
+ *     so `cat /notes.txt` reads <workspace>/notes.txt
+ *   - System prefixes (binaries, libraries, /etc, ...) stay readable so
+ *     tools keep working, but cannot be written. /proc is not among them:
+ *     /proc/<pid>/root and /proc/<pid>/cwd lead anywhere on the host, so it
+ *     maps into the workspace like any other outside path (ps, top and
+ *     similar tools will not work)
+ *
+ * Environment:
+ *   CONSTELLATION_WORKSPACE_ROOT      Absolute workspace path. The library is
+ *                                     inert when this is not set, and refuses
+ *                                     to run a process when it is "/" or not
+ *                                     absolute.
+ *   CONSTELLATION_INTERCEPT_READONLY  Colon-separated prefixes readable outside
+ *                                     the workspace (default: see below)
+ *   CONSTELLATION_INTERCEPT_WRITABLE  Colon-separated prefixes writable outside
+ *                                     the workspace (default: /dev)
+ *
+ * These and LD_PRELOAD are read once, by the first confined process. The
+ * exec family (execve, execveat, fexecve and the execl/execv variants),
+ * posix_spawn/posix_spawnp, system() and popen() overwrite them with the
+ * values that process started with, so a command cannot loosen or drop its
+ * own confinement (`LD_PRELOAD= cmd`, `CONSTELLATION_WORKSPACE_ROOT=/ cmd`,
+ * `env -i cmd`, clearenv() followed by system(), ...). Processes started by
+ * raw clone/execve syscalls are not covered.
+ *
+ * Limitations: statically linked binaries and programs that issue raw
+ * syscalls (e.g. Go binaries) do not go through libc and are not confined.
+ * Calls that are not hooked are not checked either: mknod/mkfifo, bind() and
+ * connect() on Unix sockets, extended attributes (setxattr, ...), inotify,
+ * mount, chroot and name_to_handle_at/open_by_handle_at.
+ * Setuid binaries ignore LD_PRELOAD entirely, which is why dangerous-command
+ * checks stay enabled on the TypeScript side.
+ *
+ * Build: make -C native   (outputs dist-native/libintercept.so)
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define CFS_ROOT_ENV "CONSTELLATION_WORKSPACE_ROOT"
+#define CFS_READONLY_ENV "CONSTELLATION_INTERCEPT_READONLY"
+#define CFS_WRITABLE_ENV "CONSTELLATION_INTERCEPT_WRITABLE"
+
+#define CFS_DEFAULT_READONLY "/usr:/bin:/sbin:/lib:/lib32:/lib64:/libx32:/etc:/opt:/sys:/snap"
+#define CFS_DEFAULT_WRITABLE "/dev"
+
+#define CFS_MAX_PREFIXES 32
+
+/* Access intent flags for cfs_map() */
+#define CFS_READ 0
+#define CFS_WRITE 1
+#define CFS_NOFOLLOW 2
+
+typedef struct {
+  char path[PATH_MAX];
+  size_t len;
+} cfs_prefix;
+
+static int cfs_enabled = 0;
+
+/* Workspace root as configured (normalized) and as resolved by realpath() */
+static char cfs_root[PATH_MAX];
+static size_t cfs_root_len = 0;
+static char cfs_root_real[PATH_MAX];
+static size_t cfs_root_real_len = 0;
+
+static cfs_prefix cfs_readonly[CFS_MAX_PREFIXES];
+static int cfs_readonly_count = 0;
+static cfs_prefix cfs_writable[CFS_MAX_PREFIXES];
+static int cfs_writable_count = 0;
+
+/* Path of this library, re-injected into LD_PRELOAD on exec */
+static char cfs_self_path[PATH_MAX];
+
+/* "NAME=value" entries frozen at init and forced into every exec'd environment */
+#define CFS_ENV_ENTRY_MAX (PATH_MAX * 2 + 64)
+static char cfs_env_preload[CFS_ENV_ENTRY_MAX];
+static char cfs_env_root[CFS_ENV_ENTRY_MAX];
+static char cfs_env_readonly[CFS_ENV_ENTRY_MAX];
+static char cfs_env_writable[CFS_ENV_ENTRY_MAX];
+
+/* Resolve the next definition of a libc symbol once, on first use */
+#define CFS_REAL(ret, name, ...)                                          \
+  static ret (*real_##name)(__VA_ARGS__) = NULL;                          \
+  if (!real_##name) {                                                     \
+    real_##name = (ret(*)(__VA_ARGS__))dlsym(RTLD_NEXT, #name);           \
+  }
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* Path helpers                                                           */
+/* ────────────────────────────────────────────────────────────────────── */
+
+/*
+ * Lexically normalize an absolute path: collapse "//", "." and "..".
+ * ".." at the filesystem root stays at the root, matching path.resolve().
+ */
+static int cfs_normalize(const char *in, char *out) {
+  size_t len = 1;
+  const char *p = in;
+
+  out[0] = '/';
+
+  while (*p) {
+    while (*p == '/') {
+      p++;
+    }
+    if (!*p) {
+      break;
+    }
+
+    const char *start = p;
+    while (*p && *p != '/') {
+      p++;
+    }
+    size_t n = (size_t)(p - start);
+
+    if (n == 1 && start[0] == '.') {
+      continue;
+    }
+
+    if (n == 2 && start[0] == '.' && start[1] == '.') {
+      char *slash = memrchr(out, '/', len);
+      size_t idx = slash ? (size_t)(slash - out) : 0;
+      len = idx == 0 ? 1 : idx;
+      continue;
+    }
+
+    size_t needed = len + (len > 1 ? 1 : 0) + n;
+    if (needed >= PATH_MAX) {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    if (len > 1) {
+      out[len++] = '/';
+    }
+    memcpy(out + len, start, n);
+    len += n;
+  }
+
+  out[len] = '\0';
+  return 0;
+}
+
+/* Turn a (dirfd, path) pair into an absolute path */
+static int cfs_absolute(int dirfd, const char *path, char *out) {
+  char base[PATH_MAX];
+
+  if (path[0] == '/') {
+    if (strlen(path) >= PATH_MAX) {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    strcpy(out, path);
+    return 0;
+  }
+
+  if (dirfd == AT_FDCWD) {
+    if (!getcwd(base, sizeof(base))) {
+      return -1;
+    }
+  } else {
+    CFS_REAL(ssize_t, readlink, const char *, char *, size_t);
+    char fdpath[64];
+    snprintf(fdpath, sizeof(fdpath), "/proc/self/fd/%d", dirfd);
+    ssize_t n = real_readlink(fdpath, base, sizeof(base) - 1);
+    if (n < 0) {
+      errno = EBADF;
+      return -1;
+    }
+    base[n] = '\0';
+  }
+
+  if (snprintf(out, PATH_MAX, "%s/%s", base, path) >= PATH_MAX) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  return 0;
+}
+
+static int cfs_has_prefix(const char *path, const char *prefix, size_t len) {
+  if (len == 1 && prefix[0] == '/') {
+    return 1;
+  }
+  return strncmp(path, prefix, len) == 0 && (path[len] == '\0' || path[len] == '/');
+}
+
+static int cfs_within_root(const char *path) {
+  return cfs_has_prefix(path, cfs_root, cfs_root_len) ||
+         (cfs_root_real_len > 0 && cfs_has_prefix(path, cfs_root_real, cfs_root_real_len));
+}
+
+static int cfs_match_any(const char *path, const cfs_prefix *prefixes, int count) {
+  for (int i = 0; i < count; i++) {
+    if (cfs_has_prefix(path, prefixes[i].path, prefixes[i].len)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Check whether a path inside the workspace resolves (through symlinks) to a
+ * location outside it. The longest existing ancestor is resolved, so paths
+ * that do not exist yet (O_CREAT, mkdir, rename targets) are covered too.
+ * With CFS_NOFOLLOW the final component is not followed (lstat, unlink, ...).
+ */
+static int cfs_escapes_via_symlink(const char *path, int flags) {
+  char probe[PATH_MAX];
+  char resolved[PATH_MAX];
+
+  strcpy(probe, path);
+
+  if (flags & CFS_NOFOLLOW) {
+    char *slash = strrchr(probe, '/');
+    if (!slash || slash == probe) {
+      return 0;
+    }
+    *slash = '\0';
+    /* The path is the workspace root itself, whose parent is outside by design */
+    if (!cfs_within_root(probe)) {
+      return 0;
+    }
+  }
+
+  for (;;) {
+    if (realpath(probe, resolved)) {
+      return !cfs_within_root(resolved);
+    }
+    if (errno != ENOENT && errno != ENOTDIR) {
+      /* Let the real call report permission or loop errors */
+      return 0;
+    }
+
+    char *slash = strrchr(probe, '/');
+    if (!slash || slash == probe || (size_t)(slash - probe) < cfs_root_len) {
+      return 0;
+    }
+    *slash = '\0';
+  }
+}
+
+/*
+ * Map a path for the real libc call.
+ * Returns the path to use (either `path` or `buf`), or NULL with errno set
+ * when the access is denied.
+ */
+static const char *cfs_map(int dirfd, const char *path, int flags, char *buf) {
+  char absolute[PATH_MAX];
+
+  if (!cfs_enabled || path == NULL || path[0] == '\0') {
+    return path;
+  }
+
+  int saved_errno = errno;
+
+  if (cfs_absolute(dirfd, path, absolute) < 0 || cfs_normalize(absolute, buf) < 0) {
+    return NULL;
+  }
+
+  if (!cfs_within_root(buf)) {
+    if (cfs_match_any(buf, cfs_writable, cfs_writable_count)) {
+      errno = saved_errno;
+      return buf;
+    }
+
+    if (cfs_match_any(buf, cfs_readonly, cfs_readonly_count)) {
+      if (flags & CFS_WRITE) {
+        errno = EACCES;
+        return NULL;
+      }
+      errno = saved_errno;
+      return buf;
+    }
+
+    /* Outside the workspace: treat as workspace-relative */
+    if (cfs_root_len + strlen(buf) >= PATH_MAX) {
+      errno = ENAMETOOLONG;
+      return NULL;
+    }
+    memmove(buf + cfs_root_len, buf, strlen(buf) + 1);
+    memcpy(buf, cfs_root, cfs_root_len);
+  }
+
+  if (cfs_escapes_via_symlink(buf, flags)) {
+    errno = EACCES;
+    return NULL;
+  }
+
+  errno = saved_errno;
+  return buf;
+}
+
+static int cfs_open_intent(int oflag) {
+  int accmode = oflag & O_ACCMODE;
+  if (accmode == O_WRONLY || accmode == O_RDWR || (oflag & (O_CREAT | O_TRUNC | O_APPEND))) {
+    return CFS_WRITE;
+  }
+  return CFS_READ;
+}
+
+static int cfs_fopen_intent(const char *mode) {
+  return (mode && (strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+'))) ? CFS_WRITE : CFS_READ;
+}
+
+static int cfs_needs_mode(int oflag) {
+#ifdef O_TMPFILE
+  if ((oflag & O_TMPFILE) == O_TMPFILE) {
+    return 1;
+  }
+#endif
+  return (oflag & O_CREAT) != 0;
+}
+
+static void cfs_parse_prefixes(const char *list, cfs_prefix *prefixes, int *count) {
+  char copy[PATH_MAX * 2];
+  char *saveptr = NULL;
+
+  *count = 0;
+  if (!list || strlen(list) >= sizeof(copy)) {
+    return;
+  }
+  strcpy(copy, list);
+
+  for (char *tok = strtok_r(copy, ":", &saveptr); tok && *count < CFS_MAX_PREFIXES;
+       tok = strtok_r(NULL, ":", &saveptr)) {
+    if (tok[0] != '/' || cfs_normalize(tok, prefixes[*count].path) < 0) {
+      continue;
+    }
+    prefixes[*count].len = strlen(prefixes[*count].path);
+    (*count)++;
+  }
+}
+
+/* Write "NAME=/a:/b" for a parsed prefix list */
+static void cfs_format_prefixes(char *out, const char *name, const cfs_prefix *prefixes, int count) {
+  size_t len = (size_t)snprintf(out, CFS_ENV_ENTRY_MAX, "%s=", name);
+
+  for (int i = 0; i < count && len < CFS_ENV_ENTRY_MAX; i++) {
+    len += (size_t)snprintf(out + len, CFS_ENV_ENTRY_MAX - len, "%s%s", i > 0 ? ":" : "", prefixes[i].path);
+  }
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* Initialization                                                         */
+/* ────────────────────────────────────────────────────────────────────── */
+
+__attribute__((constructor)) static void cfs_init(void) {
+  const char *root = getenv(CFS_ROOT_ENV);
+  Dl_info info;
+
+  if (!root) {
+    return;
+  }
+
+  /*
+   * A root that is set but unusable means someone tried to widen the
+   * confinement (confining to "/" would be a no-op): refuse to run rather
+   * than run unconfined.
+   */
+  if (root[0] != '/' || cfs_normalize(root, cfs_root) < 0 || strlen(cfs_root) <= 1) {
+    static const char message[] = "constellationfs: invalid " CFS_ROOT_ENV ", refusing to run unconfined\n";
+    if (write(STDERR_FILENO, message, sizeof(message) - 1) < 0) {
+      /* Nothing else to report it to */
+    }
+    _exit(126);
+  }
+  cfs_root_len = strlen(cfs_root);
+
+  if (realpath(cfs_root, cfs_root_real)) {
+    cfs_root_real_len = strlen(cfs_root_real);
+  }
+
+  const char *readonly = getenv(CFS_READONLY_ENV);
+  const char *writable = getenv(CFS_WRITABLE_ENV);
+  cfs_parse_prefixes(readonly ? readonly : CFS_DEFAULT_READONLY, cfs_readonly, &cfs_readonly_count);
+  cfs_parse_prefixes(writable ? writable : CFS_DEFAULT_WRITABLE, cfs_writable, &cfs_writable_count);
+
+  if (dladdr((void *)&cfs_init, &info) && info.dli_fname && strlen(info.dli_fname) < PATH_MAX) {
+    strcpy(cfs_self_path, info.dli_fname);
+  }
+
+  /* Keep the preload list this process started with, as long as it loads us */
+  const char *preload = getenv("LD_PRELOAD");
+  if (preload && cfs_self_path[0] && strstr(preload, cfs_self_path) &&
+      strlen(preload) < CFS_ENV_ENTRY_MAX - sizeof("LD_PRELOAD=")) {
+    snprintf(cfs_env_preload, CFS_ENV_ENTRY_MAX, "LD_PRELOAD=%s", preload);
+  } else if (cfs_self_path[0]) {
+    snprintf(cfs_env_preload, CFS_ENV_ENTRY_MAX, "LD_PRELOAD=%s", cfs_self_path);
+  }
+  snprintf(cfs_env_root, CFS_ENV_ENTRY_MAX, "%s=%s", CFS_ROOT_ENV, cfs_root);
+  cfs_format_prefixes(cfs_env_readonly, CFS_READONLY_ENV, cfs_readonly, cfs_readonly_count);
+  cfs_format_prefixes(cfs_env_writable, CFS_WRITABLE_ENV, cfs_writable, cfs_writable_count);
+
+  cfs_enabled = 1;
+
+  /* Start inside the workspace; this replaces the `cd <workspace> &&` prefix */
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd)) || !cfs_within_root(cwd)) {
+    if (chdir(cfs_root) != 0) {
+      /* Leave cwd untouched; relative paths are still checked */
+    }
+  }
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* open family                                                            */
+/* ────────────────────────────────────────────────────────────────────── */
+
+#define CFS_OPEN_MODE(oflag, mode)     \
+  mode_t mode = 0;                     \
+  if (cfs_needs_mode(oflag)) {         \
+    va_list ap;                        \
+    va_start(ap, oflag);               \
+    mode = (mode_t)va_arg(ap, int);    \
+    va_end(ap);                        \
+  }
+
+int open(const char *path, int oflag, ...) {
+  CFS_REAL(int, open, const char *, int, ...);
+  CFS_OPEN_MODE(oflag, mode);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_open(mapped, oflag, mode);
+}
+
+int open64(const char *path, int oflag, ...) {
+  CFS_REAL(int, open64, const char *, int, ...);
+  CFS_OPEN_MODE(oflag, mode);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_open64(mapped, oflag, mode);
+}
+
+int openat(int dirfd, const char *path, int oflag, ...) {
+  CFS_REAL(int, openat, int, const char *, int, ...);
+  CFS_OPEN_MODE(oflag, mode);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_openat(dirfd, mapped, oflag, mode);
+}
+
+int openat64(int dirfd, const char *path, int oflag, ...) {
+  CFS_REAL(int, openat64, int, const char *, int, ...);
+  CFS_OPEN_MODE(oflag, mode);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_openat64(dirfd, mapped, oflag, mode);
+}
+
+/* Fortified variants emitted by -D_FORTIFY_SOURCE builds */
+int __open_2(const char *path, int oflag) {
+  CFS_REAL(int, __open_2, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___open_2(mapped, oflag);
+}
+
+int __open64_2(const char *path, int oflag) {
+  CFS_REAL(int, __open64_2, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___open64_2(mapped, oflag);
+}
+
+int __openat_2(int dirfd, const char *path, int oflag) {
+  CFS_REAL(int, __openat_2, int, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___openat_2(dirfd, mapped, oflag);
+}
+
+int __openat64_2(int dirfd, const char *path, int oflag) {
+  CFS_REAL(int, __openat64_2, int, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, cfs_open_intent(oflag), buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___openat64_2(dirfd, mapped, oflag);
+}
+
+int creat(const char *path, mode_t mode) {
+  CFS_REAL(int, creat, const char *, mode_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_creat(mapped, mode);
+}
+
+int creat64(const char *path, mode_t mode) {
+  CFS_REAL(int, creat64, const char *, mode_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_creat64(mapped, mode);
+}
+
+/* stdio and dirent open files through libc-internal calls, so hook them too */
+FILE *fopen(const char *path, const char *mode) {
+  CFS_REAL(FILE *, fopen, const char *, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_fopen_intent(mode), buf);
+  if (!mapped) {
+    return NULL;
+  }
+  return real_fopen(mapped, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode) {
+  CFS_REAL(FILE *, fopen64, const char *, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_fopen_intent(mode), buf);
+  if (!mapped) {
+    return NULL;
+  }
+  return real_fopen64(mapped, mode);
+}
+
+FILE *freopen(const char *path, const char *mode, FILE *stream) {
+  CFS_REAL(FILE *, freopen, const char *, const char *, FILE *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, cfs_fopen_intent(mode), buf);
+  if (path && !mapped) {
+    return NULL;
+  }
+  return real_freopen(mapped, mode, stream);
+}
+
+DIR *opendir(const char *path) {
+  CFS_REAL(DIR *, opendir, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return NULL;
+  }
+  return real_opendir(mapped);
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* stat family                                                            */
+/* ────────────────────────────────────────────────────────────────────── */
+
+int stat(const char *path, struct stat *st) {
+  CFS_REAL(int, stat, const char *, struct stat *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_stat(mapped, st);
+}
+
+int lstat(const char *path, struct stat *st) {
+  CFS_REAL(int, lstat, const char *, struct stat *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_lstat(mapped, st);
+}
+
+int stat64(const char *path, struct stat64 *st) {
+  CFS_REAL(int, stat64, const char *, struct stat64 *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_stat64(mapped, st);
+}
+
+int lstat64(const char *path, struct stat64 *st) {
+  CFS_REAL(int, lstat64, const char *, struct stat64 *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_lstat64(mapped, st);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *st, int flag) {
+  CFS_REAL(int, fstatat, int, const char *, struct stat *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_NOFOLLOW : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_fstatat(dirfd, mapped, st, flag);
+}
+
+int fstatat64(int dirfd, const char *path, struct stat64 *st, int flag) {
+  CFS_REAL(int, fstatat64, int, const char *, struct stat64 *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_NOFOLLOW : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_fstatat64(dirfd, mapped, st, flag);
+}
+
+/* Pre-2.33 glibc routes stat() through these versioned entry points */
+int __xstat(int ver, const char *path, struct stat *st) {
+  CFS_REAL(int, __xstat, int, const char *, struct stat *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___xstat(ver, mapped, st);
+}
+
+int __lxstat(int ver, const char *path, struct stat *st) {
+  CFS_REAL(int, __lxstat, int, const char *, struct stat *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___lxstat(ver, mapped, st);
+}
+
+int __xstat64(int ver, const char *path, struct stat64 *st) {
+  CFS_REAL(int, __xstat64, int, const char *, struct stat64 *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___xstat64(ver, mapped, st);
+}
+
+int __lxstat64(int ver, const char *path, struct stat64 *st) {
+  CFS_REAL(int, __lxstat64, int, const char *, struct stat64 *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___lxstat64(ver, mapped, st);
+}
+
+int __fxstatat(int ver, int dirfd, const char *path, struct stat *st, int flag) {
+  CFS_REAL(int, __fxstatat, int, int, const char *, struct stat *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_NOFOLLOW : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___fxstatat(ver, dirfd, mapped, st, flag);
+}
+
+int __fxstatat64(int ver, int dirfd, const char *path, struct stat64 *st, int flag) {
+  CFS_REAL(int, __fxstatat64, int, int, const char *, struct stat64 *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_NOFOLLOW : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real___fxstatat64(ver, dirfd, mapped, st, flag);
+}
+
+#ifdef STATX_TYPE
+/* coreutils (ls, stat, cp) use statx() on modern systems */
+int statx(int dirfd, const char *path, int flags, unsigned int mask, struct statx *stx) {
+  CFS_REAL(int, statx, int, const char *, int, unsigned int, struct statx *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flags & AT_SYMLINK_NOFOLLOW) ? CFS_NOFOLLOW : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_statx(dirfd, mapped, flags, mask, stx);
+}
+#endif
+
+int access(const char *path, int amode) {
+  CFS_REAL(int, access, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, (amode & W_OK) ? CFS_WRITE : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_access(mapped, amode);
+}
+
+int faccessat(int dirfd, const char *path, int amode, int flag) {
+  CFS_REAL(int, faccessat, int, const char *, int, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (amode & W_OK) ? CFS_WRITE : CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_faccessat(dirfd, mapped, amode, flag);
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* readlink, rename, unlink, directories                                  */
+/* ────────────────────────────────────────────────────────────────────── */
+
+ssize_t readlink(const char *path, char *out, size_t size) {
+  CFS_REAL(ssize_t, readlink, const char *, char *, size_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_readlink(mapped, out, size);
+}
+
+ssize_t readlinkat(int dirfd, const char *path, char *out, size_t size) {
+  CFS_REAL(ssize_t, readlinkat, int, const char *, char *, size_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_readlinkat(dirfd, mapped, out, size);
+}
+
+int rename(const char *from, const char *to) {
+  CFS_REAL(int, rename, const char *, const char *);
+  char from_buf[PATH_MAX];
+  char to_buf[PATH_MAX];
+  const char *mapped_from = cfs_map(AT_FDCWD, from, CFS_WRITE | CFS_NOFOLLOW, from_buf);
+  const char *mapped_to = mapped_from ? cfs_map(AT_FDCWD, to, CFS_WRITE | CFS_NOFOLLOW, to_buf) : NULL;
+  if (!mapped_from || !mapped_to) {
+    return -1;
+  }
+  return real_rename(mapped_from, mapped_to);
+}
+
+int renameat(int fromfd, const char *from, int tofd, const char *to) {
+  CFS_REAL(int, renameat, int, const char *, int, const char *);
+  char from_buf[PATH_MAX];
+  char to_buf[PATH_MAX];
+  const char *mapped_from = cfs_map(fromfd, from, CFS_WRITE | CFS_NOFOLLOW, from_buf);
+  const char *mapped_to = mapped_from ? cfs_map(tofd, to, CFS_WRITE | CFS_NOFOLLOW, to_buf) : NULL;
+  if (!mapped_from || !mapped_to) {
+    return -1;
+  }
+  return real_renameat(fromfd, mapped_from, tofd, mapped_to);
+}
+
+int renameat2(int fromfd, const char *from, int tofd, const char *to, unsigned int flags) {
+  CFS_REAL(int, renameat2, int, const char *, int, const char *, unsigned int);
+  char from_buf[PATH_MAX];
+  char to_buf[PATH_MAX];
+  const char *mapped_from = cfs_map(fromfd, from, CFS_WRITE | CFS_NOFOLLOW, from_buf);
+  const char *mapped_to = mapped_from ? cfs_map(tofd, to, CFS_WRITE | CFS_NOFOLLOW, to_buf) : NULL;
+  if (!mapped_from || !mapped_to) {
+    return -1;
+  }
+  return real_renameat2(fromfd, mapped_from, tofd, mapped_to, flags);
+}
+
+int unlink(const char *path) {
+  CFS_REAL(int, unlink, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_unlink(mapped);
+}
+
+int unlinkat(int dirfd, const char *path, int flag) {
+  CFS_REAL(int, unlinkat, int, const char *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_unlinkat(dirfd, mapped, flag);
+}
+
+int rmdir(const char *path) {
+  CFS_REAL(int, rmdir, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_rmdir(mapped);
+}
+
+int mkdir(const char *path, mode_t mode) {
+  CFS_REAL(int, mkdir, const char *, mode_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_mkdir(mapped, mode);
+}
+
+int mkdirat(int dirfd, const char *path, mode_t mode) {
+  CFS_REAL(int, mkdirat, int, const char *, mode_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_mkdirat(dirfd, mapped, mode);
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* links, permissions, ownership, size and timestamps                     */
+/* ────────────────────────────────────────────────────────────────────── */
+
+/* The link target is stored as-is; following it later goes through cfs_map() */
+int symlink(const char *target, const char *linkpath) {
+  CFS_REAL(int, symlink, const char *, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, linkpath, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_symlink(target, mapped);
+}
+
+int symlinkat(const char *target, int dirfd, const char *linkpath) {
+  CFS_REAL(int, symlinkat, const char *, int, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, linkpath, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_symlinkat(target, dirfd, mapped);
+}
+
+/*
+ * A hard link shares the inode, so writing through it writes the original:
+ * the existing path must be writable too, or a read-only system file could be
+ * linked into the workspace and modified there.
+ */
+int link(const char *from, const char *to) {
+  CFS_REAL(int, link, const char *, const char *);
+  char from_buf[PATH_MAX];
+  char to_buf[PATH_MAX];
+  const char *mapped_from = cfs_map(AT_FDCWD, from, CFS_WRITE | CFS_NOFOLLOW, from_buf);
+  const char *mapped_to = mapped_from ? cfs_map(AT_FDCWD, to, CFS_WRITE | CFS_NOFOLLOW, to_buf) : NULL;
+  if (!mapped_from || !mapped_to) {
+    return -1;
+  }
+  return real_link(mapped_from, mapped_to);
+}
+
+int linkat(int fromfd, const char *from, int tofd, const char *to, int flag) {
+  CFS_REAL(int, linkat, int, const char *, int, const char *, int);
+  char from_buf[PATH_MAX];
+  char to_buf[PATH_MAX];
+  int from_flags = (flag & AT_SYMLINK_FOLLOW) ? CFS_WRITE : CFS_WRITE | CFS_NOFOLLOW;
+  const char *mapped_from = cfs_map(fromfd, from, from_flags, from_buf);
+  const char *mapped_to = mapped_from ? cfs_map(tofd, to, CFS_WRITE | CFS_NOFOLLOW, to_buf) : NULL;
+  if (!mapped_from || !mapped_to) {
+    return -1;
+  }
+  return real_linkat(fromfd, mapped_from, tofd, mapped_to, flag);
+}
+
+int chmod(const char *path, mode_t mode) {
+  CFS_REAL(int, chmod, const char *, mode_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_chmod(mapped, mode);
+}
+
+int fchmodat(int dirfd, const char *path, mode_t mode, int flag) {
+  CFS_REAL(int, fchmodat, int, const char *, mode_t, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_WRITE | CFS_NOFOLLOW : CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_fchmodat(dirfd, mapped, mode, flag);
+}
+
+int chown(const char *path, uid_t owner, gid_t group) {
+  CFS_REAL(int, chown, const char *, uid_t, gid_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_chown(mapped, owner, group);
+}
+
+int lchown(const char *path, uid_t owner, gid_t group) {
+  CFS_REAL(int, lchown, const char *, uid_t, gid_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_lchown(mapped, owner, group);
+}
+
+int fchownat(int dirfd, const char *path, uid_t owner, gid_t group, int flag) {
+  CFS_REAL(int, fchownat, int, const char *, uid_t, gid_t, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_WRITE | CFS_NOFOLLOW : CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_fchownat(dirfd, mapped, owner, group, flag);
+}
+
+int truncate(const char *path, off_t length) {
+  CFS_REAL(int, truncate, const char *, off_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_truncate(mapped, length);
+}
+
+int truncate64(const char *path, off64_t length) {
+  CFS_REAL(int, truncate64, const char *, off64_t);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_truncate64(mapped, length);
+}
+
+int utimensat(int dirfd, const char *path, const struct timespec times[2], int flag) {
+  CFS_REAL(int, utimensat, int, const char *, const struct timespec *, int);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, (flag & AT_SYMLINK_NOFOLLOW) ? CFS_WRITE | CFS_NOFOLLOW : CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_utimensat(dirfd, mapped, times, flag);
+}
+
+int utimes(const char *path, const struct timeval times[2]) {
+  CFS_REAL(int, utimes, const char *, const struct timeval *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_utimes(mapped, times);
+}
+
+int lutimes(const char *path, const struct timeval times[2]) {
+  CFS_REAL(int, lutimes, const char *, const struct timeval *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE | CFS_NOFOLLOW, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_lutimes(mapped, times);
+}
+
+int utime(const char *path, const struct utimbuf *times) {
+  CFS_REAL(int, utime, const char *, const struct utimbuf *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_WRITE, buf);
+  if (!mapped) {
+    return -1;
+  }
+  return real_utime(mapped, times);
+}
+
+/* Replaces ESCAPE_PATTERNS' `cd` check: `cd /` lands in the workspace root */
+int chdir(const char *path) {
+  CFS_REAL(int, chdir, const char *);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  if (cfs_enabled && !cfs_within_root(mapped)) {
+    /* System directories are readable, but not a place to work from */
+    errno = EACCES;
+    return -1;
+  }
+  return real_chdir(mapped);
+}
+
+/* ────────────────────────────────────────────────────────────────────── */
+/* exec family                                                            */
+/* ────────────────────────────────────────────────────────────────────── */
+
+static int cfs_env_is(const char *entry, const char *name) {
+  size_t len = strlen(name);
+  return strncmp(entry, name, len) == 0 && entry[len] == '=';
+}
+
+/*
+ * Build the environment for an exec: the caller's, with LD_PRELOAD, the
+ * workspace root and both prefix lists replaced by the values frozen at init,
+ * so neither `env -i` nor `VAR=... cmd` can change a child's confinement.
+ * `out` must have room for count(envp) + 5 entries.
+ */
+static char *const *cfs_confined_env(char *const envp[], char **out) {
+  size_t n = 0;
+
+  for (size_t i = 0; envp && envp[i]; i++) {
+    if (cfs_env_is(envp[i], "LD_PRELOAD") || cfs_env_is(envp[i], CFS_ROOT_ENV) ||
+        cfs_env_is(envp[i], CFS_READONLY_ENV) || cfs_env_is(envp[i], CFS_WRITABLE_ENV)) {
+      continue;
+    }
+    out[n++] = envp[i];
+  }
+  if (cfs_env_preload[0]) {
+    out[n++] = cfs_env_preload;
+  }
+  out[n++] = cfs_env_root;
+  out[n++] = cfs_env_readonly;
+  out[n++] = cfs_env_writable;
+  out[n] = NULL;
+  return out;
+}
+
+static size_t cfs_env_count(char *const envp[]) {
+  size_t n = 0;
+  while (envp && envp[n]) {
+    n++;
+  }
+  return n;
+}
+
+int execve(const char *path, char *const argv[], char *const envp[]) {
+  CFS_REAL(int, execve, const char *, char *const[], char *const[]);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  if (!cfs_enabled) {
+    return real_execve(mapped, argv, envp);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_execve(mapped, argv, cfs_confined_env(envp, env_out));
+}
+
+/* execv/execvp/execvpe call libc's internal __execve, bypassing the hook above */
+int execvpe(const char *file, char *const argv[], char *const envp[]) {
+  CFS_REAL(int, execvpe, const char *, char *const[], char *const[]);
+  char buf[PATH_MAX];
+  const char *mapped = file;
+
+  /* Bare names are looked up in PATH; only explicit paths need mapping */
+  if (strchr(file, '/')) {
+    mapped = cfs_map(AT_FDCWD, file, CFS_READ, buf);
+    if (!mapped) {
+      return -1;
+    }
+  }
+  if (!cfs_enabled) {
+    return real_execvpe(mapped, argv, envp);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_execvpe(mapped, argv, cfs_confined_env(envp, env_out));
+}
+
+int execvp(const char *file, char *const argv[]) {
+  return execvpe(file, argv, environ);
+}
+
+int execv(const char *path, char *const argv[]) {
+  return execve(path, argv, environ);
+}
+
+int fexecve(int fd, char *const argv[], char *const envp[]) {
+  CFS_REAL(int, fexecve, int, char *const[], char *const[]);
+  if (!cfs_enabled) {
+    return real_fexecve(fd, argv, envp);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_fexecve(fd, argv, cfs_confined_env(envp, env_out));
+}
+
+/* Only declared by glibc 2.34 and later; older ones have no execveat() to forward to */
+int execveat(int dirfd, const char *path, char *const argv[], char *const envp[], int flags) {
+  CFS_REAL(int, execveat, int, const char *, char *const[], char *const[], int);
+  if (!real_execveat) {
+    errno = ENOSYS;
+    return -1;
+  }
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(dirfd, path, CFS_READ, buf);
+  if (!mapped) {
+    return -1;
+  }
+  if (!cfs_enabled) {
+    return real_execveat(dirfd, mapped, argv, envp, flags);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_execveat(dirfd, mapped, argv, cfs_confined_env(envp, env_out), flags);
+}
+
+/*
+ * Collect the NULL-terminated arguments of the execl family into `argv`.
+ * Leaves `ap` positioned after the terminator (where execle's envp is), so
+ * the caller must va_end(ap).
+ */
+#define CFS_EXECL_ARGS(arg, ap, argv)                    \
+  size_t argc_ = 0;                                      \
+  va_start(ap, arg);                                     \
+  for (const char *a_ = arg; a_; a_ = va_arg(ap, const char *)) { \
+    argc_++;                                             \
+  }                                                      \
+  va_end(ap);                                            \
+  char *argv[argc_ + 1];                                 \
+  argv[0] = (char *)arg;                                 \
+  va_start(ap, arg);                                     \
+  for (size_t i_ = 1; i_ <= argc_; i_++) {               \
+    argv[i_] = va_arg(ap, char *);                       \
+  }
+
+/* glibc's execl family calls its internal __execve, bypassing the hooks above */
+int execl(const char *path, const char *arg, ...) {
+  va_list ap;
+  CFS_EXECL_ARGS(arg, ap, argv);
+  va_end(ap);
+  return execve(path, argv, environ);
+}
+
+int execlp(const char *file, const char *arg, ...) {
+  va_list ap;
+  CFS_EXECL_ARGS(arg, ap, argv);
+  va_end(ap);
+  return execvpe(file, argv, environ);
+}
+
+int execle(const char *path, const char *arg, ...) {
+  va_list ap;
+  CFS_EXECL_ARGS(arg, ap, argv);
+  char *const *envp = va_arg(ap, char *const *);
+  va_end(ap);
+  return execve(path, argv, envp);
+}
+
+int posix_spawn(pid_t *pid, const char *path, const posix_spawn_file_actions_t *actions,
+                const posix_spawnattr_t *attr, char *const argv[], char *const envp[]) {
+  CFS_REAL(int, posix_spawn, pid_t *, const char *, const posix_spawn_file_actions_t *,
+           const posix_spawnattr_t *, char *const[], char *const[]);
+  char buf[PATH_MAX];
+  const char *mapped = cfs_map(AT_FDCWD, path, CFS_READ, buf);
+  if (!mapped) {
+    /* posix_spawn reports errors as its return value */
+    return errno;
+  }
+  if (!cfs_enabled) {
+    return real_posix_spawn(pid, mapped, actions, attr, argv, envp);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_posix_spawn(pid, mapped, actions, attr, argv, cfs_confined_env(envp, env_out));
+}
+
+int posix_spawnp(pid_t *pid, const char *file, const posix_spawn_file_actions_t *actions,
+                 const posix_spawnattr_t *attr, char *const argv[], char *const envp[]) {
+  CFS_REAL(int, posix_spawnp, pid_t *, const char *, const posix_spawn_file_actions_t *,
+           const posix_spawnattr_t *, char *const[], char *const[]);
+  char buf[PATH_MAX];
+  const char *mapped = file;
+
+  /* Bare names are looked up in PATH; only explicit paths need mapping */
+  if (strchr(file, '/')) {
+    mapped = cfs_map(AT_FDCWD, file, CFS_READ, buf);
+    if (!mapped) {
+      return errno;
+    }
+  }
+  if (!cfs_enabled) {
+    return real_posix_spawnp(pid, mapped, actions, attr, argv, envp);
+  }
+
+  char *env_out[cfs_env_count(envp) + 5];
+  return real_posix_spawnp(pid, mapped, actions, attr, argv, cfs_confined_env(envp, env_out));
+}
+
+/*
+ * system() and popen() spawn through glibc's internal __posix_spawn with the
+ * process environment, which no hook sees. Put the frozen values back into
+ * that environment first; this process is confined already, so they change
+ * nothing for it.
+ */
+static void cfs_confine_environ(void) {
+  if (!cfs_enabled) {
+    return;
+  }
+  if (cfs_env_preload[0]) {
+    putenv(cfs_env_preload);
+  }
+  putenv(cfs_env_root);
+  putenv(cfs_env_readonly);
+  putenv(cfs_env_writable);
+}
+
+int system(const char *command) {
+  CFS_REAL(int, system, const char *);
+  cfs_confine_environ();
+  return real_system(command);
+}
+
+FILE *popen(const char *command, const char *type) {
+  CFS_REAL(FILE *, popen, const char *, const char *);
+  cfs_confine_environ();
+  return real_popen(command, type);
+}
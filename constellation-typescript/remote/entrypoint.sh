@@ -13,6 +13,10 @@ STORAGE_TYPE="${STORAGE_TYPE:-local}"
 # MCP server configuration
 MCP_PORT="${MCP_PORT:-3001}"
 MCP_AUTH_TOKEN="${MCP_AUTH_TOKEN:-}"
+# Set to "true" to serve latency metrics on /metrics
+MCP_METRICS="${MCP_METRICS:-false}"
+# Open MCP sessions before new ones are refused with 503
+MCP_MAX_SESSIONS="${MCP_MAX_SESSIONS:-1000}"
 
 # Configure SSH users from environment
 MCP_USER="root"
@@ -98,23 +102,44 @@ if [ "$ENABLE_LOGGING" = "true" ]; then
   sed -i 's/#LogLevel INFO/LogLevel VERBOSE/' /etc/ssh/sshd_config
 fi
 
+# Start the remote agent daemon for root and each SSH user. RemoteBackend
+# reaches it over a forwarded unix socket, so metadata calls don't need an
+# exec channel (and a shell fork) each. Sockets are 0600, owned by the user.
+AGENT_SOCKET_DIR="/run/constellationfs"
+mkdir -p "$AGENT_SOCKET_DIR"
+chmod 1777 "$AGENT_SOCKET_DIR"
+
+echo "🛰️  Starting remote agent..."
+constellationfs agent --socket "$AGENT_SOCKET_DIR/root.sock" &
+if [ -n "$SSH_USERS" ]; then
+  for user_config in "${USERS[@]}"; do
+    IFS=':' read -ra USER <<< "$user_config"
+    su - "${USER[0]}" -c "constellationfs agent --socket $AGENT_SOCKET_DIR/${USER[0]}.sock" &
+  done
+fi
+
 # Start MCP server if auth token is provided
 if [ -n "$MCP_AUTH_TOKEN" ]; then
   echo "🔌 Starting MCP server on port $MCP_PORT..."
 
+  MCP_EXTRA_ARGS="--maxSessions $MCP_MAX_SESSIONS"
+  if [ "$MCP_METRICS" = "true" ]; then
+    MCP_EXTRA_ARGS="$MCP_EXTRA_ARGS --metrics"
+  fi
+
   # Start MCP server in background
   if [ "$MCP_USER" != "root" ]; then
     su - "$MCP_USER" -c "npx constellationfs mcp-server \
       --workspaceRoot $WORKSPACE_ROOT \
       --http \
       --port $MCP_PORT \
-      --authToken $MCP_AUTH_TOKEN" &
+      --authToken $MCP_AUTH_TOKEN $MCP_EXTRA_ARGS" &
   else
     npx constellationfs mcp-server \
       --workspaceRoot "$WORKSPACE_ROOT" \
       --http \
       --port "$MCP_PORT" \
-      --authToken "$MCP_AUTH_TOKEN" &
+      --authToken "$MCP_AUTH_TOKEN" $MCP_EXTRA_ARGS &
   fi
 
   MCP_PID=$!
@@ -1,10 +1,8 @@
 import type { Client } from '@modelcontextprotocol/sdk/client/index.js'
-import { StdioClientTransport } from '@modelcontextprotocol/sdk/client/stdio.js'
-import type { StreamableHTTPClientTransport } from '@modelcontextprotocol/sdk/client/streamableHttp.js'
+import type { Transport } from '@modelcontextprotocol/sdk/shared/transport.js'
 import { BackendFactory } from './backends/index.js'
 import { ConstellationFS } from './config/Config.js'
-import { createConstellationMCPClient, createConstellationMCPTransport } from './mcp/client.js'
-import { createLocalConstellationMCPClient, createLocalConstellationMCPTransportOptions } from './mcp/local-client.js'
+import { DeferredTransport } from './mcp/deferredTransport.js'
 import type { BackendConfig, FileSystemBackend, LocalBackendConfig, RemoteBackendConfig } from './types.js'
 import { getLogger } from './utils/logger.js'
 import type { Workspace, WorkspaceConfig } from './workspace/Workspace.js'
@@ -126,6 +124,40 @@ export class FileSystem {
     return this.backend.listWorkspaces()
   }
 
+  /**
+   * Create a workspace as a copy of another one, typically a template that
+   * already has dependencies installed
+   * Files are reflinked (copy-on-write) where the filesystem supports it,
+   * which makes the copy near-instant and lets it share disk blocks with the
+   * source until either side changes them. Elsewhere files are copied.
+   * @param sourceName - Existing workspace to copy
+   * @param targetName - Name of the new workspace; must not exist yet
+   * @param config - Optional configuration for the returned workspace
+   * @returns Promise resolving to the new workspace
+   * @throws {FileSystemError} When the source is missing or the target already exists
+   *
+   * @example
+   * ```typescript
+   * const template = await fs.getWorkspace('template')
+   * await template.exec('git clone https://github.com/acme/app . && pnpm install')
+   *
+   * // Every session then starts from the prepared tree
+   * const workspace = await fs.cloneWorkspace('template', `session-${sessionId}`)
+   * ```
+   */
+  async cloneWorkspace(sourceName: string, targetName: string, config?: WorkspaceConfig): Promise<Workspace> {
+    return this.backend.cloneWorkspace(sourceName, targetName, config)
+  }
+
+  /**
+   * Establish backend connections ahead of the first operation
+   * For remote backends this opens the SSH connection, the agent channel and
+   * an SFTP session; for local backends it does nothing.
+   */
+  async warmUp(): Promise<void> {
+    await this.backend.warmUp()
+  }
+
   get isRemote(): boolean {
     return this.backendConfig.type === 'remote'
   }
@@ -182,7 +214,9 @@ export class FileSystem {
    */
   async getMCPClient(workspace: string): Promise<Client> {
     try {
+      // The MCP SDK client is loaded on first use, not with the library
       if (this.backendConfig.type === 'local') {
+        const { createLocalConstellationMCPClient } = await import('./mcp/local-client.js')
         return await createLocalConstellationMCPClient({
           userId: this.userId,
           workspace,
@@ -197,6 +231,7 @@ export class FileSystem {
 
       const mcpPort = remoteConfig.mcpPort ?? 3001
 
+      const { createConstellationMCPClient } = await import('./mcp/client.js')
       return await createConstellationMCPClient({
         url: `http://${remoteConfig.host}:${mcpPort}`,
         authToken: remoteConfig.mcpAuth.token,
@@ -217,8 +252,10 @@ export class FileSystem {
    * Get an MCP transport for this filesystem.
    * Use this with Vercel AI SDK's createMCPClient or similar.
    *
-   * For local backends: Returns StdioClientTransport (spawns MCP server as child process).
-   * For remote backends: Returns StreamableHTTPClientTransport (connects via HTTP).
+   * For local backends: Spawns the MCP server as a child process over stdio.
+   * For remote backends: Connects to the remote MCP server via HTTP.
+   * The underlying SDK transport is loaded and created when the transport is
+   * started, so the SDK client isn't loaded until then.
    *
    * @param workspace - Workspace name to scope MCP operations to
    * @returns MCP Transport instance compatible with @modelcontextprotocol/sdk
@@ -243,13 +280,16 @@ export class FileSystem {
    * await mcpClient.close()
    * ```
    */
-  getMCPTransport(workspace: string): StdioClientTransport | StreamableHTTPClientTransport {
+  getMCPTransport(workspace: string): Transport {
     if (this.backendConfig.type === 'local') {
-      const options = createLocalConstellationMCPTransportOptions({
-        userId: this.userId,
-        workspace,
+      const userId = this.userId
+      return new DeferredTransport(async () => {
+        const [{ StdioClientTransport }, { createLocalConstellationMCPTransportOptions }] = await Promise.all([
+          import('@modelcontextprotocol/sdk/client/stdio.js'),
+          import('./mcp/local-client.js'),
+        ])
+        return new StdioClientTransport(createLocalConstellationMCPTransportOptions({ userId, workspace }))
       })
-      return new StdioClientTransport(options)
     }
 
     // Remote backend
@@ -259,13 +299,17 @@ export class FileSystem {
     }
 
     const mcpPort = remoteConfig.mcpPort ?? 3001
-
-    return createConstellationMCPTransport({
+    const options = {
       url: `http://${remoteConfig.host}:${mcpPort}`,
       authToken: remoteConfig.mcpAuth.token,
       workspaceRoot: ConstellationFS.getWorkspaceRoot(),
       userId: this.userId,
       workspace,
+    }
+
+    return new DeferredTransport(async () => {
+      const { createConstellationMCPTransport } = await import('./mcp/client.js')
+      return createConstellationMCPTransport(options)
     })
   }
 
@@ -1,6 +1,7 @@
-import type { FileSystem } from './FileSystem.js'
+import { FileSystem } from './FileSystem.js'
 import type { Workspace, WorkspaceConfig } from './workspace/Workspace.js'
 import { getLogger } from './utils/logger.js'
+import { incrementCounter, recordDuration, startTimer } from './utils/metrics.js'
 import type { BackendConfig } from './types.js'
 import { BackendFactory } from './backends/BackendFactory.js'
 
@@ -101,6 +102,10 @@ export interface PoolStats {
   idleFileSystems: number
   totalActiveReferences: number
   userIds: string[]
+  /** Configured capacity (Infinity when unbounded) */
+  maxFileSystems: number
+  /** Idle filesystems destroyed to stay within maxFileSystems since the pool started */
+  evictions: number
 }
 
 /**
@@ -125,6 +130,23 @@ export interface PoolManagerConfig {
    */
   enablePeriodicCleanup?: boolean
 
+  /**
+   * Maximum number of pooled filesystems. When a new user would exceed it,
+   * the least recently released idle filesystem is destroyed first. Users
+   * with active references are never evicted, so the pool can briefly go
+   * over capacity when every entry is in use; it shrinks back as they are
+   * released.
+   * Default: unbounded
+   */
+  maxFileSystems?: number
+
+  /**
+   * Filesystems connected or torn down in parallel by prewarm(),
+   * cleanupIdle() and destroyAll()
+   * Default: 16
+   */
+  lifecycleConcurrency?: number
+
   /**
    * Default backend configuration to use if not provided in acquire options
    * Defaults to local backend
@@ -147,6 +169,24 @@ export interface PoolManagerConfig {
 
 const DEFAULT_IDLE_TIMEOUT_MS = 5 * 60 * 1000 // 5 minutes
 const DEFAULT_CLEANUP_INTERVAL_MS = 60 * 1000 // 1 minute
+const DEFAULT_LIFECYCLE_CONCURRENCY = 16
+
+/** Labels of the pool acquire metric */
+const POOL_HIT = { result: 'hit' } as const
+const POOL_MISS = { result: 'miss' } as const
+
+/**
+ * Run `task` for every item with at most `concurrency` in flight
+ */
+async function forEachLimited<T>(items: readonly T[], concurrency: number, task: (item: T) => Promise<void>): Promise<void> {
+  let next = 0
+  const worker = async () => {
+    while (next < items.length) {
+      await task(items[next++]!)
+    }
+  }
+  await Promise.all(Array.from({ length: Math.min(concurrency, items.length) }, worker))
+}
 
 /**
  * FileSystemPoolManager - Centralized management of FileSystem instances
@@ -155,6 +195,12 @@ const DEFAULT_CLEANUP_INTERVAL_MS = 60 * 1000 // 1 minute
  * - One connection per user (not per operation) - reduces overhead for remote backends
  * - Proper resource cleanup when filesystems are idle
  * - Reference counting for safe lifecycle management
+ * - An optional capacity, enforced by evicting the least recently used idle filesystem
+ *
+ * Filesystems without references are kept in release order, which is both
+ * LRU order and idle-expiry order: eviction takes the first entry, and an
+ * idle sweep stops at the first entry that has not expired yet, so neither
+ * scans the whole pool.
  *
  * @example
  * ```typescript
@@ -182,7 +228,12 @@ const DEFAULT_CLEANUP_INTERVAL_MS = 60 * 1000 // 1 minute
  */
 export class FileSystemPoolManager {
   private readonly cache = new Map<string, ManagedFileSystem>()
+  /** Entries with no active references, least recently released first */
+  private readonly idle = new Map<string, ManagedFileSystem>()
   private readonly idleTimeoutMs: number
+  private readonly maxFileSystems: number
+  private readonly lifecycleConcurrency: number
+  private evictions = 0
   private readonly cleanupIntervalMs: number
   private cleanupTimer: NodeJS.Timeout | null = null
   private readonly onConnectionCreated?: (userId: string) => void | Promise<void>
@@ -200,6 +251,8 @@ export class FileSystemPoolManager {
   constructor(config: PoolManagerConfig = {}) {
     this.idleTimeoutMs = config.idleTimeoutMs ?? DEFAULT_IDLE_TIMEOUT_MS
     this.cleanupIntervalMs = config.cleanupIntervalMs ?? DEFAULT_CLEANUP_INTERVAL_MS
+    this.maxFileSystems = config.maxFileSystems ?? Infinity
+    this.lifecycleConcurrency = Math.max(1, config.lifecycleConcurrency ?? DEFAULT_LIFECYCLE_CONCURRENCY)
     this.onConnectionCreated = config.onConnectionCreated
     this.onConnectionDestroyed = config.onConnectionDestroyed
     this.defaultBackendConfig = config.defaultBackendConfig ?? { type: 'local' }
@@ -305,6 +358,50 @@ export class FileSystemPoolManager {
     }
   }
 
+  /**
+   * Connect filesystems ahead of time for users expected to be active soon
+   *
+   * Creates pooled filesystems for the users that don't have one and opens
+   * their backend connections (for remote backends: SSH, the agent channel
+   * and an SFTP session), so their first acquire doesn't wait for the
+   * handshake. Warmed filesystems start idle and expire or get evicted like
+   * any other. Prewarming never evicts: users beyond the free capacity are
+   * skipped. Connection failures are logged and retried on first use.
+   *
+   * @param users - Users to warm, with optional backend configuration
+   * @returns Promise resolving to the number of filesystems created
+   */
+  async prewarm(users: AcquireOptions[]): Promise<number> {
+    const created: ManagedFileSystem[] = []
+    for (const { userId, backendConfig } of users) {
+      const cacheKey = this.getCacheKey(userId)
+      if (this.cache.has(cacheKey) || this.cleanupInProgress.has(cacheKey)) continue
+      if (this.cache.size >= this.maxFileSystems) break
+
+      const managed = this.createManagedFileSystem(userId, backendConfig)
+      this.cache.set(cacheKey, managed)
+      this.idle.set(cacheKey, managed)
+      created.push(managed)
+    }
+
+    getLogger().info(`[FileSystemPool] Prewarming ${created.length} filesystem(s)`)
+
+    await forEachLimited(created, this.lifecycleConcurrency, async (managed) => {
+      try {
+        await managed.fs.warmUp()
+      } catch (err) {
+        getLogger().warn(`[FileSystemPool] Prewarm failed for user ${managed.userId}:`, err)
+      }
+      if (this.onConnectionCreated) {
+        Promise.resolve(this.onConnectionCreated(managed.userId)).catch((err) => {
+          getLogger().error(`[FileSystemPool] onConnectionCreated hook failed for user ${managed.userId}:`, err)
+        })
+      }
+    })
+
+    return created.length
+  }
+
   /**
    * Internal method to acquire a filesystem handle from the pool
    *
@@ -320,6 +417,7 @@ export class FileSystemPoolManager {
   private async acquire(options: AcquireOptions): Promise<FileSystemHandle> {
     const { userId, backendConfig } = options
     const cacheKey = this.getCacheKey(userId)
+    const timer = startTimer()
 
     // If cleanup is in progress for this user, wait for it to complete
     const cleanupPromise = this.cleanupInProgress.get(cacheKey)
@@ -332,16 +430,22 @@ export class FileSystemPoolManager {
     let isNewConnection = false
 
     if (!managed) {
+      // Make room before adding, so the pool stays within capacity
+      this.evictIdle(this.maxFileSystems - 1)
+
       // Create new filesystem
       getLogger().info(`[FileSystemPool] Creating new filesystem for user: ${userId}`)
       managed = this.createManagedFileSystem(userId, backendConfig)
       this.cache.set(cacheKey, managed)
       isNewConnection = true
+      incrementCounter('constellation_pool_acquire', POOL_MISS)
     } else {
+      incrementCounter('constellation_pool_acquire', POOL_HIT)
       getLogger().debug(`[FileSystemPool] Reusing existing filesystem for user: ${userId}`)
     }
 
     // Increment reference count and update access time
+    this.idle.delete(cacheKey)
     managed.activeReferences++
     managed.lastAccessTime = Date.now()
 
@@ -358,6 +462,7 @@ export class FileSystemPoolManager {
       })
     }
 
+    recordDuration('constellation_pool_acquire', timer)
     return handle
   }
 
@@ -378,8 +483,6 @@ export class FileSystemPoolManager {
     // Create backend using factory
     const backend = BackendFactory.create(finalConfig)
 
-    // Import FileSystem class and create instance
-    const { FileSystem } = require('./FileSystem.js')
     const fs = new FileSystem(backend)
 
     return {
@@ -403,6 +506,14 @@ export class FileSystemPoolManager {
     managed.activeReferences = Math.max(0, managed.activeReferences - 1)
     managed.lastAccessTime = Date.now()
 
+    if (managed.activeReferences === 0) {
+      // Move to the most recently released end
+      this.idle.delete(cacheKey)
+      this.idle.set(cacheKey, managed)
+      // Shrink back if every entry was busy when the pool last grew
+      this.evictIdle(this.maxFileSystems)
+    }
+
     getLogger().debug(
       `[FileSystemPool] Released reference for ${cacheKey}, remaining: ${managed.activeReferences}`
     )
@@ -444,24 +555,37 @@ export class FileSystemPoolManager {
     const now = Date.now()
     const toRemove: string[] = []
 
-    for (const [key, managed] of this.cache.entries()) {
-      const idleTime = now - managed.lastAccessTime
-      if (managed.activeReferences === 0 && idleTime > this.idleTimeoutMs) {
-        toRemove.push(key)
-      }
+    // Oldest release first, so the first unexpired entry ends the sweep
+    for (const [key, managed] of this.idle) {
+      if (now - managed.lastAccessTime <= this.idleTimeoutMs) break
+      toRemove.push(key)
     }
 
     if (toRemove.length > 0) {
       getLogger().info(`[FileSystemPool] Cleaning up ${toRemove.length} idle filesystem(s)`)
     }
 
-    for (const key of toRemove) {
-      await this.destroyFileSystem(key)
-    }
+    await forEachLimited(toRemove, this.lifecycleConcurrency, (key) => this.destroyFileSystem(key))
 
     return toRemove.length
   }
 
+  /**
+   * Destroy least recently released idle filesystems until at most `limit` remain pooled
+   * Teardown runs in the background; acquire() for an evicted user waits for it.
+   */
+  private evictIdle(limit: number): void {
+    while (this.cache.size > limit && this.idle.size > 0) {
+      const key = this.idle.keys().next().value!
+      getLogger().debug(`[FileSystemPool] Evicting idle filesystem to stay within capacity: ${key}`)
+      this.evictions++
+      incrementCounter('constellation_pool_evictions')
+      this.destroyFileSystem(key).catch((err) => {
+        getLogger().error(`[FileSystemPool] Error evicting filesystem ${key}:`, err)
+      })
+    }
+  }
+
   /**
    * Destroy a specific filesystem
    */
@@ -475,6 +599,7 @@ export class FileSystemPoolManager {
     // This ensures that any cleanup operations use the existing filesystem
     // rather than creating new entries in the cache.
     this.cache.delete(cacheKey)
+    this.idle.delete(cacheKey)
 
     // Create a promise to track cleanup progress. This allows acquire() to wait
     // for cleanup to complete before creating a new filesystem for this user.
@@ -530,9 +655,9 @@ export class FileSystemPoolManager {
     const keys = Array.from(this.cache.keys())
     getLogger().info(`[FileSystemPool] Destroying all ${keys.length} filesystem(s)`)
 
-    for (const key of keys) {
-      await this.destroyFileSystem(key)
-    }
+    await forEachLimited(keys, this.lifecycleConcurrency, (key) => this.destroyFileSystem(key))
+    // Evictions still running in the background
+    await Promise.all(this.cleanupInProgress.values())
   }
 
   /**
@@ -540,25 +665,22 @@ export class FileSystemPoolManager {
    */
   getStats(): PoolStats {
     let totalActiveReferences = 0
-    let activeFileSystems = 0
+    // Entries are keyed by user, so every userId appears once
     const userIds: string[] = []
 
     for (const managed of this.cache.values()) {
       totalActiveReferences += managed.activeReferences
-      if (managed.activeReferences > 0) {
-        activeFileSystems++
-      }
-      if (!userIds.includes(managed.userId)) {
-        userIds.push(managed.userId)
-      }
+      userIds.push(managed.userId)
     }
 
     return {
       totalFileSystems: this.cache.size,
-      activeFileSystems,
-      idleFileSystems: this.cache.size - activeFileSystems,
+      activeFileSystems: this.cache.size - this.idle.size,
+      idleFileSystems: this.idle.size,
       totalActiveReferences,
       userIds,
+      maxFileSystems: this.maxFileSystems,
+      evictions: this.evictions,
     }
   }
 
@@ -35,6 +35,7 @@ function createMockFileSystem(userId: string): FileSystem & {
   _isDestroyed: boolean
   _workspaces: Map<string, MockWorkspace>
   _execCalls: string[]
+  _warmedUp: boolean
 } {
   const workspaces = new Map<string, MockWorkspace>()
   const execCalls: string[] = []
@@ -44,6 +45,7 @@ function createMockFileSystem(userId: string): FileSystem & {
     _isDestroyed: isDestroyed,
     _workspaces: workspaces,
     _execCalls: execCalls,
+    _warmedUp: false,
 
     async getWorkspace(workspaceName: string, _config?: WorkspaceConfig): Promise<Workspace> {
       if (isDestroyed) {
@@ -75,6 +77,10 @@ function createMockFileSystem(userId: string): FileSystem & {
       return workspace as unknown as Workspace
     },
 
+    async warmUp(): Promise<void> {
+      mockFs._warmedUp = true
+    },
+
     async destroy(): Promise<void> {
       isDestroyed = true
       mockFs._isDestroyed = true
@@ -102,6 +108,7 @@ function createMockFileSystem(userId: string): FileSystem & {
     _isDestroyed: boolean
     _workspaces: Map<string, MockWorkspace>
     _execCalls: string[]
+    _warmedUp: boolean
   }
 }
 
@@ -693,6 +700,84 @@ describe('FileSystemPoolManager', () => {
     })
   })
 
+  describe('Capacity', () => {
+    let bounded: FileSystemPoolManager
+
+    beforeEach(() => {
+      bounded = new FileSystemPoolManager({
+        idleTimeoutMs: 100,
+        enablePeriodicCleanup: false,
+        maxFileSystems: 2,
+      })
+      ;(bounded as any).createManagedFileSystem = (userId: string) => {
+        const mockFs = createMockFileSystem(userId)
+        mockFileSystems.set(userId, mockFs)
+        return { fs: mockFs, userId, activeReferences: 0, lastAccessTime: Date.now() }
+      }
+    })
+
+    afterEach(async () => {
+      await bounded.destroyAll()
+    })
+
+    it('should evict the least recently released idle filesystem when full', async () => {
+      const a = await bounded.acquireFileSystem({ userId: 'user-a' })
+      const b = await bounded.acquireFileSystem({ userId: 'user-b' })
+      a.release()
+      b.release()
+
+      // user-a was released first, so it goes
+      const c = await bounded.acquireFileSystem({ userId: 'user-c' })
+
+      expect(bounded.hasFileSystem('user-a')).toBe(false)
+      expect(bounded.hasFileSystem('user-b')).toBe(true)
+      expect(bounded.getStats()).toMatchObject({ totalFileSystems: 2, maxFileSystems: 2, evictions: 1 })
+      await vi.waitFor(() => expect(mockFileSystems.get('user-a')!._isDestroyed).toBe(true))
+      c.release()
+    })
+
+    it('should never evict filesystems in use, and shrink once they are released', async () => {
+      const handles = await Promise.all(['user-a', 'user-b', 'user-c'].map((userId) => bounded.acquireFileSystem({ userId })))
+      expect(bounded.getStats().totalFileSystems).toBe(3)
+
+      handles[1]!.release()
+      expect(bounded.hasFileSystem('user-b')).toBe(false)
+      expect(bounded.getStats().totalFileSystems).toBe(2)
+
+      handles[0]!.release()
+      handles[2]!.release()
+      expect(bounded.getStats().idleFileSystems).toBe(2)
+    })
+
+    it('should only sweep expired entries, oldest first', async () => {
+      const a = await bounded.acquireFileSystem({ userId: 'user-a' })
+      a.release()
+      await new Promise((resolve) => setTimeout(resolve, 150))
+      const b = await bounded.acquireFileSystem({ userId: 'user-b' })
+      b.release()
+
+      expect(await bounded.cleanupIdle()).toBe(1)
+      expect(bounded.getStats().userIds).toEqual(['user-b'])
+    })
+
+    it('should prewarm users into free capacity without evicting', async () => {
+      const a = await bounded.acquireFileSystem({ userId: 'user-a' })
+
+      const created = await bounded.prewarm([{ userId: 'user-a' }, { userId: 'user-b' }, { userId: 'user-c' }])
+
+      expect(created).toBe(1)
+      expect(mockFileSystems.get('user-b')!._warmedUp).toBe(true)
+      expect(bounded.hasFileSystem('user-c')).toBe(false)
+      expect(bounded.getStats()).toMatchObject({ activeFileSystems: 1, idleFileSystems: 1 })
+
+      // A warmed filesystem is handed out as-is
+      const b = await bounded.acquireFileSystem({ userId: 'user-b' })
+      expect(b.fileSystem).toBe(mockFileSystems.get('user-b'))
+      a.release()
+      b.release()
+    })
+  })
+
   describe('Force Destroy', () => {
     it('should force destroy filesystem for specific user', async () => {
       const { release: release1 } = await pool.acquireFileSystem({ userId: 'user-1' })
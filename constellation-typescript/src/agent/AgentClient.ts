@@ -0,0 +1,246 @@
+import { clearTimeout, setTimeout } from 'node:timers'
+import type { Duplex } from 'stream'
+import { getLogger } from '../utils/logger.js'
+import { recordDuration, startTimer } from '../utils/metrics.js'
+import { COMPRESS_MIN_BYTES, decodeBody, encodeBody, type AgentCompression } from './compression.js'
+import {
+  AgentError,
+  encodeFrame,
+  FRAME_TYPES,
+  FrameDecoder,
+  type AgentErrorPayload
+} from './protocol.js'
+
+/** Largest request id before wrapping (ids are u32 on the wire) */
+const MAX_REQUEST_ID = 0xffffffff
+
+export interface AgentClientOptions {
+  /** Per-request timeout in milliseconds */
+  timeoutMs: number
+}
+
+export interface AgentResponse<T> {
+  result: T
+  body?: Buffer
+}
+
+interface PendingRequest {
+  resolve: (response: AgentResponse<unknown>) => void
+  reject: (error: Error) => void
+  timeout: ReturnType<typeof setTimeout>
+  op: string
+  /** startTimer() value, 0 when metrics are disabled */
+  started: number
+}
+
+/**
+ * Client side of the remote agent protocol
+ * Multiplexes any number of concurrent requests over a single stream,
+ * matching responses to requests by id.
+ */
+export class AgentClient {
+  private readonly decoder = new FrameDecoder()
+  private readonly pending = new Map<number, PendingRequest>()
+  private nextId = 1
+  private closedError: Error | null = null
+  private readonly closeListeners = new Set<(error: Error) => void>()
+  private readonly eventListeners = new Map<number, (payload: unknown) => void>()
+  private compressionCodec: AgentCompression | null = null
+
+  constructor(
+    private readonly stream: Duplex,
+    private readonly options: AgentClientOptions
+  ) {
+    stream.on('data', (chunk: Buffer) => this.handleData(chunk))
+    stream.on('error', (error: Error) => this.shutdown(new AgentError(`Agent channel error: ${error.message}`, 'ECONNRESET')))
+    stream.on('close', () => this.shutdown(new AgentError('Agent channel closed', 'ECONNRESET')))
+    stream.on('end', () => this.shutdown(new AgentError('Agent channel ended', 'ECONNRESET')))
+  }
+
+  /** Whether the underlying channel has closed */
+  get closed(): boolean {
+    return this.closedError !== null
+  }
+
+  /** Body codec in use, null when bodies travel uncompressed */
+  get compression(): AgentCompression | null {
+    return this.compressionCodec
+  }
+
+  /**
+   * Compress request bodies and accept compressed responses from now on
+   * Call with the codec the agent chose in its 'hello' reply.
+   */
+  enableCompression(codec: AgentCompression): void {
+    this.compressionCodec = codec
+  }
+
+  /** Number of requests awaiting a response */
+  get inFlight(): number {
+    return this.pending.size
+  }
+
+  /**
+   * Register a callback for when the channel closes
+   * @returns A function that removes the listener
+   */
+  onClose(listener: (error: Error) => void): () => void {
+    this.closeListeners.add(listener)
+    return () => {
+      this.closeListeners.delete(listener)
+    }
+  }
+
+  /**
+   * Receive the EVENT frames of a subscription (e.g. one started by 'watch')
+   * Events that arrive before the listener is registered are dropped.
+   * @returns A function that removes the listener
+   */
+  onEvent(subscription: number, listener: (payload: unknown) => void): () => void {
+    this.eventListeners.set(subscription, listener)
+    return () => {
+      if (this.eventListeners.get(subscription) === listener) {
+        this.eventListeners.delete(subscription)
+      }
+    }
+  }
+
+  /**
+   * Send a request and wait for its response
+   * @param op - Operation name
+   * @param args - JSON arguments
+   * @param body - Optional binary payload (file contents)
+   * @throws {AgentError} With the remote errno code when the operation fails
+   */
+  call<T = unknown>(op: string, args: Record<string, unknown> = {}, body?: Buffer): Promise<AgentResponse<T>> {
+    if (this.closedError) {
+      return Promise.reject(this.closedError)
+    }
+
+    const id = this.allocateId()
+
+    return new Promise<AgentResponse<T>>((resolve, reject) => {
+      const timeout = setTimeout(() => {
+        if (this.pending.delete(id)) {
+          reject(new AgentError(`Agent request '${op}' timed out after ${this.options.timeoutMs}ms`, 'ETIMEDOUT'))
+        }
+      }, this.options.timeoutMs)
+
+      this.pending.set(id, {
+        resolve: resolve as (response: AgentResponse<unknown>) => void,
+        reject,
+        timeout,
+        op,
+        started: startTimer(),
+      })
+
+      const fail = (error: Error) => {
+        clearTimeout(timeout)
+        if (this.pending.delete(id)) reject(error)
+      }
+      const send = (frameBody: Buffer | undefined, compressed: boolean) => {
+        // Timed out or closed while the body was being compressed
+        if (!this.pending.has(id)) return
+        try {
+          this.stream.write(encodeFrame({ id, type: FRAME_TYPES.REQUEST, payload: { op, args }, body: frameBody, compressed }))
+        } catch (error) {
+          fail(error as Error)
+        }
+      }
+
+      if (body && this.compressionCodec && body.length >= COMPRESS_MIN_BYTES) {
+        encodeBody(body, this.compressionCodec).then(encoded => send(encoded.body, encoded.compressed), fail)
+      } else {
+        send(body, false)
+      }
+    })
+  }
+
+  /**
+   * Send a request and return only its JSON result
+   */
+  async request<T = unknown>(op: string, args: Record<string, unknown> = {}, body?: Buffer): Promise<T> {
+    return (await this.call<T>(op, args, body)).result
+  }
+
+  /**
+   * Close the channel, rejecting anything still in flight
+   */
+  close(): void {
+    this.shutdown(new AgentError('Agent client closed', 'ECONNRESET'))
+    try {
+      this.stream.end()
+    } catch {
+      // Ignore errors when ending an already broken channel
+    }
+  }
+
+  private allocateId(): number {
+    // Skip ids that are still pending after a wrap-around
+    for (;;) {
+      const id = this.nextId
+      this.nextId = this.nextId >= MAX_REQUEST_ID ? 1 : this.nextId + 1
+      if (!this.pending.has(id)) return id
+    }
+  }
+
+  private handleData(chunk: Buffer): void {
+    let frames
+    try {
+      frames = this.decoder.push(chunk)
+    } catch (error) {
+      getLogger().error('[Agent] Protocol error from agent, closing channel', error)
+      this.close()
+      return
+    }
+
+    for (const frame of frames) {
+      if (frame.type === FRAME_TYPES.EVENT) {
+        this.eventListeners.get(frame.id)?.(frame.payload)
+        continue
+      }
+
+      const pending = this.pending.get(frame.id)
+      if (!pending) continue
+
+      this.pending.delete(frame.id)
+      clearTimeout(pending.timeout)
+      if (pending.started) {
+        recordDuration('constellation_agent_request', pending.started, { op: pending.op })
+      }
+
+      if (frame.type === FRAME_TYPES.ERROR) {
+        const payload = frame.payload as AgentErrorPayload
+        pending.reject(new AgentError(payload?.message ?? `Agent operation '${pending.op}' failed`, payload?.code))
+      } else if (frame.body && frame.compressed) {
+        if (!this.compressionCodec) {
+          pending.reject(new AgentError('Compressed response body without a negotiated codec', 'EPROTO'))
+          continue
+        }
+        decodeBody(frame.body, this.compressionCodec).then(
+          body => pending.resolve({ result: frame.payload, body }),
+          (error: Error) => pending.reject(new AgentError(`Corrupt compressed body: ${error.message}`, 'EPROTO'))
+        )
+      } else {
+        pending.resolve({ result: frame.payload, body: frame.body })
+      }
+    }
+  }
+
+  private shutdown(error: Error): void {
+    if (this.closedError) return
+    this.closedError = error
+
+    for (const pending of this.pending.values()) {
+      clearTimeout(pending.timeout)
+      pending.reject(error)
+    }
+    this.pending.clear()
+
+    for (const listener of this.closeListeners) {
+      listener(error)
+    }
+    this.closeListeners.clear()
+    this.eventListeners.clear()
+  }
+}
@@ -0,0 +1,248 @@
+import { isAbsolute, relative, resolve } from 'path'
+import type { Readable, Writable } from 'stream'
+import { getLogger } from '../utils/logger.js'
+import { decodeBody, encodeBody, type AgentCompression } from './compression.js'
+import { DEFAULT_AGENT_OPS, type AgentOpHandler } from './ops.js'
+import {
+  AgentError,
+  encodeFrame,
+  FRAME_TYPES,
+  FrameDecoder,
+  type AgentErrorPayload,
+  type AgentFrame,
+  type AgentRequest
+} from './protocol.js'
+
+/** Per-connection state reachable from operation handlers */
+interface AgentSession {
+  send(frame: AgentFrame): void
+  subscriptions: Map<number, () => void>
+  nextSubscription: number
+  /** Body codec agreed in 'hello', null until then */
+  compression: AgentCompression | null
+}
+
+export interface AgentServerOptions {
+  /**
+   * Directory all paths must stay within (default: '/').
+   * The agent runs with the SSH user's permissions, so this is a guard
+   * against client bugs rather than a security boundary.
+   */
+  root?: string
+}
+
+/**
+ * Remote agent daemon request handler
+ * Serves framed RPCs (see protocol.ts) over any byte stream: a unix socket
+ * connection forwarded over SSH, or the stdio of an exec channel.
+ *
+ * Requests are handled concurrently and answered as they complete, so one
+ * slow read does not hold up unrelated stat calls on the same channel.
+ */
+export class AgentServer {
+  private readonly root: string
+  private readonly ops = new Map<string, AgentOpHandler>(Object.entries(DEFAULT_AGENT_OPS))
+
+  constructor(options: AgentServerOptions = {}) {
+    this.root = resolve(options.root ?? '/')
+  }
+
+  /**
+   * Register (or replace) an operation handler
+   */
+  register(op: string, handler: AgentOpHandler): void {
+    this.ops.set(op, handler)
+  }
+
+  /**
+   * Names of all registered operations
+   */
+  get operations(): string[] {
+    return [...this.ops.keys()]
+  }
+
+  /**
+   * Validate a path argument and normalize it
+   * @throws {AgentError} When the path is not absolute or leaves the root
+   */
+  resolvePath(path: unknown): string {
+    if (typeof path !== 'string' || path.length === 0) {
+      throw new AgentError('Path argument is required', 'EINVAL')
+    }
+    if (path.includes('\0')) {
+      throw new AgentError('Path contains null byte', 'EINVAL')
+    }
+    if (!isAbsolute(path)) {
+      throw new AgentError(`Path must be absolute: ${path}`, 'EINVAL')
+    }
+
+    const normalized = resolve(path)
+    const rel = relative(this.root, normalized)
+    if (rel.startsWith('..') || isAbsolute(rel)) {
+      throw new AgentError(`Path is outside the agent root: ${path}`, 'EACCES')
+    }
+    return normalized
+  }
+
+  /**
+   * Serve requests from `input`, writing responses to `output`
+   * @returns Promise resolving when the input stream ends
+   */
+  serve(input: Readable, output: Writable): Promise<void> {
+    const decoder = new FrameDecoder()
+    let inFlight = 0
+    let ended = false
+
+    return new Promise((resolvePromise) => {
+      const finish = () => {
+        if (ended) {
+          // Subscriptions (watches) end with the connection
+          for (const cleanup of session.subscriptions.values()) cleanup()
+          session.subscriptions.clear()
+        }
+        if (ended && inFlight === 0) {
+          resolvePromise()
+        }
+      }
+
+      const send = (frame: AgentFrame) => {
+        if (output.destroyed || output.writableEnded) return
+        let encoded: Buffer
+        try {
+          encoded = encodeFrame(frame)
+        } catch (error) {
+          // e.g. EFBIG: answer with an error rather than leaving the request hanging
+          encoded = encodeFrame(errorFrame(frame.id, error))
+        }
+        // Stop reading new requests while the peer is not keeping up
+        if (!output.write(encoded) && !input.isPaused()) {
+          input.pause()
+          output.once('drain', () => input.resume())
+        }
+      }
+
+      const session: AgentSession = { send, subscriptions: new Map(), nextSubscription: 1, compression: null }
+
+      input.on('data', (chunk: Buffer) => {
+        let frames: AgentFrame[]
+        try {
+          frames = decoder.push(chunk)
+        } catch (error) {
+          // The stream is out of sync; nothing after this point can be trusted
+          getLogger().error('[Agent] Protocol error, closing connection', error)
+          input.destroy()
+          output.end()
+          ended = true
+          finish()
+          return
+        }
+
+        for (const frame of frames) {
+          if (frame.type !== FRAME_TYPES.REQUEST) continue
+          inFlight++
+          this.dispatch(frame, session).then(send).finally(() => {
+            inFlight--
+            finish()
+          })
+        }
+      })
+
+      input.on('end', () => {
+        ended = true
+        finish()
+      })
+      input.on('close', () => {
+        ended = true
+        finish()
+      })
+      input.on('error', (error) => {
+        getLogger().debug('[Agent] Input stream error', error)
+      })
+      output.on('error', (error) => {
+        getLogger().debug('[Agent] Output stream error', error)
+      })
+    })
+  }
+
+  /**
+   * Run a registered operation
+   * @throws {AgentError} ENOSYS when the operation is unknown
+   */
+  private async invoke(op: unknown, args: Record<string, unknown>, body: Buffer | undefined, session: AgentSession) {
+    const handler = typeof op === 'string' ? this.ops.get(op) : undefined
+    if (!handler) {
+      throw new AgentError(`Unknown agent operation: ${String(op)}`, 'ENOSYS')
+    }
+
+    return handler({
+      args,
+      body,
+      resolvePath: (path) => this.resolvePath(path),
+      invoke: (nextOp, nextArgs, nextBody) => this.invoke(nextOp, nextArgs, nextBody, session),
+      subscribe: (cleanup) => {
+        const id = session.nextSubscription++
+        session.subscriptions.set(id, cleanup)
+        return id
+      },
+      unsubscribe: (subscription) => {
+        const cleanup = session.subscriptions.get(subscription)
+        if (!cleanup) return false
+        session.subscriptions.delete(subscription)
+        cleanup()
+        return true
+      },
+      emit: (subscription, payload) => {
+        if (session.subscriptions.has(subscription)) {
+          session.send({ id: subscription, type: FRAME_TYPES.EVENT, payload })
+        }
+      },
+      setCompression: (codec) => {
+        session.compression = codec
+      },
+    })
+  }
+
+  /**
+   * Run one request and build its response frame, compressing the response
+   * body once the connection has a codec
+   */
+  private async dispatch(frame: AgentFrame, session: AgentSession): Promise<AgentFrame> {
+    const request = frame.payload as Partial<AgentRequest> | null
+
+    try {
+      let body = frame.body
+      if (body && frame.compressed) {
+        if (!session.compression) {
+          throw new AgentError('Compressed request body without a negotiated codec', 'EPROTO')
+        }
+        body = await decodeBody(body, session.compression)
+      }
+
+      const outcome = await this.invoke(request?.op, request?.args ?? {}, body, session)
+      const response: AgentFrame = {
+        id: frame.id,
+        type: FRAME_TYPES.RESPONSE,
+        payload: outcome?.result ?? null,
+        body: outcome?.body,
+      }
+      if (response.body && session.compression) {
+        Object.assign(response, await encodeBody(response.body, session.compression))
+      }
+      return response
+    } catch (error) {
+      return errorFrame(frame.id, error)
+    }
+  }
+}
+
+/**
+ * Build an error frame carrying the message and errno code of `error`
+ */
+function errorFrame(id: number, error: unknown): AgentFrame {
+  const err = error as NodeJS.ErrnoException
+  const payload: AgentErrorPayload = {
+    message: err?.message ?? String(error),
+    code: err?.code,
+  }
+  return { id, type: FRAME_TYPES.ERROR, payload }
+}
@@ -0,0 +1,125 @@
+/**
+ * Body compression for agent frames
+ *
+ * Negotiated per connection in the 'hello' request: the client lists the
+ * codecs it can use and the agent picks the first one it has. From then on
+ * either side may compress a frame body, which sets COMPRESSED_FLAG in the
+ * frame type byte. Peers that don't negotiate never see the flag, so the
+ * frame layout stays compatible with older agents and clients.
+ */
+
+import { promisify } from 'util'
+import * as zlib from 'zlib'
+import { incrementCounter } from '../utils/metrics.js'
+import { MAX_FRAME_SIZE } from './protocol.js'
+
+export type AgentCompression = 'zstd' | 'deflate'
+
+/** Bodies smaller than this are sent as they are */
+export const COMPRESS_MIN_BYTES = 1024
+
+/** Bodies from this size on use the fastest level, to keep large transfers at line rate */
+const FAST_LEVEL_BYTES = 256 * 1024
+
+/** Bytes compressed to decide whether a large body is worth compressing */
+const SAMPLE_BYTES = 8 * 1024
+
+/** Compressed sizes above this fraction of the original are sent uncompressed */
+const MAX_RATIO = 0.9
+
+/**
+ * Magic numbers of formats that are already compressed: gzip, zip, zstd,
+ * xz, bzip2, 7z, PNG, JPEG, GIF, WebP/RIFF, and ISO media (mp4, mov, heic)
+ */
+const COMPRESSED_SIGNATURES: Array<[offset: number, magic: Buffer]> = [
+  [0, Buffer.from([0x1f, 0x8b])],
+  [0, Buffer.from('PK\x03\x04', 'latin1')],
+  [0, Buffer.from([0x28, 0xb5, 0x2f, 0xfd])],
+  [0, Buffer.from([0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00])],
+  [0, Buffer.from('BZh', 'latin1')],
+  [0, Buffer.from([0x37, 0x7a, 0xbc, 0xaf, 0x27, 0x1c])],
+  [0, Buffer.from([0x89, 0x50, 0x4e, 0x47])],
+  [0, Buffer.from([0xff, 0xd8, 0xff])],
+  [0, Buffer.from('GIF8', 'latin1')],
+  [0, Buffer.from('RIFF', 'latin1')],
+  [4, Buffer.from('ftyp', 'latin1')],
+]
+
+/** zstd is in zlib from Node 22.15; the typings may predate it */
+const zstd = zlib as unknown as {
+  zstdCompress?: (data: Buffer, options: object, callback: (error: Error | null, result: Buffer) => void) => void
+  zstdDecompress?: (data: Buffer, options: object, callback: (error: Error | null, result: Buffer) => void) => void
+  constants: { ZSTD_c_compressionLevel?: number }
+}
+
+const deflateRaw = promisify(zlib.deflateRaw)
+const inflateRaw = promisify(zlib.inflateRaw)
+
+/**
+ * Codecs this process can use, in order of preference
+ */
+export function supportedCompressions(): AgentCompression[] {
+  return typeof zstd.zstdCompress === 'function' ? ['zstd', 'deflate'] : ['deflate']
+}
+
+/**
+ * The first of the peer's offered codecs that this process supports
+ */
+export function chooseCompression(offered: unknown): AgentCompression | null {
+  if (!Array.isArray(offered)) return null
+  const supported = supportedCompressions()
+  return (offered.find(codec => supported.includes(codec)) as AgentCompression | undefined) ?? null
+}
+
+function looksCompressed(body: Buffer): boolean {
+  return COMPRESSED_SIGNATURES.some(([offset, magic]) =>
+    body.length >= offset + magic.length && body.compare(magic, 0, magic.length, offset, offset + magic.length) === 0
+  )
+}
+
+function compress(body: Buffer, codec: AgentCompression): Promise<Buffer> {
+  const fast = body.length >= FAST_LEVEL_BYTES
+  if (codec === 'zstd') {
+    return new Promise((resolve, reject) => {
+      zstd.zstdCompress!(body, { params: { [zstd.constants.ZSTD_c_compressionLevel!]: fast ? 1 : 3 } },
+        (error, result) => error ? reject(error) : resolve(result))
+    })
+  }
+  return deflateRaw(body, { level: fast ? 1 : 6 })
+}
+
+/**
+ * Compress a frame body when that makes it meaningfully smaller
+ * Small bodies and data in compressed formats are left alone; for large
+ * bodies a sample decides first, so incompressible data costs little CPU.
+ * @returns The body to send and whether it is compressed
+ */
+export async function encodeBody(body: Buffer, codec: AgentCompression): Promise<{ body: Buffer; compressed: boolean }> {
+  if (body.length < COMPRESS_MIN_BYTES || looksCompressed(body)) {
+    return { body, compressed: false }
+  }
+  if (body.length > 4 * SAMPLE_BYTES) {
+    const sample = zlib.deflateRawSync(body.subarray(0, SAMPLE_BYTES), { level: 1 })
+    if (sample.length > SAMPLE_BYTES * MAX_RATIO) return { body, compressed: false }
+  }
+
+  const compressed = await compress(body, codec)
+  if (compressed.length > body.length * MAX_RATIO) {
+    return { body, compressed: false }
+  }
+  incrementCounter('constellation_agent_compression_saved_bytes', { codec }, body.length - compressed.length)
+  return { body: compressed, compressed: true }
+}
+
+/**
+ * Decompress a body that was sent with COMPRESSED_FLAG
+ * Output is capped at MAX_FRAME_SIZE, like an uncompressed body.
+ */
+export function decodeBody(body: Buffer, codec: AgentCompression): Promise<Buffer> {
+  if (codec === 'zstd') {
+    return new Promise((resolve, reject) => {
+      zstd.zstdDecompress!(body, { maxOutputLength: MAX_FRAME_SIZE }, (error, result) => error ? reject(error) : resolve(result))
+    })
+  }
+  return inflateRaw(body, { maxOutputLength: MAX_FRAME_SIZE })
+}
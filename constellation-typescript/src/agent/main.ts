@@ -0,0 +1,111 @@
+/**
+ * Remote agent daemon entry point
+ *
+ *   constellationfs agent --socket /run/constellationfs/root.sock   (daemon, started by entrypoint.sh)
+ *   constellationfs agent --stdio                                   (one client, spawned over SSH exec)
+ *
+ * Options:
+ *   --root <path>   Reject paths outside this directory (default: /)
+ */
+
+import { chmodSync, mkdirSync, unlinkSync } from 'fs'
+import { createServer } from 'net'
+import { dirname } from 'path'
+import { getLogger, setLogger, type Logger } from '../utils/logger.js'
+import { AgentServer } from './AgentServer.js'
+
+export { AgentServer } from './AgentServer.js'
+
+interface AgentCliOptions {
+  stdio: boolean
+  socket?: string
+  root?: string
+}
+
+function parseArgs(args: string[]): AgentCliOptions {
+  const options: AgentCliOptions = { stdio: false }
+
+  for (let i = 0; i < args.length; i++) {
+    const arg = args[i]
+    if (arg === '--stdio') {
+      options.stdio = true
+    } else if (arg === '--socket') {
+      options.socket = args[++i]
+    } else if (arg === '--root') {
+      options.root = args[++i]
+    }
+  }
+
+  if (!options.stdio && !options.socket) {
+    throw new Error('Agent requires --stdio or --socket <path>')
+  }
+
+  return options
+}
+
+/**
+ * Route all log output to stderr; in --stdio mode stdout carries frames
+ */
+function stderrLogger(): Logger {
+  const write = (level: string, message: string, args: unknown[]) => {
+    if (level === 'debug' && process.env.CONSTELLATION_DEBUG_LOGGING !== 'true') return
+    process.stderr.write(`[ConstellationFS agent] ${message}${args.length ? ` ${args.map(String).join(' ')}` : ''}\n`)
+  }
+  return {
+    error: (message, ...args) => write('error', message, args),
+    warn: (message, ...args) => write('warn', message, args),
+    info: (message, ...args) => write('info', message, args),
+    debug: (message, ...args) => write('debug', message, args),
+  }
+}
+
+/**
+ * Start the agent with CLI arguments
+ */
+export async function main(args: string[]): Promise<void> {
+  const options = parseArgs(args)
+  setLogger(stderrLogger())
+
+  const server = new AgentServer({ root: options.root })
+
+  if (options.stdio) {
+    await server.serve(process.stdin, process.stdout)
+    return
+  }
+
+  const socketPath = options.socket!
+  mkdirSync(dirname(socketPath), { recursive: true })
+  try {
+    unlinkSync(socketPath)
+  } catch {
+    // No stale socket to remove
+  }
+
+  const listener = createServer((connection) => {
+    server.serve(connection, connection).catch((error) => {
+      getLogger().error('Agent connection failed', error)
+    })
+  })
+
+  await new Promise<void>((resolve, reject) => {
+    listener.once('error', reject)
+    listener.listen(socketPath, () => {
+      // Only the owning user may connect (sshd forwards as the logged-in user)
+      chmodSync(socketPath, 0o600)
+      getLogger().info(`Agent listening on ${socketPath}`)
+      resolve()
+    })
+  })
+
+  const shutdown = () => {
+    listener.close()
+    try {
+      unlinkSync(socketPath)
+    } catch {
+      // Already removed
+    }
+    process.exit(0)
+  }
+  process.on('SIGTERM', shutdown)
+  process.on('SIGINT', shutdown)
+}
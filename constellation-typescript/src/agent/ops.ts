@@ -0,0 +1,460 @@
+/**
+ * Operation handlers served by the remote agent daemon
+ *
+ * Each handler receives validated, absolute paths (via ctx.resolvePath) and
+ * returns a JSON result and/or a binary body. Errors are thrown as-is; the
+ * server forwards `message` and the errno `code` to the client.
+ */
+
+import { constants } from 'fs'
+import { access, lstat, mkdir, open, readdir, readFile, rm, stat, writeFile } from 'fs/promises'
+import { dirname, join } from 'path'
+import { applyEditsToFile, writeFileAtomic, type TextEdit } from '../utils/applyEdits.js'
+import { ChangeFeed } from '../utils/ChangeFeed.js'
+import { cloneTree } from '../utils/cloneTree.js'
+import { hashFile } from '../utils/ContentCache.js'
+import { assembleDelta, buildManifest, contentHash, type DeltaChunk } from '../utils/deltaSync.js'
+import { runInKeyOrder } from '../utils/pathOrdering.js'
+import { searchTree, type SearchOptions } from '../utils/search.js'
+import { moveToTrash } from '../utils/TrashReaper.js'
+import { TrigramIndex } from '../utils/TrigramIndex.js'
+import { UsageTracker } from '../utils/UsageTracker.js'
+import { walkTree, type WalkOptions } from '../utils/walk.js'
+import { chooseCompression, type AgentCompression } from './compression.js'
+import {
+  AGENT_PROTOCOL_VERSION,
+  AgentError,
+  serializeStats,
+  type AgentWatchEvent,
+  type SerializedDirent,
+} from './protocol.js'
+
+/** Window over which a watch collects changes into one event */
+const WATCH_COALESCE_MS = 25
+
+/** Changed paths per event before the watch reports "anything may have changed" instead */
+const WATCH_MAX_PATHS = 1_000
+
+/**
+ * lstat calls one readdirEntries request keeps in flight, so a huge directory
+ * doesn't fill the libuv threadpool every other request shares
+ */
+const READDIR_STAT_CONCURRENCY = 16
+
+export interface AgentOpContext {
+  args: Record<string, unknown>
+  body?: Buffer
+  /** Validate and normalize a path argument against the agent root */
+  resolvePath(path: unknown): string
+  /** Run another registered operation (used by 'batch') */
+  invoke(op: string, args: Record<string, unknown>, body?: Buffer): Promise<AgentOpResult | void>
+  /**
+   * Start a long-lived subscription on this connection (used by 'watch')
+   * @param cleanup - Runs on unsubscribe or when the connection ends
+   * @returns Subscription id, used as the id of its EVENT frames
+   */
+  subscribe(cleanup: () => void): number
+  /** End a subscription; false when the id is unknown */
+  unsubscribe(subscription: number): boolean
+  /** Push an EVENT frame for a subscription to the client */
+  emit(subscription: number, payload: unknown): void
+  /** Body codec for this connection's later frames, agreed in 'hello' */
+  setCompression(codec: AgentCompression | null): void
+}
+
+export interface AgentOpResult {
+  result?: unknown
+  body?: Buffer
+}
+
+export type AgentOpHandler = (ctx: AgentOpContext) => Promise<AgentOpResult | void>
+
+/** One entry of a 'batch' request; `bodyLength` bytes of the request body belong to it */
+export interface AgentBatchEntry {
+  op: string
+  args?: Record<string, unknown>
+  bodyLength?: number
+}
+
+/** One entry of a 'batch' response; `bodyLength` bytes of the response body belong to it */
+export type AgentBatchOutcome =
+  | { ok: true; result: unknown; bodyLength?: number }
+  | { ok: false; message: string; code?: string }
+
+/**
+ * Read an optional boolean argument
+ */
+export function boolArg(args: Record<string, unknown>, name: string, defaultValue = false): boolean {
+  const value = args[name]
+  if (value === undefined) return defaultValue
+  if (typeof value !== 'boolean') {
+    throw new AgentError(`Argument '${name}' must be a boolean`, 'EINVAL')
+  }
+  return value
+}
+
+/**
+ * Resolve to true/false instead of throwing for missing paths
+ */
+async function probe(check: () => Promise<unknown>): Promise<boolean> {
+  try {
+    await check()
+    return true
+  } catch {
+    return false
+  }
+}
+
+/**
+ * Built-in operations. AgentServer copies this table, so callers can add ops
+ * per server with AgentServer.register() without affecting other instances.
+ */
+export const DEFAULT_AGENT_OPS: Record<string, AgentOpHandler> = {
+  /**
+   * Handshake; `compression` lists the body codecs the client accepts, and
+   * the reply names the one both sides use (null for none)
+   */
+  async hello(ctx) {
+    const compression = chooseCompression(ctx.args.compression)
+    ctx.setCompression(compression)
+    return {
+      result: {
+        version: AGENT_PROTOCOL_VERSION,
+        pid: process.pid,
+        platform: process.platform,
+        compression,
+      },
+    }
+  },
+
+  async stat(ctx) {
+    return { result: serializeStats(await stat(ctx.resolvePath(ctx.args.path))) }
+  },
+
+  async lstat(ctx) {
+    return { result: serializeStats(await lstat(ctx.resolvePath(ctx.args.path))) }
+  },
+
+  async exists(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    return { result: await probe(() => access(path, constants.F_OK)) }
+  },
+
+  async isDirectory(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    return { result: await probe(async () => {
+      if (!(await stat(path)).isDirectory()) throw new Error('not a directory')
+    }) }
+  },
+
+  async readdir(ctx) {
+    return { result: await readdir(ctx.resolvePath(ctx.args.path)) }
+  },
+
+  /**
+   * List a directory with entry types in one request, plus each entry's
+   * lstat result with `withStats`
+   */
+  async readdirEntries(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    const withStats = boolArg(ctx.args, 'withStats')
+    const dirents = await readdir(path, { withFileTypes: true })
+
+    const entries = dirents.map((dirent): SerializedDirent => ({
+      name: dirent.name,
+      kind: dirent.isFile() ? 'file' : dirent.isDirectory() ? 'directory' : dirent.isSymbolicLink() ? 'symlink' : 'other',
+    }))
+    if (!withStats) return { result: entries }
+
+    let next = 0
+    const worker = async () => {
+      while (next < entries.length) {
+        const entry = entries[next++]!
+        try {
+          entry.stats = serializeStats(await lstat(join(path, entry.name)))
+        } catch {
+          // Removed since the directory was read
+        }
+      }
+    }
+    await Promise.all(Array.from({ length: Math.min(READDIR_STAT_CONCURRENCY, entries.length) }, worker))
+    return { result: entries }
+  },
+
+  async mkdir(ctx) {
+    await mkdir(ctx.resolvePath(ctx.args.path), { recursive: boolArg(ctx.args, 'recursive') })
+  },
+
+  async rm(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    await rm(path, {
+      recursive: boolArg(ctx.args, 'recursive'),
+      force: boolArg(ctx.args, 'force'),
+    })
+    // A deleted workspace's usage tracker would hold its file sizes forever
+    UsageTracker.peek(path)?.close()
+  },
+
+  /**
+   * Delete a directory by renaming it into `trash`, replying right away; the
+   * agent removes it in the background at a bounded rate
+   */
+  async trash(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    await moveToTrash(path, ctx.resolvePath(ctx.args.trash))
+    UsageTracker.peek(path)?.close()
+  },
+
+  /**
+   * Copy a workspace directory, reflinking files where the filesystem can
+   */
+  async clone(ctx) {
+    await cloneTree(ctx.resolvePath(ctx.args.source), ctx.resolvePath(ctx.args.target))
+  },
+
+  async touch(ctx) {
+    const handle = await open(ctx.resolvePath(ctx.args.path), 'a')
+    try {
+      const now = new Date()
+      await handle.utimes(now, now)
+    } finally {
+      await handle.close()
+    }
+  },
+
+  async readFile(ctx) {
+    return { body: await readFile(ctx.resolvePath(ctx.args.path)) }
+  },
+
+  /**
+   * Content hash and size of a file, for clients with a content cache
+   * Hashes are remembered per inode and modification time, so asking about
+   * an unchanged file costs a stat. Files smaller than `inlineBelow` bytes
+   * are returned in the body instead of hashed, saving a second request.
+   */
+  async digest(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    const inlineBelow = ctx.args.inlineBelow ?? 0
+    if (typeof inlineBelow !== 'number') {
+      throw new AgentError(`Argument 'inlineBelow' must be a number`, 'EINVAL')
+    }
+    const stats = await stat(path)
+    if (stats.isFile() && stats.size < inlineBelow) {
+      const body = await readFile(path)
+      return { result: { size: body.length }, body }
+    }
+    return { result: await hashFile(path) }
+  },
+
+  /**
+   * Watch a directory tree (inotify on Linux) and push changed paths as
+   * AgentWatchEvent frames, coalesced over a short window. Used by clients
+   * to keep metadata caches coherent with changes made by other processes,
+   * and for Workspace.watch(). Subscriptions on the same tree share one
+   * ChangeFeed with each other and with the agent's search index.
+   */
+  async watch(ctx) {
+    const root = ctx.resolvePath(ctx.args.path)
+
+    let changed = new Set<string>()
+    let overflow = false
+    let timer: ReturnType<typeof setTimeout> | null = null
+
+    const flush = () => {
+      timer = null
+      const event: AgentWatchEvent = { paths: overflow ? null : [...changed] }
+      changed = new Set()
+      overflow = false
+      ctx.emit(subscription, event)
+    }
+
+    // Rejects for missing paths or platforms without recursive watch
+    const unsubscribe = await ChangeFeed.forDirectory(root).subscribe((event) => {
+      if (event.closed) {
+        // The feed was stopped (workspace deleted); tell the client to stop trusting it
+        if (timer) clearTimeout(timer)
+        ctx.emit(subscription, { paths: null, closed: true } satisfies AgentWatchEvent)
+        ctx.unsubscribe(subscription)
+        return
+      }
+      if (event.paths === null) {
+        overflow = true
+      } else {
+        for (const path of event.paths) {
+          if (changed.size >= WATCH_MAX_PATHS) {
+            overflow = true
+            break
+          }
+          changed.add(join(root, path))
+        }
+      }
+      timer ??= setTimeout(flush, WATCH_COALESCE_MS)
+    })
+
+    const subscription = ctx.subscribe(() => {
+      unsubscribe()
+      if (timer) clearTimeout(timer)
+    })
+    return { result: { id: subscription } }
+  },
+
+  async unwatch(ctx) {
+    const id = ctx.args.id
+    if (typeof id !== 'number') {
+      throw new AgentError(`Argument 'id' must be a number`, 'EINVAL')
+    }
+    return { result: ctx.unsubscribe(id) }
+  },
+
+  /**
+   * Search file contents below a directory with the same engine local
+   * workspaces use; `prefix` is prepended to the reported paths. With
+   * `index` (a workspace root), the root's trigram index narrows the search
+   * and `prefix` must be the directory relative to that root.
+   */
+  async search(ctx) {
+    const options = ctx.args.options
+    if (typeof options !== 'object' || options === null) {
+      throw new AgentError(`Argument 'options' must be an object`, 'EINVAL')
+    }
+    const prefix = ctx.args.prefix ?? ''
+    if (typeof prefix !== 'string') {
+      throw new AgentError(`Argument 'prefix' must be a string`, 'EINVAL')
+    }
+    if (ctx.args.index !== undefined && ctx.args.index !== null) {
+      const index = TrigramIndex.for(ctx.resolvePath(ctx.args.index))
+      return { result: await index.search(prefix, options as SearchOptions) }
+    }
+    return { result: await searchTree(ctx.resolvePath(ctx.args.path), options as SearchOptions, prefix) }
+  },
+
+  /**
+   * List a directory tree with the same walker local workspaces use
+   */
+  async walk(ctx) {
+    const options = ctx.args.options ?? {}
+    if (typeof options !== 'object' || options === null) {
+      throw new AgentError(`Argument 'options' must be an object`, 'EINVAL')
+    }
+    return { result: await walkTree(ctx.resolvePath(ctx.args.path), options as WalkOptions) }
+  },
+
+  /**
+   * Disk usage of a workspace, tracked on the host so repeated calls don't
+   * walk the tree
+   * `file` (relative to the workspace) adds that file's current size, for
+   * quota checks of a write replacing it; `user` adds the combined usage of
+   * the workspace's siblings in its parent (user) directory.
+   */
+  async usage(ctx) {
+    const path = ctx.resolvePath(ctx.args.path)
+    const tracker = UsageTracker.for(path)
+    const result: Record<string, unknown> = { ...await tracker.usage() }
+    if (typeof ctx.args.file === 'string') {
+      result.fileSize = tracker.sizeOf(ctx.args.file)
+    }
+    if (boolArg(ctx.args, 'user')) {
+      result.user = await UsageTracker.forUser(ctx.resolvePath(dirname(path)))
+    }
+    return { result }
+  },
+
+  /**
+   * Apply exact-text edits to a file in place (written atomically) and
+   * return the diff, so the file never leaves the host
+   */
+  async applyEdits(ctx) {
+    const edits = ctx.args.edits
+    if (!Array.isArray(edits) || !edits.every(edit => typeof edit?.oldText === 'string' && typeof edit?.newText === 'string')) {
+      throw new AgentError(`Argument 'edits' must be an array of { oldText, newText } strings`, 'EINVAL')
+    }
+    const path = ctx.resolvePath(ctx.args.path)
+    const label = typeof ctx.args.label === 'string' ? ctx.args.label : path
+    return { result: await applyEditsToFile(path, edits as TextEdit[], { dryRun: boolArg(ctx.args, 'dryRun') }, label) }
+  },
+
+  async writeFile(ctx) {
+    await writeFile(ctx.resolvePath(ctx.args.path), ctx.body ?? Buffer.alloc(0))
+  },
+
+  /**
+   * Whole-file and chunk hashes of a file, for clients planning a delta write
+   */
+  async chunkManifest(ctx) {
+    return { result: buildManifest(await readFile(ctx.resolvePath(ctx.args.path))) }
+  },
+
+  /**
+   * Write a file from chunks of its current content plus the chunks sent in
+   * the body, replacing it atomically
+   * `base` is the hash of the content the delta was planned against and
+   * `hash` that of the result. Reports 'unchanged' without writing when the
+   * file already has the result, and 'stale' when it has neither, in which
+   * case the client sends the whole file.
+   */
+  async writeDelta(ctx) {
+    const { base, hash, chunks } = ctx.args
+    if (typeof base !== 'string' || typeof hash !== 'string') {
+      throw new AgentError(`Arguments 'base' and 'hash' must be strings`, 'EINVAL')
+    }
+    if (!Array.isArray(chunks) || !chunks.every(chunk => typeof chunk?.hash === 'string' && typeof chunk?.length === 'number')) {
+      throw new AgentError(`Argument 'chunks' must be an array of { hash, length }`, 'EINVAL')
+    }
+    const path = ctx.resolvePath(ctx.args.path)
+    const current = await readFile(path)
+    const currentHash = contentHash(current)
+    if (currentHash === hash) return { result: { status: 'unchanged' } }
+    if (currentHash !== base) return { result: { status: 'stale' } }
+
+    const content = assembleDelta(current, chunks as DeltaChunk[], ctx.body ?? Buffer.alloc(0))
+    if (contentHash(content) !== hash) return { result: { status: 'stale' } }
+    await writeFileAtomic(path, content)
+    return { result: { status: 'written' } }
+  },
+
+  /**
+   * Run several operations in one round-trip. Bodies of the individual
+   * requests and responses are concatenated in entry order.
+   * Entries on the same path run in order; the rest run concurrently.
+   */
+  async batch(ctx) {
+    const entries = ctx.args.ops
+    if (!Array.isArray(entries)) {
+      throw new AgentError(`Argument 'ops' must be an array`, 'EINVAL')
+    }
+
+    const body = ctx.body ?? Buffer.alloc(0)
+    let offset = 0
+    const requests = (entries as AgentBatchEntry[]).map((entry) => {
+      if (typeof entry?.op !== 'string' || entry.op === 'batch') {
+        throw new AgentError('Batch entries need a non-batch op', 'EINVAL')
+      }
+      const length = entry.bodyLength ?? 0
+      if (!Number.isInteger(length) || length < 0 || offset + length > body.length) {
+        throw new AgentError(`Invalid bodyLength for batch entry '${entry.op}'`, 'EINVAL')
+      }
+      const entryBody = length > 0 ? body.subarray(offset, offset + length) : undefined
+      offset += length
+      return { op: entry.op, args: entry.args ?? {}, body: entryBody }
+    })
+
+    const settled = await runInKeyOrder(
+      requests,
+      (request) => String(request.args.path ?? ''),
+      (request) => ctx.invoke(request.op, request.args, request.body)
+    )
+
+    const bodies: Buffer[] = []
+    const result: AgentBatchOutcome[] = settled.map((outcome) => {
+      if (outcome.status === 'rejected') {
+        const err = outcome.reason as NodeJS.ErrnoException
+        return { ok: false, message: err?.message ?? String(outcome.reason), code: err?.code }
+      }
+      const responseBody = outcome.value?.body
+      if (responseBody) bodies.push(responseBody)
+      return { ok: true, result: outcome.value?.result ?? null, bodyLength: responseBody?.length }
+    })
+
+    return { result, body: bodies.length > 0 ? Buffer.concat(bodies) : undefined }
+  },
+}
@@ -0,0 +1,301 @@
+/**
+ * Wire protocol shared by the remote agent daemon and RemoteBackend
+ *
+ * Every message is a length-prefixed frame so many requests can be in flight
+ * on one SSH channel and answered out of order:
+ *
+ *   u32 frameLength   bytes that follow this field
+ *   u32 id            request id, echoed in the response
+ *   u8  type          FRAME_TYPES value, plus COMPRESSED_FLAG for compressed bodies
+ *   u32 jsonLength    length of the JSON payload
+ *   …   json          UTF-8 JSON payload
+ *   …   body          raw bytes (file contents), the rest of the frame
+ *
+ * File data travels in the binary body so it is never base64/JSON encoded.
+ * Bodies are compressed only after both sides agreed on a codec in 'hello'
+ * (see compression.ts).
+ */
+
+import type { Dirent, Stats } from 'fs'
+
+/** Bumped whenever frame layout or op semantics change incompatibly */
+export const AGENT_PROTOCOL_VERSION = 1
+
+/** Bytes of fixed header after the frame length field */
+const HEADER_SIZE = 9
+
+/** Upper bound on a single frame, guards against corrupt length prefixes */
+export const MAX_FRAME_SIZE = 256 * 1024 * 1024
+
+export const FRAME_TYPES = {
+  REQUEST: 1,
+  RESPONSE: 2,
+  ERROR: 3,
+  /** Sent by the agent unprompted; `id` is a subscription id, not a request id */
+  EVENT: 4,
+} as const
+export type FrameType = typeof FRAME_TYPES[keyof typeof FRAME_TYPES]
+
+/** Set in the type byte when the body is compressed with the connection's codec */
+export const COMPRESSED_FLAG = 0x80
+
+export interface AgentFrame {
+  id: number
+  type: FrameType
+  payload: unknown
+  body?: Buffer
+  /** Whether `body` is compressed */
+  compressed?: boolean
+}
+
+/** Request payload: operation name plus JSON arguments */
+export interface AgentRequest {
+  op: string
+  args: Record<string, unknown>
+}
+
+/** Payload of the EVENT frames pushed for a 'watch' subscription */
+export interface AgentWatchEvent {
+  /** Changed absolute paths, or null when the watcher lost track and any path may have changed */
+  paths: string[] | null
+  /** Set on the last event of a subscription: the watch has stopped */
+  closed?: boolean
+}
+
+/** Error payload, mirrors the fields of a Node.js system error */
+export interface AgentErrorPayload {
+  message: string
+  code?: string
+}
+
+/**
+ * Stats as sent over the wire. Functions do not survive JSON, so the entry
+ * type is flattened into `kind` and rebuilt by deserializeStats()
+ */
+export interface SerializedStats {
+  kind: 'file' | 'directory' | 'symlink' | 'other'
+  dev: number
+  ino: number
+  mode: number
+  nlink: number
+  uid: number
+  gid: number
+  size: number
+  atimeMs: number
+  mtimeMs: number
+  ctimeMs: number
+  birthtimeMs: number
+}
+
+/**
+ * Directory entry as sent over the wire; `stats` are lstat results and only
+ * present when requested
+ */
+export interface SerializedDirent {
+  name: string
+  kind: SerializedStats['kind']
+  stats?: SerializedStats
+}
+
+/**
+ * SFTP file attributes, as returned by ssh2 for readdir and stat replies
+ */
+export interface SftpAttributes {
+  mode: number
+  uid: number
+  gid: number
+  size: number
+  /** Seconds since the epoch */
+  atime: number
+  /** Seconds since the epoch */
+  mtime: number
+}
+
+/** S_IFMT and the file type values under it */
+const FILE_TYPE_MASK = 0o170000
+const FILE_TYPE_KINDS: Record<number, SerializedStats['kind']> = {
+  0o100000: 'file',
+  0o040000: 'directory',
+  0o120000: 'symlink',
+}
+
+/**
+ * Error returned by the agent; `code` carries the remote errno name (ENOENT, ...)
+ */
+export class AgentError extends Error {
+  constructor(message: string, public readonly code?: string) {
+    super(message)
+    this.name = 'AgentError'
+  }
+}
+
+/**
+ * Encode a frame for transmission
+ */
+export function encodeFrame(frame: AgentFrame): Buffer {
+  const json = Buffer.from(JSON.stringify(frame.payload ?? null), 'utf8')
+  const bodyLength = frame.body?.length ?? 0
+  const frameLength = HEADER_SIZE + json.length + bodyLength
+
+  if (frameLength > MAX_FRAME_SIZE) {
+    throw new AgentError(`Agent frame too large: ${frameLength} bytes (max ${MAX_FRAME_SIZE})`, 'EFBIG')
+  }
+
+  const header = Buffer.allocUnsafe(4 + HEADER_SIZE)
+  header.writeUInt32BE(frameLength, 0)
+  header.writeUInt32BE(frame.id >>> 0, 4)
+  header.writeUInt8(frame.compressed && bodyLength > 0 ? frame.type | COMPRESSED_FLAG : frame.type, 8)
+  header.writeUInt32BE(json.length, 9)
+
+  return frame.body && bodyLength > 0
+    ? Buffer.concat([header, json, frame.body], 4 + frameLength)
+    : Buffer.concat([header, json], 4 + frameLength)
+}
+
+/**
+ * Incremental frame decoder; feed it stream chunks, get complete frames back.
+ * Chunks are kept in a list and only joined once a whole frame is available,
+ * so large file bodies are not re-copied on every chunk.
+ */
+export class FrameDecoder {
+  private chunks: Buffer[] = []
+  private buffered = 0
+
+  push(chunk: Buffer): AgentFrame[] {
+    this.chunks.push(chunk)
+    this.buffered += chunk.length
+
+    const frames: AgentFrame[] = []
+
+    while (this.buffered >= 4) {
+      const frameLength = this.peekUInt32()
+      if (frameLength < HEADER_SIZE || frameLength > MAX_FRAME_SIZE) {
+        throw new AgentError(`Invalid agent frame length: ${frameLength}`, 'EPROTO')
+      }
+      if (this.buffered < 4 + frameLength) {
+        break
+      }
+
+      const raw = this.take(4 + frameLength)
+      const id = raw.readUInt32BE(4)
+      const typeByte = raw.readUInt8(8)
+      const type = (typeByte & ~COMPRESSED_FLAG) as FrameType
+      const jsonLength = raw.readUInt32BE(9)
+      const jsonStart = 4 + HEADER_SIZE
+      const bodyStart = jsonStart + jsonLength
+
+      if (bodyStart > raw.length) {
+        throw new AgentError(`Invalid agent frame JSON length: ${jsonLength}`, 'EPROTO')
+      }
+
+      const payload = JSON.parse(raw.toString('utf8', jsonStart, bodyStart))
+      const body = bodyStart < raw.length ? raw.subarray(bodyStart) : undefined
+      frames.push(body && typeByte & COMPRESSED_FLAG ? { id, type, payload, body, compressed: true } : { id, type, payload, body })
+    }
+
+    return frames
+  }
+
+  private peekUInt32(): number {
+    const first = this.chunks[0]!
+    if (first.length >= 4) {
+      return first.readUInt32BE(0)
+    }
+    return Buffer.concat(this.chunks, 4).readUInt32BE(0)
+  }
+
+  private take(length: number): Buffer {
+    const joined = this.chunks.length === 1 ? this.chunks[0]! : Buffer.concat(this.chunks, this.buffered)
+    const result = joined.subarray(0, length)
+    const rest = joined.subarray(length)
+
+    this.chunks = rest.length > 0 ? [rest] : []
+    this.buffered = rest.length
+    return result
+  }
+}
+
+/**
+ * Convert fs.Stats into the wire representation
+ */
+export function serializeStats(stats: Stats): SerializedStats {
+  return {
+    kind: stats.isFile() ? 'file' : stats.isDirectory() ? 'directory' : stats.isSymbolicLink() ? 'symlink' : 'other',
+    dev: stats.dev,
+    ino: stats.ino,
+    mode: stats.mode,
+    nlink: stats.nlink,
+    uid: stats.uid,
+    gid: stats.gid,
+    size: stats.size,
+    atimeMs: stats.atimeMs,
+    mtimeMs: stats.mtimeMs,
+    ctimeMs: stats.ctimeMs,
+    birthtimeMs: stats.birthtimeMs,
+  }
+}
+
+/**
+ * Convert SFTP attributes into the wire representation, so both transports
+ * build Stats the same way. SFTP carries no device, inode or link count.
+ */
+export function serializeSftpAttributes(attrs: SftpAttributes): SerializedStats {
+  return {
+    kind: FILE_TYPE_KINDS[attrs.mode & FILE_TYPE_MASK] ?? 'other',
+    dev: 0,
+    ino: 0,
+    mode: attrs.mode,
+    nlink: 1,
+    uid: attrs.uid,
+    gid: attrs.gid,
+    size: attrs.size,
+    atimeMs: attrs.atime * 1000,
+    mtimeMs: attrs.mtime * 1000,
+    ctimeMs: attrs.mtime * 1000,
+    birthtimeMs: attrs.mtime * 1000,
+  }
+}
+
+/**
+ * Rebuild a Stats-compatible object from the wire representation
+ */
+export function deserializeStats(stats: SerializedStats): Stats {
+  const result = {
+    ...stats,
+    blksize: 4096,
+    blocks: Math.ceil(stats.size / 512),
+    rdev: 0,
+    atime: new Date(stats.atimeMs),
+    mtime: new Date(stats.mtimeMs),
+    ctime: new Date(stats.ctimeMs),
+    birthtime: new Date(stats.birthtimeMs),
+    isFile: () => stats.kind === 'file',
+    isDirectory: () => stats.kind === 'directory',
+    isSymbolicLink: () => stats.kind === 'symlink',
+    isBlockDevice: () => false,
+    isCharacterDevice: () => false,
+    isFIFO: () => false,
+    isSocket: () => false,
+  }
+  delete (result as Partial<SerializedStats>).kind
+  return result as unknown as Stats
+}
+
+/**
+ * Rebuild a Dirent-compatible object from the wire representation
+ * @param parentPath - Directory the entry was listed from
+ */
+export function deserializeDirent(entry: SerializedDirent, parentPath: string): Dirent {
+  return {
+    name: entry.name,
+    parentPath,
+    path: parentPath,
+    isFile: () => entry.kind === 'file',
+    isDirectory: () => entry.kind === 'directory',
+    isSymbolicLink: () => entry.kind === 'symlink',
+    isBlockDevice: () => false,
+    isCharacterDevice: () => false,
+    isFIFO: () => false,
+    isSocket: () => false,
+  } as Dirent
+}
@@ -8,6 +8,9 @@ import { RemoteBackend } from './RemoteBackend.js'
 /**
  * Factory for creating different types of filesystem backends
  * Handles validation and instantiation of backend implementations
+ *
+ * create() is synchronous, so both backends are imported up front; the remote
+ * backend loads ssh2 only when it opens its first connection.
  */
 export class BackendFactory {
 
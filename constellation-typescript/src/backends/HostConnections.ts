@@ -0,0 +1,181 @@
+import { createHash } from 'crypto'
+import type { Client, SFTPWrapper } from 'ssh2'
+import type { AgentClient } from '../agent/AgentClient.js'
+import { FairQueue } from '../utils/PriorityQueue.js'
+import type { RemoteBackendConfig } from './types.js'
+
+/**
+ * Default maximum concurrent SSH channels per connection.
+ * Server MaxSessions is 64, we use 50 to leave headroom.
+ */
+export const DEFAULT_CHANNELS_PER_CONNECTION = 50
+
+/** Represents a pending operation that can be rejected on connection loss */
+export interface PendingOperation {
+  reject: (error: Error) => void
+  description: string
+}
+
+/** Operation run on an SSH channel of one of the host's connections */
+export type ChannelOperation<T> = (client: Client, connection: SshConnection) => Promise<T>
+
+/** Channel usage of one backend, counted against its per-user quota */
+export interface ChannelOwner {
+  activeChannels: number
+  /** Most channels the owner may hold at once */
+  readonly channelLimit: number
+}
+
+/** Queued operation waiting for a channel slot */
+export interface QueuedOperation<T> {
+  owner: ChannelOwner
+  /** startTimer() value when queued, for the queue wait metric */
+  queuedAt: number
+  execute: ChannelOperation<T>
+  resolve: (value: T) => void
+  reject: (error: Error) => void
+}
+
+/** One SSH connection of the host's sub-pool, opened on first use */
+export interface SshConnection {
+  index: number
+  client: Client | null
+  isConnected: boolean
+  connectionPromise: Promise<Client> | null
+  /** SSH channels in use, bounded by channelsPerConnection */
+  activeChannels: number
+  /** Bumped on connection loss so channels released afterwards aren't counted twice */
+  generation: number
+  /** Operations to reject if this connection drops */
+  pendingOperations: Set<PendingOperation>
+}
+
+/** One cached SFTP session, bound to a connection */
+export interface SftpSlot {
+  connection: SshConnection
+  session: SFTPWrapper | null
+  sessionPromise: Promise<SFTPWrapper> | null
+  /** File operations and open streams using the session */
+  inFlight: number
+}
+
+/**
+ * SSH connections, SFTP sessions and the agent channel to one host, with the
+ * queue of operations waiting for a channel
+ *
+ * Owned by a single RemoteBackend, or shared by every backend created with
+ * `shareConnections` for the same host, login and connection settings.
+ */
+export interface HostConnections {
+  /** Registry key of shared connections, null when owned by one backend */
+  readonly key: string | null
+  /**
+   * SSH connections to the host. Channels go to the connection with the
+   * fewest in use; the first one also carries the agent channel.
+   */
+  readonly connections: SshConnection[]
+  /**
+   * Cached SFTP sessions, spread over the connections. Each operation uses
+   * the session with the fewest operations in flight.
+   */
+  readonly sftpSlots: SftpSlot[]
+  /** Channel budget of each connection */
+  readonly channelsPerConnection: number
+  /** Operations waiting for a channel slot, round-robin across backends, interactive before bulk */
+  // eslint-disable-next-line @typescript-eslint/no-explicit-any
+  readonly operationQueue: FairQueue<ChannelOwner, QueuedOperation<any>>
+  /** Remote agent daemon client - one multiplexed channel for metadata operations */
+  agentClient: AgentClient | null
+  agentPromise: Promise<AgentClient | null> | null
+  /** Set once the agent could not be reached on this connection; cleared on reconnect */
+  agentUnavailable: boolean
+  /** Backends using these connections; the last one to be destroyed closes them */
+  users: number
+}
+
+/** Shared connections by host key */
+const sharedHosts = new Map<string, HostConnections>()
+
+/**
+ * Key of the connections a backend may share: everything that decides where
+ * and as whom it connects, and how the connections are set up
+ * Hashed so credentials aren't kept in the key.
+ */
+function hostKey(options: RemoteBackendConfig): string {
+  return createHash('sha256').update(JSON.stringify([
+    options.host,
+    options.sshPort ?? 2222,
+    options.sshAuth,
+    options.sshConnections ?? 1,
+    options.sftpSessions ?? 1,
+    options.channelsPerConnection ?? DEFAULT_CHANNELS_PER_CONNECTION,
+    options.keepaliveIntervalMs,
+    options.keepaliveCountMax,
+    options.operationTimeoutMs,
+    options.agent ?? 'auto',
+    options.agentSocketPath,
+    options.compression ?? true,
+    options.sshCompression ?? false,
+  ])).digest('hex')
+}
+
+function createHostConnections(options: RemoteBackendConfig, key: string | null): HostConnections {
+  // Connections and SFTP sessions are created here but opened lazily
+  const connections = Array.from({ length: options.sshConnections ?? 1 }, (_, index) => ({
+    index,
+    client: null,
+    isConnected: false,
+    connectionPromise: null,
+    activeChannels: 0,
+    generation: 0,
+    pendingOperations: new Set<PendingOperation>(),
+  }))
+
+  return {
+    key,
+    connections,
+    sftpSlots: Array.from({ length: options.sftpSessions ?? 1 }, (_, index) => ({
+      connection: connections[index % connections.length]!,
+      session: null,
+      sessionPromise: null,
+      inFlight: 0,
+    })),
+    channelsPerConnection: options.channelsPerConnection ?? DEFAULT_CHANNELS_PER_CONNECTION,
+    operationQueue: new FairQueue(),
+    agentClient: null,
+    agentPromise: null,
+    agentUnavailable: false,
+    users: 0,
+  }
+}
+
+/**
+ * Get the connections a new backend should use
+ * With `shareConnections` an existing entry for the same host key is reused,
+ * so backends for thousands of users cost one set of SSH handshakes and
+ * keepalives; otherwise the backend gets connections of its own.
+ */
+export function acquireHostConnections(options: RemoteBackendConfig): HostConnections {
+  const key = options.shareConnections ? hostKey(options) : null
+  let host = key !== null ? sharedHosts.get(key) : undefined
+  if (!host) {
+    host = createHostConnections(options, key)
+    if (key !== null) sharedHosts.set(key, host)
+  }
+  host.users++
+  return host
+}
+
+/**
+ * Give up a backend's use of its connections
+ * @returns Whether it was the last user, in which case the caller closes them
+ */
+export function releaseHostConnections(host: HostConnections): boolean {
+  host.users = Math.max(0, host.users - 1)
+  if (host.users > 0) return false
+
+  if (host.key !== null && sharedHosts.get(host.key) === host) {
+    sharedHosts.delete(host.key)
+  }
+  return true
+}
@@ -1,16 +1,24 @@
 import { execSync, spawn, type ChildProcess, type SpawnOptions } from 'child_process'
 import { constants, existsSync, mkdirSync, readdirSync, readFileSync, statSync, writeFileSync, type Dirent, type Stats } from 'fs'
-import { access, mkdir as fsMkdir, readdir, readFile, rm, stat, writeFile } from 'fs/promises'
+import { access, mkdir as fsMkdir, open, readdir, readFile, rm, stat, writeFile } from 'fs/promises'
 import { join } from 'path'
+import type { Readable } from 'stream'
 import { ERROR_CODES } from '../constants.js'
 import { FileSystemError } from '../types.js'
+import { cloneTree } from '../utils/cloneTree.js'
 import { LocalWorkspaceUtils } from '../utils/LocalWorkspaceUtils.js'
 import { getLogger } from '../utils/logger.js'
+import { incrementCounter } from '../utils/metrics.js'
+import { moveToTrash, TRASH_DIRECTORY } from '../utils/TrashReaper.js'
 import { LocalWorkspace } from '../workspace/LocalWorkspace.js'
-import type { Workspace, WorkspaceConfig } from '../workspace/Workspace.js'
+import type { ReadStreamOptions, Workspace, WorkspaceConfig } from '../workspace/Workspace.js'
 import type { FileSystemBackend, LocalBackendConfig } from './types.js'
 import { validateLocalBackendConfig } from './types.js'
 
+/** Labels of the workspace cache metric */
+const WORKSPACE_CACHE_HIT = { backend: 'local', result: 'hit' } as const
+const WORKSPACE_CACHE_MISS = { backend: 'local', result: 'miss' } as const
+
 /**
  * Local filesystem backend implementation
  * Executes commands and file operations on the local machine using Node.js APIs
@@ -24,6 +32,8 @@ export class LocalBackend implements FileSystemBackend {
   public readonly options: LocalBackendConfig
   public readonly connected: boolean
   private workspaceCache = new Map<string, LocalWorkspace>()
+  /** Shell resolved by getShell(), detected on first use */
+  private shell: string | null = null
 
   /**
    * Create a new LocalBackend instance
@@ -69,6 +79,34 @@ export class LocalBackend implements FileSystemBackend {
     }
   }
 
+  /**
+   * Shell that runs commands: the configured one, or for 'auto' bash when
+   * it is installed and sh otherwise. Detected once per backend.
+   */
+  getShell(): string {
+    this.shell ??= this.detectShell()
+    return this.shell
+  }
+
+  private detectShell(): string {
+    if (this.options.shell === 'bash') {
+      return 'bash'
+    } else if (this.options.shell === 'sh') {
+      return 'sh'
+    } else if (this.options.shell === 'auto') {
+      // Auto-detection: prefer bash if available, fall back to sh
+      try {
+        this.execSyncCommand('command -v bash', { stdio: 'ignore' })
+        return 'bash'
+      } catch {
+        return 'sh'
+      }
+    }
+
+    // Fallback for any unexpected shell value
+    return 'sh'
+  }
+
   /**
    * Get or create a workspace for this user
    * @param workspaceName - Workspace name (defaults to 'default')
@@ -77,11 +115,26 @@ export class LocalBackend implements FileSystemBackend {
    */
   async getWorkspace(workspaceName = 'default', config?: WorkspaceConfig): Promise<Workspace> {
     // Generate cache key that includes env config to support different configs for same workspace name
-    const cacheKey = config?.env ? `${workspaceName}:${JSON.stringify(config.env)}` : workspaceName
+    let cacheKey = config?.env ? `${workspaceName}:${JSON.stringify(config.env)}` : workspaceName
+    if (config?.searchIndex) {
+      cacheKey += ':index'
+    }
+    if (config?.syncOperations) {
+      cacheKey += `:sync=${config.syncOperations}`
+    }
+    if (config?.shellWorkers) {
+      cacheKey += `:workers=${config.shellWorkers}`
+    }
+    if (config?.quotaBytes !== undefined) {
+      cacheKey += `:quota=${config.quotaBytes}`
+    }
 
-    if (this.workspaceCache.has(cacheKey)) {
-      return this.workspaceCache.get(cacheKey)!
+    const cached = this.workspaceCache.get(cacheKey)
+    if (cached) {
+      incrementCounter('constellation_workspace_cache', WORKSPACE_CACHE_HIT)
+      return cached
     }
+    incrementCounter('constellation_workspace_cache', WORKSPACE_CACHE_MISS)
 
     // Create workspace directory for this user
     const fullPath = LocalWorkspaceUtils.ensureUserWorkspace(join(this.userId, workspaceName))
@@ -113,10 +166,48 @@ export class LocalBackend implements FileSystemBackend {
     }
   }
 
+  /**
+   * Create a workspace as a reflinked copy of another workspace of this user
+   * @param sourceName - Existing workspace to copy
+   * @param targetName - Name of the new workspace; must not exist yet
+   * @param config - Optional configuration for the returned workspace
+   * @returns Promise resolving to the new workspace
+   */
+  async cloneWorkspace(sourceName: string, targetName: string, config?: WorkspaceConfig): Promise<Workspace> {
+    const command = `clone ${sourceName} ${targetName}`
+    try {
+      LocalWorkspaceUtils.validateWorkspacePath(sourceName)
+      LocalWorkspaceUtils.validateWorkspacePath(targetName)
+    } catch (error) {
+      throw this.wrapError(error, 'Clone workspace', ERROR_CODES.INVALID_CONFIGURATION, command)
+    }
+
+    const source = LocalWorkspaceUtils.getUserWorkspacePath(join(this.userId, sourceName))
+    const target = LocalWorkspaceUtils.getUserWorkspacePath(join(this.userId, targetName))
+    try {
+      await cloneTree(source, target)
+    } catch (error) {
+      const code = (error as NodeJS.ErrnoException).code
+      const errorCode = code === 'ENOENT' || code === 'ENOTDIR' ? ERROR_CODES.WORKSPACE_NOT_FOUND : ERROR_CODES.WRITE_FAILED
+      throw this.wrapError(error, 'Clone workspace', errorCode, command)
+    }
+
+    getLogger().debug(`Cloned workspace for user ${this.userId}: ${sourceName} -> ${targetName}`)
+    return this.getWorkspace(targetName, config)
+  }
+
+  /**
+   * Nothing to connect for the local backend
+   */
+  async warmUp(): Promise<void> {}
+
   /**
    * Clean up backend resources
    */
   async destroy(): Promise<void> {
+    for (const workspace of this.workspaceCache.values()) {
+      workspace.closeShellWorkers()
+    }
     this.workspaceCache.clear()
     getLogger().debug(`LocalBackend destroyed for user: ${this.userId}`)
   }
@@ -160,6 +251,24 @@ export class LocalBackend implements FileSystemBackend {
     return await readFile(path)
   }
 
+  /**
+   * Open a read stream on a file
+   * The file is opened (and checked not to be a directory) before returning,
+   * so open errors reject here instead of surfacing on the stream.
+   */
+  async createReadStreamAsync(path: string, options: ReadStreamOptions = {}): Promise<Readable> {
+    const handle = await open(path, 'r')
+    try {
+      if ((await handle.stat()).isDirectory()) {
+        throw Object.assign(new Error(`EISDIR: illegal operation on a directory, read '${path}'`), { code: 'EISDIR' })
+      }
+    } catch (error) {
+      await handle.close()
+      throw error
+    }
+    return handle.createReadStream({ start: options.start, end: options.end })
+  }
+
   /**
    * Write file asynchronously
    */
@@ -195,6 +304,15 @@ export class LocalBackend implements FileSystemBackend {
     await rm(path, options)
   }
 
+  /**
+   * Delete a directory tree by renaming it into the workspace root's trash
+   * It is removed in the background, throttled, so this returns in constant
+   * time however large the tree is.
+   */
+  async trashAsync(path: string): Promise<void> {
+    await moveToTrash(path, LocalWorkspaceUtils.getUserWorkspacePath(TRASH_DIRECTORY))
+  }
+
   /**
    * Check if path exists asynchronously
    */
@@ -1,16 +1,75 @@
-import type { Stats } from 'fs'
+import { randomBytes } from 'crypto'
+import { createReadStream as createLocalReadStream, createWriteStream as createLocalWriteStream, type Dirent, type Stats } from 'fs'
 import { clearTimeout, setTimeout } from 'node:timers'
-import { join } from 'path'
-import type { ConnectConfig, SFTPWrapper } from 'ssh2'
-import { Client } from 'ssh2'
-import { ERROR_CODES } from '../constants.js'
-import { isCommandSafe, isDangerous } from '../safety.js'
+import { join, posix } from 'path'
+import type { Readable, Writable } from 'stream'
+import { pipeline } from 'stream/promises'
+import type { Client, ClientChannel, ConnectConfig, SFTPWrapper } from 'ssh2'
+import { AgentClient } from '../agent/AgentClient.js'
+import { supportedCompressions, type AgentCompression } from '../agent/compression.js'
+import type { AgentBatchEntry, AgentBatchOutcome } from '../agent/ops.js'
+import {
+  AGENT_PROTOCOL_VERSION,
+  AgentError,
+  deserializeDirent,
+  deserializeStats,
+  serializeSftpAttributes,
+  type AgentWatchEvent,
+  type SerializedDirent,
+  type SerializedStats,
+  type SftpAttributes
+} from '../agent/protocol.js'
+import { ERROR_CODES, type AgentMode } from '../constants.js'
+import { analyzeCommand } from '../safety.js'
 import { DangerousOperationError, FileSystemError } from '../types.js'
+import { applyEditsToContent, type ApplyEditsOptions, type ApplyEditsResult, type TextEdit } from '../utils/applyEdits.js'
+import { cloneCommand } from '../utils/cloneTree.js'
+import { ContentCache, DEFAULT_READ_CACHE_MIN_BYTES } from '../utils/ContentCache.js'
+import {
+  buildManifest,
+  chunkContent,
+  contentHash,
+  DEFAULT_DELTA_SYNC_MIN_BYTES,
+  planDelta,
+  type ContentChunk,
+  type DeltaManifest
+} from '../utils/deltaSync.js'
+import { HeadTailBuffer, execOutputLimits } from '../utils/HeadTailBuffer.js'
 import { getLogger } from '../utils/logger.js'
-import { getPlatformGuidance } from '../utils/nativeLibrary.js'
+import { incrementCounter, observe, recordDuration, startTimer } from '../utils/metrics.js'
+import { INTERCEPT_ROOT_ENV, getPlatformGuidance } from '../utils/nativeLibrary.js'
+import type { Priority } from '../utils/PriorityQueue.js'
 import { RemoteWorkspaceUtils } from '../utils/RemoteWorkspaceUtils.js'
+import { TRASH_DIRECTORY, trashCommand } from '../utils/TrashReaper.js'
+import { grepCommand, parseGrepOutput, type SearchOptions, type SearchResult } from '../utils/search.js'
+import { parseUsageOutput, usageCommand, type UsageReport } from '../utils/UsageTracker.js'
+import { parseWalkOutput, walkCommand, type WalkOptions, type WalkResult } from '../utils/walk.js'
+import {
+  closeRemoteFile,
+  DEFAULT_SFTP_CHUNK_SIZE,
+  DEFAULT_SFTP_CONCURRENCY,
+  openRemoteFile,
+  readIntoBuffer,
+  SftpReadStream,
+  SftpWriteStream,
+  writeFromBuffer,
+  type SftpReadStreamOptions,
+  type SftpTransferOptions,
+  type SftpWriteStreamOptions
+} from '../utils/sftpStreams.js'
+import { ExecStream, type ExecStreamOptions } from '../workspace/ExecStream.js'
 import { RemoteWorkspace } from '../workspace/RemoteWorkspace.js'
-import type { Workspace, WorkspaceConfig } from '../workspace/Workspace.js'
+import type { BatchOperation, BatchResult, Workspace, WorkspaceConfig } from '../workspace/Workspace.js'
+import {
+  acquireHostConnections,
+  releaseHostConnections,
+  type ChannelOperation,
+  type ChannelOwner,
+  type HostConnections,
+  type PendingOperation,
+  type SftpSlot,
+  type SshConnection
+} from './HostConnections.js'
 import type { FileSystemBackend, RemoteBackendConfig } from './types.js'
 
 /** Default timeout for filesystem operations in milliseconds (120 seconds) */
@@ -22,23 +81,52 @@ const DEFAULT_KEEPALIVE_INTERVAL_MS = 30_000
 /** Number of missed keep-alives before considering connection dead */
 const DEFAULT_KEEPALIVE_COUNT_MAX = 3
 
-/**
- * Maximum concurrent SSH channels per connection.
- * Server MaxSessions is 64, we use 50 to leave headroom.
- */
-const MAX_CONCURRENT_CHANNELS = 50
+/** How long to wait for the remote agent to answer its handshake */
+const AGENT_HANDSHAKE_TIMEOUT_MS = 5_000
+
+/** Directory holding per-user agent sockets (see remote/entrypoint.sh) */
+const DEFAULT_AGENT_SOCKET_DIR = '/run/constellationfs'
+
+/** Command used to spawn a per-connection agent when no daemon socket is available */
+const AGENT_EXEC_COMMAND = 'constellationfs agent --stdio'
+
+/** Remote files whose chunk manifests are remembered for delta writes */
+const DELTA_MANIFEST_ENTRIES = 256
+
+/** Agent op, error label and error code for each batch operation type */
+const BATCH_OPERATIONS: Record<BatchOperation['op'], { agentOp: string; label: string; errorCode: string }> = {
+  read: { agentOp: 'readFile', label: 'Read file', errorCode: ERROR_CODES.READ_FAILED },
+  write: { agentOp: 'writeFile', label: 'Write file', errorCode: ERROR_CODES.WRITE_FAILED },
+  stat: { agentOp: 'stat', label: 'Stat file', errorCode: ERROR_CODES.READ_FAILED },
+  exists: { agentOp: 'exists', label: 'Check path exists', errorCode: ERROR_CODES.READ_FAILED },
+  readdir: { agentOp: 'readdir', label: 'List directory', errorCode: ERROR_CODES.READ_FAILED },
+}
+
+/** Labels of the workspace cache metric */
+const WORKSPACE_CACHE_HIT = { backend: 'remote', result: 'hit' } as const
+const WORKSPACE_CACHE_MISS = { backend: 'remote', result: 'miss' } as const
 
-/** Represents a pending operation that can be rejected on connection loss */
-interface PendingOperation {
-  reject: (error: Error) => void
-  description: string
+let ssh2Module: Promise<typeof import('ssh2')> | null = null
+
+/** Load ssh2 on first use; it is the heaviest dependency of the remote stack */
+function loadSsh2(): Promise<typeof import('ssh2')> {
+  ssh2Module ??= import('ssh2')
+  return ssh2Module
+}
+
+/** SFTP session leased to one operation; release() when done */
+interface SftpLease {
+  sftp: SFTPWrapper
+  connection: SshConnection
+  release: () => void
 }
 
-/** Queued operation waiting for a channel slot */
-interface QueuedOperation<T> {
-  execute: () => Promise<T>
-  resolve: (value: T) => void
-  reject: (error: Error) => void
+/**
+ * A remote directory entry, with its lstat result when requested
+ */
+export interface RemoteDirectoryEntry {
+  dirent: Dirent
+  stats?: Stats
 }
 
 /**
@@ -51,25 +139,28 @@ export class RemoteBackend implements FileSystemBackend {
   public readonly type = 'remote' as const
   public readonly userId: string
   public readonly options: RemoteBackendConfig
-  public connected: boolean
-  private sshClient: Client | null = null
-  private isConnected = false
-  private connectionPromise: Promise<void> | null = null
   private workspaceCache = new Map<string, RemoteWorkspace>()
 
-  /** Track pending operations so we can reject them on connection loss */
-  private pendingOperations = new Set<PendingOperation>()
+  /**
+   * SSH connections, SFTP sessions and agent channel to the host, possibly
+   * shared with other users' backends (see `shareConnections`)
+   */
+  private readonly ssh: HostConnections
+
+  /** This backend's channels in use, bounded by `channelsPerUser` */
+  private readonly channelOwner: ChannelOwner
 
-  /** Current number of active SSH channels */
-  private activeChannels = 0
+  /** Set once destroy() has given up this backend's share of the connections */
+  private releasedConnections = false
 
-  /** Queue of operations waiting for a channel slot */
-  // eslint-disable-next-line @typescript-eslint/no-explicit-any
-  private operationQueue: QueuedOperation<any>[] = []
+  /**
+   * Chunk hashes of recently written files, by remote path, in LRU order.
+   * Only a hint for planning deltas: the agent checks the file still matches
+   */
+  private readonly deltaManifests = new Map<string, DeltaManifest>()
 
-  /** Cached SFTP session - reused for all SFTP operations to avoid channel exhaustion */
-  private sftpSession: SFTPWrapper | null = null
-  private sftpSessionPromise: Promise<SFTPWrapper> | null = null
+  /** Shared content cache for reads (`readCacheBytes`), null when off */
+  private readonly readCache: ContentCache | null
 
   /** Configurable timeout values */
   private readonly operationTimeoutMs: number
@@ -104,9 +195,16 @@ export class RemoteBackend implements FileSystemBackend {
       )
     }
 
-    // SSH client will be created on first connection (lazy initialization)
+    // SSH clients are created on first use (lazy initialization)
     // This allows reconnection with a fresh client if the connection drops
-    this.connected = false
+    this.ssh = acquireHostConnections(options)
+    this.channelOwner = { activeChannels: 0, channelLimit: options.channelsPerUser ?? Infinity }
+    this.readCache = options.readCacheBytes ? ContentCache.shared(options.readCacheBytes) : null
+  }
+
+  /** Whether any SSH connection to the host is open */
+  get connected(): boolean {
+    return this.ssh.connections.some(c => c.isConnected)
   }
 
   /**
@@ -212,67 +310,99 @@ export class RemoteBackend implements FileSystemBackend {
     return envPairs.length > 0 ? `${envPairs.join(' ')} ` : ''
   }
 
+  /**
+   * Wrap a command so it runs in a shell with the intercept library preloaded.
+   * The login shell that sshd spawns is not preloaded, so the command is handed
+   * to a fresh shell via exec; that way builtins and redirections are confined too.
+   */
+  private buildConfinedCommand(workspacePath: string, command: string, envPrefix: string): string {
+    const quote = (value: string) => `'${value.replace(/'/g, "'\\''")}'`
+    const interceptEnv = `LD_PRELOAD=${quote(this.options.interceptLibraryPath!)} ${INTERCEPT_ROOT_ENV}=${quote(workspacePath)}`
+    return `cd ${quote(workspacePath)} && ${envPrefix}${interceptEnv} exec "\${SHELL:-sh}" -c ${quote(command)}`
+  }
+
+  /**
+   * Run the safety checks for a command
+   * @returns false when a dangerous command was handed to onDangerousOperation
+   *   instead of running
+   * @throws {DangerousOperationError} When the command is dangerous and no handler is set
+   * @throws {FileSystemError} When the command fails any other safety check
+   */
+  private checkCommand(command: string): boolean {
+    const safetyCheck = analyzeCommand(command)
+    if (safetyCheck.safe) {
+      return true
+    }
+
+    if (this.options.preventDangerous && safetyCheck.dangerous) {
+      if (this.options.onDangerousOperation) {
+        this.options.onDangerousOperation(command)
+        return false
+      } else {
+        throw new DangerousOperationError(command)
+      }
+    }
+
+    throw new FileSystemError(
+      safetyCheck.reason || 'Command failed safety check',
+      ERROR_CODES.DANGEROUS_OPERATION,
+      command
+    )
+  }
+
+  /**
+   * Whether commands in this workspace run under the intercept library
+   */
+  private isConfined(workspacePath: string): boolean {
+    return !!this.options.interceptLibraryPath && !!workspacePath && workspacePath !== '/'
+  }
+
+  /**
+   * Build the remote command line: environment, workspace change and confinement
+   */
+  private buildFullCommand(workspacePath: string, command: string, customEnv?: Record<string, string | undefined>): string {
+    const envPrefix = this.buildEnvPrefix(customEnv)
+
+    return this.isConfined(workspacePath)
+      ? this.buildConfinedCommand(workspacePath, command, envPrefix)
+      : workspacePath && workspacePath !== '/'
+        ? `${envPrefix}cd "${workspacePath}" && ${command}`
+        : `${envPrefix}${command}`
+  }
+
   /**
    * Execute command in a specific workspace path (internal use by Workspace)
    * @param workspacePath - Absolute path to workspace directory
    * @param command - Command to execute
    * @param encoding - Output encoding: 'utf8' for string (default), 'buffer' for raw Buffer
    * @param customEnv - Optional custom environment variables
+   * @param maxBufferedBytes - Optional cap on retained stdout/stderr bytes (head and tail)
    * @returns Promise resolving to command output as string or Buffer based on encoding
    */
   async execInWorkspace(
     workspacePath: string,
     command: string,
     encoding: 'utf8' | 'buffer' = 'utf8',
-    customEnv?: Record<string, string | undefined>
+    customEnv?: Record<string, string | undefined>,
+    maxBufferedBytes?: number
   ): Promise<string | Buffer> {
-    // Safety check
-    const safetyCheck = isCommandSafe(command)
-    if (!safetyCheck.safe) {
-      if (this.options.preventDangerous && isDangerous(command)) {
-        if (this.options.onDangerousOperation) {
-          this.options.onDangerousOperation(command)
-          return encoding === 'buffer' ? Buffer.alloc(0) : ''
-        } else {
-          throw new DangerousOperationError(command)
-        }
-      }
-
-      throw new FileSystemError(
-        safetyCheck.reason || 'Command failed safety check',
-        ERROR_CODES.DANGEROUS_OPERATION,
-        command
-      )
+    if (!this.checkCommand(command)) {
+      return encoding === 'buffer' ? Buffer.alloc(0) : ''
     }
 
-    // Ensure SSH connection is established
-    await this.ensureSSHConnection()
-
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.EXEC_FAILED)
-    }
+    const limits = execOutputLimits(maxBufferedBytes, encoding === 'utf8' ? this.options.maxOutputLength : undefined)
 
     // Use channel limiting to avoid overwhelming the SSH server
-    return this.withChannelLimit(() => new Promise((resolve, reject) => {
-      if (!this.sshClient) {
-        throw new FileSystemError('SSH client not initialized', ERROR_CODES.EXEC_FAILED)
-      }
-
-      // Build environment variable prefix
-      const envPrefix = this.buildEnvPrefix(customEnv)
-
+    return this.withChannelLimit((client, connection) => new Promise((resolve, reject) => {
       // Build full command with environment variables and workspace change
-      const fullCommand =
-        workspacePath && workspacePath !== '/'
-          ? `${envPrefix}cd "${workspacePath}" && ${command}`
-          : `${envPrefix}${command}`
+      const fullCommand = this.buildFullCommand(workspacePath, command, customEnv)
 
       getLogger().debug(`[SSH exec] Executing command: ${fullCommand}`)
 
       let completed = false
 
       // Track this operation so it can be rejected on connection loss
-      const untrack = this.trackOperation(`exec: ${command}`, reject)
+      const untrack = this.trackOperation(connection, `exec: ${command}`, reject)
 
       const complete = () => {
         if (!completed) {
@@ -294,7 +424,7 @@ export class RemoteBackend implements FileSystemBackend {
         }
       }, this.operationTimeoutMs)
 
-      this.sshClient.exec(fullCommand, (err, stream) => {
+      client.exec(fullCommand, (err, stream) => {
         if (err) {
           if (completed) return
           complete()
@@ -308,15 +438,15 @@ export class RemoteBackend implements FileSystemBackend {
           return
         }
 
-        // Collect output as Buffer chunks to properly support both encodings
-        const stdoutChunks: Buffer[] = []
-        const stderrChunks: Buffer[] = []
+        // Collect output as Buffers to properly support both encodings (bounded when a limit applies)
+        const stdoutCollected = new HeadTailBuffer(limits)
+        const stderrCollected = new HeadTailBuffer(limits)
 
         stream.on('error', (streamErr: Error) => {
           if (completed) return
           complete()
-          const stdout = Buffer.concat(stdoutChunks).toString('utf-8')
-          const stderr = Buffer.concat(stderrChunks).toString('utf-8')
+          const stdout = stdoutCollected.toString('utf-8')
+          const stderr = stderrCollected.toString('utf-8')
           reject(new FileSystemError(
             `SSH stream error for command: ${command}. Error: ${streamErr.message}. Stdout: ${stdout}. Stderr: ${stderr}`,
             ERROR_CODES.EXEC_FAILED,
@@ -325,7 +455,7 @@ export class RemoteBackend implements FileSystemBackend {
         })
 
         stream.on('data', (data: Buffer) => {
-          stdoutChunks.push(data)
+          stdoutCollected.append(data)
           // Only log if it looks like text (not binary data)
           if (process.env.CONSTELLATION_DEBUG_LOGGING === 'true') {
             const chunk = data.toString()
@@ -336,7 +466,7 @@ export class RemoteBackend implements FileSystemBackend {
         })
 
         stream.stderr.on('data', (data: Buffer) => {
-          stderrChunks.push(data)
+          stderrCollected.append(data)
           // Only log if it looks like text (not binary data)
           if (process.env.CONSTELLATION_DEBUG_LOGGING === 'true') {
             const chunk = data.toString()
@@ -350,28 +480,26 @@ export class RemoteBackend implements FileSystemBackend {
           if (completed) return
           complete()
 
-          const stdoutBuffer = Buffer.concat(stdoutChunks)
-          const stderrBuffer = Buffer.concat(stderrChunks)
-
           if (code === 0) {
             if (encoding === 'buffer') {
               // Return raw binary data as Buffer
-              resolve(stdoutBuffer)
+              resolve(stdoutCollected.toBuffer())
             } else {
               // Return as UTF-8 string (default behavior)
-              let output = stdoutBuffer.toString('utf-8').trim()
+              let output = stdoutCollected.toString('utf-8').trim()
 
               // Apply output length limit if configured
               if (this.options.maxOutputLength && output.length > this.options.maxOutputLength) {
                 const truncatedLength = this.options.maxOutputLength - 50
-                output = `${output.substring(0, truncatedLength)}\n\n... [Output truncated. Full output was ${output.length} characters, showing first ${truncatedLength}]`
+                const fullLength = stdoutCollected.truncated ? `${stdoutCollected.totalBytes} bytes` : `${output.length} characters`
+                output = `${output.substring(0, truncatedLength)}\n\n... [Output truncated. Full output was ${fullLength}, showing first ${truncatedLength} characters]`
               }
 
               resolve(output)
             }
           } else {
-            const stdout = stdoutBuffer.toString('utf-8').trim()
-            const stderr = stderrBuffer.toString('utf-8').trim()
+            const stdout = stdoutCollected.toString('utf-8').trim()
+            const stderr = stderrCollected.toString('utf-8').trim()
             const errorMessage = stderr || stdout
             reject(
               new FileSystemError(
@@ -387,44 +515,137 @@ export class RemoteBackend implements FileSystemBackend {
   }
 
   /**
-   * Ensure SSH connection is established
+   * Execute a command in a workspace and stream its output (internal use by Workspace)
+   * The channel slot is held until the command exits. Pausing the returned
+   * stream pauses the SSH channel, so the remote process blocks on its pipe.
+   * The operation timeout applies to the whole command.
+   * @param workspacePath - Absolute path to workspace directory
+   * @param command - Command to execute
+   * @param options - Environment variables, retention and buffering limits
+   * @returns Promise resolving once the command has started
+   */
+  async execStreamInWorkspace(workspacePath: string, command: string, options?: ExecStreamOptions): Promise<ExecStream> {
+    if (!this.checkCommand(command)) {
+      return ExecStream.empty()
+    }
+
+    return new Promise<ExecStream>((resolve, reject) => {
+      // Long-running: queued behind interactive operations when channels are scarce
+      this.withChannelLimit((client, connection) => new Promise<void>((release) => {
+        const fullCommand = this.buildFullCommand(workspacePath, command, options?.env)
+        getLogger().debug(`[SSH exec] Streaming command: ${fullCommand}`)
+
+        client.exec(fullCommand, (err, channel) => {
+          if (err) {
+            release()
+            reject(new FileSystemError(
+              `SSH command failed in workspace: ${workspacePath}, command: ${command}. Error: ${err.message}`,
+              ERROR_CODES.EXEC_FAILED,
+              command
+            ))
+            return
+          }
+
+          const stream = new ExecStream(options)
+          const untrack = this.trackOperation(connection, `execStream: ${command}`, (error) => stream.fail(error))
+
+          const timeout = setTimeout(() => {
+            getLogger().error(`[SSH exec] Command timed out after ${this.operationTimeoutMs}ms: ${command}`)
+            stream.fail(new FileSystemError(
+              `SSH command timed out after ${this.operationTimeoutMs}ms`,
+              ERROR_CODES.EXEC_FAILED,
+              command
+            ))
+          }, this.operationTimeoutMs)
+
+          stream.attach(channel, channel.stderr, () => {
+            channel.signal('TERM')
+            channel.close()
+          })
+
+          channel.on('exit', (code: number | null, signal?: string) => {
+            stream.exited(code ?? null, signal ?? null)
+          })
+
+          channel.on('close', (code?: number | null) => {
+            clearTimeout(timeout)
+            untrack()
+            // Servers that send no exit-status still close the channel
+            stream.exited(code ?? null, null)
+            release()
+          })
+
+          channel.on('error', (streamErr: Error) => {
+            stream.fail(new FileSystemError(
+              `SSH stream error for command: ${command}. Error: ${streamErr.message}`,
+              ERROR_CODES.EXEC_FAILED,
+              command
+            ))
+          })
+
+          resolve(stream)
+        })
+      }), 'bulk').catch(reject)
+    })
+  }
+
+  /**
+   * Ensure the primary SSH connection is established
+   * The primary connection carries the agent channel and workspace setup.
+   */
+  private async ensureSSHConnection(): Promise<Client> {
+    return this.connect(this.ssh.connections[0]!)
+  }
+
+  /**
+   * Ensure a connection of the sub-pool is established
    */
-  private async ensureSSHConnection(): Promise<void> {
+  private async connect(connection: SshConnection): Promise<Client> {
     // If already connected, return immediately
-    if (this.isConnected && this.sshClient) {
-      getLogger().debug('[SSH] ensureSSHConnection: already connected')
-      return Promise.resolve()
+    if (connection.isConnected && connection.client) {
+      getLogger().debug(`[SSH #${connection.index}] connect: already connected`)
+      return connection.client
     }
 
     // If connection is in progress, wait for it
-    if (this.connectionPromise) {
-      getLogger().debug('[SSH] ensureSSHConnection: connection in progress, waiting...')
-      return this.connectionPromise
+    if (connection.connectionPromise) {
+      getLogger().debug(`[SSH #${connection.index}] connect: connection in progress, waiting...`)
+      return connection.connectionPromise
     }
 
     // Start new connection (this will create a fresh SSH client if needed)
-    getLogger().debug(`[SSH] ensureSSHConnection: starting new connection (isConnected=${this.isConnected}, sshClient=${!!this.sshClient})`)
-    this.connectionPromise = this.connectSSH()
-    return this.connectionPromise
+    getLogger().debug(`[SSH #${connection.index}] connect: starting new connection (isConnected=${connection.isConnected}, sshClient=${!!connection.client})`)
+    const timer = startTimer()
+    connection.connectionPromise = this.connectSSH(connection)
+    if (timer) {
+      connection.connectionPromise.then(
+        () => recordDuration('constellation_ssh_connect', timer),
+        () => incrementCounter('constellation_ssh_connect_failures')
+      )
+    }
+    return connection.connectionPromise
   }
 
   /**
    * Connect to SSH server
    * Creates a fresh SSH client instance to ensure clean state
    */
-  private async connectSSH(): Promise<void> {
+  private async connectSSH(connection: SshConnection): Promise<Client> {
+    // ssh2 is loaded on the first connection, so local-only users never load it
+    const { Client } = await loadSsh2()
     return new Promise((resolve, reject) => {
       // Always create a fresh SSH client - ssh2 Client cannot be reused after close
-      if (this.sshClient) {
+      if (connection.client) {
         // Clean up old client if it exists
-        this.sshClient.removeAllListeners()
+        connection.client.removeAllListeners()
         try {
-          this.sshClient.end()
+          connection.client.end()
         } catch {
           // Ignore errors when ending old client
         }
       }
-      this.sshClient = new Client()
+      const client = new Client()
+      connection.client = client
 
       const sshAuth = this.options.sshAuth
       const connectOptions: ConnectConfig = {
@@ -449,41 +670,45 @@ export class RemoteBackend implements FileSystemBackend {
         }
       }
 
+      if (this.options.sshCompression) {
+        // Offered in order; servers without compression fall back to 'none'
+        connectOptions.algorithms = { compress: ['zlib@openssh.com', 'zlib', 'none'] }
+      }
+
       // Enable client-side keep-alives to detect dead connections proactively
       connectOptions.keepaliveInterval = this.keepaliveIntervalMs
       connectOptions.keepaliveCountMax = this.keepaliveCountMax
 
       // Set up event handlers BEFORE connecting
-      this.sshClient.on('ready', () => {
-        this.isConnected = true
-        this.connected = true
-        this.connectionPromise = null
-        getLogger().debug('[ConstellationFS] SSH connection ready')
-        resolve()
+      client.on('ready', () => {
+        connection.isConnected = true
+        connection.connectionPromise = null
+        getLogger().debug(`[ConstellationFS] SSH connection #${connection.index} ready`)
+        resolve(client)
       })
 
-      this.sshClient.on('end', () => {
+      client.on('end', () => {
         // 'end' fires when the connection is gracefully closed
-        getLogger().debug('[ConstellationFS] SSH connection ended')
-        this.handleConnectionLoss('Connection ended')
+        getLogger().debug(`[ConstellationFS] SSH connection #${connection.index} ended`)
+        this.handleConnectionLoss(connection, 'Connection ended')
       })
 
-      this.sshClient.on('close', () => {
+      client.on('close', () => {
         // 'close' fires after connection is fully closed (may follow 'end' or happen on its own)
-        getLogger().debug('[ConstellationFS] SSH connection closed')
-        this.handleConnectionLoss('Connection closed')
+        getLogger().debug(`[ConstellationFS] SSH connection #${connection.index} closed`)
+        this.handleConnectionLoss(connection, 'Connection closed')
       })
 
-      this.sshClient.on('error', (err) => {
-        getLogger().error('[ConstellationFS] SSH connection error', err)
-        this.handleConnectionLoss(`Connection error: ${err.message}`)
+      client.on('error', (err) => {
+        getLogger().error(`[ConstellationFS] SSH connection #${connection.index} error`, err)
+        this.handleConnectionLoss(connection, `Connection error: ${err.message}`)
         reject(err)
       })
 
       // Handle keyboard-interactive authentication (required by some SSH servers)
       // This must be set up before connect() is called
       if (sshAuth.type === 'password') {
-        this.sshClient.on('keyboard-interactive', (_name, _instructions, _instructionsLang, prompts, finish) => {
+        client.on('keyboard-interactive', (_name, _instructions, _instructionsLang, prompts, finish) => {
           getLogger().debug(`[ConstellationFS] Keyboard-interactive auth requested with ${prompts.length} prompt(s)`)
           // Respond to all prompts with the password
           const responses = prompts.map(() => sshAuth.credentials.password as string)
@@ -491,28 +716,38 @@ export class RemoteBackend implements FileSystemBackend {
         })
       }
 
-      this.sshClient.connect(connectOptions)
+      client.connect(connectOptions)
     })
   }
 
   /**
-   * Handle connection loss by rejecting all pending operations
+   * Handle connection loss by rejecting the connection's pending operations
    * This ensures operations don't hang when the connection drops
    */
-  private handleConnectionLoss(reason: string): void {
+  private handleConnectionLoss(connection: SshConnection, reason: string): void {
     // Only process if we were previously connected
-    const wasConnected = this.isConnected
+    const wasConnected = connection.isConnected
+
+    connection.isConnected = false
+    connection.connectionPromise = null
 
-    this.isConnected = false
-    this.connected = false
-    this.connectionPromise = null
+    // Clear cached SFTP sessions (they're tied to the old connection)
+    for (const slot of this.ssh.sftpSlots) {
+      if (slot.connection !== connection) continue
+      if (slot.session) {
+        getLogger().debug('[ConstellationFS] Clearing cached SFTP session due to connection loss')
+        slot.session = null
+      }
+      slot.sessionPromise = null
+    }
 
-    // Clear cached SFTP session (it's tied to the old connection)
-    if (this.sftpSession) {
-      getLogger().debug('[ConstellationFS] Clearing cached SFTP session due to connection loss')
-      this.sftpSession = null
+    // The agent channel died with the primary connection; retry it after reconnecting
+    if (connection.index === 0) {
+      this.ssh.agentClient?.close()
+      this.ssh.agentClient = null
+      this.ssh.agentPromise = null
+      this.ssh.agentUnavailable = false
     }
-    this.sftpSessionPromise = null
 
     const error = new FileSystemError(
       `SSH connection lost: ${reason}`,
@@ -520,127 +755,200 @@ export class RemoteBackend implements FileSystemBackend {
     )
 
     // Reject all pending operations
-    if (wasConnected && this.pendingOperations.size > 0) {
-      getLogger().warn(`[ConstellationFS] Connection lost (${reason}), rejecting ${this.pendingOperations.size} pending operation(s)`)
-      for (const op of this.pendingOperations) {
+    if (wasConnected && connection.pendingOperations.size > 0) {
+      getLogger().warn(`[ConstellationFS] Connection lost (${reason}), rejecting ${connection.pendingOperations.size} pending operation(s)`)
+      for (const op of connection.pendingOperations) {
         getLogger().debug(`[ConstellationFS] Rejecting pending operation: ${op.description}`)
         op.reject(error)
       }
-      this.pendingOperations.clear()
+      connection.pendingOperations.clear()
     }
 
-    // Reject all queued operations
-    if (this.operationQueue.length > 0) {
-      getLogger().warn(`[ConstellationFS] Connection lost (${reason}), rejecting ${this.operationQueue.length} queued operation(s)`)
-      for (const queued of this.operationQueue) {
+    // Reset channel count; operations still unwinding on the old client won't release into it
+    connection.activeChannels = 0
+    connection.generation++
+
+    // Reject all queued operations unless another connection can still run them
+    const usable = this.ssh.connections.some(c => c.isConnected || c.connectionPromise)
+    if (!usable && this.ssh.operationQueue.length > 0) {
+      getLogger().warn(`[ConstellationFS] Connection lost (${reason}), rejecting ${this.ssh.operationQueue.length} queued operation(s)`)
+      for (const queued of this.ssh.operationQueue.drain()) {
         queued.reject(error)
       }
-      this.operationQueue = []
     }
-
-    // Reset channel count
-    this.activeChannels = 0
   }
 
   /**
    * Register a pending operation for tracking
    * Returns a cleanup function to call when the operation completes
    */
-  private trackOperation(description: string, reject: (error: Error) => void): () => void {
+  private trackOperation(connection: SshConnection, description: string, reject: (error: Error) => void): () => void {
     const op: PendingOperation = { reject, description }
-    this.pendingOperations.add(op)
+    connection.pendingOperations.add(op)
 
     return () => {
-      this.pendingOperations.delete(op)
+      connection.pendingOperations.delete(op)
     }
   }
 
   /**
    * Execute an operation with channel concurrency limiting.
-   * Ensures we don't exceed MAX_CONCURRENT_CHANNELS to avoid SSH server rejection.
+   * Runs on the connection with the fewest channels in use, so no connection
+   * exceeds channelsPerConnection and gets rejected by the SSH server. When
+   * every connection is at its budget, or this backend holds channelsPerUser
+   * channels, the operation is queued. Queued operations are taken from each
+   * backend sharing the connections in turn, interactive before bulk.
    */
-  private async withChannelLimit<T>(operation: () => Promise<T>): Promise<T> {
+  private async withChannelLimit<T>(operation: ChannelOperation<T>, priority: Priority = 'interactive'): Promise<T> {
     // If we have capacity, execute immediately
-    if (this.activeChannels < MAX_CONCURRENT_CHANNELS) {
-      return this.executeWithChannelTracking(operation)
+    const owner = this.channelOwner
+    const connection = owner.activeChannels < owner.channelLimit ? this.leastLoadedConnection() : null
+    if (connection) {
+      observe('constellation_channel_queue_wait', 0)
+      return this.executeWithChannelTracking(connection, owner, operation)
     }
 
     // Otherwise, queue the operation
+    incrementCounter('constellation_channel_queued', { priority })
     return new Promise<T>((resolve, reject) => {
-      this.operationQueue.push({
+      this.ssh.operationQueue.push(owner, {
+        owner,
+        queuedAt: startTimer(),
         execute: operation,
         resolve,
         reject,
-      })
-      getLogger().debug(`[SSH] Operation queued, queue size: ${this.operationQueue.length}, active channels: ${this.activeChannels}`)
+      }, priority)
+      getLogger().debug(`[SSH] ${priority} operation queued, queue size: ${this.ssh.operationQueue.length}`)
     })
   }
 
+  /**
+   * Connection with the fewest channels in use that is under its budget
+   * Ties go to the lowest index, so extra connections are only opened once
+   * the first ones are busy.
+   */
+  private leastLoadedConnection(): SshConnection | null {
+    let best: SshConnection | null = null
+    for (const connection of this.ssh.connections) {
+      if (connection.activeChannels >= this.ssh.channelsPerConnection) continue
+      if (!best || connection.activeChannels < best.activeChannels) {
+        best = connection
+      }
+    }
+    return best
+  }
+
   /**
    * Execute an operation while tracking channel usage
    */
-  private async executeWithChannelTracking<T>(operation: () => Promise<T>): Promise<T> {
-    this.activeChannels++
-    getLogger().debug(`[SSH] Channel acquired, active: ${this.activeChannels}/${MAX_CONCURRENT_CHANNELS}`)
+  private async executeWithChannelTracking<T>(connection: SshConnection, owner: ChannelOwner, operation: ChannelOperation<T>): Promise<T> {
+    // Take the slot before connecting so concurrent callers spread out
+    const generation = connection.generation
+    connection.activeChannels++
+    owner.activeChannels++
+    getLogger().debug(`[SSH #${connection.index}] Channel acquired, active: ${connection.activeChannels}/${this.ssh.channelsPerConnection}`)
 
     try {
-      return await operation()
+      const client = await this.connect(connection)
+      return await operation(client, connection)
     } finally {
-      this.activeChannels--
-      getLogger().debug(`[SSH] Channel released, active: ${this.activeChannels}/${MAX_CONCURRENT_CHANNELS}`)
+      if (connection.generation === generation) {
+        connection.activeChannels--
+      }
+      owner.activeChannels--
+      getLogger().debug(`[SSH #${connection.index}] Channel released, active: ${connection.activeChannels}/${this.ssh.channelsPerConnection}`)
       this.processQueue()
     }
   }
 
   /**
    * Process queued operations when a channel becomes available
+   * The queue is shared with the other backends on these connections, so
+   * this may start their operations; owners at their quota are passed over.
    */
   private processQueue(): void {
-    while (this.operationQueue.length > 0 && this.activeChannels < MAX_CONCURRENT_CHANNELS) {
-      const queued = this.operationQueue.shift()!
-      getLogger().debug(`[SSH] Dequeuing operation, remaining queue: ${this.operationQueue.length}`)
+    while (this.ssh.operationQueue.length > 0) {
+      const connection = this.leastLoadedConnection()
+      if (!connection) return
+
+      const queued = this.ssh.operationQueue.shift(owner => owner.activeChannels < owner.channelLimit)
+      if (!queued) return
+      getLogger().debug(`[SSH] Dequeuing operation, remaining queue: ${this.ssh.operationQueue.length}`)
+      recordDuration('constellation_channel_queue_wait', queued.queuedAt)
 
       // Execute the queued operation
-      this.executeWithChannelTracking(queued.execute)
+      this.executeWithChannelTracking(connection, queued.owner, queued.execute)
         .then(queued.resolve)
         .catch(queued.reject)
     }
   }
 
   /**
-   * Get or create a cached SFTP session.
-   * Reuses a single SFTP channel for all SFTP operations to avoid channel exhaustion.
-   * The SFTP session is automatically cleaned up on connection loss.
+   * Lease the SFTP session with the fewest operations in flight
+   * Sessions are created on first use and cleaned up on connection loss.
+   * Callers must release() the lease when their operation (or stream) ends.
    */
-  private async getSftpSession(): Promise<SFTPWrapper> {
-    // Return existing session if available
-    if (this.sftpSession) {
-      return this.sftpSession
+  private async acquireSftp(): Promise<SftpLease> {
+    let slot = this.ssh.sftpSlots[0]!
+    for (const candidate of this.ssh.sftpSlots) {
+      if (candidate.inFlight < slot.inFlight) {
+        slot = candidate
+      }
     }
 
-    // If session creation is in progress, wait for it
-    if (this.sftpSessionPromise) {
-      return this.sftpSessionPromise
+    slot.inFlight++
+    let released = false
+    const release = () => {
+      if (released) return
+      released = true
+      slot.inFlight--
     }
 
-    // Ensure SSH connection first
-    await this.ensureSSHConnection()
+    try {
+      const sftp = await this.getSftpSession(slot)
+      return { sftp, connection: slot.connection, release }
+    } catch (error) {
+      release()
+      throw error
+    }
+  }
+
+  /**
+   * Run an operation on a leased SFTP session
+   */
+  private async withSftp<T>(operation: (sftp: SFTPWrapper) => Promise<T>): Promise<T> {
+    const timer = startTimer()
+    const lease = await this.acquireSftp()
+    try {
+      return await operation(lease.sftp)
+    } finally {
+      lease.release()
+      recordDuration('constellation_sftp_operation', timer)
+    }
+  }
 
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.READ_FAILED)
+  /**
+   * Get or create the cached SFTP session of a slot.
+   * Each session is one long-lived channel, shared by the operations leasing
+   * it, to avoid channel exhaustion.
+   */
+  private async getSftpSession(slot: SftpSlot): Promise<SFTPWrapper> {
+    // Return existing session if available
+    if (slot.session) {
+      return slot.session
     }
 
-    // Create new SFTP session (this opens one channel that stays open)
-    this.sftpSessionPromise = new Promise<SFTPWrapper>((resolve, reject) => {
-      if (!this.sshClient) {
-        reject(new FileSystemError('SSH client not initialized', ERROR_CODES.READ_FAILED))
-        return
-      }
+    // If session creation is in progress, wait for it
+    if (slot.sessionPromise) {
+      return slot.sessionPromise
+    }
 
-      getLogger().debug('[SFTP] Creating new cached SFTP session')
+    // Create new SFTP session (this opens one channel that stays open)
+    slot.sessionPromise = this.connect(slot.connection).then(client => new Promise<SFTPWrapper>((resolve, reject) => {
+      getLogger().debug(`[SFTP] Creating new cached SFTP session on connection #${slot.connection.index}`)
 
-      this.sshClient.sftp((err, sftp) => {
-        this.sftpSessionPromise = null
+      client.sftp((err, sftp) => {
+        slot.sessionPromise = null
 
         if (err) {
           getLogger().error('[SFTP] Failed to create SFTP session', err)
@@ -654,21 +962,127 @@ export class RemoteBackend implements FileSystemBackend {
         // Listen for session close to clear the cache
         sftp.on('close', () => {
           getLogger().debug('[SFTP] Cached SFTP session closed')
-          this.sftpSession = null
+          if (slot.session === sftp) slot.session = null
         })
 
         sftp.on('error', (sftpErr: Error) => {
           getLogger().error('[SFTP] Cached SFTP session error', sftpErr)
-          this.sftpSession = null
+          if (slot.session === sftp) slot.session = null
         })
 
         getLogger().debug('[SFTP] Cached SFTP session created successfully')
-        this.sftpSession = sftp
+        slot.session = sftp
         resolve(sftp)
       })
+    }), (error) => {
+      slot.sessionPromise = null
+      throw error
+    })
+
+    return slot.sessionPromise
+  }
+
+  /**
+   * Get the remote agent client, connecting on first use.
+   * Tries the daemon socket started by entrypoint.sh, then spawning an agent
+   * over exec. Resolves to null when neither works (or agent is 'off'), in
+   * which case callers fall back to running shell commands.
+   */
+  private async getAgent(): Promise<AgentClient | null> {
+    const mode = this.options.agent ?? 'auto'
+    if (mode === 'off' || this.ssh.agentUnavailable) {
+      return null
+    }
+
+    if (this.ssh.agentClient && !this.ssh.agentClient.closed) {
+      return this.ssh.agentClient
+    }
+
+    if (this.ssh.agentPromise) {
+      return this.ssh.agentPromise
+    }
+
+    this.ssh.agentPromise = this.connectAgent(mode).finally(() => {
+      this.ssh.agentPromise = null
     })
+    return this.ssh.agentPromise
+  }
+
+  private async connectAgent(mode: Exclude<AgentMode, 'off'>): Promise<AgentClient | null> {
+    const sshClient = await this.ensureSSHConnection()
+
+    const transports: Array<'socket' | 'exec'> = mode === 'auto' ? ['socket', 'exec'] : [mode]
+
+    for (const transport of transports) {
+      try {
+        const channel = await this.openAgentChannel(sshClient, transport)
+        const client = new AgentClient(channel, { timeoutMs: this.operationTimeoutMs })
+
+        let handshakeTimer: ReturnType<typeof setTimeout> | undefined
+        const hello = await Promise.race([
+          client.request<{ version: number; compression?: AgentCompression | null }>('hello', {
+            // SSH compression already covers the agent channel
+            compression: (this.options.compression ?? true) && !this.options.sshCompression ? supportedCompressions() : [],
+          }),
+          new Promise<never>((_, reject) => {
+            handshakeTimer = setTimeout(() => reject(new Error('handshake timed out')), AGENT_HANDSHAKE_TIMEOUT_MS)
+          }),
+        ]).finally(() => clearTimeout(handshakeTimer))
+
+        if (hello.version !== AGENT_PROTOCOL_VERSION) {
+          client.close()
+          throw new Error(`protocol version ${hello.version}, expected ${AGENT_PROTOCOL_VERSION}`)
+        }
+
+        // Agents that predate compression ignore the offer and reply without a codec
+        if (hello.compression) {
+          client.enableCompression(hello.compression)
+        }
 
-    return this.sftpSessionPromise
+        client.onClose(() => {
+          if (this.ssh.agentClient === client) {
+            this.ssh.agentClient = null
+          }
+        })
+        this.ssh.agentClient = client
+        getLogger().debug(`[Agent] Connected via ${transport}`)
+        return client
+      } catch (error) {
+        getLogger().debug(`[Agent] ${transport} transport unavailable: ${error instanceof Error ? error.message : String(error)}`)
+      }
+    }
+
+    getLogger().debug('[Agent] Remote agent unavailable, falling back to shell commands')
+    this.ssh.agentUnavailable = true
+    return null
+  }
+
+  /**
+   * Open the byte stream the agent protocol runs over
+   */
+  private openAgentChannel(sshClient: Client, transport: 'socket' | 'exec'): Promise<ClientChannel> {
+    return new Promise((resolve, reject) => {
+      if (transport === 'socket') {
+        const socketPath = this.options.agentSocketPath ?? `${DEFAULT_AGENT_SOCKET_DIR}/${this.getUserFromAuth()}.sock`
+        sshClient.openssh_forwardOutStreamLocal(socketPath, (err, channel) => {
+          if (err) reject(err)
+          else resolve(channel)
+        })
+        return
+      }
+
+      sshClient.exec(AGENT_EXEC_COMMAND, (err, channel) => {
+        if (err) {
+          reject(err)
+          return
+        }
+        // Agent logs go to stderr; drain it so the channel window never fills
+        channel.stderr.on('data', (data: Buffer) => {
+          getLogger().debug(`[Agent stderr] ${data.toString().trim()}`)
+        })
+        resolve(channel)
+      })
+    })
   }
 
   /**
@@ -679,24 +1093,41 @@ export class RemoteBackend implements FileSystemBackend {
    */
   async getWorkspace(workspaceName = 'default', config?: WorkspaceConfig): Promise<Workspace> {
     // Ensure SSH connection
-    await this.ensureSSHConnection()
-
-    // Generate cache key that includes env config
-    const cacheKey = config?.env ? `${workspaceName}:${JSON.stringify(config.env)}` : workspaceName
+    const sshClient = await this.ensureSSHConnection()
 
-    if (this.workspaceCache.has(cacheKey)) {
-      return this.workspaceCache.get(cacheKey)!
+    // Generate cache key that includes env config (and metadata caching and search indexing, which are per instance)
+    let cacheKey = config?.env ? `${workspaceName}:${JSON.stringify(config.env)}` : workspaceName
+    if (config?.metadataCache) {
+      cacheKey += `:cache=${JSON.stringify(config.metadataCache)}`
     }
-
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.EXEC_FAILED)
+    if (config?.searchIndex) {
+      cacheKey += ':index'
+    }
+    if (config?.quotaBytes !== undefined) {
+      cacheKey += `:quota=${config.quotaBytes}`
     }
 
-    // Create workspace directory for this user on remote system using static utility
-    const fullPath = await RemoteWorkspaceUtils.ensureUserWorkspace(
-      this.sshClient,
-      join(this.userId, workspaceName)
-    )
+    const cached = this.workspaceCache.get(cacheKey)
+    if (cached) {
+      incrementCounter('constellation_workspace_cache', WORKSPACE_CACHE_HIT)
+      return cached
+    }
+    incrementCounter('constellation_workspace_cache', WORKSPACE_CACHE_MISS)
+
+    // Create workspace directory for this user on remote system
+    const agent = await this.getAgent()
+    let fullPath: string
+    if (agent) {
+      fullPath = RemoteWorkspaceUtils.getUserWorkspacePath(join(this.userId, workspaceName))
+      await agent.request('mkdir', { path: fullPath, recursive: true }).catch((error) => {
+        throw this.wrapError(error, 'Create workspace', ERROR_CODES.EXEC_FAILED, `mkdir -p ${fullPath}`, fullPath)
+      })
+    } else {
+      fullPath = await RemoteWorkspaceUtils.ensureUserWorkspace(
+        sshClient,
+        join(this.userId, workspaceName)
+      )
+    }
 
     const workspace = new RemoteWorkspace(this, this.userId, workspaceName, fullPath, config)
     this.workspaceCache.set(cacheKey, workspace)
@@ -723,115 +1154,538 @@ export class RemoteBackend implements FileSystemBackend {
   }
 
   /**
-   * Public helper methods for RemoteWorkspace
+   * Create a workspace as a copy of another workspace of this user
+   * The agent reflinks files where the remote filesystem supports it; without
+   * the agent, or with one that predates the 'clone' operation,
+   * `cp -a --reflink=auto` does the same.
+   * @param sourceName - Existing workspace to copy
+   * @param targetName - Name of the new workspace; must not exist yet
+   * @param config - Optional configuration for the returned workspace
+   * @returns Promise resolving to the new workspace
    */
+  async cloneWorkspace(sourceName: string, targetName: string, config?: WorkspaceConfig): Promise<Workspace> {
+    const command = `clone ${sourceName} ${targetName}`
+    try {
+      RemoteWorkspaceUtils.validateWorkspacePath(sourceName)
+      RemoteWorkspaceUtils.validateWorkspacePath(targetName)
+    } catch (error) {
+      throw this.wrapError(error, 'Clone workspace', ERROR_CODES.INVALID_CONFIGURATION, command)
+    }
 
-  async readFile(remotePath: string): Promise<Buffer>
-  async readFile(remotePath: string, encoding: BufferEncoding): Promise<string>
-  async readFile(remotePath: string, encoding?: BufferEncoding): Promise<string | Buffer> {
-    const sftp = await this.getSftpSession()
+    await this.ensureSSHConnection()
+    const source = RemoteWorkspaceUtils.getUserWorkspacePath(join(this.userId, sourceName))
+    const target = RemoteWorkspaceUtils.getUserWorkspacePath(join(this.userId, targetName))
 
-    return new Promise((resolve, reject) => {
+    const agent = await this.getAgent()
+    if (agent) {
+      try {
+        await agent.request('clone', { source, target })
+      } catch (error) {
+        if (!(error instanceof AgentError && error.code === 'ENOSYS')) {
+          const code = (error as NodeJS.ErrnoException).code
+          const errorCode = code === 'ENOENT' || code === 'ENOTDIR' ? ERROR_CODES.WORKSPACE_NOT_FOUND : ERROR_CODES.WRITE_FAILED
+          throw this.wrapError(error, 'Clone workspace', errorCode, command, target)
+        }
+        await this.cloneWorkspaceWithoutAgent(source, target, command)
+      }
+    } else {
+      await this.cloneWorkspaceWithoutAgent(source, target, command)
+    }
+
+    getLogger().debug(`Cloned remote workspace for user ${this.userId}: ${sourceName} -> ${targetName}`)
+    return this.getWorkspace(targetName, config)
+  }
+
+  private async cloneWorkspaceWithoutAgent(source: string, target: string, command: string): Promise<void> {
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
           completed = true
-          getLogger().error(`[SFTP] readFile timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          getLogger().error(`[SSH] cloneWorkspace timed out after ${this.operationTimeoutMs}ms: ${target}`)
           reject(new FileSystemError(
-            `readFile timed out after ${this.operationTimeoutMs}ms`,
-            ERROR_CODES.READ_FAILED,
-            `read ${remotePath}`
+            `cloneWorkspace timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.WRITE_FAILED,
+            command
           ))
         }
       }, this.operationTimeoutMs)
 
-      if (encoding) {
-        // Read as string with specified encoding
-        sftp.readFile(remotePath, encoding, (readErr, data) => {
+      client.exec(cloneCommand(source, target), (err, stream) => {
+        if (err) {
           if (completed) return
           completed = true
           clearTimeout(timeout)
-          if (readErr) {
-            reject(this.wrapError(readErr, 'Read file', ERROR_CODES.READ_FAILED, `read ${remotePath}`, remotePath))
-          } else {
-            resolve(Buffer.isBuffer(data) ? data.toString(encoding) : data)
-          }
-        })
-      } else {
-        // Read as Buffer (no encoding)
-        sftp.readFile(remotePath, (readErr, data) => {
+          reject(this.wrapError(err, 'Clone workspace', ERROR_CODES.WRITE_FAILED, command, target))
+          return
+        }
+
+        let stderr = ''
+
+        stream.on('error', (streamErr: Error) => {
           if (completed) return
           completed = true
           clearTimeout(timeout)
-          if (readErr) {
-            reject(this.wrapError(readErr, 'Read file', ERROR_CODES.READ_FAILED, `read ${remotePath}`, remotePath))
-          } else {
-            resolve(data)
-          }
+          reject(this.wrapError(streamErr, 'Clone workspace', ERROR_CODES.WRITE_FAILED, command, target))
         })
-      }
-    })
-  }
 
-  async writeFile(remotePath: string, content: string | Buffer, encoding: BufferEncoding = 'utf8'): Promise<void> {
-    const sftp = await this.getSftpSession()
+        stream.on('data', () => {})
 
-    return new Promise((resolve, reject) => {
-      let completed = false
-      const timeout = setTimeout(() => {
-        if (!completed) {
-          completed = true
-          getLogger().error(`[SFTP] writeFile timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
-          reject(new FileSystemError(
-            `writeFile timed out after ${this.operationTimeoutMs}ms`,
-            ERROR_CODES.WRITE_FAILED,
-            `write ${remotePath}`
-          ))
-        }
-      }, this.operationTimeoutMs)
+        stream.stderr.on('data', (data: Buffer) => {
+          stderr += data.toString()
+        })
 
-      // Handle Buffer or string content differently
-      if (Buffer.isBuffer(content)) {
-        sftp.writeFile(remotePath, content, (writeErr) => {
+        stream.on('close', (code: number) => {
           if (completed) return
           completed = true
           clearTimeout(timeout)
-          if (writeErr) {
-            reject(this.wrapError(writeErr, 'Write file', ERROR_CODES.WRITE_FAILED, `write ${remotePath}`, remotePath))
-          } else {
+
+          if (code === 0) {
             resolve()
+          } else if (code === 3) {
+            reject(new FileSystemError(`Workspace to clone does not exist: ${source}`, ERROR_CODES.WORKSPACE_NOT_FOUND, command))
+          } else if (code === 4) {
+            reject(new FileSystemError(`Workspace already exists: ${target}`, ERROR_CODES.WRITE_FAILED, command))
+          } else {
+            reject(new FileSystemError(
+              `Clone workspace failed for path: ${target}. Error: ${stderr.trim() || `exit code ${code}`}`,
+              ERROR_CODES.WRITE_FAILED,
+              command
+            ))
           }
         })
-      } else {
-        sftp.writeFile(remotePath, content, encoding, (writeErr) => {
-          if (completed) return
-          completed = true
-          clearTimeout(timeout)
-          if (writeErr) {
-            reject(this.wrapError(writeErr, 'Write file', ERROR_CODES.WRITE_FAILED, `write ${remotePath}`, remotePath))
-          } else {
-            resolve()
+      })
+    }))
+  }
+
+  /**
+   * Public helper methods for RemoteWorkspace
+   */
+
+  async readFile(remotePath: string): Promise<Buffer>
+  async readFile(remotePath: string, encoding: BufferEncoding): Promise<string>
+  async readFile(remotePath: string, encoding?: BufferEncoding): Promise<string | Buffer> {
+    const data = (this.readCache && await this.readFileThroughCache(remotePath, this.readCache))
+      ?? await this.readFileWithoutCache(remotePath)
+    // Return string with specified encoding, or raw Buffer (no encoding)
+    return encoding ? data.toString(encoding) : data
+  }
+
+  /**
+   * Read a file through the shared content cache (`readCacheBytes`)
+   * The agent reports the file's content hash, which it remembers per inode,
+   * so a file whose content any backend in this process already read from
+   * this host costs one small request instead of a transfer. Files below
+   * `readCacheMinBytes` come back with that request and aren't cached.
+   * @returns The content, or null to read the file without the cache
+   */
+  private async readFileThroughCache(remotePath: string, cache: ContentCache): Promise<Buffer | null> {
+    const agent = await this.getAgent()
+    if (!agent) return null
+
+    let digest
+    try {
+      digest = await agent.call<{ size: number; hash?: string }>('digest', {
+        path: remotePath,
+        inlineBelow: this.options.readCacheMinBytes ?? DEFAULT_READ_CACHE_MIN_BYTES,
+      })
+    } catch (error) {
+      // Missing files, directories and agents without the op take the normal
+      // read, which reports the error if there is one
+      getLogger().debug(`[Agent] No content hash for ${remotePath}, reading without the cache:`, error)
+      return null
+    }
+
+    const { size, hash } = digest.result
+    if (!hash) return digest.body ?? Buffer.alloc(0)
+
+    // Entries are shared only between backends for the same host, whose agent vouches for the hash
+    const scope = `${this.options.host}:${this.options.sshPort ?? 2222}`
+    const cached = cache.get(scope, hash)
+    if (cached) {
+      incrementCounter('constellation_read_cache', { result: 'hit' })
+      incrementCounter('constellation_read_cache_saved_bytes', undefined, cached.length)
+      return cached
+    }
+
+    incrementCounter('constellation_read_cache', { result: 'miss' })
+    const data = await this.readFileWithoutCache(remotePath)
+    // The file may have changed between the hash and the read
+    if (data.length === size && contentHash(data) === hash) {
+      cache.set(scope, hash, data)
+    }
+    return data
+  }
+
+  private async readFileWithoutCache(remotePath: string): Promise<Buffer> {
+    return this.withSftp((sftp) => new Promise<Buffer>((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SFTP] readFile timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `readFile timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.READ_FAILED,
+            `read ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      this.readWholeFile(sftp, remotePath).then((data) => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        resolve(data)
+      }, (readErr) => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        reject(this.wrapError(readErr, 'Read file', ERROR_CODES.READ_FAILED, `read ${remotePath}`, remotePath))
+      })
+    }))
+  }
+
+  async writeFile(remotePath: string, content: string | Buffer, encoding: BufferEncoding = 'utf8'): Promise<void> {
+    // Handle Buffer or string content differently
+    const data = Buffer.isBuffer(content) ? content : Buffer.from(content, encoding)
+
+    let chunks: ContentChunk[] | undefined
+    if ((this.options.deltaSync ?? true) && data.length >= (this.options.deltaSyncMinBytes ?? DEFAULT_DELTA_SYNC_MIN_BYTES)) {
+      chunks = chunkContent(data)
+      if (await this.writeFileDelta(remotePath, data, chunks)) return
+    }
+
+    await this.withSftp((sftp) => new Promise<void>((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SFTP] writeFile timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `writeFile timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.WRITE_FAILED,
+            `write ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      this.writeWholeFile(sftp, remotePath, data).then(() => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        resolve()
+      }, (writeErr) => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        reject(this.wrapError(writeErr, 'Write file', ERROR_CODES.WRITE_FAILED, `write ${remotePath}`, remotePath))
+      })
+    }))
+    // The next write of this file can be a delta against what we just sent
+    if (chunks) this.rememberManifest(remotePath, buildManifest(data, chunks))
+  }
+
+  /**
+   * Write a file as a delta against its current remote content
+   * Plans against the remembered manifest of the file, or one fetched from
+   * the agent, and sends only the chunks missing from it. If the file
+   * changed since the manifest was taken, retries once with a fresh one.
+   * @returns Whether the file now has the content; false means upload it whole
+   */
+  private async writeFileDelta(remotePath: string, data: Buffer, chunks: ContentChunk[]): Promise<boolean> {
+    const agent = await this.getAgent()
+    if (!agent) return false
+
+    const target = buildManifest(data, chunks)
+    let base = this.deltaManifests.get(remotePath)
+    this.deltaManifests.delete(remotePath)
+    for (let attempt = 0; attempt < 2; attempt++) {
+      try {
+        const fresh = !base
+        base ??= await agent.request<DeltaManifest>('chunkManifest', { path: remotePath })
+        const delta = planDelta(data, chunks, base)
+        const { status } = await agent.request<{ status: 'written' | 'unchanged' | 'stale' }>(
+          'writeDelta',
+          { path: remotePath, base: base.hash, hash: target.hash, chunks: delta.chunks },
+          delta.body
+        )
+        if (status !== 'stale') {
+          incrementCounter('constellation_delta_writes', { status })
+          incrementCounter('constellation_delta_saved_bytes', undefined, data.length - delta.body.length)
+          this.rememberManifest(remotePath, target)
+          return true
+        }
+        if (fresh) break
+        base = undefined
+      } catch (error) {
+        // Missing files, unsupported agents and the like take the full upload,
+        // which reports the error if there is one
+        getLogger().debug(`[Agent] Delta write failed for ${remotePath}, uploading whole file:`, error)
+        break
+      }
+    }
+    incrementCounter('constellation_delta_writes', { status: 'full' })
+    return false
+  }
+
+  private rememberManifest(remotePath: string, manifest: DeltaManifest): void {
+    this.deltaManifests.delete(remotePath)
+    this.deltaManifests.set(remotePath, manifest)
+    if (this.deltaManifests.size > DELTA_MANIFEST_ENTRIES) {
+      this.deltaManifests.delete(this.deltaManifests.keys().next().value!)
+    }
+  }
+
+  /**
+   * Open a streaming reader on a remote file
+   * Keeps `sftpConcurrency` reads of `sftpChunkSize` bytes in flight, and
+   * issues no new reads while the consumer is behind, so memory use does not
+   * depend on the file size.
+   * @param remotePath - Absolute remote path
+   * @param options - Byte range and per-call transfer tuning
+   */
+  async createReadStream(remotePath: string, options?: SftpReadStreamOptions): Promise<Readable> {
+    // The stream holds its session lease until it closes
+    const { sftp, connection, release } = await this.acquireSftp()
+
+    let handle: Buffer
+    try {
+      handle = await openRemoteFile(sftp, remotePath, 'r')
+    } catch (error) {
+      release()
+      throw this.wrapError(error, 'Read file', ERROR_CODES.READ_FAILED, `read ${remotePath}`, remotePath)
+    }
+
+    let untrack = () => {}
+    const stream = new SftpReadStream(sftp, handle, { ...this.transferOptions, ...options }, () => {
+      untrack()
+      release()
+    })
+    // Fail the stream if the connection drops mid-transfer
+    untrack = this.trackOperation(connection, `read stream: ${remotePath}`, (error) => stream.destroy(error))
+    return stream
+  }
+
+  /**
+   * Open a streaming writer on a remote file
+   * Keeps up to `sftpConcurrency` writes in flight; a faster source is held
+   * back through normal Writable backpressure.
+   * @param remotePath - Absolute remote path
+   * @param options - Start offset, open flags ('w' truncates, 'r+' overwrites
+   *   in place) and per-call transfer tuning
+   */
+  async createWriteStream(
+    remotePath: string,
+    options?: SftpWriteStreamOptions & { flags?: 'w' | 'r+' }
+  ): Promise<Writable> {
+    const { sftp, connection, release } = await this.acquireSftp()
+
+    let handle: Buffer
+    try {
+      handle = await openRemoteFile(sftp, remotePath, options?.flags ?? 'w')
+    } catch (error) {
+      release()
+      throw this.wrapError(error, 'Write file', ERROR_CODES.WRITE_FAILED, `write ${remotePath}`, remotePath)
+    }
+
+    let untrack = () => {}
+    const stream = new SftpWriteStream(sftp, handle, { ...this.transferOptions, ...options }, () => {
+      untrack()
+      release()
+    })
+    untrack = this.trackOperation(connection, `write stream: ${remotePath}`, (error) => stream.destroy(error))
+    return stream
+  }
+
+  /**
+   * Upload a local file or a Node stream to a remote file
+   * @param source - Local file path or a Readable
+   * @param remotePath - Absolute remote path
+   * @param options - Per-call transfer tuning
+   */
+  async upload(source: string | Readable, remotePath: string, options?: SftpTransferOptions): Promise<void> {
+    const output = await this.createWriteStream(remotePath, options)
+    try {
+      await pipeline(typeof source === 'string' ? createLocalReadStream(source) : source, output)
+    } catch (error) {
+      throw this.wrapError(error, 'Upload file', ERROR_CODES.WRITE_FAILED, `write ${remotePath}`, remotePath)
+    }
+  }
+
+  /**
+   * Download a remote file to a local file or a Node stream
+   * @param remotePath - Absolute remote path
+   * @param destination - Local file path or a Writable
+   * @param options - Per-call transfer tuning
+   */
+  async download(remotePath: string, destination: string | Writable, options?: SftpTransferOptions): Promise<void> {
+    const input = await this.createReadStream(remotePath, options)
+    try {
+      await pipeline(input, typeof destination === 'string' ? createLocalWriteStream(destination) : destination)
+    } catch (error) {
+      throw this.wrapError(error, 'Download file', ERROR_CODES.READ_FAILED, `read ${remotePath}`, remotePath)
+    }
+  }
+
+  /**
+   * Chunk size and concurrency for SFTP transfers from the backend config
+   */
+  private get transferOptions(): SftpTransferOptions {
+    return {
+      chunkSize: this.options.sftpChunkSize ?? DEFAULT_SFTP_CHUNK_SIZE,
+      concurrency: this.options.sftpConcurrency ?? DEFAULT_SFTP_CONCURRENCY,
+    }
+  }
+
+  /**
+   * Read a whole remote file with pipelined requests into one preallocated buffer
+   */
+  private async readWholeFile(sftp: SFTPWrapper, remotePath: string): Promise<Buffer> {
+    const handle = await openRemoteFile(sftp, remotePath, 'r')
+    try {
+      const size = await new Promise<number>((resolve, reject) => {
+        sftp.fstat(handle, (err, stats) => (err ? reject(err) : resolve(stats.size ?? 0)))
+      })
+
+      if (size > 0) {
+        const data = Buffer.allocUnsafe(size)
+        const bytesRead = await readIntoBuffer(sftp, handle, data, 0, this.transferOptions)
+        return bytesRead === size ? data : data.subarray(0, bytesRead)
+      }
+
+      // Size unknown (e.g. /proc files report 0): read until end of file
+      const chunks: Buffer[] = []
+      for await (const chunk of new SftpReadStream(sftp, handle, { ...this.transferOptions, concurrency: 1 })) {
+        chunks.push(chunk as Buffer)
+      }
+      return Buffer.concat(chunks)
+    } finally {
+      await closeRemoteFile(sftp, handle).catch(() => {})
+    }
+  }
+
+  /**
+   * Apply exact-text edits to a remote file (see Workspace.applyEdits)
+   * With the agent the file is edited on the host, so only the edits and
+   * the diff cross the network. Without it, or with an agent that predates
+   * the 'applyEdits' operation, the file is downloaded, edited here and
+   * uploaded to a hidden sibling that is renamed over it.
+   * @param label - Path shown in the diff header
+   */
+  async applyEdits(remotePath: string, edits: TextEdit[], options: ApplyEditsOptions, label: string): Promise<ApplyEditsResult> {
+    const command = `edit ${remotePath}`
+    try {
+      const agent = await this.getAgent()
+      if (agent) {
+        try {
+          return await agent.request<ApplyEditsResult>('applyEdits', {
+            path: remotePath,
+            edits,
+            dryRun: options.dryRun ?? false,
+            label,
+          })
+        } catch (error) {
+          if (!(error instanceof AgentError && error.code === 'ENOSYS')) {
+            throw error
           }
-        })
+        }
       }
+      return await this.applyEditsWithoutAgent(remotePath, edits, options, label)
+    } catch (error) {
+      if ((error as NodeJS.ErrnoException).code === 'ENOMATCH') {
+        throw new FileSystemError((error as Error).message, ERROR_CODES.EDIT_NOT_FOUND, command)
+      }
+      throw this.wrapError(error, 'Edit file', ERROR_CODES.WRITE_FAILED, command, remotePath)
+    }
+  }
+
+  private async applyEditsWithoutAgent(remotePath: string, edits: TextEdit[], options: ApplyEditsOptions, label: string): Promise<ApplyEditsResult> {
+    const { content, diff, changed } = applyEditsToContent(await this.readFile(remotePath), edits, label)
+    if (!changed || options.dryRun) {
+      return { diff, changed }
+    }
+
+    const temp = posix.join(posix.dirname(remotePath), `.${posix.basename(remotePath)}.edit-${randomBytes(6).toString('hex')}`)
+    const call = (operation: (callback: (err?: Error | null) => void) => void) => new Promise<void>((resolve, reject) => {
+      operation((err) => err ? reject(err) : resolve())
     })
+
+    await this.withSftp((sftp) => new Promise<void>((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SFTP] applyEdits timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `applyEdits timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.WRITE_FAILED,
+            `edit ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      const replace = async () => {
+        const mode = await new Promise<number>((resolveMode, rejectMode) => {
+          sftp.stat(remotePath, (err, stats) => err ? rejectMode(err) : resolveMode(stats.mode & 0o7777))
+        })
+        try {
+          await this.writeWholeFile(sftp, temp, content)
+          await call(callback => sftp.chmod(temp, mode, callback))
+          // POSIX rename replaces the target; plain SFTP rename refuses to
+          await call(callback => sftp.ext_openssh_rename(temp, remotePath, callback))
+        } catch (error) {
+          await call(callback => sftp.unlink(temp, callback)).catch(() => {})
+          throw error
+        }
+      }
+
+      replace().then(() => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        resolve()
+      }, (err) => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        reject(err)
+      })
+    }))
+    return { diff, changed }
+  }
+
+  /**
+   * Write a whole buffer to a remote file with pipelined requests
+   */
+  private async writeWholeFile(sftp: SFTPWrapper, remotePath: string, data: Buffer): Promise<void> {
+    const handle = await openRemoteFile(sftp, remotePath, 'w')
+    try {
+      await writeFromBuffer(sftp, handle, data, 0, this.transferOptions)
+    } catch (error) {
+      await closeRemoteFile(sftp, handle).catch(() => {})
+      throw error
+    }
+    await closeRemoteFile(sftp, handle)
   }
 
   async createDirectory(remotePath: string, recursive: boolean): Promise<void> {
-    await this.ensureSSHConnection()
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.createDirectoryWithoutAgent(remotePath, recursive)
+    }
 
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED)
+    try {
+      await agent.request('mkdir', { path: remotePath, recursive })
+    } catch (error) {
+      throw this.wrapError(error, 'Create directory', ERROR_CODES.WRITE_FAILED, `mkdir ${remotePath}`, remotePath)
     }
+  }
 
+  private async createDirectoryWithoutAgent(remotePath: string, recursive: boolean): Promise<void> {
     if (recursive) {
       // Use mkdir -p for recursive directory creation
-      return this.withChannelLimit(() => new Promise((resolve, reject) => {
-        if (!this.sshClient) {
-          reject(new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED))
-          return
-        }
-
+      return this.withChannelLimit((client) => new Promise((resolve, reject) => {
         let completed = false
         const timeout = setTimeout(() => {
           if (!completed) {
@@ -845,7 +1699,7 @@ export class RemoteBackend implements FileSystemBackend {
           }
         }, this.operationTimeoutMs)
 
-        this.sshClient.exec(`mkdir -p "${remotePath}"`, (err, stream) => {
+        client.exec(`mkdir -p "${remotePath}"`, (err, stream) => {
           if (err) {
             if (completed) return
             completed = true
@@ -890,9 +1744,7 @@ export class RemoteBackend implements FileSystemBackend {
       }))
     } else {
       // Non-recursive: use cached SFTP session
-      const sftp = await this.getSftpSession()
-
-      return new Promise((resolve, reject) => {
+      return this.withSftp((sftp) => new Promise((resolve, reject) => {
         let completed = false
         const timeout = setTimeout(() => {
           if (!completed) {
@@ -916,23 +1768,25 @@ export class RemoteBackend implements FileSystemBackend {
             resolve()
           }
         })
-      })
+      }))
     }
   }
 
   async touchFile(remotePath: string): Promise<void> {
-    await this.ensureSSHConnection()
-
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED)
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.touchFileWithoutAgent(remotePath)
     }
 
-    return this.withChannelLimit(() => new Promise((resolve, reject) => {
-      if (!this.sshClient) {
-        reject(new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED))
-        return
-      }
+    try {
+      await agent.request('touch', { path: remotePath })
+    } catch (error) {
+      throw this.wrapError(error, 'Create file', ERROR_CODES.WRITE_FAILED, `touch ${remotePath}`, remotePath)
+    }
+  }
 
+  private async touchFileWithoutAgent(remotePath: string): Promise<void> {
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
@@ -947,7 +1801,7 @@ export class RemoteBackend implements FileSystemBackend {
       }, this.operationTimeoutMs)
 
       // Use touch command for creating empty files
-      this.sshClient.exec(`touch "${remotePath}"`, (err, stream) => {
+      client.exec(`touch "${remotePath}"`, (err, stream) => {
         if (err) {
           if (completed) return
           completed = true
@@ -993,18 +1847,17 @@ export class RemoteBackend implements FileSystemBackend {
   }
 
   async directoryExists(remotePath: string): Promise<boolean> {
-    await this.ensureSSHConnection()
-
-    if (!this.sshClient) {
-      return false
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.directoryExistsWithoutAgent(remotePath)
     }
 
-    return this.withChannelLimit(() => new Promise((resolve) => {
-      if (!this.sshClient) {
-        resolve(false)
-        return
-      }
+    // Resolve as false on failure, matching the shell implementation
+    return agent.request<boolean>('isDirectory', { path: remotePath }).catch(() => false)
+  }
 
+  private async directoryExistsWithoutAgent(remotePath: string): Promise<boolean> {
+    return this.withChannelLimit((client) => new Promise((resolve) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
@@ -1014,7 +1867,7 @@ export class RemoteBackend implements FileSystemBackend {
         }
       }, this.operationTimeoutMs)
 
-      this.sshClient.exec(`test -d "${remotePath}"`, (err, stream) => {
+      client.exec(`test -d "${remotePath}"`, (err, stream) => {
         if (err) {
           if (completed) return
           completed = true
@@ -1042,18 +1895,16 @@ export class RemoteBackend implements FileSystemBackend {
   }
 
   async pathExists(remotePath: string): Promise<boolean> {
-    await this.ensureSSHConnection()
-
-    if (!this.sshClient) {
-      return false
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.pathExistsWithoutAgent(remotePath)
     }
 
-    return this.withChannelLimit(() => new Promise((resolve) => {
-      if (!this.sshClient) {
-        resolve(false)
-        return
-      }
+    return agent.request<boolean>('exists', { path: remotePath }).catch(() => false)
+  }
 
+  private async pathExistsWithoutAgent(remotePath: string): Promise<boolean> {
+    return this.withChannelLimit((client, connection) => new Promise((resolve) => {
       let completed = false
       let execCallbackFired = false
       let streamCreated = false
@@ -1071,15 +1922,15 @@ export class RemoteBackend implements FileSystemBackend {
           getLogger().error(
             `[SSH] pathExists timed out after ${this.operationTimeoutMs}ms: ${remotePath}. ` +
             `Diagnostics: execCallbackFired=${execCallbackFired}, streamCreated=${streamCreated}, ` +
-            `isConnected=${this.isConnected}, sshClient=${!!this.sshClient}`
+            `connection=#${connection.index}, isConnected=${connection.isConnected}`
           )
           complete(false, 'timeout')
         }
       }, this.operationTimeoutMs)
 
-      getLogger().debug(`[SSH] pathExists starting: ${remotePath}, isConnected=${this.isConnected}`)
+      getLogger().debug(`[SSH] pathExists starting: ${remotePath} on connection #${connection.index}`)
 
-      this.sshClient.exec(`test -e "${remotePath}"`, (err, stream) => {
+      client.exec(`test -e "${remotePath}"`, (err, stream) => {
         execCallbackFired = true
 
         if (err) {
@@ -1125,9 +1976,7 @@ export class RemoteBackend implements FileSystemBackend {
   }
 
   async pathStat(remotePath: string): Promise<Stats> {
-    const sftp = await this.getSftpSession()
-
-    return new Promise((resolve, reject) => {
+    return this.withSftp((sftp) => new Promise((resolve, reject) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
@@ -1153,22 +2002,108 @@ export class RemoteBackend implements FileSystemBackend {
           resolve(stats as unknown as Stats)
         }
       })
-    })
+    }))
   }
 
-  async deleteDirectory(remotePath: string): Promise<void> {
-    await this.ensureSSHConnection()
-
-    if (!this.sshClient) {
-      throw new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED)
+  /**
+   * Delete a workspace directory without waiting for its files to go (internal use by Workspace.delete)
+   * The directory is renamed into the trash next to the user directories and
+   * removed in the background: by the agent at a bounded rate, or by a
+   * detached, niced `rm -rf` without the agent or with one that predates the
+   * 'trash' operation.
+   * @param remotePath - Absolute workspace directory
+   */
+  async trashDirectory(remotePath: string): Promise<void> {
+    const trashRoot = RemoteWorkspaceUtils.getUserWorkspacePath(TRASH_DIRECTORY)
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.trashDirectoryWithoutAgent(remotePath, trashRoot)
     }
 
-    return this.withChannelLimit(() => new Promise((resolve, reject) => {
-      if (!this.sshClient) {
-        reject(new FileSystemError('SSH client not initialized', ERROR_CODES.WRITE_FAILED))
-        return
+    try {
+      await agent.request('trash', { path: remotePath, trash: trashRoot })
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'ENOSYS') {
+        return this.trashDirectoryWithoutAgent(remotePath, trashRoot)
       }
+      throw this.wrapError(error, 'Delete directory', ERROR_CODES.WRITE_FAILED, `trash ${remotePath}`, remotePath)
+    }
+  }
 
+  private async trashDirectoryWithoutAgent(remotePath: string, trashRoot: string): Promise<void> {
+    const command = trashCommand(remotePath, trashRoot)
+
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SSH] trashDirectory timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `trashDirectory timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.WRITE_FAILED,
+            `trash ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      client.exec(command, (err, stream) => {
+        if (err) {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(err, 'Delete directory', ERROR_CODES.WRITE_FAILED, `trash ${remotePath}`, remotePath))
+          return
+        }
+
+        let stderr = ''
+
+        stream.on('error', (streamErr: Error) => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(streamErr, 'Delete directory', ERROR_CODES.WRITE_FAILED, `trash ${remotePath}`, remotePath))
+        })
+
+        stream.on('data', () => {})
+
+        stream.stderr.on('data', (data: Buffer) => {
+          stderr += data.toString()
+        })
+
+        stream.on('close', (code: number) => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          if (code === 0) {
+            resolve()
+          } else {
+            reject(new FileSystemError(
+              `Failed to delete directory: ${remotePath}. Error: ${stderr.trim() || `exit code ${code}`}`,
+              ERROR_CODES.WRITE_FAILED,
+              `trash ${remotePath}`
+            ))
+          }
+        })
+      })
+    }))
+  }
+
+  async deleteDirectory(remotePath: string): Promise<void> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.deleteDirectoryWithoutAgent(remotePath)
+    }
+
+    try {
+      await agent.request('rm', { path: remotePath, recursive: true, force: true })
+    } catch (error) {
+      throw this.wrapError(error, 'Delete directory', ERROR_CODES.WRITE_FAILED, `rm -rf ${remotePath}`, remotePath)
+    }
+  }
+
+  private async deleteDirectoryWithoutAgent(remotePath: string): Promise<void> {
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
@@ -1182,7 +2117,7 @@ export class RemoteBackend implements FileSystemBackend {
         }
       }, this.operationTimeoutMs)
 
-      this.sshClient.exec(`rm -rf "${remotePath}"`, (err, stream) => {
+      client.exec(`rm -rf "${remotePath}"`, (err, stream) => {
         if (err) {
           if (completed) return
           completed = true
@@ -1220,52 +2155,211 @@ export class RemoteBackend implements FileSystemBackend {
     }))
   }
 
-  async listDirectory(remotePath: string): Promise<string[]> {
-    await this.ensureSSHConnection()
+  /**
+   * Watch a remote directory tree for changes through the agent (internal use
+   * by Workspace metadata caches)
+   * `onChange` receives the changed paths as they are reported. When the watch
+   * ends for any reason, including a lost connection, it receives one final
+   * `{ paths: null, closed: true }`.
+   * @param remotePath - Absolute remote directory
+   * @param onChange - Change listener
+   * @returns Promise resolving to a function that stops watching, or null when
+   *   the agent is unavailable or cannot watch on this host
+   */
+  async watchTree(remotePath: string, onChange: (event: AgentWatchEvent) => void): Promise<(() => void) | null> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return null
+    }
 
-    if (!this.sshClient) {
-      return []
+    let id: number
+    try {
+      ({ id } = await agent.request<{ id: number }>('watch', { path: remotePath }))
+    } catch (error) {
+      getLogger().debug(`[Agent] Cannot watch ${remotePath}: ${error instanceof Error ? error.message : String(error)}`)
+      return null
     }
 
-    return this.withChannelLimit(() => new Promise((resolve, reject) => {
-      if (!this.sshClient) {
-        resolve([])
-        return
+    let active = true
+    const end = () => {
+      if (!active) return
+      active = false
+      removeListener()
+      removeCloseListener()
+      onChange({ paths: null, closed: true })
+    }
+
+    const removeListener = agent.onEvent(id, (payload) => {
+      const event = payload as AgentWatchEvent
+      if (event.closed) {
+        end()
+      } else {
+        onChange(event)
+      }
+    })
+    const removeCloseListener = agent.onClose(end)
+
+    return () => {
+      if (!active) return
+      active = false
+      removeListener()
+      removeCloseListener()
+      agent.request('unwatch', { id }).catch(() => {})
+    }
+  }
+
+  /**
+   * Run a batch of operations on absolute remote paths in a single agent round-trip
+   * (internal use by Workspace.batch)
+   * @param operations - Operations with absolute remote paths
+   * @returns Promise resolving to per-operation results, or null when the agent is
+   *   unavailable or the batch is too large for one frame (callers then run the
+   *   operations individually over the shared SFTP session)
+   */
+  async batchOperations(operations: BatchOperation[]): Promise<BatchResult[] | null> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return null
+    }
+
+    const bodies: Buffer[] = []
+    const entries: AgentBatchEntry[] = operations.map((operation) => {
+      const entry: AgentBatchEntry = { op: BATCH_OPERATIONS[operation.op].agentOp, args: { path: operation.path } }
+      if (operation.op === 'write') {
+        const content = Buffer.isBuffer(operation.content)
+          ? operation.content
+          : Buffer.from(operation.content, operation.encoding ?? 'utf8')
+        bodies.push(content)
+        entry.bodyLength = content.length
+      }
+      return entry
+    })
+
+    let response
+    try {
+      response = await agent.call<AgentBatchOutcome[]>(
+        'batch',
+        { ops: entries },
+        bodies.length > 0 ? Buffer.concat(bodies) : undefined
+      )
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'EFBIG') {
+        return null
+      }
+      throw this.wrapError(error, 'Batch', ERROR_CODES.READ_FAILED, `batch (${operations.length} operations)`)
+    }
+
+    const body = response.body ?? Buffer.alloc(0)
+    let offset = 0
+
+    return response.result.map((outcome, index): BatchResult => {
+      const operation = operations[index]!
+      const { label, errorCode } = BATCH_OPERATIONS[operation.op]
+
+      if (!outcome.ok) {
+        // Missing or unreadable directories list as empty, matching listDirectory()
+        if (operation.op === 'readdir') {
+          return { ok: true, value: [] }
+        }
+        const command = `${operation.op} ${operation.path}`
+        return { ok: false, error: this.wrapError(new AgentError(outcome.message, outcome.code), label, errorCode, command, operation.path) }
+      }
+
+      let data = Buffer.alloc(0)
+      if (outcome.bodyLength !== undefined) {
+        data = body.subarray(offset, offset + outcome.bodyLength)
+        offset += outcome.bodyLength
+      }
+
+      switch (operation.op) {
+        case 'read':
+          return { ok: true, value: operation.encoding ? data.toString(operation.encoding) : data }
+        case 'write':
+          return { ok: true, value: undefined }
+        case 'stat':
+          return { ok: true, value: deserializeStats(outcome.result as SerializedStats) }
+        default:
+          return { ok: true, value: outcome.result as boolean | string[] }
+      }
+    })
+  }
+
+  /**
+   * Search file contents below a remote directory (internal use by Workspace.search)
+   * The agent runs the search engine on the remote host. Without the agent,
+   * or with one that predates the 'search' operation, GNU grep is used
+   * instead: the pattern is then a POSIX extended regex and .gitignore files
+   * are not applied.
+   * @param remotePath - Absolute remote directory
+   * @param options - Search options (`path` is ignored)
+   * @param pathPrefix - Prepended to the reported paths
+   * @param indexRoot - Workspace root whose trigram index the agent should use
+   *   (`pathPrefix` must then be `remotePath` relative to it)
+   * @returns Promise resolving to matches sorted by path and line
+   */
+  async searchFiles(remotePath: string, options: SearchOptions, pathPrefix = '', indexRoot?: string): Promise<SearchResult> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.searchFilesWithoutAgent(remotePath, options, pathPrefix)
+    }
+
+    try {
+      return await agent.request<SearchResult>('search', { path: remotePath, options, prefix: pathPrefix, index: indexRoot })
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'ENOSYS') {
+        return this.searchFilesWithoutAgent(remotePath, options, pathPrefix)
       }
+      throw this.wrapError(error, 'Search', ERROR_CODES.READ_FAILED, `search ${options.pattern}`, remotePath)
+    }
+  }
 
+  private async searchFilesWithoutAgent(remotePath: string, options: SearchOptions, pathPrefix: string): Promise<SearchResult> {
+    let command: string
+    try {
+      command = grepCommand(remotePath, options)
+    } catch (error) {
+      throw this.wrapError(error, 'Search', ERROR_CODES.READ_FAILED, `search ${options.pattern}`, remotePath)
+    }
+
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
       let completed = false
       const timeout = setTimeout(() => {
         if (!completed) {
           completed = true
-          getLogger().error(`[SSH] listDirectory timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          getLogger().error(`[SSH] search timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
           reject(new FileSystemError(
-            `listDirectory timed out after ${this.operationTimeoutMs}ms`,
+            `search timed out after ${this.operationTimeoutMs}ms`,
             ERROR_CODES.READ_FAILED,
-            `ls ${remotePath}`
+            `search ${options.pattern}`
           ))
         }
       }, this.operationTimeoutMs)
 
-      this.sshClient.exec(`ls -1 "${remotePath}"`, (err, stream) => {
+      client.exec(command, (err, stream) => {
         if (err) {
           if (completed) return
           completed = true
           clearTimeout(timeout)
-          reject(this.wrapError(err, 'List directory', ERROR_CODES.READ_FAILED, `ls ${remotePath}`, remotePath))
+          reject(this.wrapError(err, 'Search', ERROR_CODES.READ_FAILED, `search ${options.pattern}`, remotePath))
           return
         }
 
-        let stdout = ''
+        const stdout: Buffer[] = []
+        let stderr = ''
 
         stream.on('error', (streamErr: Error) => {
           if (completed) return
           completed = true
           clearTimeout(timeout)
-          reject(this.wrapError(streamErr, 'List directory', ERROR_CODES.READ_FAILED, `ls ${remotePath}`, remotePath))
+          reject(this.wrapError(streamErr, 'Search', ERROR_CODES.READ_FAILED, `search ${options.pattern}`, remotePath))
         })
 
         stream.on('data', (data: Buffer) => {
-          stdout += data.toString()
+          stdout.push(data)
+        })
+
+        stream.stderr.on('data', (data: Buffer) => {
+          stderr += data.toString()
         })
 
         stream.on('close', (code: number) => {
@@ -1273,17 +2367,282 @@ export class RemoteBackend implements FileSystemBackend {
           completed = true
           clearTimeout(timeout)
 
-          if (code === 0) {
-            resolve(stdout.trim().split('\n').filter(Boolean))
+          const output = Buffer.concat(stdout).toString('utf8')
+          // grep exits 1 for no matches, and 2 for unreadable entries even when others matched
+          if (code === 0 || code === 1 || output) {
+            resolve(parseGrepOutput(output, options, pathPrefix))
+          } else {
+            reject(new FileSystemError(
+              `Search failed for path: ${remotePath}. Error: ${stderr.trim() || `exit code ${code}`}`,
+              ERROR_CODES.READ_FAILED,
+              `search ${options.pattern}`
+            ))
+          }
+        })
+      })
+    }))
+  }
+
+  /**
+   * Disk usage of a remote workspace (internal use by Workspace.usage and quota checks)
+   * The agent keeps usage current on the host from its change watcher, so
+   * this costs a round trip. Without the agent, or with one that predates the
+   * 'usage' operation, find walks the tree each time.
+   * @param remotePath - Absolute workspace directory
+   * @param file - Workspace-relative file whose current size to include
+   * @param user - Include the usage of all the user's workspaces
+   */
+  async workspaceUsage(remotePath: string, file?: string, user = false): Promise<UsageReport> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.workspaceUsageWithoutAgent(remotePath, file, user)
+    }
+
+    try {
+      return await agent.request<UsageReport>('usage', { path: remotePath, file, user })
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'ENOSYS') {
+        return this.workspaceUsageWithoutAgent(remotePath, file, user)
+      }
+      throw this.wrapError(error, 'Usage', ERROR_CODES.READ_FAILED, `usage ${remotePath}`, remotePath)
+    }
+  }
+
+  private async workspaceUsageWithoutAgent(remotePath: string, file: string | undefined, user: boolean): Promise<UsageReport> {
+    const command = usageCommand(remotePath, file, user)
+
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SSH] usage timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `usage timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.READ_FAILED,
+            `usage ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      client.exec(command, (err, stream) => {
+        if (err) {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(err, 'Usage', ERROR_CODES.READ_FAILED, `usage ${remotePath}`, remotePath))
+          return
+        }
+
+        const stdout: Buffer[] = []
+
+        stream.on('error', (streamErr: Error) => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(streamErr, 'Usage', ERROR_CODES.READ_FAILED, `usage ${remotePath}`, remotePath))
+        })
+
+        stream.on('data', (data: Buffer) => {
+          stdout.push(data)
+        })
+
+        stream.on('close', () => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          // Unreadable entries are left out rather than failing the whole count
+          resolve(parseUsageOutput(Buffer.concat(stdout).toString('utf8'), file, user))
+        })
+      })
+    }), 'bulk')
+  }
+
+  /**
+   * List a remote directory tree in one call (internal use by Workspace.walk)
+   * The agent walks the tree on the remote host. Without the agent, or with
+   * one that predates the 'walk' operation, GNU find lists it in one command
+   * and the exclude globs are applied locally.
+   * @param remotePath - Absolute remote directory
+   * @param options - Walk options (`path` is ignored)
+   * @returns Promise resolving to entries relative to `remotePath`
+   */
+  async walkTree(remotePath: string, options: WalkOptions): Promise<WalkResult> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.walkTreeWithoutAgent(remotePath, options)
+    }
+
+    try {
+      return await agent.request<WalkResult>('walk', { path: remotePath, options })
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'ENOSYS') {
+        return this.walkTreeWithoutAgent(remotePath, options)
+      }
+      throw this.wrapError(error, 'Walk directory', ERROR_CODES.READ_FAILED, `walk ${remotePath}`, remotePath)
+    }
+  }
+
+  private async walkTreeWithoutAgent(remotePath: string, options: WalkOptions): Promise<WalkResult> {
+    const command = walkCommand(remotePath, options)
+
+    return this.withChannelLimit((client) => new Promise((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SSH] walk timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `walk timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.READ_FAILED,
+            `walk ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      client.exec(command, (err, stream) => {
+        if (err) {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(err, 'Walk directory', ERROR_CODES.READ_FAILED, `walk ${remotePath}`, remotePath))
+          return
+        }
+
+        const stdout: Buffer[] = []
+        let stderr = ''
+
+        stream.on('error', (streamErr: Error) => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+          reject(this.wrapError(streamErr, 'Walk directory', ERROR_CODES.READ_FAILED, `walk ${remotePath}`, remotePath))
+        })
+
+        stream.on('data', (data: Buffer) => {
+          stdout.push(data)
+        })
+
+        stream.stderr.on('data', (data: Buffer) => {
+          stderr += data.toString()
+        })
+
+        stream.on('close', (code: number) => {
+          if (completed) return
+          completed = true
+          clearTimeout(timeout)
+
+          const output = Buffer.concat(stdout).toString('utf8')
+          // find exits 1 when some entries were unreadable but still lists the rest
+          if (code === 0 || output) {
+            resolve(parseWalkOutput(output, options))
           } else {
-            // Directory doesn't exist or is empty
-            resolve([])
+            reject(new FileSystemError(
+              `Walk failed for path: ${remotePath}. Error: ${stderr.trim() || `exit code ${code}`}`,
+              ERROR_CODES.READ_FAILED,
+              `walk ${remotePath}`
+            ))
           }
         })
       })
     }))
   }
 
+  async listDirectory(remotePath: string): Promise<string[]> {
+    const agent = await this.getAgent()
+    // Missing or unreadable directories list as empty. Dotfiles are included
+    // (same as LocalWorkspace.readdir), and SFTP keeps names with newlines intact
+    if (!agent) {
+      return this.readDirectoryWithSftp(remotePath).then(
+        entries => entries.map(entry => entry.name),
+        () => []
+      )
+    }
+
+    return agent.request<string[]>('readdir', { path: remotePath }).catch(() => [])
+  }
+
+  /**
+   * List a remote directory with entry types in one round trip
+   * Uses the agent's readdirEntries op, or SFTP readdir without the agent or
+   * with one that predates the op (its replies already carry every entry's
+   * attributes). Unlike
+   * listDirectory, a missing directory is an error.
+   * @param remotePath - Absolute remote directory
+   * @param withStats - Also return each entry's lstat result
+   */
+  async listDirectoryEntries(remotePath: string, withStats = false): Promise<RemoteDirectoryEntry[]> {
+    let entries: SerializedDirent[]
+    try {
+      entries = await this.readDirectoryEntries(remotePath, withStats)
+    } catch (error) {
+      throw this.wrapError(error, 'List directory', ERROR_CODES.READ_FAILED, `readdir ${remotePath}`, remotePath)
+    }
+
+    return entries.map(entry => ({
+      dirent: deserializeDirent(entry, remotePath),
+      ...(withStats && entry.stats ? { stats: deserializeStats(entry.stats) } : {}),
+    }))
+  }
+
+  /**
+   * Read a directory through the agent, or over SFTP when there is no agent
+   * or it lacks the readdirEntries operation
+   */
+  private async readDirectoryEntries(remotePath: string, withStats: boolean): Promise<SerializedDirent[]> {
+    const agent = await this.getAgent()
+    if (!agent) {
+      return this.readDirectoryWithSftp(remotePath)
+    }
+
+    try {
+      return await agent.request<SerializedDirent[]>('readdirEntries', { path: remotePath, withStats })
+    } catch (error) {
+      if (error instanceof AgentError && error.code === 'ENOSYS') {
+        return this.readDirectoryWithSftp(remotePath)
+      }
+      throw error
+    }
+  }
+
+  /**
+   * Read a directory over SFTP, with lstat attributes for every entry
+   */
+  private async readDirectoryWithSftp(remotePath: string): Promise<SerializedDirent[]> {
+    return this.withSftp((sftp) => new Promise((resolve, reject) => {
+      let completed = false
+      const timeout = setTimeout(() => {
+        if (!completed) {
+          completed = true
+          getLogger().error(`[SFTP] readdir timed out after ${this.operationTimeoutMs}ms: ${remotePath}`)
+          reject(new FileSystemError(
+            `readdir timed out after ${this.operationTimeoutMs}ms`,
+            ERROR_CODES.READ_FAILED,
+            `readdir ${remotePath}`
+          ))
+        }
+      }, this.operationTimeoutMs)
+
+      sftp.readdir(remotePath, (err, list) => {
+        if (completed) return
+        completed = true
+        clearTimeout(timeout)
+        if (err) {
+          reject(err)
+          return
+        }
+
+        const entries: SerializedDirent[] = []
+        for (const entry of list) {
+          if (entry.filename === '.' || entry.filename === '..') continue
+          const stats = serializeSftpAttributes(entry.attrs as unknown as SftpAttributes)
+          entries.push({ name: entry.filename, kind: stats.kind, stats })
+        }
+        resolve(entries)
+      })
+    }))
+  }
+
   /**
    * Wrap errors consistently
    */
@@ -1316,6 +2675,15 @@ export class RemoteBackend implements FileSystemBackend {
     )
   }
 
+  /**
+   * Open the primary SSH connection, the agent channel and an SFTP session
+   * ahead of the first operation, so it doesn't pay for the handshakes
+   */
+  async warmUp(): Promise<void> {
+    await this.ensureSSHConnection()
+    await Promise.all([this.getAgent(), this.withSftp(async () => {})])
+  }
+
   /**
    * Clean up resources on destruction
    */
@@ -1323,23 +2691,40 @@ export class RemoteBackend implements FileSystemBackend {
     // Clear workspace cache
     this.workspaceCache.clear()
 
-    // Clear cached SFTP session
-    if (this.sftpSession) {
-      try {
-        this.sftpSession.end()
-      } catch {
-        // Ignore errors when ending SFTP session
+    // Shared connections stay open until their last backend is destroyed
+    const lastUser = this.releasedConnections ? this.ssh.users === 0 : releaseHostConnections(this.ssh)
+    this.releasedConnections = true
+    if (!lastUser) {
+      getLogger().debug(`RemoteBackend destroyed for user: ${this.userId} (connections still shared by ${this.ssh.users})`)
+      return
+    }
+
+    // Close the agent channel
+    this.ssh.agentClient?.close()
+    this.ssh.agentClient = null
+    this.ssh.agentPromise = null
+
+    // Clear cached SFTP sessions
+    for (const slot of this.ssh.sftpSlots) {
+      if (slot.session) {
+        try {
+          slot.session.end()
+        } catch {
+          // Ignore errors when ending SFTP session
+        }
+        slot.session = null
       }
-      this.sftpSession = null
+      slot.sessionPromise = null
     }
-    this.sftpSessionPromise = null
 
-    // Close SSH connection
-    if (this.sshClient) {
-      this.sshClient.end()
-      this.sshClient = null
-      this.isConnected = false
-      this.connectionPromise = null
+    // Close SSH connections
+    for (const connection of this.ssh.connections) {
+      if (connection.client) {
+        connection.client.end()
+        connection.client = null
+        connection.isConnected = false
+        connection.connectionPromise = null
+      }
     }
 
     getLogger().debug(`RemoteBackend destroyed for user: ${this.userId}`)
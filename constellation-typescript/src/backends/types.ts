@@ -1,5 +1,5 @@
 import { z } from 'zod'
-import { AUTH_TYPES, DEFAULTS, SHELL_TYPES } from '../constants.js'
+import { AGENT_MODES, AUTH_TYPES, DEFAULTS, SHELL_TYPES } from '../constants.js'
 import type { Workspace, WorkspaceConfig } from '../workspace/Workspace.js'
 
 /**
@@ -15,6 +15,12 @@ const BaseBackendConfigSchema = z.object({
     })
     .optional(),
   maxOutputLength: z.number().positive().optional(),
+  /**
+   * Reject workspace writes that would grow all of this user's workspaces
+   * together beyond this many bytes (default: no quota). Checked by the same
+   * writes as WorkspaceConfig.quotaBytes
+   */
+  userQuotaBytes: z.number().int().positive().optional(),
 })
 
 /**
@@ -48,6 +54,72 @@ const RemoteBackendConfigSchema = BaseBackendConfigSchema.extend({
   keepaliveIntervalMs: z.number().positive().optional(),
   /** Number of missed keep-alives before considering connection dead (default: 3) */
   keepaliveCountMax: z.number().positive().optional(),
+  /**
+   * Path to libintercept.so on the remote host. When set, commands run with the
+   * library preloaded so every process is confined to the workspace at the libc
+   * level (the runtime image builds it to /app/dist-native/libintercept.so)
+   */
+  interceptLibraryPath: z.string().startsWith('/', 'interceptLibraryPath must be absolute').optional(),
+  /**
+   * How to reach the remote agent daemon, which answers stat/exists/list/mkdir/rm
+   * over one multiplexed channel instead of an exec per call (default: 'auto')
+   */
+  agent: z.enum(AGENT_MODES).optional(),
+  /** Agent daemon socket on the remote host (default: /run/constellationfs/<username>.sock) */
+  agentSocketPath: z.string().startsWith('/', 'agentSocketPath must be absolute').optional(),
+  /**
+   * Compress agent request and response bodies with zstd (or deflate where
+   * zstd is unavailable) when the agent supports it; bodies in already
+   * compressed formats are sent as they are (default: true)
+   */
+  compression: z.boolean().optional(),
+  /**
+   * Ask the SSH server for zlib transport compression, which also covers SFTP
+   * transfers and exec output (default: false). Costs CPU on both ends for
+   * every byte, so it pays off mainly over slow links
+   */
+  sshCompression: z.boolean().optional(),
+  /** Bytes per SFTP read/write request for file transfers (default: 32768) */
+  sftpChunkSize: z.number().int().positive().optional(),
+  /** SFTP requests kept in flight per file transfer (default: 64) */
+  sftpConcurrency: z.number().int().positive().optional(),
+  /**
+   * Write files through the agent as content-defined chunks, sending only the
+   * chunks the remote copy lacks and skipping unchanged content (default: true)
+   */
+  deltaSync: z.boolean().optional(),
+  /** Smallest file written with deltaSync; smaller files are uploaded whole (default: 65536) */
+  deltaSyncMinBytes: z.number().int().nonnegative().optional(),
+  /**
+   * Keep file contents read through the agent in a content-addressed cache of
+   * up to this many bytes, shared by every remote backend in the process
+   * (default: off). A read asks the agent for the file's hash and skips the
+   * transfer when any backend already read the same content from this host
+   */
+  readCacheBytes: z.number().int().positive().optional(),
+  /** Smallest file looked up in the read cache; smaller files come back with the hash request (default: 65536) */
+  readCacheMinBytes: z.number().int().nonnegative().optional(),
+  /**
+   * SSH connections opened to the host (default: 1). Commands and transfers go
+   * to the least busy connection; extra connections open only under load
+   */
+  sshConnections: z.number().int().positive().optional(),
+  /** SFTP sessions spread over the connections (default: 1) */
+  sftpSessions: z.number().int().positive().optional(),
+  /** Concurrent SSH channels per connection before operations queue (default: 50, keep below the server's MaxSessions) */
+  channelsPerConnection: z.number().int().positive().optional(),
+  /**
+   * Share SSH connections, SFTP sessions and the agent channel with every other
+   * backend for the same host, login and connection settings (default: false).
+   * Users stay isolated by their workspace paths, as with separate connections
+   */
+  shareConnections: z.boolean().optional(),
+  /**
+   * Concurrent SSH channels this backend may hold before its operations queue
+   * (default: no limit beyond channelsPerConnection). With shareConnections this
+   * keeps one user from taking the whole budget of the shared connections
+   */
+  channelsPerUser: z.number().int().positive().optional(),
 })
 
 export const BackendConfigSchema = z.discriminatedUnion('type', [
@@ -106,6 +178,25 @@ export interface FileSystemBackend {
    */
   listWorkspaces(): Promise<string[]>
 
+  /**
+   * Create a workspace as a copy of another workspace of this user
+   * Files are reflinked where the host filesystem supports it, so the copy
+   * is near-instant and shares unchanged blocks with the source.
+   * @param sourceName - Existing workspace to copy, e.g. a prepared template
+   * @param targetName - Name of the new workspace; must not exist yet
+   * @param config - Optional configuration for the returned workspace
+   * @returns Promise resolving to the new workspace
+   * @throws {FileSystemError} When the source is missing or the target already exists
+   */
+  cloneWorkspace(sourceName: string, targetName: string, config?: WorkspaceConfig): Promise<Workspace>
+
+  /**
+   * Establish connections ahead of the first operation
+   * (a no-op for backends without connections)
+   * @returns Promise that resolves once the backend is ready
+   */
+  warmUp(): Promise<void>
+
   /**
    * Clean up backend resources
    * @returns Promise that resolves when cleanup is complete
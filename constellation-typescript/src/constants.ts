@@ -20,6 +20,15 @@ export type ShellType = typeof SHELL_TYPES[number]
 export const AUTH_TYPES = ['key', 'password'] as const
 export type AuthType = typeof AUTH_TYPES[number]
 
+/**
+ * Remote agent usage modes
+ * - auto: daemon socket, then spawn over exec, then plain shell commands
+ * - socket / exec: only the given transport, then plain shell commands
+ * - off: always use shell commands
+ */
+export const AGENT_MODES = ['auto', 'socket', 'exec', 'off'] as const
+export type AgentMode = typeof AGENT_MODES[number]
+
 /**
  * Default values for configuration
  */
@@ -51,6 +60,9 @@ export const ERROR_CODES = {
   READ_FAILED: 'READ_FAILED',
   WRITE_FAILED: 'WRITE_FAILED',
   LS_FAILED: 'LS_FAILED',
+  EDIT_NOT_FOUND: 'EDIT_NOT_FOUND',
+  WATCH_FAILED: 'WATCH_FAILED',
+  QUOTA_EXCEEDED: 'QUOTA_EXCEEDED',
 
   // Validation errors
   EMPTY_COMMAND: 'EMPTY_COMMAND',
@@ -0,0 +1,105 @@
+// Local entry point: everything needed to run workspaces on this machine.
+// It loads neither ssh2 nor the MCP SDK; `constellationfs/remote` adds the
+// remote backend classes and `constellationfs/mcp` the MCP client helpers.
+
+// Core API
+export { ConstellationFS } from './config/Config.js'
+export { FileSystem } from './FileSystem.js'
+export {
+  FileSystemPoolManager,
+  type AcquireOptions,
+  type PoolManagerConfig,
+  type PoolStats
+} from './FileSystemPoolManager.js'
+
+// Backend Management
+export { BackendFactory } from './backends/BackendFactory.js'
+
+// Workspace Classes
+export { LocalWorkspace } from './workspace/LocalWorkspace.js'
+export { BaseWorkspace } from './workspace/Workspace.js'
+export {
+  DEFAULT_EXEC_STREAM_RETAIN_BYTES, ExecStream,
+  type ExecStreamChunk, type ExecStreamOptions, type ExecStreamResult
+} from './workspace/ExecStream.js'
+export type {
+  BatchOperation,
+  BatchResult,
+  ExecOptions,
+  ReadStreamOptions,
+  SyncOperationsPolicy,
+  Workspace,
+  WorkspaceConfig,
+  WorkspacePromises,
+} from './workspace/Workspace.js'
+
+// Backend Classes
+export { LocalBackend } from './backends/LocalBackend.js'
+
+// Operations Logging
+export {
+  ArrayOperationsLogger,
+  ConsoleOperationsLogger,
+  FileOperationLogSink,
+  MODIFYING_OPERATIONS,
+  OtlpOperationLogSink,
+  RingBufferOperationsLogger,
+  shouldLogOperation
+} from './logging/index.js'
+export type {
+  LoggingMode,
+  OperationLogEntry,
+  OperationLogSink,
+  OperationsLogger,
+  OperationType,
+  OtlpOperationLogSinkOptions,
+  RingBufferOperationsLoggerOptions
+} from './logging/index.js'
+
+// Metrics
+export {
+  formatPrometheusMetrics,
+  getMetrics,
+  isMetricsEnabled,
+  METRIC_QUANTILES,
+  resetMetrics,
+  setMetricsEnabled
+} from './utils/metrics.js'
+export type { CounterSnapshot, HistogramSnapshot, MetricLabels, MetricsSnapshot } from './utils/metrics.js'
+
+// Error Classes
+export { DangerousOperationError, FileSystemError } from './types.js'
+
+// Utilities
+export {
+  applyEditsToContent,
+  createUnifiedDiff,
+  EditNoMatchError,
+  type ApplyEditsOptions,
+  type ApplyEditsResult,
+  type TextEdit
+} from './utils/applyEdits.js'
+export {
+  ChangeFeed,
+  DEFAULT_WATCH_DEBOUNCE_MS,
+  type ChangeSource,
+  type WatchEvent,
+  type WatchOptions,
+  type WorkspaceWatcher
+} from './utils/ChangeFeed.js'
+export { cloneTree } from './utils/cloneTree.js'
+export { ContentCache, DEFAULT_READ_CACHE_MIN_BYTES, hashFile } from './utils/ContentCache.js'
+export { HeadTailBuffer, type HeadTailLimits } from './utils/HeadTailBuffer.js'
+export { MetadataCache, type MetadataCacheOptions } from './utils/MetadataCache.js'
+export { SearchPatternError, searchTree, type SearchMatch, type SearchOptions, type SearchResult } from './utils/search.js'
+export { moveToTrash, TRASH_DIRECTORY, TrashReaper, type TrashReaperOptions } from './utils/TrashReaper.js'
+export { SEARCH_INDEX_DIRECTORY, TrigramIndex } from './utils/TrigramIndex.js'
+export { UsageTracker, type UsageReport, type WorkspaceUsage } from './utils/UsageTracker.js'
+export { compileExcludes, walkTree, type WalkEntry, type WalkEntryType, type WalkOptions, type WalkResult } from './utils/walk.js'
+
+// Public Types
+export type {
+  BackendConfig, FileInfo, FileSystemBackend, FileSystemInterface,
+  LocalBackendConfig,
+  RemoteBackendConfig
+} from './types.js'
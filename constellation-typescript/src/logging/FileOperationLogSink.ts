@@ -0,0 +1,20 @@
+import { appendFile } from 'fs/promises'
+import type { OperationLogEntry, OperationLogSink } from './types.js'
+
+/**
+ * Sink appending records to a file as JSON Lines
+ * Each batch is one append, so the file sees one write per drain rather
+ * than one per operation.
+ */
+export class FileOperationLogSink implements OperationLogSink {
+  /**
+   * @param path - File to append to; created when missing
+   */
+  constructor(public readonly path: string) {}
+
+  async write(entries: readonly OperationLogEntry[]): Promise<void> {
+    if (entries.length === 0) return
+    const lines = entries.map(entry => JSON.stringify(entry)).join('\n')
+    await appendFile(this.path, `${lines}\n`)
+  }
+}
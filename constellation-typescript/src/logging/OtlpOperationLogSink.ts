@@ -0,0 +1,91 @@
+import type { OperationLogEntry, OperationLogSink } from './types.js'
+
+/** OTLP severity numbers for successful and failed operations */
+const SEVERITY_INFO = 9
+const SEVERITY_ERROR = 17
+
+/**
+ * Options for OtlpOperationLogSink
+ */
+export interface OtlpOperationLogSinkOptions {
+  /** OTLP/HTTP logs endpoint, e.g. http://collector:4318/v1/logs */
+  url: string
+  /** Extra request headers, e.g. for authentication */
+  headers?: Record<string, string>
+  /** service.name resource attribute (default: 'constellationfs') */
+  serviceName?: string
+  /** Request timeout in milliseconds (default: 10000) */
+  timeoutMs?: number
+}
+
+type OtlpValue = { stringValue: string } | { intValue: string } | { doubleValue: number } | { boolValue: boolean }
+
+function attribute(key: string, value: OtlpValue): { key: string; value: OtlpValue } {
+  return { key, value }
+}
+
+/**
+ * Sink exporting records to an OpenTelemetry collector as OTLP/HTTP JSON logs
+ * One export request per batch.
+ */
+export class OtlpOperationLogSink implements OperationLogSink {
+  private readonly options: OtlpOperationLogSinkOptions
+
+  constructor(options: OtlpOperationLogSinkOptions) {
+    this.options = options
+  }
+
+  async write(entries: readonly OperationLogEntry[]): Promise<void> {
+    if (entries.length === 0) return
+
+    const response = await fetch(this.options.url, {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json', ...this.options.headers },
+      body: JSON.stringify(this.exportRequest(entries)),
+      signal: AbortSignal.timeout(this.options.timeoutMs ?? 10_000),
+    })
+    if (!response.ok) {
+      throw new Error(`OTLP export failed: ${response.status} ${response.statusText}`)
+    }
+  }
+
+  /**
+   * ExportLogsServiceRequest for a batch
+   */
+  exportRequest(entries: readonly OperationLogEntry[]): object {
+    return {
+      resourceLogs: [{
+        resource: {
+          attributes: [attribute('service.name', { stringValue: this.options.serviceName ?? 'constellationfs' })],
+        },
+        scopeLogs: [{
+          scope: { name: 'constellationfs' },
+          logRecords: entries.map(entry => this.logRecord(entry)),
+        }],
+      }],
+    }
+  }
+
+  private logRecord(entry: OperationLogEntry): object {
+    const attributes = [
+      attribute('constellation.operation', { stringValue: entry.operation }),
+      attribute('constellation.user_id', { stringValue: entry.userId }),
+      attribute('constellation.workspace', { stringValue: entry.workspaceName }),
+      attribute('constellation.workspace_path', { stringValue: entry.workspacePath }),
+      attribute('constellation.success', { boolValue: entry.success }),
+      attribute('constellation.duration_ms', { doubleValue: entry.durationMs }),
+    ]
+    if (entry.exitCode !== undefined) attributes.push(attribute('process.exit_code', { intValue: String(entry.exitCode) }))
+    if (entry.stdout !== undefined) attributes.push(attribute('constellation.stdout', { stringValue: entry.stdout }))
+    if (entry.stderr !== undefined) attributes.push(attribute('constellation.stderr', { stringValue: entry.stderr }))
+    if (entry.error !== undefined) attributes.push(attribute('exception.message', { stringValue: entry.error }))
+
+    return {
+      timeUnixNano: (BigInt(entry.timestamp.getTime()) * 1_000_000n).toString(),
+      severityNumber: entry.success ? SEVERITY_INFO : SEVERITY_ERROR,
+      severityText: entry.success ? 'INFO' : 'ERROR',
+      body: { stringValue: `${entry.operation}: ${entry.command}` },
+      attributes,
+    }
+  }
+}
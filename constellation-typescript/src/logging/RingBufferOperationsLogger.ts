@@ -0,0 +1,268 @@
+import { getLogger } from '../utils/logger.js'
+import type { LoggingMode, OperationLogEntry, OperationLogSink, OperationsLogger, OperationType } from './types.js'
+
+/** Default number of records kept */
+const DEFAULT_CAPACITY = 1024
+
+/** Default bytes of stdout and of stderr kept per record */
+const DEFAULT_MAX_OUTPUT_BYTES = 4096
+
+/** Default records handed to the sinks per write */
+const DEFAULT_BATCH_SIZE = 256
+
+/** Default interval between background drains in milliseconds */
+const DEFAULT_FLUSH_INTERVAL_MS = 1000
+
+const SUCCESS = 1
+/** Length stored for an absent stdout/stderr, as opposed to an empty one */
+const NO_OUTPUT = -1
+
+/**
+ * Options for RingBufferOperationsLogger
+ */
+export interface RingBufferOperationsLoggerOptions {
+  /** Logging mode (default: 'standard') */
+  mode?: LoggingMode
+  /** Records kept; once full, each new record replaces the oldest (default: 1024) */
+  capacity?: number
+  /** UTF-8 bytes of stdout and of stderr kept per record; longer output is truncated (default: 4096) */
+  maxOutputBytes?: number
+  /** Destinations the records are drained to in batches (default: none, records are only kept in memory) */
+  sinks?: OperationLogSink[]
+  /** Records per sink write; reaching it also triggers a drain (default: 256) */
+  batchSize?: number
+  /** Interval between background drains in milliseconds (default: 1000) */
+  flushIntervalMs?: number
+}
+
+/**
+ * Operations logger with fixed memory, cheap enough for verbose mode on busy workspaces
+ *
+ * Records go into preallocated slots: numeric fields in typed arrays, exec
+ * output copied into one preallocated buffer and truncated at
+ * maxOutputBytes, so the logger never holds on to a command's full
+ * stdout/stderr. Paths, commands and error messages are kept by reference.
+ * When the ring is full, new records replace the oldest.
+ *
+ * With sinks, records are drained in batches off the hot path: every
+ * flushIntervalMs, or as soon as batchSize records are waiting. Records
+ * replaced before they were drained are counted in `dropped`.
+ */
+export class RingBufferOperationsLogger implements OperationsLogger {
+  public readonly mode: LoggingMode
+
+  private readonly capacity: number
+  private readonly maxOutputBytes: number
+  private readonly sinks: OperationLogSink[]
+  private readonly batchSize: number
+  private readonly flushIntervalMs: number
+
+  // One slot per record, indexed by sequence number % capacity
+  private readonly timestamps: Float64Array
+  private readonly durations: Float64Array
+  private readonly exitCodes: Float64Array
+  private readonly flags: Uint8Array
+  /** Bytes of stdout then stderr stored in `output`, or NO_OUTPUT */
+  private readonly outputBytes: Int32Array
+  /** Length in characters of the original stdout then stderr */
+  private readonly outputLengths: Uint32Array
+  private readonly output: Buffer
+  private readonly operations: OperationType[]
+  private readonly userIds: string[]
+  private readonly workspaceNames: string[]
+  private readonly workspacePaths: string[]
+  private readonly commands: string[]
+  private readonly errors: Array<string | undefined>
+
+  /** Sequence number of the next record */
+  private written = 0
+  /** Sequence number of the oldest record not yet drained */
+  private drained = 0
+  private droppedRecords = 0
+  private timer: ReturnType<typeof setInterval> | null = null
+  private drainScheduled = false
+  private flushing: Promise<void> = Promise.resolve()
+
+  constructor(options: RingBufferOperationsLoggerOptions = {}) {
+    this.mode = options.mode ?? 'standard'
+    this.capacity = Math.max(1, Math.floor(options.capacity ?? DEFAULT_CAPACITY))
+    this.maxOutputBytes = Math.max(0, Math.floor(options.maxOutputBytes ?? DEFAULT_MAX_OUTPUT_BYTES))
+    this.sinks = options.sinks ?? []
+    this.batchSize = Math.max(1, Math.floor(options.batchSize ?? DEFAULT_BATCH_SIZE))
+    this.flushIntervalMs = options.flushIntervalMs ?? DEFAULT_FLUSH_INTERVAL_MS
+
+    this.timestamps = new Float64Array(this.capacity)
+    this.durations = new Float64Array(this.capacity)
+    this.exitCodes = new Float64Array(this.capacity)
+    this.flags = new Uint8Array(this.capacity)
+    this.outputBytes = new Int32Array(this.capacity * 2)
+    this.outputLengths = new Uint32Array(this.capacity * 2)
+    this.output = Buffer.alloc(this.capacity * 2 * this.maxOutputBytes)
+    this.operations = new Array(this.capacity)
+    this.userIds = new Array(this.capacity)
+    this.workspaceNames = new Array(this.capacity)
+    this.workspacePaths = new Array(this.capacity)
+    this.commands = new Array(this.capacity)
+    this.errors = new Array(this.capacity)
+  }
+
+  log(entry: OperationLogEntry): void {
+    const slot = this.written % this.capacity
+    this.timestamps[slot] = entry.timestamp.getTime()
+    this.durations[slot] = entry.durationMs
+    this.exitCodes[slot] = entry.exitCode ?? NaN
+    this.flags[slot] = entry.success ? SUCCESS : 0
+    this.operations[slot] = entry.operation
+    this.userIds[slot] = entry.userId
+    this.workspaceNames[slot] = entry.workspaceName
+    this.workspacePaths[slot] = entry.workspacePath
+    this.commands[slot] = entry.command
+    this.errors[slot] = entry.error
+    this.storeOutput(slot * 2, entry.stdout)
+    this.storeOutput(slot * 2 + 1, entry.stderr)
+    this.written++
+
+    if (this.sinks.length === 0) return
+    if (this.written - this.drained > this.capacity) {
+      this.droppedRecords += this.written - this.drained - this.capacity
+      this.drained = this.written - this.capacity
+    }
+    if (this.written - this.drained >= this.batchSize) {
+      this.scheduleDrain()
+    }
+    if (!this.timer && this.flushIntervalMs > 0) {
+      this.timer = setInterval(() => void this.flush(), this.flushIntervalMs)
+      this.timer.unref()
+    }
+  }
+
+  /**
+   * Records still in the ring, oldest first
+   */
+  getEntries(): OperationLogEntry[] {
+    const entries: OperationLogEntry[] = []
+    for (let seq = Math.max(0, this.written - this.capacity); seq < this.written; seq++) {
+      entries.push(this.readRecord(seq))
+    }
+    return entries
+  }
+
+  /** Number of records in the ring */
+  get length(): number {
+    return Math.min(this.written, this.capacity)
+  }
+
+  /** Records replaced before they could be drained to the sinks */
+  get dropped(): number {
+    return this.droppedRecords
+  }
+
+  /**
+   * Drop every record, drained or not
+   */
+  clear(): void {
+    this.written = 0
+    this.drained = 0
+    this.commands.fill(undefined as unknown as string)
+    this.errors.fill(undefined)
+  }
+
+  /**
+   * Drain every waiting record to the sinks
+   * A failing sink is reported through the internal logger and doesn't stop
+   * the others; its records are not retried.
+   */
+  flush(): Promise<void> {
+    this.flushing = this.flushing.then(() => this.drain())
+    return this.flushing
+  }
+
+  /**
+   * Stop the background drain, flush and close the sinks
+   */
+  async close(): Promise<void> {
+    if (this.timer) {
+      clearInterval(this.timer)
+      this.timer = null
+    }
+    await this.flush()
+    await Promise.all(this.sinks.map(async (sink) => {
+      try {
+        await sink.close?.()
+      } catch (error) {
+        getLogger().error('Failed to close operation log sink', error)
+      }
+    }))
+  }
+
+  private storeOutput(index: number, text: string | undefined): void {
+    if (text === undefined) {
+      this.outputBytes[index] = NO_OUTPUT
+      return
+    }
+    // A UTF-8 byte per UTF-16 unit at least, so this prefix fills the slot when the text is longer
+    const prefix = text.length > this.maxOutputBytes ? text.slice(0, this.maxOutputBytes) : text
+    this.outputBytes[index] = this.output.write(prefix, index * this.maxOutputBytes, this.maxOutputBytes, 'utf8')
+    this.outputLengths[index] = text.length
+  }
+
+  private readOutput(index: number): string | undefined {
+    const bytes = this.outputBytes[index]!
+    if (bytes === NO_OUTPUT) return undefined
+
+    const start = index * this.maxOutputBytes
+    const text = this.output.toString('utf8', start, start + bytes)
+    const length = this.outputLengths[index]!
+    return text.length < length ? `${text}\n... [truncated, ${length} characters in total]` : text
+  }
+
+  private readRecord(seq: number): OperationLogEntry {
+    const slot = seq % this.capacity
+    const entry: OperationLogEntry = {
+      timestamp: new Date(this.timestamps[slot]!),
+      operation: this.operations[slot]!,
+      userId: this.userIds[slot]!,
+      workspaceName: this.workspaceNames[slot]!,
+      workspacePath: this.workspacePaths[slot]!,
+      command: this.commands[slot]!,
+      success: (this.flags[slot]! & SUCCESS) !== 0,
+      durationMs: this.durations[slot]!,
+    }
+    const stdout = this.readOutput(slot * 2)
+    const stderr = this.readOutput(slot * 2 + 1)
+    if (stdout !== undefined) entry.stdout = stdout
+    if (stderr !== undefined) entry.stderr = stderr
+    if (!Number.isNaN(this.exitCodes[slot])) entry.exitCode = this.exitCodes[slot]
+    if (this.errors[slot] !== undefined) entry.error = this.errors[slot]
+    return entry
+  }
+
+  private scheduleDrain(): void {
+    if (this.drainScheduled) return
+    this.drainScheduled = true
+    setImmediate(() => {
+      this.drainScheduled = false
+      void this.flush()
+    })
+  }
+
+  private async drain(): Promise<void> {
+    while (this.written > this.drained) {
+      // Decode before awaiting the sinks; the slots may be reused meanwhile
+      const end = Math.min(this.written, this.drained + this.batchSize)
+      const batch: OperationLogEntry[] = []
+      for (let seq = this.drained; seq < end; seq++) {
+        batch.push(this.readRecord(seq))
+      }
+      this.drained = end
+
+      await Promise.all(this.sinks.map(async (sink) => {
+        try {
+          await sink.write(batch)
+        } catch (error) {
+          getLogger().error(`Failed to write ${batch.length} operation log record(s)`, error)
+        }
+      }))
+    }
+  }
+}
@@ -1,8 +1,12 @@
 export { ArrayOperationsLogger } from './ArrayOperationsLogger.js'
 export { ConsoleOperationsLogger } from './ConsoleOperationsLogger.js'
+export { FileOperationLogSink } from './FileOperationLogSink.js'
+export { OtlpOperationLogSink, type OtlpOperationLogSinkOptions } from './OtlpOperationLogSink.js'
+export { RingBufferOperationsLogger, type RingBufferOperationsLoggerOptions } from './RingBufferOperationsLogger.js'
 export type {
   LoggingMode,
   OperationLogEntry,
+  OperationLogSink,
   OperationsLogger,
   OperationType,
 } from './types.js'
@@ -21,6 +21,9 @@ export type OperationType =
   | 'exists'
   | 'stat'
   | 'list'
+  | 'search'
+  | 'walk'
+  | 'edit'
 
 /**
  * Operations that modify the workspace state
@@ -33,6 +36,7 @@ export const MODIFYING_OPERATIONS: readonly OperationType[] = [
   'touch',
   'mkdir',
   'delete',
+  'edit',
 ] as const
 
 /**
@@ -95,6 +99,20 @@ export interface OperationsLogger {
   readonly mode: LoggingMode
 }
 
+/**
+ * Destination that a buffering logger drains operation records to in batches
+ */
+export interface OperationLogSink {
+  /**
+   * Write one batch of records, oldest first
+   * @param entries - Records of the batch
+   */
+  write(entries: readonly OperationLogEntry[]): void | Promise<void>
+
+  /** Release the sink's resources after the last batch */
+  close?(): void | Promise<void>
+}
+
 /**
  * Helper function to determine if an operation should be logged based on mode
  * @param operation - The operation type
@@ -0,0 +1,68 @@
+import type { Transport } from '@modelcontextprotocol/sdk/shared/transport.js'
+
+/**
+ * MCP transport that creates the real transport when it is started
+ *
+ * FileSystem.getMCPTransport() returns one so it can stay synchronous while
+ * the MCP SDK's client modules are only loaded by processes that connect.
+ * Callbacks, protocol version and session ID are forwarded to the real
+ * transport once it exists.
+ */
+export class DeferredTransport implements Transport {
+  onclose?: Transport['onclose']
+  onerror?: Transport['onerror']
+  onmessage?: Transport['onmessage']
+
+  private transport: Transport | null = null
+  private protocolVersion: string | undefined
+  private closed = false
+
+  /**
+   * @param create - Loads and builds the real transport
+   */
+  constructor(private readonly create: () => Promise<Transport>) {}
+
+  get sessionId(): string | undefined {
+    return this.transport?.sessionId
+  }
+
+  async start(): Promise<void> {
+    if (this.transport) {
+      throw new Error('DeferredTransport already started')
+    }
+    const transport = await this.create()
+    if (this.closed) {
+      throw new Error('DeferredTransport closed before it started')
+    }
+    transport.onclose = () => this.onclose?.()
+    transport.onerror = (error) => this.onerror?.(error)
+    transport.onmessage = (...args: Parameters<NonNullable<Transport['onmessage']>>) => this.onmessage?.(...args)
+    if (this.protocolVersion !== undefined) {
+      transport.setProtocolVersion?.(this.protocolVersion)
+    }
+    this.transport = transport
+    await transport.start()
+  }
+
+  async send(...args: Parameters<Transport['send']>): Promise<void> {
+    if (!this.transport) {
+      throw new Error('DeferredTransport not started')
+    }
+    await this.transport.send(...args)
+  }
+
+  async close(): Promise<void> {
+    if (this.closed) return
+    this.closed = true
+    if (this.transport) {
+      await this.transport.close()
+    } else {
+      this.onclose?.()
+    }
+  }
+
+  setProtocolVersion(version: string): void {
+    this.protocolVersion = version
+    this.transport?.setProtocolVersion?.(version)
+  }
+}
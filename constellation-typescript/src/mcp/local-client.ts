@@ -1,7 +1,37 @@
 import { Client } from '@modelcontextprotocol/sdk/client/index.js'
 import { StdioClientTransport } from '@modelcontextprotocol/sdk/client/stdio.js'
+import { existsSync } from 'fs'
+import { dirname, join } from 'path'
+import { fileURLToPath } from 'url'
 import { ConstellationFS } from '../config/Config.js'
 
+/** MCP server script of this package, relative to the package root */
+const MCP_BIN = join('bin', 'constellation-fs-mcp.js')
+
+/** Compiled server the script loads, relative to the package root */
+const MCP_SERVER_BUILD = join('dist', 'mcp', 'server.js')
+
+let packagedServer: string | null | undefined
+
+/**
+ * The MCP server script of this package, when it is installed with its build
+ * This module runs from src/mcp or from a bundle in dist, so the package root
+ * is looked for in the directories above it.
+ */
+function findPackagedServer(): string | null {
+  if (packagedServer !== undefined) return packagedServer
+  packagedServer = null
+  let dir = dirname(fileURLToPath(import.meta.url))
+  for (let depth = 0; depth < 3; depth++) {
+    dir = dirname(dir)
+    if (existsSync(join(dir, MCP_BIN)) && existsSync(join(dir, MCP_SERVER_BUILD))) {
+      packagedServer = join(dir, MCP_BIN)
+      break
+    }
+  }
+  return packagedServer
+}
+
 export interface LocalConstellationMCPClientOptions {
   /** User ID for workspace isolation */
   userId: string
@@ -24,6 +54,10 @@ export interface LocalMCPTransportOptions {
  * Get stdio transport options for spawning a local ConstellationFS MCP server.
  * Use this with Vercel AI SDK's StdioMCPTransport.
  *
+ * The server script of this package is run with the current Node binary, so a
+ * session doesn't pay for npx resolving the package on every spawn. `npx
+ * constellation-fs-mcp` is the fallback when the package isn't built.
+ *
  * @example
  * ```typescript
  * import { experimental_createMCPClient as createMCPClient } from '@ai-sdk/mcp'
@@ -44,15 +78,16 @@ export function createLocalConstellationMCPTransportOptions(
   options: LocalConstellationMCPClientOptions
 ): LocalMCPTransportOptions {
   const workspaceRoot = options.workspaceRoot ?? ConstellationFS.getWorkspaceRoot()
-  return {
-    command: 'npx',
-    args: [
-      'constellation-fs-mcp',
-      '--workspaceRoot', workspaceRoot,
-      '--userId', options.userId,
-      '--workspace', options.workspace,
-    ],
+  const serverArgs = [
+    '--workspaceRoot', workspaceRoot,
+    '--userId', options.userId,
+    '--workspace', options.workspace,
+  ]
+  const server = findPackagedServer()
+  if (server) {
+    return { command: process.execPath, args: [server, ...serverArgs] }
   }
+  return { command: 'npx', args: ['constellation-fs-mcp', ...serverArgs] }
 }
 
 /** Default timeout for local MCP client connection (15 seconds - longer since it spawns a process) */
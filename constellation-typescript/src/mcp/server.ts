@@ -1,10 +1,14 @@
 import { McpServer } from '@modelcontextprotocol/sdk/server/mcp.js'
 import { StdioServerTransport } from '@modelcontextprotocol/sdk/server/stdio.js'
-import { StreamableHTTPServerTransport } from '@modelcontextprotocol/sdk/server/streamableHttp.js'
+import type { StreamableHTTPServerTransport } from '@modelcontextprotocol/sdk/server/streamableHttp.js'
 import { randomUUID } from 'crypto'
-import express, { type NextFunction, type Request, type Response } from 'express'
+import type { NextFunction, Request, Response } from 'express'
 import { ConstellationFS } from '../config/Config.js'
 import { FileSystem } from '../FileSystem.js'
+import { FileSystemPoolManager } from '../FileSystemPoolManager.js'
+import { getLogger } from '../utils/logger.js'
+import { formatPrometheusMetrics, incrementCounter, setMetricsEnabled } from '../utils/metrics.js'
+import { OverloadedError, RequestLimiter } from '../utils/RequestLimiter.js'
 import type { Workspace } from '../workspace/Workspace.js'
 import { registerTools } from './tools.js'
 
@@ -42,6 +46,11 @@ import { registerTools } from './tools.js'
 //     --port 3000 \
 //     --authToken secret123
 //
+// Add --metrics to record latency metrics and serve them in the Prometheus
+// text format on GET /metrics (same bearer token as /mcp). --maxSessions,
+// --sessionIdleTimeoutMs, --maxConcurrentRequests and --maxQueuedRequests
+// bound the server's memory and work (see Session Management below).
+//
 // CHOOSING A MODE
 // ---------------
 // - If each user/session spawns its own MCP server process → use stdio mode
@@ -65,6 +74,11 @@ interface ServerConfig {
   http?: boolean
   port?: number
   authToken?: string
+  metrics?: boolean
+  maxSessions?: number
+  sessionIdleTimeoutMs?: number
+  maxConcurrentRequests?: number
+  maxQueuedRequests?: number
 }
 
 function parseArgs(args: string[]): ServerConfig {
@@ -98,6 +112,25 @@ function parseArgs(args: string[]): ServerConfig {
         config.authToken = next
         i++
         break
+      case '--metrics':
+        config.metrics = true
+        break
+      case '--maxSessions':
+        config.maxSessions = parseInt(next || '', 10)
+        i++
+        break
+      case '--sessionIdleTimeoutMs':
+        config.sessionIdleTimeoutMs = parseInt(next || '', 10)
+        i++
+        break
+      case '--maxConcurrentRequests':
+        config.maxConcurrentRequests = parseInt(next || '', 10)
+        i++
+        break
+      case '--maxQueuedRequests':
+        config.maxQueuedRequests = parseInt(next || '', 10)
+        i++
+        break
     }
   }
 
@@ -114,6 +147,14 @@ function parseArgs(args: string[]): ServerConfig {
       printUsage()
       process.exit(1)
     }
+    for (const flag of ['maxSessions', 'sessionIdleTimeoutMs', 'maxConcurrentRequests', 'maxQueuedRequests'] as const) {
+      const value = config[flag]
+      if (value !== undefined && !(Number.isInteger(value) && value >= (flag === 'maxQueuedRequests' ? 0 : 1))) {
+        console.error(`--${flag} must be a ${flag === 'maxQueuedRequests' ? 'non-negative' : 'positive'} integer`)
+        printUsage()
+        process.exit(1)
+      }
+    }
   } else {
     if (!config.userId || !config.workspace) {
       console.error('--userId and --workspace are required in stdio mode')
@@ -132,21 +173,43 @@ Usage:
     constellation-fs-mcp --workspaceRoot <path> --userId <userId> --workspace <workspace>
 
   HTTP mode (multi-session):
-    constellation-fs-mcp --workspaceRoot <path> --http --port <port> --authToken <token>
+    constellation-fs-mcp --workspaceRoot <path> --http --port <port> --authToken <token> [--metrics]
+      [--maxSessions <n>]              open sessions (default: ${DEFAULT_MAX_SESSIONS})
+      [--sessionIdleTimeoutMs <ms>]    close sessions idle this long (default: ${DEFAULT_SESSION_IDLE_TIMEOUT_MS})
+      [--maxConcurrentRequests <n>]    requests handled at once (default: ${DEFAULT_MAX_CONCURRENT_REQUESTS})
+      [--maxQueuedRequests <n>]        requests waiting beyond that, then 503 (default: ${DEFAULT_MAX_QUEUED_REQUESTS})
 `)
 }
 
 // ─────────────────────────────────────────────────────────────────
 // Session Management (HTTP mode only)
 // ─────────────────────────────────────────────────────────────────
+//
+// Each session gets its own McpServer and transport, but its workspace comes
+// from a FileSystemPoolManager, so sessions of the same user share one
+// FileSystem and its backend connections. Sessions are capped, expire after
+// an idle period even if the client never closes them, and their requests
+// run through a RequestLimiter that queues up to a bound and sheds the rest
+// with 503 instead of letting memory grow with the backlog.
 
 interface SessionContext {
   userId: string
   workspaceName: string
   workspace: Workspace
-  fs: FileSystem
+  server: McpServer
+  transport: StreamableHTTPServerTransport
+  /** Returns the session's pool reference */
+  release: () => void
+  lastActivity: number
 }
 
+const DEFAULT_MAX_SESSIONS = 1000
+const DEFAULT_SESSION_IDLE_TIMEOUT_MS = 30 * 60 * 1000
+const DEFAULT_MAX_CONCURRENT_REQUESTS = 256
+const DEFAULT_MAX_QUEUED_REQUESTS = 1024
+/** Seconds clients are asked to wait before retrying a shed request */
+const RETRY_AFTER_SECONDS = 1
+
 const sessions = new Map<string, SessionContext>()
 
 /**
@@ -174,36 +237,50 @@ function validateSessionHeaders(headers: Record<string, string>): void {
   }
 }
 
-async function initializeSession(
-  sessionId: string,
-  headers: Record<string, string>,
-): Promise<SessionContext> {
-  // Headers are already validated by validateSessionHeaders, but extract values
-  const userId = headers['x-user-id']!
-  const workspaceName = headers['x-workspace']!
-
-  const fs = new FileSystem({ userId, type: 'local' })
-  const workspace = await fs.getWorkspace(workspaceName)
-
-  const context: SessionContext = { userId, workspaceName, workspace, fs }
-  sessions.set(sessionId, context)
-  return context
+function createMcpServer(getWorkspace: () => Workspace): McpServer {
+  const server = new McpServer({
+    name: 'constellation-fs',
+    version: '1.0.0',
+  })
+  registerTools(server, getWorkspace)
+  return server
 }
 
-function getSessionContext(sessionId: string): SessionContext {
+async function destroySession(sessionId: string): Promise<void> {
   const context = sessions.get(sessionId)
-  if (!context) {
-    throw new Error(`Session not found: ${sessionId}`)
+  if (!context) return
+
+  // Delete first so the transport's own close callback finds nothing to do
+  sessions.delete(sessionId)
+  try {
+    await context.server.close()
+  } catch (err) {
+    console.error(`[MCP] Error closing session ${sessionId}:`, err)
   }
-  return context
+  context.release()
 }
 
-async function destroySession(sessionId: string): Promise<void> {
-  const context = sessions.get(sessionId)
-  if (context) {
-    await context.fs.destroy()
-    sessions.delete(sessionId)
+/**
+ * Destroy sessions that saw no request for longer than `idleTimeoutMs`
+ */
+async function expireIdleSessions(idleTimeoutMs: number): Promise<void> {
+  const now = Date.now()
+  const expired = [...sessions].filter(([, context]) => now - context.lastActivity > idleTimeoutMs)
+  if (expired.length > 0) {
+    console.log(`[MCP] Expiring ${expired.length} idle session(s)`)
   }
+  await Promise.all(expired.map(([sessionId]) => destroySession(sessionId)))
+}
+
+/**
+ * Reply 503 with a JSON-RPC error so MCP clients can back off and retry
+ */
+function sendOverloaded(res: Response, message: string): void {
+  res.status(503).set('Retry-After', String(RETRY_AFTER_SECONDS)).json({
+    jsonrpc: '2.0',
+    error: { code: -32000, message },
+    id: null,
+  })
 }
 
 // ─────────────────────────────────────────────────────────────────
@@ -218,46 +295,84 @@ export async function main(args: string[]) {
     workspaceRoot: config.workspaceRoot,
   })
 
-  // Create MCP server
-  const mcpServer = new McpServer({
-    name: 'constellation-fs',
-    version: '1.0.0',
-  })
-
   if (config.http) {
     // ─────────────────────────────────────────────────────────────
     // HTTP Mode: Multi-session, workspace from headers
     // ─────────────────────────────────────────────────────────────
 
-    registerTools(mcpServer, (sessionId) => {
-      if (!sessionId) throw new Error('Session ID required')
-      return getSessionContext(sessionId).workspace
+    // Loaded here so stdio servers, spawned once per session, don't pay for them
+    const [{ default: express }, { StreamableHTTPServerTransport }] = await Promise.all([
+      import('express'),
+      import('@modelcontextprotocol/sdk/server/streamableHttp.js'),
+    ])
+
+    const maxSessions = config.maxSessions ?? DEFAULT_MAX_SESSIONS
+    const sessionIdleTimeoutMs = config.sessionIdleTimeoutMs ?? DEFAULT_SESSION_IDLE_TIMEOUT_MS
+    const pool = new FileSystemPoolManager({ defaultBackendConfig: { type: 'local' } })
+    const limiter = new RequestLimiter({
+      maxConcurrent: config.maxConcurrentRequests ?? DEFAULT_MAX_CONCURRENT_REQUESTS,
+      maxQueued: config.maxQueuedRequests ?? DEFAULT_MAX_QUEUED_REQUESTS,
     })
+    // Sessions between admission and the end of their initialize request
+    let initializing = 0
+
+    const expiryTimer = setInterval(() => {
+      expireIdleSessions(sessionIdleTimeoutMs).catch((err) => {
+        console.error('[MCP] Session expiry failed:', err)
+      })
+    }, Math.min(60_000, Math.max(1000, sessionIdleTimeoutMs / 4)))
+    expiryTimer.unref()
+
+    /**
+     * Handle one request for `userId` within the limiter
+     * The slot is held until the HTTP response ends, since the transport may
+     * stream the result after handleRequest() returns.
+     */
+    const handleLimited = async (userId: string, res: Response, handle: () => Promise<void>) => {
+      try {
+        await limiter.run(userId, async () => {
+          // The client gave up while the request was queued
+          if (res.writableEnded || res.destroyed) return
+          const finished = new Promise<void>(resolve => res.once('close', resolve))
+          await handle()
+          await finished
+        })
+      } catch (err) {
+        if (err instanceof OverloadedError) {
+          incrementCounter('constellation_mcp_rejected', { reason: 'overloaded' })
+          sendOverloaded(res, err.message)
+          return
+        }
+        throw err
+      }
+    }
 
-    const transports: Record<string, StreamableHTTPServerTransport> = {}
     const app = express()
     app.use(express.json())
 
     // Auth middleware
     const authToken = config.authToken!
-    app.use('/mcp', (req: Request, res: Response, next: NextFunction) => {
+    const requireAuth = (req: Request, res: Response, next: NextFunction) => {
       const auth = req.headers.authorization
       if (!auth?.startsWith('Bearer ') || auth.slice(7) !== authToken) {
         res.status(401).json({ error: 'Unauthorized' })
         return
       }
       next()
-    })
+    }
+    app.use('/mcp', requireAuth)
 
     // MCP endpoint
     app.post('/mcp', async (req: Request, res: Response) => {
       const sessionId = req.headers['mcp-session-id'] as string | undefined
 
-      console.log(`[MCP] POST /mcp - sessionId: ${sessionId}, method: ${req.body?.method}`)
+      getLogger().debug(`[MCP] POST /mcp - sessionId: ${sessionId}, method: ${req.body?.method}`)
 
-      if (sessionId && transports[sessionId]) {
+      const session = sessionId ? sessions.get(sessionId) : undefined
+      if (session) {
+        session.lastActivity = Date.now()
         // Pass req.body as parsedBody since express.json() already consumed the stream
-        await transports[sessionId].handleRequest(req, res, req.body)
+        await handleLimited(session.userId, res, () => session.transport.handleRequest(req, res, req.body))
         return
       }
 
@@ -283,34 +398,71 @@ export async function main(args: string[]) {
         return
       }
 
-      const newSessionId = randomUUID()
-      const transport = new StreamableHTTPServerTransport({
-        sessionIdGenerator: () => newSessionId,
-        onsessioninitialized: async (sid: string) => {
+      if (sessions.size + initializing >= maxSessions) {
+        incrementCounter('constellation_mcp_rejected', { reason: 'sessions' })
+        sendOverloaded(res, `Session limit reached (${maxSessions})`)
+        return
+      }
+
+      const userId = headers['x-user-id']!
+      const workspaceName = headers['x-workspace']!
+      initializing++
+      try {
+        await handleLimited(userId, res, async () => {
+          // Sessions of the same user share the pooled FileSystem
+          const { workspace, release } = await pool.acquireWorkspace({ userId, workspace: workspaceName })
+          const server = createMcpServer(() => workspace)
+          const transport: StreamableHTTPServerTransport = new StreamableHTTPServerTransport({
+            sessionIdGenerator: () => randomUUID(),
+            onsessioninitialized: (sid: string) => {
+              sessions.set(sid, { userId, workspaceName, workspace, server, transport, release, lastActivity: Date.now() })
+            },
+            onsessionclosed: async (sid: string) => {
+              await destroySession(sid)
+            },
+          })
+
           try {
-            await initializeSession(sid, headers)
-            transports[sid] = transport
-          } catch (err) {
-            // This shouldn't happen since we validated headers above,
-            // but log just in case
-            console.error('Session init failed:', err)
+            await server.connect(transport)
+            // Pass req.body as parsedBody since express.json() already consumed the stream
+            await transport.handleRequest(req, res, req.body)
+          } finally {
+            // The handshake failed before a session was registered
+            if (!transport.sessionId || !sessions.has(transport.sessionId)) {
+              await server.close().catch(() => {})
+              release()
+            }
           }
-        },
-        onsessionclosed: async (sid: string) => {
-          await destroySession(sid)
-          delete transports[sid]
-        },
-      })
-
-      await mcpServer.connect(transport)
-      // Pass req.body as parsedBody since express.json() already consumed the stream
-      await transport.handleRequest(req, res, req.body)
+        })
+      } catch (err) {
+        console.error('[MCP] Session init failed:', err)
+        if (!res.headersSent) {
+          res.status(500).json({ error: 'Session initialization failed' })
+        }
+      } finally {
+        initializing--
+      }
     })
 
     app.get('/health', (_: Request, res: Response) => {
-      res.json({ status: 'ok', sessions: Object.keys(transports).length })
+      const poolStats = pool.getStats()
+      res.json({
+        status: 'ok',
+        sessions: sessions.size,
+        maxSessions,
+        fileSystems: poolStats.totalFileSystems,
+        activeRequests: limiter.active,
+        queuedRequests: limiter.queued,
+      })
     })
 
+    if (config.metrics) {
+      setMetricsEnabled(true)
+      app.get('/metrics', requireAuth, (_: Request, res: Response) => {
+        res.type('text/plain; version=0.0.4').send(formatPrometheusMetrics())
+      })
+    }
+
     const port = config.port || 3000
     app.listen(port, '0.0.0.0', () => {
       console.log(`ConstellationFS MCP server (HTTP) listening on port ${port}`)
@@ -331,7 +483,7 @@ export async function main(args: string[]) {
 
     console.error(`[constellation-fs-mcp] Workspace initialized: ${workspace.workspacePath}`)
 
-    registerTools(mcpServer, () => workspace)
+    const mcpServer = createMcpServer(() => workspace)
 
     const transport = new StdioServerTransport()
     await mcpServer.connect(transport)
@@ -1,95 +1,11 @@
 import type { McpServer } from '@modelcontextprotocol/sdk/server/mcp.js'
-import { minimatch } from 'minimatch'
+import { Minimatch } from 'minimatch'
 import * as path from 'path'
 import { z } from 'zod'
 import type { Workspace } from '../workspace/Workspace.js'
 
 type WorkspaceGetter = (sessionId?: string) => Workspace
 
-/**
- * Create a simple unified diff between two strings
- * This is a lightweight implementation - the official server uses the 'diff' library
- */
-function createUnifiedDiff(original: string, modified: string, filepath: string): string {
-  const originalLines = original.split('\n')
-  const modifiedLines = modified.split('\n')
-
-  const lines: string[] = [
-    `--- ${filepath}`,
-    `+++ ${filepath}`,
-  ]
-
-  // Simple diff: show context around changes
-  let i = 0
-  let j = 0
-
-  while (i < originalLines.length || j < modifiedLines.length) {
-    // Skip matching lines
-    while (i < originalLines.length && j < modifiedLines.length && originalLines[i] === modifiedLines[j]) {
-      i++
-      j++
-    }
-
-    // If we're at the end, break
-    if (i >= originalLines.length && j >= modifiedLines.length) break
-
-    // Find extent of difference
-    const diffStartI = i
-    const diffStartJ = j
-
-    // Count removed lines (in original but changed)
-    let removedCount = 0
-    while (i < originalLines.length && (j >= modifiedLines.length || originalLines[i] !== modifiedLines[j])) {
-      // Check if this line appears later in modified
-      let found = false
-      for (let k = j; k < Math.min(j + 10, modifiedLines.length); k++) {
-        if (originalLines[i] === modifiedLines[k]) {
-          found = true
-          break
-        }
-      }
-      if (found) break
-      i++
-      removedCount++
-    }
-
-    // Count added lines (in modified but not original)
-    let addedCount = 0
-    const tempJ = j
-    while (j < modifiedLines.length && (diffStartI + removedCount >= originalLines.length || modifiedLines[j] !== originalLines[diffStartI + removedCount])) {
-      let found = false
-      for (let k = diffStartI + removedCount; k < Math.min(diffStartI + removedCount + 10, originalLines.length); k++) {
-        if (modifiedLines[j] === originalLines[k]) {
-          found = true
-          break
-        }
-      }
-      if (found) break
-      j++
-      addedCount++
-    }
-
-    if (removedCount > 0 || addedCount > 0) {
-      // Add hunk header
-      const origStart = diffStartI + 1
-      const modStart = diffStartJ + 1
-      lines.push(`@@ -${origStart},${removedCount} +${modStart},${addedCount} @@`)
-
-      // Add removed lines
-      for (let k = 0; k < removedCount; k++) {
-        lines.push(`-${originalLines[diffStartI + k]}`)
-      }
-
-      // Add added lines
-      for (let k = 0; k < addedCount; k++) {
-        lines.push(`+${modifiedLines[tempJ + k]}`)
-      }
-    }
-  }
-
-  return lines.join('\n')
-}
-
 /**
  * Format file size in human-readable format (matches official MCP filesystem server)
  */
@@ -226,16 +142,13 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
     },
     async ({ paths }, { sessionId }) => {
       const workspace = getWorkspace(sessionId)
-      const results = await Promise.all(
-        paths.map(async (filePath: string) => {
-          try {
-            const content = await workspace.readFile(filePath, 'utf-8')
-            return `${filePath}:\n${content}\n`
-          } catch (error) {
-            const errorMessage = error instanceof Error ? error.message : String(error)
-            return `${filePath}: Error - ${errorMessage}`
-          }
-        })
+      // One batch, so remote workspaces fetch every file in a single round-trip
+      const outcomes = await workspace.batch(
+        paths.map((filePath: string) => ({ op: 'read' as const, path: filePath, encoding: 'utf-8' as const }))
+      )
+      const results = outcomes.map((outcome, i) => outcome.ok
+        ? `${paths[i]}:\n${outcome.value}\n`
+        : `${paths[i]}: Error - ${outcome.error.message}`
       )
 
       // Join with separator matching official MCP filesystem server format
@@ -295,30 +208,8 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
     async ({ path: filePath, edits, dryRun: dryRunParam }, { sessionId }) => {
       const dryRun = dryRunParam ?? false
       const workspace = getWorkspace(sessionId)
-      const original = await workspace.readFile(filePath, 'utf-8') as string
-
-      // Normalize line endings for consistent matching
-      const normalizeLineEndings = (text: string) => text.replace(/\r\n/g, '\n')
-      let modified = normalizeLineEndings(original)
-
-      for (const edit of edits) {
-        const normalizedOld = normalizeLineEndings(edit.oldText)
-        const normalizedNew = normalizeLineEndings(edit.newText)
-
-        // Require exact match - throw error if not found (matches official behavior)
-        if (!modified.includes(normalizedOld)) {
-          throw new Error(`Could not find exact match for edit:\n${edit.oldText}`)
-        }
-
-        modified = modified.replace(normalizedOld, normalizedNew)
-      }
-
-      // Generate unified diff
-      const diff = createUnifiedDiff(normalizeLineEndings(original), modified, filePath)
-
-      if (!dryRun && modified !== normalizeLineEndings(original)) {
-        await workspace.writeFile(filePath, modified)
-      }
+      // Applied next to the data, and written atomically (temp file + rename)
+      const { diff } = await workspace.applyEdits(filePath, edits, { dryRun })
 
       return {
         content: [{
@@ -360,19 +251,8 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
     },
     async ({ path: dirPath }, { sessionId }) => {
       const workspace = getWorkspace(sessionId)
-      const entries = await workspace.readdir(dirPath) as string[]
-
-      const formatted = await Promise.all(
-        entries.map(async (entry) => {
-          try {
-            const stats = await workspace.stat(path.join(dirPath, entry))
-            const prefix = stats.isDirectory() ? '[DIR]' : '[FILE]'
-            return `${prefix} ${entry}`
-          } catch {
-            return `[?] ${entry}`
-          }
-        })
-      )
+      const { entries } = await workspace.walk({ path: dirPath, maxDepth: 1 })
+      const formatted = entries.map((entry) => `${entry.type === 'directory' ? '[DIR]' : '[FILE]'} ${entry.path}`)
 
       return {
         content: [{ type: 'text', text: formatted.join('\n') }]
@@ -393,22 +273,13 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
     async ({ path: dirPath, sortBy: sortByParam }, { sessionId }) => {
       const sortBy = sortByParam ?? 'name'
       const workspace = getWorkspace(sessionId)
-      const entries = await workspace.readdir(dirPath) as string[]
-
-      const detailed = await Promise.all(
-        entries.map(async (entry) => {
-          try {
-            const stats = await workspace.stat(path.join(dirPath, entry))
-            return {
-              name: entry,
-              isDir: stats.isDirectory(),
-              size: stats.size,
-            }
-          } catch {
-            return { name: entry, isDir: false, size: 0 }
-          }
-        })
-      )
+      // One listing with stats instead of a stat round trip per entry
+      const { entries } = await workspace.walk({ path: dirPath, maxDepth: 1, withStats: true })
+      const detailed = entries.map((entry) => ({
+        name: entry.path,
+        isDir: entry.type === 'directory',
+        size: entry.size ?? 0,
+      }))
 
       // Sort (size is descending, name is ascending)
       detailed.sort((a, b) => {
@@ -457,58 +328,67 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
         children?: TreeNode[]
       }
 
-      async function buildTree(currentPath: string): Promise<TreeNode[]> {
-        const entries = await workspace.readdir(currentPath) as string[]
-        const children: TreeNode[] = []
-
-        for (const entry of entries) {
-          const entryPath = path.join(currentPath, entry)
-          const relativePath = path.relative(dirPath, entryPath)
-
-          // Use minimatch for proper glob pattern matching (matches official server behavior)
-          const shouldExclude = excludePatterns.some((pattern: string) => {
-            // Support both exact matches and glob patterns
-            if (pattern.includes('*')) {
-              return minimatch(relativePath, pattern, { dot: true })
-            }
-            // For non-glob patterns, match as directory/file name or path component
-            return minimatch(relativePath, pattern, { dot: true }) ||
-              minimatch(relativePath, `**/${pattern}`, { dot: true }) ||
-              minimatch(relativePath, `**/${pattern}/**`, { dot: true })
-          })
-
-          if (shouldExclude) continue
-
-          try {
-            const stats = await workspace.stat(entryPath)
-            if (stats.isDirectory()) {
-              children.push({
-                name: entry,
-                type: 'directory',
-                children: await buildTree(entryPath),
-              })
-            } else {
-              children.push({
-                name: entry,
-                type: 'file',
-                size: stats.size,
-              })
-            }
-          } catch {
-            // Skip inaccessible entries
-          }
+      // The whole tree comes back from one walk (run on the remote host by the agent)
+      const { entries } = await workspace.walk({ path: dirPath, excludes: excludePatterns, withStats: true })
+      const tree: TreeNode[] = []
+      const childrenOf = new Map<string, TreeNode[]>([['', tree]])
+      for (const entry of entries) {
+        // Entries are depth first, so a directory's node exists before its contents
+        const slash = entry.path.lastIndexOf('/')
+        const siblings = childrenOf.get(slash === -1 ? '' : entry.path.slice(0, slash))
+        if (!siblings) continue
+
+        const name = entry.path.slice(slash + 1)
+        if (entry.type === 'directory') {
+          const children: TreeNode[] = []
+          childrenOf.set(entry.path, children)
+          siblings.push({ name, type: 'directory', children })
+        } else {
+          siblings.push({ name, type: 'file', size: entry.size })
         }
-
-        return children
       }
 
-      const tree = await buildTree(dirPath)
       return {
         content: [{ type: 'text', text: JSON.stringify(tree, null, 2) }]
       }
     }
   )
 
+  server.registerTool(
+    'search_file_contents',
+    {
+      description: 'Search file contents for lines matching a regular expression or plain text. Skips binary files and paths ignored by .gitignore. Returns one "path:line:column: text" line per match.',
+      inputSchema: {
+        pattern: z.string().describe('Regular expression (JavaScript syntax), or plain text when literal is true'),
+        path: z.string().nullable().describe('Directory to search, null defaults to the workspace root'),
+        glob: z.array(z.string()).nullable()
+          .describe('Only search files matching these globs (e.g., "*.ts", "src/**/*.tsx"), null searches all files'),
+        literal: z.boolean().nullable().describe('Treat the pattern as plain text (null defaults to false)'),
+        ignoreCase: z.boolean().nullable().describe('Case-insensitive matching (null defaults to false)'),
+        maxResults: z.number().int().positive().nullable().describe('Maximum matches to return, null defaults to 200'),
+      },
+    },
+    async ({ pattern, path: searchPath, glob, literal, ignoreCase, maxResults }, { sessionId }) => {
+      const workspace = getWorkspace(sessionId)
+      const result = await workspace.search({
+        pattern,
+        path: searchPath ?? undefined,
+        glob: glob ?? undefined,
+        literal: literal ?? false,
+        ignoreCase: ignoreCase ?? false,
+        maxResults: maxResults ?? 200,
+      })
+
+      const lines = result.matches.map((match) => `${match.path}:${match.line}:${match.column}: ${match.text}`)
+      if (result.truncated) {
+        lines.push(`[Results truncated at ${result.matches.length} matches]`)
+      }
+      return {
+        content: [{ type: 'text', text: lines.length > 0 ? lines.join('\n') : 'No matches found' }]
+      }
+    }
+  )
+
   // ─────────────────────────────────────────────────────────────────
   // FILE OPERATIONS
   // ─────────────────────────────────────────────────────────────────
@@ -564,41 +444,25 @@ export function registerTools(server: McpServer, getWorkspace: WorkspaceGetter):
     async ({ path: searchPath, pattern, excludePatterns: excludePatternsParam }, { sessionId }) => {
       const excludePatterns = excludePatternsParam ?? []
       const workspace = getWorkspace(sessionId)
-      const results: string[] = []
+      const matcher = new Minimatch(pattern, { dot: true })
+      const excludeMatchers = excludePatterns.map((excludePattern: string) => new Minimatch(excludePattern, { dot: true }))
 
-      // Recursive search function using minimatch for glob matching
-      async function searchDir(currentPath: string): Promise<void> {
-        const entries = await workspace.readdir(currentPath) as string[]
-
-        for (const entry of entries) {
-          const fullPath = path.join(currentPath, entry)
-          const relativePath = path.relative(searchPath, fullPath)
-
-          // Check if this path should be excluded
-          const shouldExclude = excludePatterns.some((excludePattern: string) =>
-            minimatch(relativePath, excludePattern, { dot: true })
-          )
-          if (shouldExclude) continue
-
-          // Check if this path matches the search pattern
-          if (minimatch(relativePath, pattern, { dot: true })) {
-            results.push(fullPath)
-          }
-
-          // Recurse into directories
-          try {
-            const stats = await workspace.stat(fullPath)
-            if (stats.isDirectory()) {
-              await searchDir(fullPath)
-            }
-          } catch {
-            // Skip inaccessible entries
-          }
+      // Excluded directories are skipped with their contents; entries are depth first, so parents come first
+      const { entries } = await workspace.walk({ path: searchPath })
+      const excluded = new Set<string>()
+      const results: string[] = []
+      for (const entry of entries) {
+        const slash = entry.path.lastIndexOf('/')
+        if ((slash !== -1 && excluded.has(entry.path.slice(0, slash))) ||
+          excludeMatchers.some((excludeMatcher) => excludeMatcher.match(entry.path))) {
+          excluded.add(entry.path)
+          continue
+        }
+        if (matcher.match(entry.path)) {
+          results.push(path.join(searchPath, entry.path))
         }
       }
 
-      await searchDir(searchPath)
-
       return {
         content: [{ type: 'text', text: results.length > 0 ? results.join('\n') : 'No matches found' }]
       }
@@ -0,0 +1,19 @@
+// Remote entry point: the SSH backend and the agent that serves it. Config
+// types and FileSystem come from `constellationfs/local`.
+// ssh2 itself is loaded when the first connection is opened.
+
+// Backend and Workspace Classes
+export { RemoteBackend, type RemoteDirectoryEntry } from './backends/RemoteBackend.js'
+export { RemoteWorkspace } from './workspace/RemoteWorkspace.js'
+
+// Remote Agent
+export { AgentClient, type AgentClientOptions } from './agent/AgentClient.js'
+export { AgentServer, type AgentServerOptions } from './agent/AgentServer.js'
+export type { AgentOpContext, AgentOpHandler, AgentOpResult } from './agent/ops.js'
+export { AGENT_PROTOCOL_VERSION, AgentError } from './agent/protocol.js'
+
+// Platform Detection
+export {
+  detectPlatformCapabilities,
+  buildInterceptEnv, findNativeLibrary, getInterceptLibrary, getPlatformGuidance, getRemoteBackendLibrary, validateNativeLibrary, type PlatformCapabilities
+} from './utils/nativeLibrary.js'
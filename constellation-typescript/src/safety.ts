@@ -1,3 +1,6 @@
+import { recordDuration, startTimer } from './utils/metrics.js'
+import { tokenizeCommand, type ShellToken } from './utils/shellTokenizer.js'
+
 /**
  * Configuration for safety checks
  */
@@ -109,6 +112,123 @@ const ESCAPE_PATTERNS = [
   /`[^`]+`/,      // Backtick command substitution
 ]
 
+/** Leading word of a command, as `^word\b` sees it */
+const LEADING_WORD = /^\w+/
+
+/**
+ * Source prefix of a pattern anchored to one or more command words followed
+ * by `\b` or `\s`, e.g. /^sudo\b/ or /^(cp|mv|ln)\b/
+ */
+const ANCHORED_WORDS = /^\^(?:\(((?:\w+\|)*\w+)\)|(\w+))\\[bs]/
+
+/** Backreferences and named groups change meaning when sources are joined */
+const UNJOINABLE = /\\[1-9]|\\k<|\(\?<[^=!]/
+
+/**
+ * Whether a regex source has a `|` outside any group, which would make a
+ * leading `^word` cover only the first alternative
+ */
+function hasTopLevelAlternation(source: string): boolean {
+  let depth = 0
+  let inClass = false
+  for (let i = 0; i < source.length; i++) {
+    const char = source[i]
+    if (char === '\\') {
+      i++
+    } else if (inClass) {
+      if (char === ']') inClass = false
+    } else if (char === '[') {
+      inClass = true
+    } else if (char === '(') {
+      depth++
+    } else if (char === ')') {
+      depth--
+    } else if (char === '|' && depth === 0) {
+      return true
+    }
+  }
+  return false
+}
+
+/**
+ * A list of patterns compiled so testing it costs about one scan of the
+ * command instead of one scan per pattern
+ *
+ * Patterns anchored to a leading command word (`^sudo\b`, `^rm\s+...`) are
+ * indexed by that word, so only those for the command's first word run at
+ * all. The remaining flag-less patterns are joined into a single
+ * alternation. Patterns with flags or backreferences are tested on their
+ * own, which keeps the result identical to `patterns.some(p => p.test(s))`.
+ */
+class PatternSet {
+  private readonly byLeadingWord = new Map<string, RegExp[]>()
+  private readonly joined: RegExp | null = null
+  private readonly separate: RegExp[] = []
+
+  constructor(patterns: readonly RegExp[]) {
+    const joinable: RegExp[] = []
+
+    for (const pattern of patterns) {
+      const plain = pattern.flags === ''
+      const anchored = plain && !hasTopLevelAlternation(pattern.source)
+        ? ANCHORED_WORDS.exec(pattern.source)
+        : null
+
+      if (anchored) {
+        for (const word of (anchored[1] ?? anchored[2]!).split('|')) {
+          const indexed = this.byLeadingWord.get(word)
+          if (indexed) indexed.push(pattern)
+          else this.byLeadingWord.set(word, [pattern])
+        }
+      } else if (plain && !UNJOINABLE.test(pattern.source)) {
+        joinable.push(pattern)
+      } else {
+        this.separate.push(pattern)
+      }
+    }
+
+    if (joinable.length === 1) {
+      this.joined = joinable[0]!
+    } else if (joinable.length > 1) {
+      try {
+        this.joined = new RegExp(joinable.map(pattern => `(?:${pattern.source})`).join('|'))
+      } catch {
+        this.separate.push(...joinable)
+      }
+    }
+  }
+
+  test(text: string): boolean {
+    const word = LEADING_WORD.exec(text)?.[0]
+    const indexed = word === undefined ? undefined : this.byLeadingWord.get(word)
+    if (indexed?.some(pattern => pattern.test(text))) return true
+    if (this.joined?.test(text)) return true
+    return this.separate.some(pattern => pattern.test(text))
+  }
+}
+
+const DANGEROUS_SET = new PatternSet(DANGEROUS_PATTERNS)
+const ESCAPE_SET = new PatternSet(ESCAPE_PATTERNS)
+const DEFAULT_ALLOWED_SET = new PatternSet(DEFAULT_ALLOWED_PATTERNS)
+
+/**
+ * Compiled allow lists by the allowedPatterns array they came from. The
+ * array is treated as immutable once it has been used for a check.
+ */
+const allowedSets = new WeakMap<RegExp[], PatternSet>()
+
+function allowedSetFor(config?: SafetyConfig): PatternSet {
+  const extra = config?.allowedPatterns
+  if (!extra || extra.length === 0) return DEFAULT_ALLOWED_SET
+
+  let set = allowedSets.get(extra)
+  if (!set) {
+    set = new PatternSet([...DEFAULT_ALLOWED_PATTERNS, ...extra])
+    allowedSets.set(extra, set)
+  }
+  return set
+}
+
 /**
  * Check if a command matches any allowed pattern
  * @param command - The command to check
@@ -116,10 +236,7 @@ const ESCAPE_PATTERNS = [
  * @returns true if the command matches an allowed pattern
  */
 function isAllowed(command: string, config?: SafetyConfig): boolean {
-  const normalized = command.trim()
-  const allAllowed = [...DEFAULT_ALLOWED_PATTERNS, ...(config?.allowedPatterns ?? [])]
-
-  return allAllowed.some(pattern => pattern.test(normalized))
+  return allowedSetFor(config).test(command.trim())
 }
 
 /**
@@ -129,14 +246,12 @@ function isAllowed(command: string, config?: SafetyConfig): boolean {
  * @returns true if the command is considered dangerous
  */
 export function isDangerous(command: string, config?: SafetyConfig): boolean {
-  const normalized = command.trim().toLowerCase()
-
   // Check allowlist first - if matched, it's not dangerous
   if (isAllowed(command, config)) {
     return false
   }
 
-  return DANGEROUS_PATTERNS.some(pattern => pattern.test(normalized))
+  return DANGEROUS_SET.test(command.trim().toLowerCase())
 }
 
 /**
@@ -148,6 +263,7 @@ export function isDangerous(command: string, config?: SafetyConfig): boolean {
 function stripHeredocContent(command: string): string {
   // Match heredocs: << 'DELIMITER' ... DELIMITER or << "DELIMITER" ... DELIMITER or <<DELIMITER ... DELIMITER
   // We'll be conservative and strip all heredoc content since it's literal data
+  if (!command.includes('<<')) return command
   const heredocRegex = /<<\s*['"]?(\w+)['"]?[\s\S]*?\n\1/g
 
   // Replace heredoc content with a safe placeholder
@@ -163,7 +279,7 @@ export function isEscapingWorkspace(command: string): boolean {
   // Strip heredoc content before validation since heredocs are literal data
   const commandWithoutHeredocs = stripHeredocContent(command)
 
-  return ESCAPE_PATTERNS.some(pattern => pattern.test(commandWithoutHeredocs))
+  return ESCAPE_SET.test(commandWithoutHeredocs)
 }
 
 /**
@@ -175,14 +291,29 @@ export function getBaseCommand(command: string): string {
   return command.trim().split(/\s+/)[0] || ''
 }
 
+/** Verdicts kept for recently checked commands (agents repeat commands a lot) */
+const VERDICT_CACHE_ENTRIES = 1024
+
+/** Longer commands (usually heredoc file writes) are not worth keeping */
+const VERDICT_CACHE_MAX_COMMAND_LENGTH = 4096
+
 /**
- * Comprehensive safety check for commands
- * Combines dangerous command checking and workspace escape detection
- * @param command - The command to check
- * @param config - Optional safety configuration with allowed pattern exceptions
- * @returns Object with safety status and optional reason
+ * Result of analyzeCommand
  */
-export function isCommandSafe(command: string, config?: SafetyConfig): { safe: boolean; reason?: string } {
+export interface CommandAnalysis {
+  safe: boolean
+  reason?: string
+  /**
+   * Whether the command matched a dangerous pattern and no allowed pattern,
+   * as opposed to failing only the workspace escape checks
+   */
+  dangerous: boolean
+}
+
+/** Map iteration order is insertion order, so the first key is the LRU entry */
+const verdictCache = new Map<string, CommandAnalysis>()
+
+function evaluateCommand(command: string, config?: SafetyConfig): CommandAnalysis {
   // Check for dangerous commands first
   if (isDangerous(command, config)) {
     const baseCmd = getBaseCommand(command)
@@ -191,32 +322,84 @@ export function isCommandSafe(command: string, config?: SafetyConfig): { safe: b
     if (/(?:curl|wget)\b.*\|\s*(?:sh|bash|zsh|fish)\b/.test(command.toLowerCase())) {
       return {
         safe: false,
-        reason: "Piping downloads to shell is dangerous. Download to a file first (e.g., 'curl -O <url>'), inspect it, then execute if safe."
+        reason: "Piping downloads to shell is dangerous. Download to a file first (e.g., 'curl -O <url>'), inspect it, then execute if safe.",
+        dangerous: true,
       }
     }
 
-    return { safe: false, reason: `Dangerous command '${baseCmd}' is not allowed` }
+    return { safe: false, reason: `Dangerous command '${baseCmd}' is not allowed`, dangerous: true }
   }
 
   // Check for workspace escape attempts
   if (isEscapingWorkspace(command)) {
     // More specific messages for different escape types
     if (/\bcd\b/.test(command)) {
-      return { safe: false, reason: 'Directory change commands are not allowed' }
+      return { safe: false, reason: 'Directory change commands are not allowed', dangerous: false }
     }
     // if (/(?<!https?:)(^|\s)\/[^\s]+/.test(command)) {
     //   return { safe: false, reason: 'Command contains absolute paths' }
     // }
     if (/~\//.test(command) || /\$HOME/.test(command)) {
-      return { safe: false, reason: 'Home directory references are not allowed' }
+      return { safe: false, reason: 'Home directory references are not allowed', dangerous: false }
     }
     if (/\.\.[/\\]/.test(command)) {
-      return { safe: false, reason: 'Parent directory traversal is not allowed' }
+      return { safe: false, reason: 'Parent directory traversal is not allowed', dangerous: false }
     }
-    return { safe: false, reason: 'Command attempts to escape workspace' }
+    return { safe: false, reason: 'Command attempts to escape workspace', dangerous: false }
   }
 
-  return { safe: true }
+  return { safe: true, dangerous: false }
+}
+
+/**
+ * Run every safety check for a command once
+ * Callers that need both the verdict and whether the command is dangerous
+ * (to hand it to onDangerousOperation) use this instead of calling
+ * isCommandSafe and isDangerous separately. Verdicts for recent commands
+ * without custom allowedPatterns are cached.
+ * @param command - The command to check
+ * @param config - Optional safety configuration with allowed pattern exceptions
+ * @returns Frozen analysis; do not mutate
+ */
+export function analyzeCommand(command: string, config?: SafetyConfig): CommandAnalysis {
+  const timer = startTimer()
+  const analysis = analyzeCommandCached(command, config)
+  recordDuration('constellation_safety_check', timer)
+  return analysis
+}
+
+function analyzeCommandCached(command: string, config?: SafetyConfig): CommandAnalysis {
+  const cacheable = !config?.allowedPatterns?.length && command.length <= VERDICT_CACHE_MAX_COMMAND_LENGTH
+  if (!cacheable) {
+    return evaluateCommand(command, config)
+  }
+
+  const cached = verdictCache.get(command)
+  if (cached) {
+    // Move to the most recently used end
+    verdictCache.delete(command)
+    verdictCache.set(command, cached)
+    return cached
+  }
+
+  const analysis = Object.freeze(evaluateCommand(command, config))
+  verdictCache.set(command, analysis)
+  if (verdictCache.size > VERDICT_CACHE_ENTRIES) {
+    verdictCache.delete(verdictCache.keys().next().value!)
+  }
+  return analysis
+}
+
+/**
+ * Comprehensive safety check for commands
+ * Combines dangerous command checking and workspace escape detection
+ * @param command - The command to check
+ * @param config - Optional safety configuration with allowed pattern exceptions
+ * @returns Object with safety status and optional reason
+ */
+export function isCommandSafe(command: string, config?: SafetyConfig): { safe: boolean; reason?: string } {
+  const { safe, reason } = analyzeCommand(command, config)
+  return reason === undefined ? { safe } : { safe, reason }
 }
 
 /**
@@ -226,19 +409,23 @@ export function isCommandSafe(command: string, config?: SafetyConfig): { safe: b
  */
 export interface ParsedCommand {
   command: string
+  /** Token values after the command word, quotes removed */
   args: string[]
+  /** Full tokenization, for callers that need operators or heredoc bodies */
+  tokens: ShellToken[]
   hasAbsolutePath: boolean
   hasEscapePattern: boolean
 }
 
 export function parseCommand(command: string): ParsedCommand {
-  const parts = command.trim().split(/\s+/)
-  const baseCommand = parts[0] || ''
-  const args = parts.slice(1)
-  
+  const tokens = tokenizeCommand(command)
+  const baseCommand = tokens[0]?.type === 'word' ? tokens[0].value : ''
+  const args = tokens.slice(baseCommand ? 1 : 0).map(token => token.value)
+
   return {
     command: baseCommand,
     args,
+    tokens,
     hasAbsolutePath: /(?<!https?:)(^|\s)\/[^\s]+/.test(command),
     hasEscapePattern: isEscapingWorkspace(command),
   }
@@ -0,0 +1,343 @@
+import { watch } from 'fs'
+import { sep } from 'path'
+import { getLogger } from './logger.js'
+
+/** Default window over which a watcher collects changes into one batch */
+export const DEFAULT_WATCH_DEBOUNCE_MS = 50
+
+/** Changed paths per batch before a watcher reports "anything may have changed" instead */
+const WATCH_MAX_PATHS = 1_000
+
+/** Delay before restarting a feed whose watcher stopped, doubled per failed attempt */
+const RESTART_MIN_MS = 1_000
+const RESTART_MAX_MS = 30_000
+
+/**
+ * A batch of changes reported by Workspace.watch()
+ */
+export interface WatchEvent {
+  /**
+   * Changed paths relative to the workspace root ('/'-separated), or null
+   * when the watcher lost track and any path may have changed
+   */
+  paths: string[] | null
+  /** Set on the last event of a watcher: it has stopped */
+  closed?: boolean
+}
+
+/**
+ * Options for Workspace.watch()
+ */
+export interface WatchOptions {
+  /** Report changes anywhere below the path, not just its direct entries (default: true) */
+  recursive?: boolean
+  /** Window over which changes are collected into one event (default: 50) */
+  debounceMs?: number
+}
+
+/**
+ * A running Workspace.watch()
+ */
+export interface WorkspaceWatcher {
+  /** Stop watching; no events are delivered afterwards */
+  close(): void
+}
+
+/**
+ * Starts the underlying watcher of a ChangeFeed
+ * `emit` reports changed paths relative to the feed's root (null when any
+ * path may have changed) and `end` that the watcher stopped on its own.
+ * @returns Promise resolving to a function that stops the watcher; rejects
+ *   when the tree can't be watched
+ */
+export type ChangeSource = (
+  emit: (paths: string[] | null) => void,
+  end: () => void
+) => Promise<() => void>
+
+type ChangeListener = (event: WatchEvent) => void
+
+/**
+ * One watcher over a directory tree, shared by every consumer of its changes
+ *
+ * Workspace.watch() callers, the search index and the remote metadata cache
+ * subscribe to the same feed, so a tree is watched once (one inotify watch
+ * set locally, one agent subscription remotely) however many of them are
+ * interested. The source runs while there are subscribers. When it stops on
+ * its own, for example on a lost connection, subscribers get a null event
+ * and the feed restarts it with backoff, sending another null event once it
+ * is back since changes in between were missed.
+ */
+export class ChangeFeed {
+  private static readonly directories = new Map<string, ChangeFeed>()
+
+  private readonly listeners = new Set<ChangeListener>()
+  private stopSource: (() => void) | null = null
+  private starting: Promise<void> | null = null
+  private restartTimer: NodeJS.Timeout | null = null
+  private restartDelayMs = RESTART_MIN_MS
+
+  /**
+   * The feed for a local directory (recursive fs.watch, inotify on Linux),
+   * shared by every workspace on the same directory in this process
+   */
+  static forDirectory(root: string): ChangeFeed {
+    let feed = ChangeFeed.directories.get(root)
+    if (!feed) {
+      feed = new ChangeFeed(directorySource(root), () => ChangeFeed.directories.delete(root))
+      ChangeFeed.directories.set(root, feed)
+    }
+    return feed
+  }
+
+  /**
+   * Stop the local directory feed for `root`, if one is running
+   */
+  static closeDirectory(root: string): void {
+    ChangeFeed.directories.get(root)?.close()
+  }
+
+  /**
+   * @param source - Starts the underlying watcher
+   * @param onIdle - Called when the last subscriber leaves
+   */
+  constructor(
+    private readonly source: ChangeSource,
+    private readonly onIdle?: () => void
+  ) {}
+
+  /** Whether the underlying watcher is running */
+  get active(): boolean {
+    return this.stopSource !== null
+  }
+
+  /**
+   * Receive every change in the tree until the returned function is called
+   * Changes made before the promise resolves are not reported.
+   * @throws When the tree can't be watched
+   */
+  async subscribe(listener: ChangeListener): Promise<() => void> {
+    this.listeners.add(listener)
+    try {
+      await this.start()
+    } catch (error) {
+      this.unsubscribe(listener)
+      throw error
+    }
+    return () => this.unsubscribe(listener)
+  }
+
+  /**
+   * Stop the watcher and end every subscription with a closed event
+   */
+  close(): void {
+    const listeners = [...this.listeners]
+    this.listeners.clear()
+    this.halt()
+    for (const listener of listeners) {
+      notify(listener, { paths: null, closed: true })
+    }
+  }
+
+  private unsubscribe(listener: ChangeListener): void {
+    if (this.listeners.delete(listener) && this.listeners.size === 0) {
+      this.halt()
+    }
+  }
+
+  private start(): Promise<void> {
+    if (this.stopSource) return Promise.resolve()
+
+    this.starting ??= (async () => {
+      let running = false
+      let ended = false
+      const stop = await this.source(
+        (paths) => {
+          if (running) this.dispatch({ paths })
+        },
+        () => {
+          ended = true
+          if (running) {
+            running = false
+            this.lost()
+          }
+        }
+      )
+
+      if (this.listeners.size === 0) {
+        stop()
+        return
+      }
+      if (ended) {
+        stop()
+        this.lost()
+        return
+      }
+      running = true
+      this.stopSource = () => {
+        running = false
+        stop()
+      }
+      this.restartDelayMs = RESTART_MIN_MS
+      if (this.restartTimer) {
+        // Started by a new subscriber before the scheduled restart
+        clearTimeout(this.restartTimer)
+        this.restartTimer = null
+      }
+    })().finally(() => {
+      this.starting = null
+    })
+    return this.starting
+  }
+
+  private lost(): void {
+    this.stopSource = null
+    this.dispatch({ paths: null })
+    this.scheduleRestart()
+  }
+
+  private scheduleRestart(): void {
+    if (this.listeners.size === 0 || this.restartTimer) return
+
+    this.restartTimer = setTimeout(() => {
+      this.restartTimer = null
+      if (this.listeners.size === 0) return
+      this.start().then(() => {
+        if (this.active) this.dispatch({ paths: null })
+      }, (error) => {
+        getLogger().debug('[ChangeFeed] Restarting watcher failed:', error)
+        this.scheduleRestart()
+      })
+    }, this.restartDelayMs)
+    this.restartTimer.unref()
+    this.restartDelayMs = Math.min(this.restartDelayMs * 2, RESTART_MAX_MS)
+  }
+
+  private halt(): void {
+    if (this.restartTimer) {
+      clearTimeout(this.restartTimer)
+      this.restartTimer = null
+    }
+    this.stopSource?.()
+    this.stopSource = null
+    this.restartDelayMs = RESTART_MIN_MS
+    this.onIdle?.()
+  }
+
+  private dispatch(event: WatchEvent): void {
+    for (const listener of [...this.listeners]) {
+      notify(listener, event)
+    }
+  }
+}
+
+function notify(listener: ChangeListener, event: WatchEvent): void {
+  try {
+    listener(event)
+  } catch (error) {
+    getLogger().error('[ChangeFeed] Change listener threw:', error)
+  }
+}
+
+/**
+ * Recursive fs.watch on a local directory
+ */
+function directorySource(root: string): ChangeSource {
+  return async (emit, end) => {
+    // Throws synchronously for missing paths or platforms without recursive watch
+    const watcher = watch(root, { recursive: true, persistent: false }, (_event, filename) => {
+      if (filename === null) {
+        emit(null)
+      } else {
+        const path = filename.toString()
+        emit([sep === '/' ? path : path.split(sep).join('/')])
+      }
+    })
+    watcher.on('error', (error) => {
+      getLogger().debug(`[ChangeFeed] Watcher for ${root} failed:`, error)
+      watcher.close()
+      end()
+    })
+    return () => watcher.close()
+  }
+}
+
+/**
+ * Subscribe to the changes of one path in a feed, coalesced into batches
+ * @param feed - Feed of the workspace tree
+ * @param path - Root-relative, '/'-separated path to watch ('' for the root)
+ * @param options - Recursion and debounce window
+ * @param listener - Receives each batch
+ * @param exclude - Root-relative directory whose changes are not reported
+ *   (the workspace's own `.constellationfs` state)
+ * @throws When the tree can't be watched
+ */
+export async function watchChanges(
+  feed: ChangeFeed,
+  path: string,
+  options: WatchOptions,
+  listener: (event: WatchEvent) => void,
+  exclude?: string
+): Promise<WorkspaceWatcher> {
+  const recursive = options.recursive ?? true
+  const debounceMs = Math.max(0, options.debounceMs ?? DEFAULT_WATCH_DEBOUNCE_MS)
+  const prefix = path ? `${path}/` : ''
+  const excludePrefix = exclude ? `${exclude}/` : null
+
+  const inScope = (changed: string): boolean => {
+    if (exclude && (changed === exclude || changed.startsWith(excludePrefix!))) return false
+    if (changed === path) return true
+    if (!changed.startsWith(prefix)) return false
+    return recursive || !changed.includes('/', prefix.length)
+  }
+
+  let changed = new Set<string>()
+  let overflow = false
+  let timer: ReturnType<typeof setTimeout> | null = null
+  let open = true
+
+  const flush = () => {
+    if (timer) clearTimeout(timer)
+    timer = null
+    if (!overflow && changed.size === 0) return
+    const event: WatchEvent = { paths: overflow ? null : [...changed] }
+    changed = new Set()
+    overflow = false
+    notify(listener, event)
+  }
+
+  const unsubscribe = await feed.subscribe((event) => {
+    if (!open) return
+    if (event.closed) {
+      open = false
+      flush()
+      notify(listener, event)
+      return
+    }
+
+    if (event.paths === null) {
+      overflow = true
+    } else {
+      for (const changedPath of event.paths) {
+        if (!inScope(changedPath)) continue
+        if (changed.size >= WATCH_MAX_PATHS) {
+          overflow = true
+          break
+        }
+        changed.add(changedPath)
+      }
+    }
+    if (overflow || changed.size > 0) {
+      timer ??= setTimeout(flush, debounceMs)
+    }
+  })
+
+  return {
+    close() {
+      if (!open) return
+      open = false
+      if (timer) clearTimeout(timer)
+      unsubscribe()
+    },
+  }
+}
@@ -0,0 +1,152 @@
+import { createHash } from 'crypto'
+import { createReadStream, type BigIntStats } from 'fs'
+import { stat } from 'fs/promises'
+
+/** Smallest file looked up in the read cache; smaller ones come back with the hash request */
+export const DEFAULT_READ_CACHE_MIN_BYTES = 64 * 1024
+
+/** Share of the cache one file may take, so a single huge file can't flush everything else */
+const MAX_ENTRY_FRACTION = 4
+
+/** Files whose hashes hashFile() remembers */
+const HASH_MEMO_ENTRIES = 10_000
+
+/**
+ * Files changed more recently than this are hashed every time: timestamps
+ * are only as fine as the filesystem's clock, so a same-size rewrite right
+ * after the hash could keep the identity (git's "racy clean" problem)
+ */
+const HASH_MEMO_SETTLE_MS = 2_000
+
+/**
+ * Content-addressed LRU of file contents, bounded in bytes
+ *
+ * Entries are keyed by a scope (the remote host) and the SHA-256 of their
+ * content, so one copy serves every path, workspace and user whose file has
+ * those bytes, and an entry never goes stale: changed content has another
+ * hash. Contents are copied in and out, so callers may modify what they get.
+ */
+export class ContentCache {
+  private static sharedCache: ContentCache | null = null
+
+  /** Map iteration order is insertion order, so the first key is the LRU entry */
+  private readonly entries = new Map<string, Buffer>()
+  private bytes = 0
+
+  /**
+   * The process-wide cache used by remote backends with `readCacheBytes`
+   * Its limit is the largest one any backend asked for.
+   */
+  static shared(maxBytes: number): ContentCache {
+    if (!ContentCache.sharedCache) {
+      ContentCache.sharedCache = new ContentCache(maxBytes)
+    } else if (maxBytes > ContentCache.sharedCache.maxBytes) {
+      ContentCache.sharedCache.maxBytes = maxBytes
+    }
+    return ContentCache.sharedCache
+  }
+
+  constructor(public maxBytes: number) {}
+
+  /** Number of cached contents */
+  get size(): number {
+    return this.entries.size
+  }
+
+  /** Bytes of cached content */
+  get usedBytes(): number {
+    return this.bytes
+  }
+
+  get(scope: string, hash: string): Buffer | undefined {
+    const key = `${scope}\0${hash}`
+    const content = this.entries.get(key)
+    if (!content) return undefined
+
+    // Move to the most recently used end
+    this.entries.delete(key)
+    this.entries.set(key, content)
+    return Buffer.from(content)
+  }
+
+  /**
+   * Store content under its hash; the caller has checked that `hash` is the
+   * SHA-256 of `content`
+   */
+  set(scope: string, hash: string, content: Buffer): void {
+    if (content.length > this.maxBytes / MAX_ENTRY_FRACTION) return
+
+    const key = `${scope}\0${hash}`
+    this.delete(key)
+    this.entries.set(key, Buffer.from(content))
+    this.bytes += content.length
+
+    while (this.bytes > this.maxBytes) {
+      this.delete(this.entries.keys().next().value!)
+    }
+  }
+
+  clear(): void {
+    this.entries.clear()
+    this.bytes = 0
+  }
+
+  private delete(key: string): void {
+    const content = this.entries.get(key)
+    if (!content) return
+    this.entries.delete(key)
+    this.bytes -= content.length
+  }
+}
+
+/** Hashes of files by identity, in LRU order */
+const hashMemo = new Map<string, string>()
+
+/**
+ * Identity of a file's current content: any write changes the size, mtime
+ * or ctime, and a replaced file has another inode
+ */
+function fileIdentity(stats: BigIntStats): string {
+  return `${stats.dev}:${stats.ino}:${stats.size}:${stats.mtimeNs}:${stats.ctimeNs}`
+}
+
+/**
+ * SHA-256 (hex) and size of a regular file
+ * Hashes are remembered by (dev, inode, size, mtime, ctime), so asking again
+ * about an unchanged file costs one stat rather than a read, once the file
+ * has been left alone for a couple of seconds.
+ * @throws EISDIR for non-files, EAGAIN when the file changed while it was read
+ */
+export async function hashFile(path: string): Promise<{ hash: string; size: number }> {
+  const before = await stat(path, { bigint: true })
+  if (!before.isFile()) {
+    throw Object.assign(new Error(`Not a regular file: ${path}`), { code: 'EISDIR' })
+  }
+  const identity = fileIdentity(before)
+  const size = Number(before.size)
+
+  const known = hashMemo.get(identity)
+  if (known) {
+    hashMemo.delete(identity)
+    hashMemo.set(identity, known)
+    return { hash: known, size }
+  }
+
+  const hasher = createHash('sha256')
+  for await (const chunk of createReadStream(path)) {
+    hasher.update(chunk as Buffer)
+  }
+  const hash = hasher.digest('hex')
+
+  if (fileIdentity(await stat(path, { bigint: true })) !== identity) {
+    throw Object.assign(new Error(`File changed while hashing: ${path}`), { code: 'EAGAIN' })
+  }
+  const changedAt = Number((before.mtimeNs > before.ctimeNs ? before.mtimeNs : before.ctimeNs) / 1_000_000n)
+  if (Date.now() - changedAt >= HASH_MEMO_SETTLE_MS) {
+    hashMemo.set(identity, hash)
+    if (hashMemo.size > HASH_MEMO_ENTRIES) {
+      hashMemo.delete(hashMemo.keys().next().value!)
+    }
+  }
+  return { hash, size }
+}
@@ -0,0 +1,128 @@
+/**
+ * Size limits for a HeadTailBuffer
+ */
+export interface HeadTailLimits {
+  /** Bytes kept from the start of the output (default: unbounded) */
+  headBytes?: number
+  /** Bytes kept from the end of the output, in a ring buffer (default: 0) */
+  tailBytes?: number
+}
+
+/**
+ * Constant-memory output collector
+ * Keeps the first `headBytes` and the last `tailBytes` of everything
+ * appended and counts the rest, so a command that prints hundreds of MB
+ * costs at most headBytes + tailBytes of memory. With the default limits it
+ * keeps everything, like collecting chunks and calling Buffer.concat.
+ */
+export class HeadTailBuffer {
+  private readonly headBytes: number
+  private readonly headChunks: Buffer[] = []
+  private headLength = 0
+  private readonly ring: Buffer
+  /** Next write position in the ring */
+  private ringOffset = 0
+  /** Bytes currently held in the ring (at most ring.length) */
+  private ringLength = 0
+  private total = 0
+
+  constructor(limits: HeadTailLimits = {}) {
+    this.headBytes = limits.headBytes ?? Infinity
+    this.ring = Buffer.alloc(limits.tailBytes ?? 0)
+  }
+
+  /** Total bytes appended so far, including discarded ones */
+  get totalBytes(): number {
+    return this.total
+  }
+
+  /** Bytes dropped between the head and the tail */
+  get omittedBytes(): number {
+    return this.total - this.headLength - this.ringLength
+  }
+
+  /** Whether any output was discarded */
+  get truncated(): boolean {
+    return this.omittedBytes > 0
+  }
+
+  append(chunk: Buffer): void {
+    this.total += chunk.length
+
+    let rest = chunk
+    if (this.headLength < this.headBytes) {
+      const take = Math.min(rest.length, this.headBytes - this.headLength)
+      // Copy: callers may reuse the chunk's memory (e.g. pooled stream buffers)
+      this.headChunks.push(Buffer.from(rest.subarray(0, take)))
+      this.headLength += take
+      rest = rest.subarray(take)
+    }
+
+    const capacity = this.ring.length
+    if (rest.length === 0 || capacity === 0) return
+
+    // Only the last `capacity` bytes of a large chunk can survive
+    if (rest.length >= capacity) {
+      rest.copy(this.ring, 0, rest.length - capacity)
+      this.ringOffset = 0
+      this.ringLength = capacity
+      return
+    }
+
+    const firstPart = Math.min(rest.length, capacity - this.ringOffset)
+    rest.copy(this.ring, this.ringOffset, 0, firstPart)
+    rest.copy(this.ring, 0, firstPart)
+    this.ringOffset = (this.ringOffset + rest.length) % capacity
+    this.ringLength = Math.min(capacity, this.ringLength + rest.length)
+  }
+
+  /** Retained head bytes */
+  head(): Buffer {
+    return Buffer.concat(this.headChunks, this.headLength)
+  }
+
+  /** Retained tail bytes, oldest first */
+  tail(): Buffer {
+    if (this.ringLength < this.ring.length) {
+      return Buffer.from(this.ring.subarray(0, this.ringLength))
+    }
+    return Buffer.concat([this.ring.subarray(this.ringOffset), this.ring.subarray(0, this.ringOffset)])
+  }
+
+  /**
+   * Retained bytes: head followed by tail. Equal to the full output when
+   * nothing was truncated.
+   */
+  toBuffer(): Buffer {
+    return this.ringLength === 0 ? this.head() : Buffer.concat([this.head(), this.tail()])
+  }
+
+  /**
+   * Decode the retained output, marking where bytes were omitted
+   */
+  toString(encoding: BufferEncoding = 'utf-8'): string {
+    if (!this.truncated) {
+      return this.toBuffer().toString(encoding)
+    }
+    const marker = `\n\n... [${this.omittedBytes} bytes omitted] ...\n\n`
+    return `${this.head().toString(encoding)}${marker}${this.tail().toString(encoding)}`
+  }
+}
+
+/**
+ * Buffer limits for exec() output
+ * An explicit `maxBufferedBytes` keeps its first and last halves. Otherwise,
+ * when text output is cut to `maxOutputLength` characters anyway, nothing past
+ * the first maxOutputLength * 4 bytes (the UTF-8 worst case) can be shown, so
+ * the rest is not kept.
+ */
+export function execOutputLimits(maxBufferedBytes?: number, maxOutputLength?: number): HeadTailLimits {
+  if (maxBufferedBytes !== undefined) {
+    const headBytes = Math.ceil(maxBufferedBytes / 2)
+    return { headBytes, tailBytes: maxBufferedBytes - headBytes }
+  }
+  if (maxOutputLength !== undefined) {
+    return { headBytes: maxOutputLength * 4 }
+  }
+  return {}
+}
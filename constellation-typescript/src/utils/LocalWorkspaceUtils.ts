@@ -1,6 +1,7 @@
 import { existsSync, mkdirSync } from 'fs'
 import { join } from 'path'
 import { ConstellationFS } from '../config/Config.js'
+import { TRASH_DIRECTORY } from './TrashReaper.js'
 
 /**
  * Manages user workspace directories for local filesystem operations
@@ -60,5 +61,8 @@ export class LocalWorkspaceUtils {
     if (path.includes('..') || path.includes('./') || path.includes('/') || path.includes('\\')) {
       throw new Error('Workspace path cannot contain path traversal sequences')
     }
+    if (path === TRASH_DIRECTORY) {
+      throw new Error(`Workspace path '${path}' is reserved`)
+    }
   }
 }
@@ -0,0 +1,157 @@
+import type { Stats } from 'fs'
+import { dirname } from 'path'
+
+/** Default number of cached results per workspace */
+export const DEFAULT_METADATA_CACHE_ENTRIES = 5_000
+
+/** Default lifetime of a cached result while a change watcher is running */
+export const DEFAULT_METADATA_CACHE_TTL_MS = 30_000
+
+/** Default lifetime of a cached result when no change watcher is available */
+export const DEFAULT_METADATA_CACHE_UNWATCHED_TTL_MS = 1_000
+
+/**
+ * Options for a workspace metadata cache
+ */
+export interface MetadataCacheOptions {
+  /** Cached results kept before the least recently used are evicted (default: 5000) */
+  maxEntries?: number
+  /**
+   * Lifetime of a cached result while the remote change watcher is running
+   * (default: 30s). Bounds staleness if an invalidation is ever missed.
+   */
+  ttlMs?: number
+  /**
+   * Lifetime of a cached result without a watcher, e.g. when the agent is
+   * unavailable (default: 1s). Only the client's own writes invalidate then.
+   */
+  unwatchedTtlMs?: number
+}
+
+/** Cached result types by kind */
+export interface CachedMetadata {
+  stat: Stats
+  exists: boolean
+  readdir: string[]
+}
+
+interface CacheEntry {
+  value: unknown
+  expiresAt: number
+}
+
+/**
+ * Path-keyed LRU of stat, exists and readdir results
+ *
+ * Entries are dropped when the path, its parent or (for directory changes)
+ * anything below it is invalidated. A read that started before an
+ * invalidation is not stored, so a slow response never overwrites newer
+ * state: take a `ticket()` before the request and pass it to `set()`.
+ */
+export class MetadataCache {
+  /** Map iteration order is insertion order, so the first key is the LRU entry */
+  private readonly entries = new Map<string, CacheEntry>()
+  private readonly maxEntries: number
+  private readonly ttlMs: number
+  private readonly unwatchedTtlMs: number
+  /** Incremented by every invalidation */
+  private epoch = 0
+
+  /** Whether a remote change watcher currently covers this cache */
+  watched = false
+
+  constructor(options: MetadataCacheOptions = {}) {
+    this.maxEntries = options.maxEntries ?? DEFAULT_METADATA_CACHE_ENTRIES
+    this.ttlMs = options.ttlMs ?? DEFAULT_METADATA_CACHE_TTL_MS
+    this.unwatchedTtlMs = options.unwatchedTtlMs ?? DEFAULT_METADATA_CACHE_UNWATCHED_TTL_MS
+  }
+
+  /** Number of cached results */
+  get size(): number {
+    return this.entries.size
+  }
+
+  get<K extends keyof CachedMetadata>(kind: K, path: string): CachedMetadata[K] | undefined {
+    const key = `${kind}:${path}`
+    const entry = this.entries.get(key)
+    if (!entry) return undefined
+
+    if (entry.expiresAt <= Date.now()) {
+      this.entries.delete(key)
+      return undefined
+    }
+
+    // Move to the most recently used end
+    this.entries.delete(key)
+    this.entries.set(key, entry)
+    // Listings are copied so callers can sort them in place
+    return (Array.isArray(entry.value) ? [...entry.value] : entry.value) as CachedMetadata[K]
+  }
+
+  /**
+   * Current invalidation epoch, to pass to set() once the result arrives
+   */
+  ticket(): number {
+    return this.epoch
+  }
+
+  /**
+   * Store a result unless something was invalidated since `ticket` was taken
+   */
+  set<K extends keyof CachedMetadata>(kind: K, path: string, value: CachedMetadata[K], ticket: number): void {
+    if (ticket !== this.epoch) return
+
+    const key = `${kind}:${path}`
+    this.entries.delete(key)
+    this.entries.set(key, {
+      value: Array.isArray(value) ? [...value] : value,
+      expiresAt: Date.now() + (this.watched ? this.ttlMs : this.unwatchedTtlMs),
+    })
+
+    while (this.entries.size > this.maxEntries) {
+      this.entries.delete(this.entries.keys().next().value!)
+    }
+  }
+
+  /**
+   * Drop results affected by a change to `path`: the path itself, the
+   * listing and stat of its parent, and everything below it
+   */
+  invalidate(path: string): void {
+    this.epoch++
+    this.dropPath(path)
+    this.dropPath(dirname(path))
+
+    const prefix = path.endsWith('/') ? path : `${path}/`
+    for (const key of this.entries.keys()) {
+      if (key.slice(key.indexOf(':') + 1).startsWith(prefix)) {
+        this.entries.delete(key)
+      }
+    }
+  }
+
+  /**
+   * Drop results affected by creating `path` and any missing ancestors
+   * (mkdir -p): the path and the listing of every ancestor
+   */
+  invalidateWithAncestors(path: string): void {
+    this.invalidate(path)
+    for (let dir = dirname(path); dir !== dirname(dir); dir = dirname(dir)) {
+      this.dropPath(dirname(dir))
+    }
+  }
+
+  /**
+   * Drop everything, e.g. after a shell command that may have changed any file
+   */
+  clear(): void {
+    this.epoch++
+    this.entries.clear()
+  }
+
+  private dropPath(path: string): void {
+    this.entries.delete(`stat:${path}`)
+    this.entries.delete(`exists:${path}`)
+    this.entries.delete(`readdir:${path}`)
+  }
+}
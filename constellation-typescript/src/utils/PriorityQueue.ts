@@ -0,0 +1,163 @@
+/**
+ * Scheduling classes for queued remote operations, highest priority first.
+ * Interactive work (single reads, stats, short commands) is dequeued before
+ * bulk work (streamed transfers, long-running commands).
+ */
+export const PRIORITIES = ['interactive', 'bulk'] as const
+
+export type Priority = typeof PRIORITIES[number]
+
+/**
+ * FIFO queue on a growable ring buffer
+ * push and shift are O(1), unlike Array.prototype.shift which moves every
+ * remaining element.
+ */
+export class Deque<T> {
+  private items: Array<T | undefined>
+  private head = 0
+  private count = 0
+
+  constructor(initialCapacity = 16) {
+    this.items = new Array(Math.max(1, initialCapacity))
+  }
+
+  get length(): number {
+    return this.count
+  }
+
+  push(item: T): void {
+    if (this.count === this.items.length) {
+      this.grow()
+    }
+    this.items[(this.head + this.count) % this.items.length] = item
+    this.count++
+  }
+
+  shift(): T | undefined {
+    if (this.count === 0) return undefined
+    const item = this.items[this.head]
+    // Drop the reference so dequeued items can be collected
+    this.items[this.head] = undefined
+    this.head = (this.head + 1) % this.items.length
+    this.count--
+    return item
+  }
+
+  peek(): T | undefined {
+    return this.count === 0 ? undefined : this.items[this.head]
+  }
+
+  /**
+   * Remove and return every item in order
+   */
+  drain(): T[] {
+    const drained: T[] = []
+    for (let item = this.shift(); item !== undefined; item = this.shift()) {
+      drained.push(item)
+    }
+    return drained
+  }
+
+  private grow(): void {
+    const grown = new Array<T | undefined>(this.items.length * 2)
+    for (let i = 0; i < this.count; i++) {
+      grown[i] = this.items[(this.head + i) % this.items.length]
+    }
+    this.items = grown
+    this.head = 0
+  }
+}
+
+/**
+ * FIFO queue per priority class; shift returns the oldest item of the
+ * highest non-empty class in O(1)
+ */
+export class PriorityQueue<T> {
+  private readonly levels = PRIORITIES.map(() => new Deque<T>())
+
+  get length(): number {
+    let total = 0
+    for (const level of this.levels) total += level.length
+    return total
+  }
+
+  push(item: T, priority: Priority = 'interactive'): void {
+    this.levels[PRIORITIES.indexOf(priority)]!.push(item)
+  }
+
+  shift(): T | undefined {
+    for (const level of this.levels) {
+      if (level.length > 0) return level.shift()
+    }
+    return undefined
+  }
+
+  /**
+   * Remove and return every item, highest priority first
+   */
+  drain(): T[] {
+    return this.levels.flatMap(level => level.drain())
+  }
+}
+
+/**
+ * PriorityQueue per owner, dequeued round-robin across owners so one owner
+ * with a deep backlog can't starve the others. Within an owner, interactive
+ * items still go before bulk ones.
+ */
+export class FairQueue<K, T> {
+  private readonly queues = new Map<K, PriorityQueue<T>>()
+  /** Owners with queued items, in turn order */
+  private readonly turns = new Deque<K>()
+  private count = 0
+
+  get length(): number {
+    return this.count
+  }
+
+  push(owner: K, item: T, priority: Priority = 'interactive'): void {
+    let queue = this.queues.get(owner)
+    if (!queue) {
+      queue = new PriorityQueue<T>()
+      this.queues.set(owner, queue)
+      this.turns.push(owner)
+    }
+    queue.push(item, priority)
+    this.count++
+  }
+
+  /**
+   * Dequeue from the next owner in turn that `eligible` accepts
+   * Owners passed over stay in the rotation for the next call.
+   */
+  shift(eligible: (owner: K) => boolean = () => true): T | undefined {
+    for (let remaining = this.turns.length; remaining > 0; remaining--) {
+      const owner = this.turns.shift()!
+      if (!eligible(owner)) {
+        this.turns.push(owner)
+        continue
+      }
+
+      const queue = this.queues.get(owner)!
+      const item = queue.shift()
+      this.count--
+      if (queue.length > 0) {
+        this.turns.push(owner)
+      } else {
+        this.queues.delete(owner)
+      }
+      return item
+    }
+    return undefined
+  }
+
+  /**
+   * Remove and return every item, owner by owner
+   */
+  drain(): T[] {
+    const drained = this.turns.drain().flatMap(owner => this.queues.get(owner)!.drain())
+    this.queues.clear()
+    this.count = 0
+    return drained
+  }
+}
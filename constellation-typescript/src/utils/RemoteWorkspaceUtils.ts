@@ -4,6 +4,7 @@ import { ConstellationFS } from '../config/Config.js'
 import { ERROR_CODES } from '../constants.js'
 import { FileSystemError } from '../types.js'
 import { getLogger } from './logger.js'
+import { TRASH_DIRECTORY } from './TrashReaper.js'
 
 /**
  * Utility functions for managing user workspace directories on remote filesystems via SSH
@@ -139,6 +140,9 @@ export class RemoteWorkspaceUtils {
     if (path.includes('..') || path.includes('./') || path.includes('/') || path.includes('\\')) {
       throw new Error('Workspace path cannot contain path traversal sequences')
     }
+    if (path === TRASH_DIRECTORY) {
+      throw new Error(`Workspace path '${path}' is reserved`)
+    }
   }
 
   /**
@@ -162,5 +166,8 @@ export class RemoteWorkspaceUtils {
     if (userId.includes('..') || userId.includes('./') || userId.includes('/') || userId.includes('\\')) {
       throw new Error('User ID cannot contain path traversal sequences')
     }
+    if (userId === TRASH_DIRECTORY) {
+      throw new Error(`User ID '${userId}' is reserved`)
+    }
   }
 }
@@ -0,0 +1,80 @@
+import { FairQueue } from './PriorityQueue.js'
+
+/**
+ * Thrown when the limiter's queue is full; the caller should shed the request
+ */
+export class OverloadedError extends Error {
+  constructor(message = 'Server is overloaded, retry later') {
+    super(message)
+    this.name = 'OverloadedError'
+  }
+}
+
+export interface RequestLimiterOptions {
+  /** Tasks running at the same time */
+  maxConcurrent: number
+  /** Tasks waiting for a slot; further tasks are rejected with OverloadedError */
+  maxQueued: number
+}
+
+interface Waiter {
+  start: () => void
+}
+
+/**
+ * Bounded executor with admission control
+ *
+ * Runs at most `maxConcurrent` tasks at once and queues up to `maxQueued`
+ * more. Waiting tasks are started round-robin across owners, so one busy
+ * owner can't starve the others. Once the queue is full, run() rejects
+ * immediately instead of letting memory grow with the backlog.
+ */
+export class RequestLimiter<K = string> {
+  private readonly queue = new FairQueue<K, Waiter>()
+  private running = 0
+
+  constructor(private readonly options: RequestLimiterOptions) {}
+
+  /** Tasks currently running */
+  get active(): number {
+    return this.running
+  }
+
+  /** Tasks waiting for a slot */
+  get queued(): number {
+    return this.queue.length
+  }
+
+  /**
+   * Run `task` once a slot is free
+   * @throws OverloadedError when the queue is full
+   */
+  async run<T>(owner: K, task: () => Promise<T>): Promise<T> {
+    if (this.running >= this.options.maxConcurrent) {
+      if (this.queue.length >= this.options.maxQueued) {
+        throw new OverloadedError()
+      }
+      await new Promise<void>(resolve => this.queue.push(owner, { start: resolve }))
+    } else {
+      this.running++
+    }
+
+    try {
+      return await task()
+    } finally {
+      this.next()
+    }
+  }
+
+  /**
+   * Hand the finished task's slot to the next waiter, or free it
+   */
+  private next(): void {
+    const waiter = this.queue.shift()
+    if (waiter) {
+      waiter.start()
+    } else {
+      this.running--
+    }
+  }
+}
@@ -0,0 +1,213 @@
+import { randomBytes } from 'crypto'
+import { lstat, mkdir, readdir, rename, rm, rmdir, unlink } from 'fs/promises'
+import { basename, join, posix } from 'path'
+import { setTimeout as sleep } from 'timers/promises'
+import { getLogger } from './logger.js'
+import { incrementCounter } from './metrics.js'
+import { shellQuote } from './search.js'
+
+/**
+ * Directory in the workspace root that deleted workspaces are renamed into
+ * It sits next to the user directories, on the same filesystem, so the
+ * rename is atomic and instant. Reserved: no user or workspace can be named so.
+ */
+export const TRASH_DIRECTORY = '.constellation-trash'
+
+/** Entries the reaper removes per second, so it doesn't starve other I/O on the disk */
+const REAP_ENTRIES_PER_SECOND = 5_000
+
+/** Unlinks the reaper keeps in flight */
+const REAP_CONCURRENCY = 16
+
+/**
+ * Options for TrashReaper
+ */
+export interface TrashReaperOptions {
+  /** Entries removed per second (default: 5000) */
+  entriesPerSecond?: number
+  /** Unlinks in flight (default: 16) */
+  concurrency?: number
+}
+
+/**
+ * Move a directory into the trash and have it removed in the background
+ * Returns as soon as the rename is done, however big the tree is.
+ * @param path - Directory to delete
+ * @param trashRoot - Trash directory on the same filesystem
+ * @returns Promise resolving once `path` is gone; a missing path is not an error
+ */
+export async function moveToTrash(path: string, trashRoot: string): Promise<void> {
+  await mkdir(trashRoot, { recursive: true })
+  try {
+    await rename(path, join(trashRoot, trashName(path)))
+  } catch (error) {
+    const code = (error as NodeJS.ErrnoException).code
+    if (code === 'ENOENT') return
+    // The trash is on another filesystem (e.g. a workspace that is a mount point)
+    if (code === 'EXDEV' || code === 'EBUSY') {
+      await rm(path, { recursive: true, force: true })
+      return
+    }
+    throw error
+  }
+  incrementCounter('constellation_trash_moves')
+  TrashReaper.for(trashRoot).schedule()
+}
+
+/**
+ * Shell command doing what moveToTrash() does, for remote hosts without the
+ * agent: a rename, then a detached `rm -rf` at idle I/O priority (where
+ * ionice exists) and lowest CPU priority
+ * @param path - Absolute directory to delete
+ * @param trashRoot - Absolute trash directory
+ */
+export function trashCommand(path: string, trashRoot: string): string {
+  const target = shellQuote(posix.join(trashRoot, trashName(path)))
+  const source = shellQuote(path)
+  return [
+    `mkdir -p ${shellQuote(trashRoot)} || exit 1`,
+    `if [ -e ${source} ] || [ -L ${source} ]; then mv ${source} ${target} || rm -rf ${source} || exit 1; fi`,
+    // Output and input are detached so the SSH channel closes right away
+    `if [ -e ${target} ]; then nohup $(command -v ionice >/dev/null 2>&1 && echo ionice -c 3) nice -n 19 rm -rf ${target} </dev/null >/dev/null 2>&1 & fi`,
+  ].join('; ')
+}
+
+/**
+ * Unique name for a trashed directory, keeping its own name for debugging
+ */
+function trashName(path: string): string {
+  return `${basename(path)}.${Date.now()}.${randomBytes(4).toString('hex')}`
+}
+
+/**
+ * Empties a trash directory in the background
+ *
+ * One reaper per trash directory and process. Each pass removes everything
+ * in the trash, including what an earlier process left behind, depth first
+ * with a bounded number of unlinks in flight and at most `entriesPerSecond`
+ * removals per second. Timers don't keep the process alive: an interrupted
+ * pass is picked up by the next one.
+ */
+export class TrashReaper {
+  private static readonly reapers = new Map<string, TrashReaper>()
+
+  private readonly entriesPerSecond: number
+  private readonly concurrency: number
+  private running: Promise<void> | null = null
+  private rerun = false
+  private windowStart = 0
+  private windowCount = 0
+
+  /**
+   * The reaper for `trashRoot`; options apply when it is first created
+   */
+  static for(trashRoot: string, options?: TrashReaperOptions): TrashReaper {
+    let reaper = TrashReaper.reapers.get(trashRoot)
+    if (!reaper) {
+      reaper = new TrashReaper(trashRoot, options)
+      TrashReaper.reapers.set(trashRoot, reaper)
+    }
+    return reaper
+  }
+
+  private constructor(readonly trashRoot: string, options: TrashReaperOptions = {}) {
+    this.entriesPerSecond = Math.max(1, options.entriesPerSecond ?? REAP_ENTRIES_PER_SECOND)
+    this.concurrency = Math.max(1, options.concurrency ?? REAP_CONCURRENCY)
+  }
+
+  /**
+   * Start a pass, or another one after the running pass
+   */
+  schedule(): void {
+    if (this.running) {
+      this.rerun = true
+      return
+    }
+    this.running = this.reap().finally(() => {
+      this.running = null
+      if (this.rerun) {
+        this.rerun = false
+        this.schedule()
+      }
+    })
+  }
+
+  /**
+   * Resolves when no pass is running or scheduled
+   */
+  async idle(): Promise<void> {
+    while (this.running) {
+      await this.running
+    }
+  }
+
+  private async reap(): Promise<void> {
+    let names: string[]
+    try {
+      names = await readdir(this.trashRoot)
+    } catch {
+      return
+    }
+
+    for (const name of names) {
+      try {
+        await this.removeTree(join(this.trashRoot, name))
+        incrementCounter('constellation_trash_reaped')
+      } catch (error) {
+        getLogger().warn(`[TrashReaper] Could not remove ${name} from ${this.trashRoot}:`, error)
+      }
+    }
+  }
+
+  private async removeTree(path: string): Promise<void> {
+    const stats = await lstat(path).catch(ignoreMissing)
+    if (!stats) return
+    if (!stats.isDirectory()) {
+      await this.throttle(1)
+      await unlink(path).catch(ignoreMissing)
+      return
+    }
+
+    const dirents = await readdir(path, { withFileTypes: true }).catch(ignoreMissing) ?? []
+    let files: string[] = []
+    const unlinkFiles = async () => {
+      await this.throttle(files.length)
+      await Promise.all(files.map(file => unlink(file).catch(ignoreMissing)))
+      files = []
+    }
+
+    for (const dirent of dirents) {
+      const child = join(path, dirent.name)
+      if (dirent.isDirectory()) {
+        await this.removeTree(child)
+      } else {
+        files.push(child)
+        if (files.length >= this.concurrency) await unlinkFiles()
+      }
+    }
+    if (files.length > 0) await unlinkFiles()
+
+    await this.throttle(1)
+    await rmdir(path).catch(ignoreMissing)
+  }
+
+  /** Wait as long as needed to stay within entriesPerSecond */
+  private async throttle(count: number): Promise<void> {
+    const now = Date.now()
+    if (now - this.windowStart >= 1_000) {
+      this.windowStart = now
+      this.windowCount = 0
+    }
+    this.windowCount += count
+    if (this.windowCount > this.entriesPerSecond) {
+      await sleep(this.windowStart + 1_000 - now, undefined, { ref: false })
+      this.windowStart = Date.now()
+      this.windowCount = count
+    }
+  }
+}
+
+function ignoreMissing(error: NodeJS.ErrnoException): undefined {
+  if (error.code === 'ENOENT') return undefined
+  throw error
+}
@@ -0,0 +1,520 @@
+import { mkdir, open, readFile, rename, stat, writeFile } from 'fs/promises'
+import { join, sep } from 'path'
+import { ChangeFeed } from './ChangeFeed.js'
+import { getLogger } from './logger.js'
+import { IgnoreFile, isIgnored } from './gitignore.js'
+import {
+  DEFAULT_SEARCH_MAX_FILE_SIZE,
+  requiredLiteral,
+  searchFileList,
+  searchTree,
+  walkFiles,
+  type SearchOptions,
+  type SearchResult,
+} from './search.js'
+
+/** Directory below the workspace root that holds the index */
+export const SEARCH_INDEX_DIRECTORY = '.constellationfs'
+
+const INDEX_FILE = 'search-index'
+
+/** 'CFTI' */
+const INDEX_MAGIC = 0x43465449
+const INDEX_VERSION = 1
+
+/** Signature bits per distinct trigram; with two probes this gives ~5% false positives */
+const BITS_PER_TRIGRAM = 8
+const MIN_SIGNATURE_BITS = 64
+/** 32 KiB per file at most; very large files just match more often */
+const MAX_SIGNATURE_BITS = 1 << 18
+
+/** Files with a NUL byte in this prefix are binary and never candidates (as in searchTree) */
+const BINARY_SNIFF_BYTES = 8_192
+
+/** Index writes are batched and happen at most this often */
+const SAVE_DELAY_MS = 2_000
+
+/** Files reindexed at the same time while applying changes */
+const UPDATE_CONCURRENCY = 16
+
+/** Signature of binary and oversized files: they never match */
+const NO_SIGNATURE = new Uint8Array(0)
+
+interface IndexEntry {
+  mtimeMs: number
+  size: number
+  signature: Uint8Array
+}
+
+/** ASCII lowercase, so one signature serves case-sensitive and -insensitive queries */
+function fold(byte: number): number {
+  return byte >= 0x41 && byte <= 0x5a ? byte | 0x20 : byte
+}
+
+/** murmur3 finalizer */
+function mix(hash: number): number {
+  hash ^= hash >>> 16
+  hash = Math.imul(hash, 0x85ebca6b)
+  hash ^= hash >>> 13
+  hash = Math.imul(hash, 0xc2b2ae35)
+  hash ^= hash >>> 16
+  return hash >>> 0
+}
+
+/** Distinct case-folded byte trigrams of `data` */
+function trigrams(data: Uint8Array): Set<number> {
+  const keys = new Set<number>()
+  if (data.length < 3) return keys
+  let key = (fold(data[0]!) << 8) | fold(data[1]!)
+  for (let i = 2; i < data.length; i++) {
+    key = ((key << 8) | fold(data[i]!)) & 0xffffff
+    keys.add(key)
+  }
+  return keys
+}
+
+function setBits(signature: Uint8Array, key: number): void {
+  const mask = signature.length * 8 - 1
+  const first = mix(key) & mask
+  const second = mix(key ^ 0x5bd1e995) & mask
+  signature[first >>> 3]! |= 1 << (first & 7)
+  signature[second >>> 3]! |= 1 << (second & 7)
+}
+
+function hasBits(signature: Uint8Array, key: number): boolean {
+  const mask = signature.length * 8 - 1
+  const first = mix(key) & mask
+  const second = mix(key ^ 0x5bd1e995) & mask
+  return (signature[first >>> 3]! & (1 << (first & 7))) !== 0 && (signature[second >>> 3]! & (1 << (second & 7))) !== 0
+}
+
+/**
+ * Bloom filter of a file's trigrams, sized to the number of distinct trigrams
+ * (a power of two between 8 bytes and 32 KiB)
+ */
+export function trigramSignature(data: Uint8Array): Uint8Array {
+  const keys = trigrams(data)
+  let bits = MIN_SIGNATURE_BITS
+  while (bits < keys.size * BITS_PER_TRIGRAM && bits < MAX_SIGNATURE_BITS) bits *= 2
+
+  const signature = new Uint8Array(bits / 8)
+  for (const key of keys) setBits(signature, key)
+  return signature
+}
+
+/**
+ * Whether a file with this signature may contain every trigram of `text`
+ * False positives are possible, false negatives are not.
+ */
+export function signatureMayContain(signature: Uint8Array, text: string): boolean {
+  if (signature.length === 0) return false
+  for (const key of trigrams(Buffer.from(text))) {
+    if (!hasBits(signature, key)) return false
+  }
+  return true
+}
+
+function toIndexPath(path: string): string {
+  return sep === '/' ? path : path.split(sep).join('/')
+}
+
+/**
+ * Persistent trigram index of the text files in one directory tree
+ *
+ * Narrows a search to the files that can contain the pattern's required
+ * literal, then verifies them with the normal search. Each file keeps a
+ * bloom filter of its trigrams rather than entries in shared posting lists,
+ * so a change reindexes just that file. Freshness comes from the tree's
+ * ChangeFeed (shared with Workspace.watch()), from markDirty() for writes made through the
+ * workspace, and from an mtime/size check of every file when the watcher is
+ * unavailable or after a restart. File contents are only read again when
+ * they changed.
+ *
+ * The index is stored in `.constellationfs/search-index` below the root.
+ * Searches that can't be narrowed (no literal of 3+ characters, hidden
+ * files, gitignore disabled, or a larger maxFileSize) walk the tree as usual.
+ */
+export class TrigramIndex {
+  private static readonly shared = new Map<string, TrigramIndex>()
+
+  private readonly entries = new Map<string, IndexEntry>()
+  private readonly dirty = new Set<string>()
+  /** Parsed .gitignore per directory, for checking single changed paths */
+  private readonly ignoreFiles = new Map<string, IgnoreFile | null>()
+  private readonly indexFile: string
+  /** Subscription to the tree's ChangeFeed */
+  private feed: ChangeFeed | null = null
+  private unsubscribe: (() => void) | null = null
+  private watchUnavailable = false
+  /** Set until a full scan has confirmed the loaded entries, and after a missed event */
+  private fullScanNeeded = true
+  private loaded: Promise<void> | null = null
+  private refreshing: Promise<void> | null = null
+  private saveTimer: NodeJS.Timeout | null = null
+  private closed = false
+
+  /**
+   * The index for `root`, shared by every workspace on the same directory
+   * in this process
+   */
+  static for(root: string): TrigramIndex {
+    let index = TrigramIndex.shared.get(root)
+    if (!index) {
+      index = new TrigramIndex(root)
+      TrigramIndex.shared.set(root, index)
+    }
+    return index
+  }
+
+  private constructor(readonly root: string) {
+    this.indexFile = join(root, SEARCH_INDEX_DIRECTORY, INDEX_FILE)
+  }
+
+  /** Number of indexed files */
+  get size(): number {
+    return this.entries.size
+  }
+
+  /**
+   * Note that a file changed; it is reindexed before the next search
+   * @param path - Path relative to the root
+   */
+  markDirty(path: string): void {
+    const indexPath = toIndexPath(path).replace(/^\.?\/+/, '').replace(/\/+$/, '')
+    if (indexPath) this.dirty.add(indexPath)
+  }
+
+  /**
+   * Search a directory of the tree, using the index when the query allows
+   * @param searchDir - '/'-separated directory relative to the root ('' for the root)
+   * @param options - Pattern and filters (`options.path` is ignored)
+   * @returns Matches with paths relative to the root
+   */
+  async search(searchDir: string, options: SearchOptions): Promise<SearchResult> {
+    const literal = this.queryLiteral(options)
+    if (literal === null) {
+      return searchTree(join(this.root, searchDir), options, searchDir)
+    }
+
+    const directory = join(this.root, searchDir)
+    if (!(await stat(directory)).isDirectory()) {
+      throw Object.assign(new Error(`Not a directory: ${directory}`), { code: 'ENOTDIR' })
+    }
+    await this.refresh()
+
+    const prefix = searchDir ? `${searchDir}/` : ''
+    const candidates: string[] = []
+    for (const [path, entry] of this.entries) {
+      if (path.startsWith(prefix) && signatureMayContain(entry.signature, literal)) {
+        candidates.push(path.slice(prefix.length))
+      }
+    }
+    candidates.sort()
+    return searchFileList(directory, candidates, options, searchDir)
+  }
+
+  /**
+   * Stop watching and write pending changes
+   * @param save - Write the index first (false when the tree is being deleted)
+   */
+  async close(save = true): Promise<void> {
+    this.closed = true
+    TrigramIndex.shared.delete(this.root)
+    this.unsubscribe?.()
+    this.unsubscribe = null
+    this.feed = null
+    if (this.saveTimer) {
+      clearTimeout(this.saveTimer)
+      this.saveTimer = null
+      if (save) await this.save()
+    }
+  }
+
+  /**
+   * Lowercased literal every match must contain, or null when the index
+   * can't answer the query
+   */
+  private queryLiteral(options: SearchOptions): string | null {
+    if (options.hidden || options.gitignore === false) return null
+    if ((options.maxFileSize ?? DEFAULT_SEARCH_MAX_FILE_SIZE) > DEFAULT_SEARCH_MAX_FILE_SIZE) return null
+    if (typeof options.pattern !== 'string') return null
+
+    const literal = options.literal ? options.pattern : requiredLiteral(options.pattern)
+    if (!literal || Buffer.byteLength(literal) < 3) return null
+    // Only ASCII letters are folded, so other case-insensitive text can't be looked up
+    // eslint-disable-next-line no-control-regex
+    if (options.ignoreCase && /[^\x00-\x7f]/.test(literal)) return null
+    return literal
+  }
+
+  /** Bring the index up to date; concurrent searches share one refresh */
+  private refresh(): Promise<void> {
+    this.refreshing ??= this.update().finally(() => {
+      this.refreshing = null
+    })
+    return this.refreshing
+  }
+
+  private async update(): Promise<void> {
+    this.loaded ??= this.load()
+    await this.loaded
+    await this.startWatching()
+
+    let changed: boolean
+    // The feed reports null events while it is down, but a scan is needed until it is back
+    if (this.fullScanNeeded || !this.feed?.active) {
+      this.fullScanNeeded = false
+      this.dirty.clear()
+      changed = await this.scan()
+    } else {
+      const paths = [...this.dirty]
+      this.dirty.clear()
+      changed = await this.applyChanges(paths)
+    }
+
+    if (changed) this.scheduleSave()
+  }
+
+  private async startWatching(): Promise<void> {
+    if (this.unsubscribe || this.watchUnavailable || this.closed) return
+    const feed = ChangeFeed.forDirectory(this.root)
+    try {
+      const unsubscribe = await feed.subscribe((event) => {
+        if (event.closed) {
+          // The workspace stopped its feed; subscribe again on next search
+          this.unsubscribe = null
+          this.feed = null
+          this.fullScanNeeded = true
+        } else if (event.paths === null) {
+          this.fullScanNeeded = true
+        } else {
+          for (const path of event.paths) {
+            if (path !== SEARCH_INDEX_DIRECTORY && !path.startsWith(`${SEARCH_INDEX_DIRECTORY}/`)) this.dirty.add(path)
+          }
+        }
+      })
+      if (this.closed) {
+        unsubscribe()
+        return
+      }
+      this.feed = feed
+      this.unsubscribe = unsubscribe
+    } catch (error) {
+      // Without a watcher every search checks file mtimes instead
+      getLogger().debug(`Search index can't watch ${this.root}:`, error)
+      this.watchUnavailable = true
+    }
+  }
+
+  /**
+   * Check every file against the index
+   * @returns Whether any entry changed
+   */
+  private async scan(): Promise<boolean> {
+    this.ignoreFiles.clear()
+    const seen = new Set<string>()
+    let changed = false
+    await walkFiles(this.root, {}, async (path) => {
+      seen.add(path)
+      if (await this.reindex(path)) changed = true
+    })
+    for (const path of this.entries.keys()) {
+      if (!seen.has(path)) {
+        this.entries.delete(path)
+        changed = true
+      }
+    }
+    return changed
+  }
+
+  /**
+   * Reindex paths reported by the watcher or markDirty()
+   * New directories and .gitignore changes fall back to a full scan.
+   */
+  private async applyChanges(paths: string[]): Promise<boolean> {
+    if (paths.some(path => path === '.gitignore' || path.endsWith('/.gitignore'))) {
+      return this.scan()
+    }
+
+    let changed = false
+    let rescan = false
+    const pending = [...paths]
+    const worker = async () => {
+      for (let path = pending.pop(); path !== undefined; path = pending.pop()) {
+        const result = await this.applyChange(path)
+        if (result === 'rescan') rescan = true
+        else if (result) changed = true
+      }
+    }
+    await Promise.all(Array.from({ length: Math.min(UPDATE_CONCURRENCY, pending.length) }, worker))
+    return rescan ? this.scan() : changed
+  }
+
+  private async applyChange(path: string): Promise<boolean | 'rescan'> {
+    let isDirectory = false
+    let exists = true
+    try {
+      isDirectory = (await stat(join(this.root, path))).isDirectory()
+    } catch {
+      exists = false
+    }
+
+    if (!exists) {
+      // A removed directory takes its files with it
+      let removed = this.entries.delete(path)
+      const prefix = `${path}/`
+      for (const key of this.entries.keys()) {
+        if (key.startsWith(prefix)) {
+          this.entries.delete(key)
+          removed = true
+        }
+      }
+      return removed
+    }
+    if (isDirectory) {
+      // Its contents may have arrived without events of their own (e.g. mv)
+      return (await this.isExcluded(path, true)) ? false : 'rescan'
+    }
+    if (await this.isExcluded(path, false)) {
+      return this.entries.delete(path)
+    }
+    return this.reindex(path)
+  }
+
+  /** Whether a walk of the root would skip `path` */
+  private async isExcluded(path: string, isDirectory: boolean): Promise<boolean> {
+    const segments = path.split('/')
+    if (segments.some(segment => segment.startsWith('.'))) return true
+
+    const files: IgnoreFile[] = []
+    for (let i = 0; i < segments.length; i++) {
+      const dir = segments.slice(0, i).join('/')
+      const file = await this.ignoreFile(dir)
+      if (file) files.push(file)
+      // An ignored directory excludes everything below it
+      const ancestor = segments.slice(0, i + 1).join('/')
+      const last = i === segments.length - 1
+      if (isIgnored(files, ancestor, last ? isDirectory : true)) return true
+    }
+    return false
+  }
+
+  private async ignoreFile(dir: string): Promise<IgnoreFile | null> {
+    let file = this.ignoreFiles.get(dir)
+    if (file === undefined) {
+      try {
+        file = new IgnoreFile(await readFile(join(this.root, dir, '.gitignore'), 'utf8'), dir)
+      } catch {
+        file = null
+      }
+      this.ignoreFiles.set(dir, file)
+    }
+    return file
+  }
+
+  /**
+   * Reindex one file if its size or mtime changed
+   * @returns Whether the entry changed
+   */
+  private async reindex(path: string): Promise<boolean> {
+    let entry: IndexEntry
+    try {
+      const handle = await open(join(this.root, path), 'r')
+      try {
+        const stats = await handle.stat()
+        if (!stats.isFile()) return this.entries.delete(path)
+
+        const previous = this.entries.get(path)
+        if (previous && previous.mtimeMs === stats.mtimeMs && previous.size === stats.size) return false
+
+        entry = { mtimeMs: stats.mtimeMs, size: stats.size, signature: NO_SIGNATURE }
+        if (stats.size <= DEFAULT_SEARCH_MAX_FILE_SIZE) {
+          const data = await handle.readFile()
+          if (!data.subarray(0, BINARY_SNIFF_BYTES).includes(0)) entry.signature = trigramSignature(data)
+        }
+      } finally {
+        await handle.close()
+      }
+    } catch {
+      return this.entries.delete(path)
+    }
+
+    this.entries.set(path, entry)
+    return true
+  }
+
+  private scheduleSave(): void {
+    if (this.saveTimer || this.closed) return
+    this.saveTimer = setTimeout(() => {
+      this.saveTimer = null
+      void this.save()
+    }, SAVE_DELAY_MS)
+    this.saveTimer.unref()
+  }
+
+  /**
+   * Read the stored index; a missing or unreadable file leaves it empty
+   */
+  private async load(): Promise<void> {
+    let data: Buffer
+    try {
+      data = await readFile(this.indexFile)
+    } catch {
+      return
+    }
+
+    try {
+      if (data.readUInt32BE(0) !== INDEX_MAGIC || data.readUInt32LE(4) !== INDEX_VERSION) return
+      const count = data.readUInt32LE(8)
+      let offset = 12
+      for (let i = 0; i < count; i++) {
+        const pathLength = data.readUInt32LE(offset)
+        const path = data.toString('utf8', offset + 4, offset + 4 + pathLength)
+        offset += 4 + pathLength
+        const mtimeMs = data.readDoubleLE(offset)
+        const size = data.readDoubleLE(offset + 8)
+        const signatureLength = data.readUInt32LE(offset + 16)
+        offset += 20
+        if (offset + signatureLength > data.length) throw new RangeError('Truncated search index')
+        // Copied so the file buffer isn't kept alive by one entry
+        const signature = signatureLength === 0 ? NO_SIGNATURE : new Uint8Array(data.subarray(offset, offset + signatureLength))
+        offset += signatureLength
+        this.entries.set(path, { mtimeMs, size, signature })
+      }
+    } catch (error) {
+      getLogger().debug(`Ignoring corrupt search index ${this.indexFile}:`, error)
+      this.entries.clear()
+    }
+  }
+
+  /**
+   * Write the index atomically (temporary file, then rename)
+   */
+  private async save(): Promise<void> {
+    const parts: Buffer[] = []
+    const header = Buffer.alloc(12)
+    header.writeUInt32BE(INDEX_MAGIC, 0)
+    header.writeUInt32LE(INDEX_VERSION, 4)
+    header.writeUInt32LE(this.entries.size, 8)
+    parts.push(header)
+
+    for (const [path, entry] of this.entries) {
+      const name = Buffer.from(path)
+      const fields = Buffer.alloc(24)
+      fields.writeUInt32LE(name.length, 0)
+      fields.writeDoubleLE(entry.mtimeMs, 4)
+      fields.writeDoubleLE(entry.size, 12)
+      fields.writeUInt32LE(entry.signature.length, 20)
+      parts.push(fields.subarray(0, 4), name, fields.subarray(4), entry.signature)
+    }
+
+    const temporary = `${this.indexFile}.${process.pid}.tmp`
+    try {
+      await mkdir(join(this.root, SEARCH_INDEX_DIRECTORY), { recursive: true })
+      await writeFile(temporary, Buffer.concat(parts))
+      await rename(temporary, this.indexFile)
+    } catch (error) {
+      getLogger().debug(`Failed to save search index ${this.indexFile}:`, error)
+    }
+  }
+}
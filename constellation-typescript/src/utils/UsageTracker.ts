@@ -0,0 +1,344 @@
+import { lstat, readdir } from 'fs/promises'
+import { join, posix } from 'path'
+import { ChangeFeed } from './ChangeFeed.js'
+import { getLogger } from './logger.js'
+import { shellQuote } from './search.js'
+import { walkTree } from './walk.js'
+
+/** How long usage stays valid without a change feed before the tree is scanned again */
+const UNWATCHED_RESCAN_MS = 10_000
+
+/** Trackers not asked for usage or sent a write for this long are closed */
+const IDLE_CLOSE_MS = 5 * 60_000
+
+/**
+ * Disk usage of a workspace, as apparent file sizes
+ */
+export interface WorkspaceUsage {
+  /** Total size of the files (and symlinks) in bytes */
+  bytes: number
+  /** Number of files (and symlinks) */
+  files: number
+}
+
+/**
+ * Usage of a workspace as the agent's 'usage' operation reports it
+ */
+export interface UsageReport extends WorkspaceUsage {
+  /** Current size of the file asked about, 0 when it doesn't exist */
+  fileSize?: number
+  /** Combined usage of all workspaces of the user */
+  user?: WorkspaceUsage
+}
+
+/**
+ * Incrementally maintained disk usage of one directory tree
+ *
+ * The first call scans the tree once. After that the total is kept current
+ * from the tree's ChangeFeed (shared with Workspace.watch() and the search
+ * index) and from record() for writes made through the workspace: only the
+ * changed paths are looked at again, so usage() costs O(changes) rather
+ * than a walk, and O(1) when nothing changed. A lost feed or an overflowing
+ * batch triggers one rescan. Without a watcher the total is rescanned at
+ * most every 10 seconds.
+ *
+ * Memory is one map entry per file, for the per-file sizes the deltas need,
+ * plus the watcher. Trackers idle for 5 minutes are closed, so a process
+ * serving many workspaces keeps only the recently used ones; the next
+ * usage() of a closed one scans its tree again.
+ */
+export class UsageTracker {
+  private static readonly shared = new Map<string, UsageTracker>()
+  private static sweepTimer: NodeJS.Timeout | null = null
+
+  /** Size of every file, keyed by '/'-separated path relative to the root */
+  private readonly sizes = new Map<string, number>()
+  private readonly dirty = new Set<string>()
+  private bytes = 0
+  private scanNeeded = true
+  private scannedAt = 0
+  private feed: ChangeFeed | null = null
+  private unsubscribe: (() => void) | null = null
+  private watchUnavailable = false
+  private refreshing: Promise<void> | null = null
+  private closed = false
+  private lastUsedAt = Date.now()
+
+  /**
+   * The tracker for `root`, shared by every workspace on the same directory
+   * in this process
+   */
+  static for(root: string): UsageTracker {
+    let tracker = UsageTracker.shared.get(root)
+    if (!tracker) {
+      tracker = new UsageTracker(root)
+      UsageTracker.shared.set(root, tracker)
+      UsageTracker.startSweeping()
+    }
+    return tracker
+  }
+
+  /**
+   * Close the trackers that haven't been used for `idleMs`; runs on its own
+   * every few minutes while there are trackers
+   */
+  static closeIdle(idleMs = IDLE_CLOSE_MS): void {
+    const now = Date.now()
+    for (const tracker of [...UsageTracker.shared.values()]) {
+      if (!tracker.refreshing && now - tracker.lastUsedAt >= idleMs) {
+        tracker.close()
+      }
+    }
+  }
+
+  /**
+   * The tracker for `root` if one was created, without starting one
+   * Writes report to it so it doesn't wait for the watcher.
+   */
+  static peek(root: string): UsageTracker | undefined {
+    return UsageTracker.shared.get(root)
+  }
+
+  /**
+   * Combined usage of every workspace directory below a user's directory
+   * Each workspace keeps its own tracker, so this is one readdir plus a
+   * lookup per workspace once they are loaded.
+   */
+  static async forUser(userRoot: string): Promise<WorkspaceUsage> {
+    const dirents = await readdir(userRoot, { withFileTypes: true }).catch(() => [])
+    const usages = await Promise.all(dirents
+      .filter(dirent => dirent.isDirectory())
+      .map(dirent => UsageTracker.for(join(userRoot, dirent.name)).usage()))
+    return usages.reduce((total, usage) => ({ bytes: total.bytes + usage.bytes, files: total.files + usage.files }), { bytes: 0, files: 0 })
+  }
+
+  private static startSweeping(): void {
+    if (UsageTracker.sweepTimer) return
+    UsageTracker.sweepTimer = setInterval(() => UsageTracker.closeIdle(), IDLE_CLOSE_MS / 2)
+    UsageTracker.sweepTimer.unref()
+  }
+
+  private constructor(readonly root: string) {}
+
+  /**
+   * Current usage of the tree
+   */
+  async usage(): Promise<WorkspaceUsage> {
+    this.lastUsedAt = Date.now()
+    await this.refresh()
+    return { bytes: this.bytes, files: this.sizes.size }
+  }
+
+  /**
+   * Size of one file as last seen, 0 when it is not known to exist
+   * Call after usage() so pending changes are applied.
+   * @param path - '/'-separated path relative to the root
+   */
+  sizeOf(path: string): number {
+    return this.sizes.get(path) ?? 0
+  }
+
+  /**
+   * Account for a file written through the workspace without waiting for
+   * the watcher to report it
+   * @param path - '/'-separated path relative to the root
+   * @param size - New size in bytes
+   */
+  record(path: string, size: number): void {
+    this.lastUsedAt = Date.now()
+    this.set(path, size)
+  }
+
+  /**
+   * Stop tracking; the next for() starts over
+   */
+  close(): void {
+    this.closed = true
+    if (UsageTracker.shared.get(this.root) === this) {
+      UsageTracker.shared.delete(this.root)
+    }
+    this.unsubscribe?.()
+    this.unsubscribe = null
+    this.feed = null
+    if (UsageTracker.shared.size === 0 && UsageTracker.sweepTimer) {
+      clearInterval(UsageTracker.sweepTimer)
+      UsageTracker.sweepTimer = null
+    }
+  }
+
+  /** Bring the total up to date; concurrent callers share one refresh */
+  private refresh(): Promise<void> {
+    this.refreshing ??= this.update().finally(() => {
+      this.refreshing = null
+    })
+    return this.refreshing
+  }
+
+  private async update(): Promise<void> {
+    await this.startWatching()
+
+    const watched = this.feed?.active ?? false
+    if (this.scanNeeded || (!watched && Date.now() - this.scannedAt > UNWATCHED_RESCAN_MS)) {
+      this.scanNeeded = false
+      this.dirty.clear()
+      await this.scan()
+      return
+    }
+
+    const paths = [...this.dirty]
+    this.dirty.clear()
+    for (const path of paths) {
+      await this.applyChange(path)
+    }
+  }
+
+  private async startWatching(): Promise<void> {
+    if (this.unsubscribe || this.watchUnavailable || this.closed) return
+    const feed = ChangeFeed.forDirectory(this.root)
+    try {
+      const unsubscribe = await feed.subscribe((event) => {
+        if (event.closed) {
+          this.unsubscribe = null
+          this.feed = null
+          this.scanNeeded = true
+        } else if (event.paths === null) {
+          this.scanNeeded = true
+        } else {
+          for (const path of event.paths) this.dirty.add(path)
+        }
+      })
+      if (this.closed) {
+        unsubscribe()
+        return
+      }
+      this.feed = feed
+      this.unsubscribe = unsubscribe
+    } catch (error) {
+      // Falls back to walking the whole tree on quota checks, at most every 10 seconds
+      getLogger().warn(`Usage tracker can't watch ${this.root}, rescanning it instead:`, error)
+      this.watchUnavailable = true
+    }
+  }
+
+  private async scan(): Promise<void> {
+    this.sizes.clear()
+    this.bytes = 0
+    try {
+      const { entries } = await walkTree(this.root, { withStats: true, maxEntries: Infinity })
+      for (const entry of entries) {
+        if (entry.type !== 'directory') this.set(entry.path, entry.size ?? 0)
+      }
+    } catch (error) {
+      // A missing root has no usage
+      if ((error as NodeJS.ErrnoException).code !== 'ENOENT') throw error
+    }
+    this.scannedAt = Date.now()
+  }
+
+  /**
+   * Look at one changed path again
+   * A new directory (e.g. moved in) is walked; a vanished path takes
+   * everything that was below it along.
+   */
+  private async applyChange(path: string): Promise<void> {
+    const stats = await lstat(join(this.root, path)).catch(() => null)
+    if (!stats) {
+      this.removeTree(path)
+      return
+    }
+    if (!stats.isDirectory()) {
+      this.set(path, stats.size)
+      return
+    }
+
+    this.removeTree(path)
+    const { entries } = await walkTree(join(this.root, path), { withStats: true, maxEntries: Infinity }).catch(() => ({ entries: [] }))
+    for (const entry of entries) {
+      if (entry.type !== 'directory') this.set(`${path}/${entry.path}`, entry.size ?? 0)
+    }
+  }
+
+  private set(path: string, size: number): void {
+    this.bytes += size - (this.sizes.get(path) ?? 0)
+    this.sizes.set(path, size)
+  }
+
+  private removeTree(path: string): void {
+    const size = this.sizes.get(path)
+    if (size !== undefined) {
+      this.bytes -= size
+      this.sizes.delete(path)
+      return
+    }
+    // Not a file we knew: a directory, whose contents went with it
+    const prefix = `${path}/`
+    for (const [file, fileSize] of this.sizes) {
+      if (file.startsWith(prefix)) {
+        this.bytes -= fileSize
+        this.sizes.delete(file)
+      }
+    }
+  }
+}
+
+/**
+ * Check a write against workspace and user quotas
+ * @param usage - Current workspace usage
+ * @param growth - Bytes the write adds (new size minus the file's current size)
+ * @param quotaBytes - Workspace quota, if any
+ * @param userUsage - Current usage across the user's workspaces, when a user quota is set
+ * @param userQuotaBytes - User quota, if any
+ * @returns A message describing the exceeded quota, or null when the write fits
+ */
+export function quotaViolation(
+  usage: WorkspaceUsage,
+  growth: number,
+  quotaBytes: number | undefined,
+  userUsage: WorkspaceUsage | null,
+  userQuotaBytes: number | undefined
+): string | null {
+  // Writes that shrink or keep the size are always allowed, so users can clean up
+  if (growth <= 0) return null
+  if (quotaBytes !== undefined && usage.bytes + growth > quotaBytes) {
+    return `Workspace quota exceeded: ${usage.bytes + growth} bytes needed, quota is ${quotaBytes}`
+  }
+  if (userQuotaBytes !== undefined && userUsage && userUsage.bytes + growth > userQuotaBytes) {
+    return `User quota exceeded: ${userUsage.bytes + growth} bytes needed, quota is ${userQuotaBytes}`
+  }
+  return null
+}
+
+/**
+ * Shell command that reports the same as the agent's 'usage' operation,
+ * for hosts without the agent
+ * This walks the tree on every call, so remote quota checks without the
+ * agent cost a find per write.
+ * @param root - Absolute workspace directory
+ * @param file - Workspace-relative file whose size to report as well
+ * @param user - Also report the usage of the workspace's parent directory
+ */
+export function usageCommand(root: string, file?: string, user = false): string {
+  const parts = [
+    `u() { find "$1" ! -type d -printf '%s\\n' 2>/dev/null | awk '{ b += $1; n++ } END { print b + 0, n + 0 }'; }`,
+    `u ${shellQuote(root)}`,
+  ]
+  if (file !== undefined) parts.push(`stat -c %s ${shellQuote(posix.join(root, file))} 2>/dev/null || echo 0`)
+  if (user) parts.push(`u ${shellQuote(posix.dirname(root))}`)
+  return parts.join('; ')
+}
+
+/**
+ * Turn the output of usageCommand() into a UsageReport
+ */
+export function parseUsageOutput(output: string, file?: string, user = false): UsageReport {
+  const lines = output.trim().split('\n')
+  const pair = (line = ''): WorkspaceUsage => {
+    const [bytes, files] = line.trim().split(/\s+/).map(Number)
+    return { bytes: bytes || 0, files: files || 0 }
+  }
+  const report: UsageReport = pair(lines[0])
+  let next = 1
+  if (file !== undefined) report.fileSize = Number(lines[next++]) || 0
+  if (user) report.user = pair(lines[next])
+  return report
+}
@@ -0,0 +1,326 @@
+import { randomBytes } from 'crypto'
+import { chmod, readFile, realpath, rename, rm, stat, writeFile } from 'fs/promises'
+import { basename, dirname, join } from 'path'
+
+/** Bytes compared per native call when looking for the changed region */
+const COMPARE_BLOCK = 4096
+
+const LF = 0x0a
+const CRLF = Buffer.from('\r\n')
+const LF_BUFFER = Buffer.from('\n')
+
+/**
+ * One exact-text replacement
+ */
+export interface TextEdit {
+  /** Text to find; must occur in the file */
+  oldText: string
+  /** Text to put in its place */
+  newText: string
+}
+
+export interface ApplyEditsOptions {
+  /** Compute the diff without writing the file (default: false) */
+  dryRun?: boolean
+}
+
+export interface ApplyEditsResult {
+  /** Unified diff of the change */
+  diff: string
+  /** Whether the edits changed the content (and, unless dryRun, the file) */
+  changed: boolean
+}
+
+/**
+ * Raised when an edit's oldText is not in the file; code 'ENOMATCH'
+ */
+export class EditNoMatchError extends Error {
+  readonly code = 'ENOMATCH'
+
+  constructor(readonly oldText: string) {
+    super(`Could not find exact match for edit:\n${oldText}`)
+    this.name = 'EditNoMatchError'
+  }
+}
+
+function normalizeLineEndings(text: string): string {
+  return text.replace(/\r\n/g, '\n')
+}
+
+/** LF-only copy of a buffer, or the buffer itself when it has no CRLF */
+function normalizeBuffer(content: Buffer): Buffer {
+  let index = content.indexOf(CRLF)
+  if (index === -1) return content
+
+  const parts: Buffer[] = []
+  let start = 0
+  while (index !== -1) {
+    parts.push(content.subarray(start, index), LF_BUFFER)
+    start = index + CRLF.length
+    index = content.indexOf(CRLF, start)
+  }
+  parts.push(content.subarray(start))
+  return Buffer.concat(parts)
+}
+
+/**
+ * First occurrence of `needle` in the concatenation of `pieces`
+ * Each piece is searched natively with Buffer.indexOf; only the few bytes
+ * around piece boundaries are copied to find matches that span pieces.
+ */
+function findInPieces(pieces: Buffer[], needle: Buffer): { piece: number; offset: number } | null {
+  for (let i = 0; i < pieces.length; i++) {
+    const piece = pieces[i]!
+    const index = piece.indexOf(needle)
+    if (index !== -1) return { piece: i, offset: index }
+    if (needle.length <= 1 || i + 1 === pieces.length) continue
+
+    // A match that starts in this piece's last needle.length - 1 bytes
+    const tailStart = Math.max(0, piece.length - needle.length + 1)
+    const window = [piece.subarray(tailStart)]
+    let following = 0
+    for (let j = i + 1; j < pieces.length && following < needle.length - 1; j++) {
+      const part = pieces[j]!.subarray(0, needle.length - 1 - following)
+      window.push(part)
+      following += part.length
+    }
+    const spanning = Buffer.concat(window).indexOf(needle)
+    if (spanning !== -1 && spanning < piece.length - tailStart) {
+      return { piece: i, offset: tailStart + spanning }
+    }
+  }
+  return null
+}
+
+/**
+ * Replace `length` bytes at a position with `replacement`, splitting pieces
+ * without copying them
+ */
+function replaceInPieces(pieces: Buffer[], at: { piece: number; offset: number }, length: number, replacement: Buffer): void {
+  let last = at.piece
+  let end = at.offset + length
+  while (end > pieces[last]!.length && last + 1 < pieces.length) {
+    end -= pieces[last]!.length
+    last++
+  }
+  const spliced = [pieces[at.piece]!.subarray(0, at.offset), replacement, pieces[last]!.subarray(end)]
+  pieces.splice(at.piece, last - at.piece + 1, ...spliced.filter(piece => piece.length > 0))
+}
+
+function commonPrefixLength(a: Buffer, b: Buffer): number {
+  const limit = Math.min(a.length, b.length)
+  let i = 0
+  while (i + COMPARE_BLOCK <= limit && a.compare(b, i, i + COMPARE_BLOCK, i, i + COMPARE_BLOCK) === 0) i += COMPARE_BLOCK
+  while (i < limit && a[i] === b[i]) i++
+  return i
+}
+
+function commonSuffixLength(a: Buffer, b: Buffer, limit: number): number {
+  let n = 0
+  while (n + COMPARE_BLOCK <= limit &&
+    a.compare(b, b.length - n - COMPARE_BLOCK, b.length - n, a.length - n - COMPARE_BLOCK, a.length - n) === 0) {
+    n += COMPARE_BLOCK
+  }
+  while (n < limit && a[a.length - n - 1] === b[b.length - n - 1]) n++
+  return n
+}
+
+function countLines(content: Buffer, end: number): number {
+  let lines = 0
+  let index = content.indexOf(LF)
+  while (index !== -1 && index < end) {
+    lines++
+    index = content.indexOf(LF, index + 1)
+  }
+  return lines
+}
+
+/**
+ * Create a simple unified diff between two strings
+ * This is a lightweight implementation - the official server uses the 'diff' library
+ * @param lineOffset - Lines before the compared text, added to hunk line numbers
+ */
+export function createUnifiedDiff(original: string, modified: string, filepath: string, lineOffset = 0): string {
+  const originalLines = original.split('\n')
+  const modifiedLines = modified.split('\n')
+
+  const lines: string[] = [
+    `--- ${filepath}`,
+    `+++ ${filepath}`,
+  ]
+
+  // Simple diff: show context around changes
+  let i = 0
+  let j = 0
+
+  while (i < originalLines.length || j < modifiedLines.length) {
+    // Skip matching lines
+    while (i < originalLines.length && j < modifiedLines.length && originalLines[i] === modifiedLines[j]) {
+      i++
+      j++
+    }
+
+    // If we're at the end, break
+    if (i >= originalLines.length && j >= modifiedLines.length) break
+
+    // Find extent of difference
+    const diffStartI = i
+    const diffStartJ = j
+
+    // Count removed lines (in original but changed)
+    let removedCount = 0
+    while (i < originalLines.length && (j >= modifiedLines.length || originalLines[i] !== modifiedLines[j])) {
+      // Check if this line appears later in modified
+      let found = false
+      for (let k = j; k < Math.min(j + 10, modifiedLines.length); k++) {
+        if (originalLines[i] === modifiedLines[k]) {
+          found = true
+          break
+        }
+      }
+      if (found) break
+      i++
+      removedCount++
+    }
+
+    // Count added lines (in modified but not original)
+    let addedCount = 0
+    const tempJ = j
+    while (j < modifiedLines.length && (diffStartI + removedCount >= originalLines.length || modifiedLines[j] !== originalLines[diffStartI + removedCount])) {
+      let found = false
+      for (let k = diffStartI + removedCount; k < Math.min(diffStartI + removedCount + 10, originalLines.length); k++) {
+        if (modifiedLines[j] === originalLines[k]) {
+          found = true
+          break
+        }
+      }
+      if (found) break
+      j++
+      addedCount++
+    }
+
+    if (removedCount > 0 || addedCount > 0) {
+      // Add hunk header
+      const origStart = lineOffset + diffStartI + 1
+      const modStart = lineOffset + diffStartJ + 1
+      lines.push(`@@ -${origStart},${removedCount} +${modStart},${addedCount} @@`)
+
+      // Add removed lines
+      for (let k = 0; k < removedCount; k++) {
+        lines.push(`-${originalLines[diffStartI + k]}`)
+      }
+
+      // Add added lines
+      for (let k = 0; k < addedCount; k++) {
+        lines.push(`+${modifiedLines[tempJ + k]}`)
+      }
+    }
+  }
+
+  return lines.join('\n')
+}
+
+/**
+ * Unified diff of two buffers, decoding and diffing only the lines between
+ * their common prefix and suffix
+ */
+function diffBuffers(original: Buffer, modified: Buffer, label: string): string {
+  const prefix = commonPrefixLength(original, modified)
+  const suffix = commonSuffixLength(original, modified, Math.min(original.length, modified.length) - prefix)
+
+  // Widen to whole lines
+  const start = prefix === 0 ? 0 : original.lastIndexOf(LF, prefix - 1) + 1
+  const lineEnd = original.indexOf(LF, original.length - suffix)
+  const originalEnd = lineEnd === -1 ? original.length : lineEnd
+  const modifiedEnd = modified.length - (original.length - originalEnd)
+
+  return createUnifiedDiff(
+    original.toString('utf8', start, originalEnd),
+    modified.toString('utf8', start, modifiedEnd),
+    label,
+    countLines(original, start)
+  )
+}
+
+/**
+ * Apply exact-text edits to file content
+ *
+ * Edits apply in order, each to the first occurrence of its oldText in the
+ * result of the previous ones, like successive String.replace calls. Line
+ * endings of the content and the edits are normalized to LF first. The
+ * content is kept as a list of slices, so an edit costs a native search
+ * and never copies the whole file; the result is assembled once.
+ *
+ * @param label - Path shown in the diff header
+ * @throws {EditNoMatchError} When an oldText does not occur
+ */
+export function applyEditsToContent(content: Buffer, edits: TextEdit[], label: string): ApplyEditsResult & { content: Buffer } {
+  const original = normalizeBuffer(content)
+  const pieces = original.length > 0 ? [original] : []
+
+  for (const edit of edits) {
+    const oldText = Buffer.from(normalizeLineEndings(edit.oldText))
+    const at = oldText.length === 0 ? { piece: 0, offset: 0 } : findInPieces(pieces, oldText)
+    if (!at) throw new EditNoMatchError(edit.oldText)
+    const newText = Buffer.from(normalizeLineEndings(edit.newText))
+    if (pieces.length === 0) {
+      if (newText.length > 0) pieces.push(newText)
+    } else {
+      replaceInPieces(pieces, at, oldText.length, newText)
+    }
+  }
+
+  const modified = Buffer.concat(pieces)
+  const changed = !modified.equals(original)
+  const diff = changed ? diffBuffers(original, modified, label) : createUnifiedDiff('', '', label)
+  return { content: modified, diff, changed }
+}
+
+/**
+ * Replace a file's content atomically: write a hidden sibling with the
+ * file's mode, then rename it over the file
+ * Readers see the old or the new content, never a partial write. Symlinks
+ * are followed, so the link stays a link; hard links to the old content
+ * keep it.
+ */
+export async function writeFileAtomic(path: string, content: Buffer): Promise<void> {
+  const target = await realpath(path)
+  const mode = (await stat(target)).mode & 0o7777
+  const temp = join(dirname(target), `.${basename(target)}.edit-${randomBytes(6).toString('hex')}`)
+  try {
+    await writeFile(temp, content, { flag: 'wx', mode })
+    // writeFile's mode is subject to the umask
+    await chmod(temp, mode)
+    await rename(temp, target)
+  } catch (error) {
+    await rm(temp, { force: true }).catch(() => {})
+    throw error
+  }
+}
+
+/**
+ * Read a file, apply edits and write it back atomically unless nothing
+ * changed or `dryRun` is set
+ * @param path - Absolute path of the file
+ * @param label - Path shown in the diff header
+ * @throws {EditNoMatchError} When an oldText does not occur; the file is left as it was
+ */
+export async function applyEditsToFile(path: string, edits: TextEdit[], options: ApplyEditsOptions, label: string): Promise<ApplyEditsResult> {
+  const { content, diff, changed } = applyEditsToContent(await readFile(path), edits, label)
+  if (changed && !options.dryRun) {
+    await writeFileAtomic(path, content)
+  }
+  return { diff, changed }
+}
+
+/**
+ * Most bytes a set of edits can add to a file, for quota checks before
+ * the file is read (line ending normalization only ever shrinks it)
+ */
+export function editGrowth(edits: TextEdit[]): number {
+  let growth = 0
+  for (const edit of edits) {
+    growth += Math.max(0, Buffer.byteLength(edit.newText) - Buffer.byteLength(edit.oldText))
+  }
+  return growth
+}
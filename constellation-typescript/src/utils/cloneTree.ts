@@ -0,0 +1,105 @@
+import { randomBytes } from 'crypto'
+import { constants } from 'fs'
+import { chmod, copyFile, lstat, mkdir, readdir, readlink, rename, rm, stat, symlink, utimes } from 'fs/promises'
+import { basename, dirname, join } from 'path'
+import { runTasks, shellQuote } from './search.js'
+import { SEARCH_INDEX_DIRECTORY } from './TrigramIndex.js'
+
+type CloneTask =
+  | { kind: 'dir'; path: string }
+  | { kind: 'file'; path: string }
+  | { kind: 'symlink'; path: string }
+
+/** Hidden sibling of `target` that a clone is assembled in */
+function stagingPath(target: string): string {
+  return join(dirname(target), `.${basename(target)}.clone-${randomBytes(6).toString('hex')}`)
+}
+
+function errnoError(message: string, code: string): Error {
+  return Object.assign(new Error(`${code}: ${message}`), { code })
+}
+
+/**
+ * Copy a directory tree so the copy shares unchanged blocks with the source
+ * where the filesystem allows it
+ *
+ * Files are copied with COPYFILE_FICLONE: a reflink (copy-on-write) clone on
+ * btrfs, XFS and other filesystems that support it, and a regular copy
+ * elsewhere. Modes and file mtimes are kept, so tools that compare stats
+ * (git's index, package manager caches) see unchanged files. Symlinks are
+ * copied as links; sockets, FIFOs and devices are skipped, and so is the
+ * source's search index, which the copy rebuilds for itself.
+ *
+ * The tree is built in a hidden sibling directory and renamed into place, so
+ * `target` appears complete or not at all.
+ *
+ * @param source - Absolute directory to copy
+ * @param target - Absolute path of the copy; must not exist
+ * @throws ENOENT / ENOTDIR when `source` is not a directory, EEXIST when `target` exists
+ */
+export async function cloneTree(source: string, target: string): Promise<void> {
+  if (!(await stat(source)).isDirectory()) {
+    throw errnoError(`not a directory, clone '${source}'`, 'ENOTDIR')
+  }
+  const existing = await lstat(target).catch(() => null)
+  if (existing) {
+    throw errnoError(`file already exists, clone '${target}'`, 'EEXIST')
+  }
+
+  const staging = stagingPath(target)
+  const directories: Array<{ path: string; mode: number }> = []
+
+  try {
+    await runTasks<CloneTask>([{ kind: 'dir', path: '' }], async (task, queue) => {
+      const from = join(source, task.path)
+      const to = join(staging, task.path)
+
+      if (task.kind === 'file') {
+        await copyFile(from, to, constants.COPYFILE_FICLONE)
+        const info = await stat(from)
+        await utimes(to, info.atime, info.mtime)
+        return
+      }
+      if (task.kind === 'symlink') {
+        await symlink(await readlink(from), to)
+        return
+      }
+
+      const info = await stat(from)
+      // Writable while filling it; the real mode is applied at the end
+      await mkdir(to, { mode: 0o700 })
+      directories.push({ path: to, mode: info.mode & 0o7777 })
+
+      for (const entry of await readdir(from, { withFileTypes: true })) {
+        if (!task.path && entry.name === SEARCH_INDEX_DIRECTORY) continue
+        const path = task.path ? join(task.path, entry.name) : entry.name
+        if (entry.isDirectory()) queue({ kind: 'dir', path })
+        else if (entry.isFile()) queue({ kind: 'file', path })
+        else if (entry.isSymbolicLink()) queue({ kind: 'symlink', path })
+      }
+    })
+
+    // Deepest first, so read-only directories are only locked once filled
+    for (const directory of directories.reverse()) {
+      await chmod(directory.path, directory.mode)
+    }
+    await rename(staging, target)
+  } catch (error) {
+    await rm(staging, { recursive: true, force: true }).catch(() => {})
+    throw error
+  }
+}
+
+/**
+ * Shell command approximating cloneTree, for hosts without the agent
+ * GNU cp's `--reflink=auto` clones blocks where supported. Exit status 3
+ * means the source is not a directory, 4 that the target already exists.
+ */
+export function cloneCommand(source: string, target: string): string {
+  const staging = shellQuote(stagingPath(target))
+  const from = shellQuote(source)
+  const to = shellQuote(target)
+  return `test -d ${from} || exit 3; test ! -e ${to} || exit 4; ` +
+    `cp -a --reflink=auto ${from} ${staging} && rm -rf ${staging}/${SEARCH_INDEX_DIRECTORY} && mv -T ${staging} ${to} ` +
+    `|| { rm -rf ${staging}; exit 1; }`
+}
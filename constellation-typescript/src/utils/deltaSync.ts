@@ -0,0 +1,160 @@
+import { createHash } from 'crypto'
+
+/** Smallest chunk, except at the end of the content */
+export const DELTA_MIN_CHUNK = 2 * 1024
+
+/** Chunk size the cut points aim for */
+export const DELTA_AVERAGE_CHUNK = 8 * 1024
+
+/** Largest chunk; a cut is forced here */
+export const DELTA_MAX_CHUNK = 64 * 1024
+
+/** Default smallest file written by delta instead of a full upload */
+export const DEFAULT_DELTA_SYNC_MIN_BYTES = 64 * 1024
+
+/**
+ * Cut masks for normalized chunking: harder to hit before the average size,
+ * easier after it, which narrows the spread of chunk sizes around it. The
+ * masks test high bits, which depend on the last 32 bytes; low bits of a
+ * shifted hash only depend on the last few.
+ */
+const MASK_SMALL = 0xfffe0000
+const MASK_LARGE = 0xffe00000
+
+/**
+ * Gear table: one pseudo-random 32-bit value per byte value
+ * Generated from a fixed seed (mulberry32), so the client and the agent
+ * cut the same content at the same places.
+ */
+const GEAR = (() => {
+  const table = new Uint32Array(256)
+  let seed = 0x9e3779b9
+  for (let i = 0; i < 256; i++) {
+    seed = (seed + 0x6d2b79f5) >>> 0
+    let value = Math.imul(seed ^ (seed >>> 15), seed | 1)
+    value ^= value + Math.imul(value ^ (value >>> 7), value | 61)
+    table[i] = (value ^ (value >>> 14)) >>> 0
+  }
+  return table
+})()
+
+/**
+ * One content-defined chunk
+ */
+export interface ContentChunk {
+  offset: number
+  length: number
+  /** Truncated SHA-256 of the chunk bytes */
+  hash: string
+}
+
+/**
+ * Hashes describing a file's content, enough to plan a delta against it
+ */
+export interface DeltaManifest {
+  /** SHA-256 of the whole content */
+  hash: string
+  /** Chunk hashes in content order */
+  chunks: string[]
+}
+
+/**
+ * One chunk of the new content in a delta write: either bytes sent in the
+ * request body (`data`) or a chunk with this hash in the current file
+ */
+export interface DeltaChunk {
+  hash: string
+  length: number
+  data?: boolean
+}
+
+export function contentHash(content: Buffer): string {
+  return createHash('sha256').update(content).digest('hex')
+}
+
+function chunkHash(chunk: Buffer): string {
+  return createHash('sha256').update(chunk).digest('hex').slice(0, 32)
+}
+
+/** Length of the chunk starting at `start` (FastCDC cut point search) */
+function cutPoint(content: Buffer, start: number): number {
+  const remaining = content.length - start
+  if (remaining <= DELTA_MIN_CHUNK) return remaining
+
+  const end = start + Math.min(remaining, DELTA_MAX_CHUNK)
+  const normal = start + Math.min(remaining, DELTA_AVERAGE_CHUNK)
+  let hash = 0
+  let i = start + DELTA_MIN_CHUNK
+  for (; i < normal; i++) {
+    hash = ((hash << 1) + GEAR[content[i]!]!) >>> 0
+    if ((hash & MASK_SMALL) === 0) return i + 1 - start
+  }
+  for (; i < end; i++) {
+    hash = ((hash << 1) + GEAR[content[i]!]!) >>> 0
+    if ((hash & MASK_LARGE) === 0) return i + 1 - start
+  }
+  return end - start
+}
+
+/**
+ * Split content into content-defined chunks (FastCDC with a gear hash)
+ * Cut points depend on the bytes around them, not on offsets, so an insert
+ * or delete changes only the chunks it touches and the rest hash the same.
+ */
+export function chunkContent(content: Buffer): ContentChunk[] {
+  const chunks: ContentChunk[] = []
+  let offset = 0
+  while (offset < content.length) {
+    const length = cutPoint(content, offset)
+    chunks.push({ offset, length, hash: chunkHash(content.subarray(offset, offset + length)) })
+    offset += length
+  }
+  return chunks
+}
+
+export function buildManifest(content: Buffer, chunks = chunkContent(content)): DeltaManifest {
+  return { hash: contentHash(content), chunks: chunks.map(chunk => chunk.hash) }
+}
+
+/**
+ * Describe `content` as chunks of a file with the `base` manifest plus the
+ * bytes of the chunks it lacks
+ * @returns The chunk list and the body holding the missing chunks in order
+ */
+export function planDelta(content: Buffer, chunks: ContentChunk[], base: DeltaManifest): { chunks: DeltaChunk[]; body: Buffer } {
+  const available = new Set(base.chunks)
+  const literals: Buffer[] = []
+  const plan = chunks.map(({ offset, length, hash }): DeltaChunk => {
+    if (available.has(hash)) return { hash, length }
+    literals.push(content.subarray(offset, offset + length))
+    return { hash, length, data: true }
+  })
+  return { chunks: plan, body: Buffer.concat(literals) }
+}
+
+/**
+ * Rebuild content from a delta against the current file
+ * @throws {Error} code 'ESTALE' when a referenced chunk is not in `base` or
+ * the body does not match the chunk list
+ */
+export function assembleDelta(base: Buffer, chunks: DeltaChunk[], body: Buffer): Buffer {
+  const baseChunks = new Map<string, Buffer>()
+  for (const { offset, length, hash } of chunkContent(base)) {
+    baseChunks.set(hash, base.subarray(offset, offset + length))
+  }
+
+  const parts: Buffer[] = []
+  let bodyOffset = 0
+  for (const { hash, length, data } of chunks) {
+    const part = data ? body.subarray(bodyOffset, bodyOffset + length) : baseChunks.get(hash)
+    if (data) bodyOffset += length
+    if (!part || part.length !== length) {
+      throw Object.assign(new Error(`Delta chunk ${hash} is not available`), { code: 'ESTALE' })
+    }
+    parts.push(part)
+  }
+  if (bodyOffset !== body.length) {
+    throw Object.assign(new Error('Delta body does not match its chunk list'), { code: 'ESTALE' })
+  }
+  return Buffer.concat(parts)
+}
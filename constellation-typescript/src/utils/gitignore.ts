@@ -0,0 +1,70 @@
+import { Minimatch } from 'minimatch'
+
+interface IgnoreRule {
+  matcher: Minimatch
+  negate: boolean
+  dirOnly: boolean
+}
+
+/**
+ * Rules from one .gitignore file
+ * Follows gitignore(5): `#` comments, `!` negation, trailing `/` for
+ * directories only, and patterns containing a `/` anchored to the file's
+ * directory while the others match at any depth below it.
+ */
+export class IgnoreFile {
+  private readonly rules: IgnoreRule[] = []
+
+  /**
+   * @param content - Text of the .gitignore file
+   * @param base - '/'-separated directory of the file, relative to the walk root ('' for the root)
+   */
+  constructor(content: string, readonly base: string) {
+    for (const rawLine of content.split(/\r?\n/)) {
+      // Trailing spaces are ignored unless escaped
+      let line = rawLine.replace(/(?<!\\)\s+$/, '')
+      if (!line || line.startsWith('#')) continue
+
+      const negate = line.startsWith('!')
+      if (negate) line = line.slice(1)
+      if (line.startsWith('\\#') || line.startsWith('\\!')) line = line.slice(1)
+
+      const dirOnly = line.endsWith('/')
+      if (dirOnly) line = line.slice(0, -1)
+      if (!line) continue
+
+      const anchored = line.includes('/')
+      const pattern = anchored ? line.replace(/^\//, '') : `**/${line}`
+      this.rules.push({ matcher: new Minimatch(pattern, { dot: true }), negate, dirOnly })
+    }
+  }
+
+  /**
+   * Whether this file decides about `path`
+   * @returns true (ignored), false (re-included by a negation) or undefined (no rule matched)
+   */
+  test(path: string, isDirectory: boolean): boolean | undefined {
+    if (this.base && !path.startsWith(`${this.base}/`)) return undefined
+    const relative = this.base ? path.slice(this.base.length + 1) : path
+
+    let verdict: boolean | undefined
+    for (const rule of this.rules) {
+      if (rule.dirOnly && !isDirectory) continue
+      if (rule.matcher.match(relative)) verdict = !rule.negate
+    }
+    return verdict
+  }
+}
+
+/**
+ * Whether `path` is ignored by the .gitignore files that apply to it
+ * @param files - Applicable files, outermost first; later files take precedence
+ * @param path - '/'-separated path relative to the walk root
+ */
+export function isIgnored(files: readonly IgnoreFile[], path: string, isDirectory: boolean): boolean {
+  for (let i = files.length - 1; i >= 0; i--) {
+    const verdict = files[i]!.test(path, isDirectory)
+    if (verdict !== undefined) return verdict
+  }
+  return false
+}
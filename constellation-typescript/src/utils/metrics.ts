@@ -0,0 +1,256 @@
+/**
+ * Latency histograms and counters for the hot paths of backends, workspaces and the pool
+ *
+ * Disabled by default: every recording call then returns after one boolean
+ * check, and startTimer() doesn't read the clock. Enable with
+ * setMetricsEnabled(true) or CONSTELLATION_METRICS=true.
+ */
+
+/** Label values of one series, e.g. { op: 'stat' } */
+export type MetricLabels = Readonly<Record<string, string>>
+
+/** Sub-buckets per power of two; 128 keeps every bucket within 1% of its values */
+const SUB_BUCKET_BITS = 7
+const SUB_BUCKETS = 1 << SUB_BUCKET_BITS
+
+/** Largest recordable value in microseconds (~35 minutes); larger values are clamped */
+const MAX_MICROS = 2 ** 31 - 1
+
+const BUCKET_COUNT = bucketIndex(MAX_MICROS) + 1
+
+/** Quantiles reported in snapshots and on the Prometheus endpoint */
+export const METRIC_QUANTILES = [0.5, 0.9, 0.99, 0.999] as const
+
+/**
+ * Log-linear bucket of a value, as in HdrHistogram: exact below 128, then
+ * 64 buckets per power of two
+ */
+function bucketIndex(micros: number): number {
+  if (micros < SUB_BUCKETS) return micros
+  const shift = 31 - Math.clz32(micros) - SUB_BUCKET_BITS + 1
+  return (shift << (SUB_BUCKET_BITS - 1)) + (micros >>> shift)
+}
+
+/** Middle of the values a bucket holds */
+function bucketValue(index: number): number {
+  if (index < SUB_BUCKETS) return index
+  const shift = (index >> (SUB_BUCKET_BITS - 1)) - 1
+  const base = index - (shift << (SUB_BUCKET_BITS - 1))
+  return (base << shift) + ((1 << shift) - 1) / 2
+}
+
+/**
+ * Summary of one histogram series; durations in milliseconds
+ */
+export interface HistogramSnapshot {
+  name: string
+  labels: MetricLabels
+  count: number
+  sumMs: number
+  minMs: number
+  maxMs: number
+  /** Quantile → value, for each of METRIC_QUANTILES */
+  quantilesMs: Record<string, number>
+}
+
+/**
+ * One counter series
+ */
+export interface CounterSnapshot {
+  name: string
+  labels: MetricLabels
+  value: number
+}
+
+/**
+ * Every series recorded since metrics were enabled or last reset
+ */
+export interface MetricsSnapshot {
+  enabled: boolean
+  histograms: HistogramSnapshot[]
+  counters: CounterSnapshot[]
+}
+
+/**
+ * Duration histogram with microsecond resolution and bounded relative error
+ * Fixed memory (~7 KiB) however many values are recorded.
+ */
+export class Histogram {
+  private readonly counts = new Uint32Array(BUCKET_COUNT)
+  private count = 0
+  private sumMicros = 0
+  private minMicros = Infinity
+  private maxMicros = 0
+
+  constructor(readonly name: string, readonly labels: MetricLabels = {}) {}
+
+  /** Record a duration in milliseconds */
+  record(durationMs: number): void {
+    const micros = Math.min(MAX_MICROS, Math.max(0, Math.round(durationMs * 1000)))
+    this.counts[bucketIndex(micros)]!++
+    this.count++
+    this.sumMicros += micros
+    if (micros < this.minMicros) this.minMicros = micros
+    if (micros > this.maxMicros) this.maxMicros = micros
+  }
+
+  /**
+   * Value at or below which `quantile` of the recorded values fall, in milliseconds
+   */
+  quantile(quantile: number): number {
+    if (this.count === 0) return 0
+    const rank = Math.max(1, Math.ceil(quantile * this.count))
+    let seen = 0
+    for (let index = 0; index < BUCKET_COUNT; index++) {
+      seen += this.counts[index]!
+      if (seen >= rank) {
+        // The extremes are known exactly; keep estimates within them
+        return Math.min(this.maxMicros, Math.max(this.minMicros, bucketValue(index))) / 1000
+      }
+    }
+    return this.maxMicros / 1000
+  }
+
+  snapshot(): HistogramSnapshot {
+    const quantilesMs: Record<string, number> = {}
+    for (const quantile of METRIC_QUANTILES) {
+      quantilesMs[String(quantile)] = this.quantile(quantile)
+    }
+    return {
+      name: this.name,
+      labels: this.labels,
+      count: this.count,
+      sumMs: this.sumMicros / 1000,
+      minMs: this.count === 0 ? 0 : this.minMicros / 1000,
+      maxMs: this.maxMicros / 1000,
+      quantilesMs,
+    }
+  }
+}
+
+let enabled = process.env.CONSTELLATION_METRICS === 'true'
+const histograms = new Map<string, Histogram>()
+const counters = new Map<string, CounterSnapshot>()
+
+function seriesKey(name: string, labels?: MetricLabels): string {
+  if (!labels) return name
+  let key = name
+  for (const label in labels) key += `\0${label}=${labels[label]}`
+  return key
+}
+
+/**
+ * Turn recording on or off; series recorded so far are kept
+ */
+export function setMetricsEnabled(value: boolean): void {
+  enabled = value
+}
+
+export function isMetricsEnabled(): boolean {
+  return enabled
+}
+
+/**
+ * Start timing an operation
+ * @returns Start time for recordDuration(), or 0 when metrics are disabled
+ */
+export function startTimer(): number {
+  return enabled ? performance.now() : 0
+}
+
+/**
+ * Record the time since startTimer() in a histogram
+ * No-op for timers started while metrics were disabled.
+ */
+export function recordDuration(name: string, start: number, labels?: MetricLabels): void {
+  if (!enabled || start === 0) return
+  observe(name, performance.now() - start, labels)
+}
+
+/**
+ * Record a duration in milliseconds in a histogram
+ */
+export function observe(name: string, durationMs: number, labels?: MetricLabels): void {
+  if (!enabled) return
+  const key = seriesKey(name, labels)
+  let histogram = histograms.get(key)
+  if (!histogram) {
+    histogram = new Histogram(name, labels)
+    histograms.set(key, histogram)
+  }
+  histogram.record(durationMs)
+}
+
+/**
+ * Add to a counter
+ */
+export function incrementCounter(name: string, labels?: MetricLabels, by = 1): void {
+  if (!enabled) return
+  const key = seriesKey(name, labels)
+  const counter = counters.get(key)
+  if (counter) {
+    counter.value += by
+  } else {
+    counters.set(key, { name, labels: labels ?? {}, value: by })
+  }
+}
+
+/**
+ * Current value of every series
+ */
+export function getMetrics(): MetricsSnapshot {
+  return {
+    enabled,
+    histograms: [...histograms.values()].map(histogram => histogram.snapshot()),
+    counters: [...counters.values()].map(counter => ({ ...counter })),
+  }
+}
+
+/**
+ * Drop every recorded series
+ */
+export function resetMetrics(): void {
+  histograms.clear()
+  counters.clear()
+}
+
+function formatLabels(labels: MetricLabels, extra?: MetricLabels): string {
+  const pairs = Object.entries({ ...labels, ...extra })
+    .map(([label, value]) => `${label}="${value.replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n')}"`)
+  return pairs.length > 0 ? `{${pairs.join(',')}}` : ''
+}
+
+/**
+ * Render a snapshot in the Prometheus text exposition format
+ * Histograms become summaries in seconds (`<name>_seconds`), counters `<name>_total`.
+ */
+export function formatPrometheusMetrics(snapshot: MetricsSnapshot = getMetrics()): string {
+  const lines: string[] = []
+  const typed = new Set<string>()
+  // Series of one metric have to be adjacent
+  const byName = <T extends { name: string }>(series: T[]) => [...series].sort((a, b) => a.name.localeCompare(b.name))
+
+  for (const histogram of byName(snapshot.histograms)) {
+    const name = `${histogram.name}_seconds`
+    if (!typed.has(name)) {
+      typed.add(name)
+      lines.push(`# TYPE ${name} summary`)
+    }
+    for (const [quantile, valueMs] of Object.entries(histogram.quantilesMs)) {
+      lines.push(`${name}${formatLabels(histogram.labels, { quantile })} ${valueMs / 1000}`)
+    }
+    lines.push(`${name}_sum${formatLabels(histogram.labels)} ${histogram.sumMs / 1000}`)
+    lines.push(`${name}_count${formatLabels(histogram.labels)} ${histogram.count}`)
+  }
+
+  for (const counter of byName(snapshot.counters)) {
+    const name = `${counter.name}_total`
+    if (!typed.has(name)) {
+      typed.add(name)
+      lines.push(`# TYPE ${name} counter`)
+    }
+    lines.push(`${name}${formatLabels(counter.labels)} ${counter.value}`)
+  }
+
+  return lines.length > 0 ? `${lines.join('\n')}\n` : ''
+}
@@ -59,7 +59,7 @@ export function detectPlatformCapabilities(): PlatformCapabilities {
     if (nativeLibPath) {
       capabilities.nativeLibraryAvailable = true
       capabilities.nativeLibraryPath = nativeLibPath
-      capabilities.notes.push('LD_PRELOAD intercept library available for enhanced performance')
+      capabilities.notes.push('LD_PRELOAD intercept library available for in-process path confinement')
     } else {
       capabilities.notes.push('LD_PRELOAD requested but native library not found')
       capabilities.notes.push('Run: npm run build:native')
@@ -122,11 +122,28 @@ export function validateNativeLibrary(libraryPath: string): boolean {
   return true
 }
 
+/**
+ * Environment variable read by libintercept.so to find the workspace root
+ */
+export const INTERCEPT_ROOT_ENV = 'CONSTELLATION_WORKSPACE_ROOT'
+
+/**
+ * Build the environment that activates the intercept library for a workspace
+ * @param libraryPath - Path to libintercept.so on the machine running the command
+ * @param workspacePath - Absolute workspace path the command is confined to
+ */
+export function buildInterceptEnv(libraryPath: string, workspacePath: string): Record<string, string> {
+  return {
+    LD_PRELOAD: libraryPath,
+    [INTERCEPT_ROOT_ENV]: workspacePath,
+  }
+}
+
 /**
  * Gets the appropriate LD_PRELOAD library path if enabled and available
  * @returns Library path if LD_PRELOAD is enabled and available, null otherwise
  */
-export function getRemoteBackendLibrary(): string | null {
+export function getInterceptLibrary(): string | null {
   const capabilities = detectPlatformCapabilities()
   
   // LD_PRELOAD is now optional - only use if explicitly enabled
@@ -146,10 +163,15 @@ export function getRemoteBackendLibrary(): string | null {
     return null
   }
   
-  logger.info('Using LD_PRELOAD intercept library for enhanced performance')
+  logger.info('Using LD_PRELOAD intercept library for in-process path confinement')
   return libraryPath
 }
 
+/**
+ * @deprecated Use getInterceptLibrary() - the library is used by both backends
+ */
+export const getRemoteBackendLibrary = getInterceptLibrary
+
 /**
  * Provides user-friendly error messages and guidance for platform limitations
  */
@@ -174,7 +196,7 @@ export function getPlatformGuidance(requestedBackend: 'local' | 'remote'): {
     // Add suggestions about optional LD_PRELOAD enhancement
     if (process.platform === 'linux' && !capabilities.nativeLibraryAvailable) {
       suggestions.push('Optional: Enable LD_PRELOAD for enhanced performance:')
-      suggestions.push('  1. Build native library: npm run build:native')
+      suggestions.push('  1. Build native library: npm run build:native (or: npx constellationfs build-native)')
       suggestions.push('  2. Set environment: USE_LD_PRELOAD=true')
     } else if (process.platform !== 'linux' && process.env.USE_LD_PRELOAD === 'true') {
       suggestions.push('Note: LD_PRELOAD is only available on Linux platforms')
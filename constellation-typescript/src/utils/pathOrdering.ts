@@ -0,0 +1,27 @@
+/**
+ * Run tasks concurrently, except that tasks sharing a key run one after
+ * another in submission order. Used by batch operations so that a write
+ * followed by a read of the same file observes the write, while unrelated
+ * paths are still pipelined.
+ *
+ * @param items - Items to process
+ * @param keyOf - Ordering key for an item (usually its resolved path)
+ * @param run - Task to run for each item
+ * @returns Settled results in the same order as `items`
+ */
+export function runInKeyOrder<T, R>(
+  items: readonly T[],
+  keyOf: (item: T) => string,
+  run: (item: T, index: number) => Promise<R>
+): Promise<PromiseSettledResult<R>[]> {
+  const tails = new Map<string, Promise<unknown>>()
+
+  return Promise.allSettled(items.map((item, index) => {
+    const key = keyOf(item)
+    const previous = tails.get(key) ?? Promise.resolve()
+    // Chain on settlement, not success, so one failure doesn't cancel later tasks
+    const task = previous.then(() => run(item, index))
+    tails.set(key, task.catch(() => undefined))
+    return task
+  }))
+}
@@ -0,0 +1,555 @@
+import type { Dirent } from 'fs'
+import { open, readdir, readFile, stat } from 'fs/promises'
+import { join } from 'path'
+import { Minimatch } from 'minimatch'
+import { IgnoreFile, isIgnored } from './gitignore.js'
+
+/** Default number of matches returned by a search */
+export const DEFAULT_SEARCH_MAX_RESULTS = 1_000
+
+/** Default size above which files are not searched */
+export const DEFAULT_SEARCH_MAX_FILE_SIZE = 10 * 1024 * 1024
+
+/** Directories and files read at the same time (the I/O runs on libuv's thread pool) */
+const SEARCH_CONCURRENCY = 16
+
+/** Files with a NUL byte in this prefix are treated as binary and skipped */
+const BINARY_SNIFF_BYTES = 8_192
+
+/** Longer matching lines are cut to this many characters */
+const MAX_MATCH_TEXT_LENGTH = 500
+
+/**
+ * Options for a content search
+ */
+export interface SearchOptions {
+  /** Regular expression (JavaScript syntax), or plain text with `literal` */
+  pattern: string
+  /** Directory to search, relative to the workspace (default: the workspace root) */
+  path?: string
+  /**
+   * Only search files matching these globs, relative to the search directory.
+   * Globs without a '/' match the file name at any depth, e.g. '*.ts'.
+   */
+  glob?: string | string[]
+  /** Treat the pattern as plain text (default: false) */
+  literal?: boolean
+  /** Case-insensitive matching (default: false) */
+  ignoreCase?: boolean
+  /** Stop after this many matches (default: 1000) */
+  maxResults?: number
+  /** Skip files larger than this many bytes (default: 10 MiB) */
+  maxFileSize?: number
+  /** Search dotfiles and dot-directories (default: false; .git is always skipped) */
+  hidden?: boolean
+  /** Skip paths ignored by .gitignore files (default: true) */
+  gitignore?: boolean
+}
+
+/**
+ * One matching line
+ */
+export interface SearchMatch {
+  /** '/'-separated path relative to the workspace root */
+  path: string
+  /** 1-based line number */
+  line: number
+  /** 1-based column of the first match on the line */
+  column: number
+  /** The matching line, cut to 500 characters */
+  text: string
+}
+
+/**
+ * Result of a content search
+ */
+export interface SearchResult {
+  /** Matches sorted by path, then line */
+  matches: SearchMatch[]
+  /** Whether the search stopped at maxResults */
+  truncated: boolean
+  /** Number of text files that were searched */
+  filesSearched: number
+}
+
+/**
+ * Thrown for patterns that are not valid regular expressions
+ */
+export class SearchPatternError extends Error {
+  readonly code = 'EINVAL'
+
+  constructor(message: string) {
+    super(message)
+    this.name = 'SearchPatternError'
+  }
+}
+
+/** Regex metacharacters; anything else stands for itself */
+const REGEX_SYNTAX = new Set(['.', '[', ']', '(', ')', '{', '}', '*', '+', '?', '^', '$', '|', '\\'])
+
+/** Escapes that stand for one literal character */
+const LITERAL_ESCAPES = /[^\w\s]/
+
+/**
+ * Longest run of text every match of `source` must contain, used to skip
+ * files with Buffer.indexOf before decoding them
+ * Conservative: gives up on top-level alternation, and treats groups,
+ * classes and escapes like \w as breaks in the run.
+ */
+export function requiredLiteral(source: string): string | null {
+  let best = ''
+  let run = ''
+  let depth = 0
+  const endRun = () => {
+    if (run.length > best.length) best = run
+    run = ''
+  }
+
+  for (let i = 0; i < source.length; i++) {
+    const char = source[i]!
+    let literal: string | null = null
+
+    if (char === '\\') {
+      const next = source[i + 1]
+      i++
+      if (next !== undefined && LITERAL_ESCAPES.test(next)) literal = next
+    } else if (char === '[') {
+      // Skip the class, including an escaped or leading ']'
+      i++
+      if (source[i] === '^') i++
+      if (source[i] === ']') i++
+      while (i < source.length && source[i] !== ']') {
+        if (source[i] === '\\') i++
+        i++
+      }
+    } else if (char === '{') {
+      // Quantifier bounds such as {2,3} are not text
+      const close = source.indexOf('}', i)
+      if (close !== -1) i = close
+    } else if (char === '(') {
+      depth++
+    } else if (char === ')') {
+      depth--
+    } else if (char === '|') {
+      if (depth === 0) return null
+    } else if (!REGEX_SYNTAX.has(char) && depth === 0) {
+      literal = char
+    }
+
+    if (literal === null) {
+      endRun()
+      continue
+    }
+
+    // A quantifier that allows zero repetitions makes the character optional
+    const quantifier = source[i + 1]
+    if (quantifier === '?' || quantifier === '*' || quantifier === '{') {
+      endRun()
+    } else if (quantifier === '+') {
+      run += literal
+      endRun()
+    } else {
+      run += literal
+    }
+  }
+  endRun()
+
+  return best.length > 0 ? best : null
+}
+
+function escapeRegex(text: string): string {
+  return text.replace(/[.*+?^${}()|[\]\\]/g, '\\$&')
+}
+
+/** Which entries a walk visits */
+export interface WalkFilter {
+  /** Visit dotfiles and dot-directories (default: false; .git is always skipped) */
+  hidden?: boolean
+  /** Skip paths ignored by .gitignore files (default: true) */
+  gitignore?: boolean
+  /** Only visit files matching these globs (see SearchOptions.glob) */
+  glob?: string | string[]
+}
+
+interface CompiledFilter {
+  globs: Minimatch[]
+  hidden: boolean
+  gitignore: boolean
+}
+
+interface CompiledSearch extends CompiledFilter {
+  /** Global, multiline: `^` and `$` apply per line */
+  regex: RegExp
+  /** Non-global, for checking a single line */
+  lineRegex: RegExp
+  prefilter: Buffer | null
+  maxResults: number
+  maxFileSize: number
+}
+
+function compileFilter(filter: WalkFilter): CompiledFilter {
+  return {
+    globs: globList(filter).map(glob => new Minimatch(glob, { dot: true, matchBase: !glob.includes('/') })),
+    hidden: filter.hidden ?? false,
+    gitignore: filter.gitignore ?? true,
+  }
+}
+
+function compileSearch(options: SearchOptions): CompiledSearch {
+  if (typeof options.pattern !== 'string' || options.pattern === '') {
+    throw new SearchPatternError('Search pattern cannot be empty')
+  }
+
+  const source = options.literal ? escapeRegex(options.pattern) : options.pattern
+  const flags = options.ignoreCase ? 'i' : ''
+  let regex: RegExp
+  let lineRegex: RegExp
+  try {
+    regex = new RegExp(source, `${flags}gm`)
+    lineRegex = new RegExp(source, flags)
+  } catch (error) {
+    throw new SearchPatternError(`Invalid search pattern: ${error instanceof Error ? error.message : String(error)}`)
+  }
+
+  // Byte search only works when case matters
+  const literal = options.ignoreCase ? null : options.literal ? options.pattern : requiredLiteral(source)
+
+  return {
+    ...compileFilter(options),
+    regex,
+    lineRegex,
+    prefilter: literal ? Buffer.from(literal) : null,
+    maxResults: options.maxResults ?? DEFAULT_SEARCH_MAX_RESULTS,
+    maxFileSize: options.maxFileSize ?? DEFAULT_SEARCH_MAX_FILE_SIZE,
+  }
+}
+
+type WalkTask =
+  | { kind: 'dir'; path: string; ignores: IgnoreFile[] }
+  | { kind: 'file'; path: string }
+
+/**
+ * Run tasks with at most SEARCH_CONCURRENCY in flight; a task can queue more
+ * Last in, first out, so walks go depth first and the queue stays small.
+ */
+export function runTasks<T>(
+  initial: T[],
+  run: (task: T, queue: (task: T) => void) => Promise<void>,
+  stopped: () => boolean = () => false
+): Promise<void> {
+  const pending = [...initial]
+  const queue = (task: T) => {
+    pending.push(task)
+  }
+  let active = 0
+
+  return new Promise<void>((resolve, reject) => {
+    let failed = false
+    const pump = () => {
+      if (failed) return
+      while (active < SEARCH_CONCURRENCY && pending.length > 0 && !stopped()) {
+        active++
+        run(pending.pop()!, queue).then(() => {
+          active--
+          pump()
+        }, (error: unknown) => {
+          failed = true
+          reject(error)
+        })
+      }
+      if (active === 0 && (pending.length === 0 || stopped())) resolve()
+    }
+    pump()
+  })
+}
+
+/**
+ * Read one directory of a walk and queue its subdirectories and wanted files
+ */
+async function readWalkDirectory(
+  root: string,
+  task: Extract<WalkTask, { kind: 'dir' }>,
+  filter: CompiledFilter,
+  queue: (task: WalkTask) => void
+): Promise<void> {
+  let entries: Dirent[]
+  try {
+    entries = await readdir(join(root, task.path), { withFileTypes: true })
+  } catch {
+    return
+  }
+
+  let ignores = task.ignores
+  if (filter.gitignore && entries.some(entry => entry.name === '.gitignore' && entry.isFile())) {
+    try {
+      const content = await readFile(join(root, task.path, '.gitignore'), 'utf8')
+      ignores = [...ignores, new IgnoreFile(content, task.path)]
+    } catch {
+      // Unreadable ignore file: keep the inherited rules
+    }
+  }
+
+  for (const entry of entries) {
+    if (entry.name === '.git') continue
+    if (!filter.hidden && entry.name.startsWith('.')) continue
+
+    const path = task.path ? `${task.path}/${entry.name}` : entry.name
+    const isDirectory = entry.isDirectory()
+    if (!isDirectory && !entry.isFile()) continue
+    if (filter.gitignore && isIgnored(ignores, path, isDirectory)) continue
+
+    if (isDirectory) {
+      queue({ kind: 'dir', path, ignores })
+    } else if (filter.globs.length === 0 || filter.globs.some(glob => glob.match(path))) {
+      queue({ kind: 'file', path })
+    }
+  }
+}
+
+async function assertDirectory(root: string): Promise<void> {
+  if (!(await stat(root)).isDirectory()) {
+    throw Object.assign(new Error(`Not a directory: ${root}`), { code: 'ENOTDIR' })
+  }
+}
+
+/**
+ * Visit the files below `root` that a search with the same filters would read
+ * Symlinks and unreadable directories are skipped.
+ * @param root - Absolute directory to walk
+ * @param filter - Hidden, .gitignore and glob filters
+ * @param visit - Called with each '/'-separated path relative to `root`
+ * @throws When `root` is not a readable directory
+ */
+export async function walkFiles(root: string, filter: WalkFilter, visit: (path: string) => Promise<void> | void): Promise<void> {
+  const compiled = compileFilter(filter)
+  await assertDirectory(root)
+  await runTasks<WalkTask>([{ kind: 'dir', path: '', ignores: [] }], async (task, queue) => {
+    if (task.kind === 'dir') await readWalkDirectory(root, task, compiled, queue)
+    else await visit(task.path)
+  })
+}
+
+/**
+ * Collects the matches of one search across files
+ */
+class MatchCollector {
+  private readonly matches: SearchMatch[] = []
+  private readonly prefix: string
+  private filesSearched = 0
+  truncated = false
+
+  constructor(private readonly search: CompiledSearch, pathPrefix: string) {
+    const prefix = pathPrefix.replace(/\/+$/, '')
+    this.prefix = prefix === '.' ? '' : prefix
+  }
+
+  async searchFile(root: string, path: string): Promise<void> {
+    let data: Buffer
+    try {
+      const handle = await open(join(root, path), 'r')
+      try {
+        if ((await handle.stat()).size > this.search.maxFileSize) return
+        data = await handle.readFile()
+      } finally {
+        await handle.close()
+      }
+    } catch {
+      return
+    }
+
+    if (data.subarray(0, BINARY_SNIFF_BYTES).includes(0)) return
+    this.filesSearched++
+    // Buffer.indexOf is a native memchr/memmem-style scan
+    if (this.search.prefilter && data.indexOf(this.search.prefilter) === -1) return
+
+    const display = this.prefix ? `${this.prefix}/${path}` : path
+    for (const match of matchLines(data.toString('utf8'), this.search)) {
+      if (this.matches.length >= this.search.maxResults) {
+        this.truncated = true
+        return
+      }
+      this.matches.push({ path: display, ...match })
+    }
+  }
+
+  result(): SearchResult {
+    this.matches.sort((a, b) => (a.path < b.path ? -1 : a.path > b.path ? 1 : a.line - b.line))
+    return { matches: this.matches, truncated: this.truncated, filesSearched: this.filesSearched }
+  }
+}
+
+/**
+ * Search the files below `root` for lines matching a pattern
+ *
+ * Directories are walked and files are read with a bounded number of
+ * operations in flight. Files that cannot contain a match are skipped with
+ * a byte search for the pattern's required literal before anything is
+ * decoded. Binary files, symlinks and unreadable entries are skipped.
+ *
+ * @param root - Absolute directory to search
+ * @param options - Pattern and filters (`options.path` is ignored; pass the resolved directory as `root`)
+ * @param pathPrefix - Prepended to reported paths, e.g. the search directory relative to the workspace
+ * @returns Matches, sorted by path and line
+ * @throws {SearchPatternError} When the pattern is empty or invalid
+ * @throws When `root` is not a readable directory
+ */
+export async function searchTree(root: string, options: SearchOptions, pathPrefix = ''): Promise<SearchResult> {
+  const search = compileSearch(options)
+  await assertDirectory(root)
+
+  const collector = new MatchCollector(search, pathPrefix)
+  await runTasks<WalkTask>(
+    [{ kind: 'dir', path: '', ignores: [] }],
+    async (task, queue) => {
+      if (task.kind === 'dir') await readWalkDirectory(root, task, search, queue)
+      else await collector.searchFile(root, task.path)
+    },
+    () => collector.truncated
+  )
+  return collector.result()
+}
+
+/**
+ * Search only the given files below `root`, e.g. candidates from an index
+ * Globs still apply; missing and binary files are skipped.
+ * @param root - Absolute directory the paths are relative to
+ * @param paths - '/'-separated paths relative to `root`
+ * @param options - Pattern and filters
+ * @param pathPrefix - Prepended to reported paths
+ */
+export async function searchFileList(
+  root: string,
+  paths: readonly string[],
+  options: SearchOptions,
+  pathPrefix = ''
+): Promise<SearchResult> {
+  const search = compileSearch(options)
+  const collector = new MatchCollector(search, pathPrefix)
+  const wanted = search.globs.length === 0 ? paths : paths.filter(path => search.globs.some(glob => glob.match(path)))
+
+  // Reversed so the LIFO runner reads them in the given order
+  await runTasks([...wanted].reverse(), (path) => collector.searchFile(root, path), () => collector.truncated)
+  return collector.result()
+}
+
+/**
+ * Matching lines of a decoded file, one entry per line
+ */
+function* matchLines(text: string, search: CompiledSearch): Generator<Omit<SearchMatch, 'path'>> {
+  const { regex, lineRegex } = search
+  regex.lastIndex = 0
+  // Line numbers are counted incrementally from the previous match
+  let line = 1
+  let counted = 0
+
+  for (let found = regex.exec(text); found !== null; found = regex.exec(text)) {
+    const lineStart = text.lastIndexOf('\n', found.index - 1) + 1
+    const newline = text.indexOf('\n', found.index)
+    const lineEnd = newline === -1 ? text.length : newline
+    const lineText = text.slice(lineStart, lineEnd).replace(/\r$/, '')
+    const nextLine = lineEnd + 1
+
+    let column = found.index - lineStart + 1
+    if (found.index + found[0].length > lineEnd) {
+      // The match ran into the next line; only count it if the line matches on its own
+      const local = lineRegex.exec(lineText)
+      if (!local) {
+        regex.lastIndex = nextLine
+        if (nextLine > text.length) return
+        continue
+      }
+      column = local.index + 1
+    }
+
+    for (let i = text.indexOf('\n', counted); i !== -1 && i < lineStart; i = text.indexOf('\n', i + 1)) {
+      line++
+      counted = i + 1
+    }
+
+    yield {
+      line,
+      column,
+      text: lineText.length > MAX_MATCH_TEXT_LENGTH ? lineText.slice(0, MAX_MATCH_TEXT_LENGTH) : lineText,
+    }
+
+    if (nextLine > text.length) return
+    regex.lastIndex = nextLine
+  }
+}
+
+export function shellQuote(value: string): string {
+  return `'${value.replace(/'/g, "'\\''")}'`
+}
+
+function globList(options: SearchOptions): string[] {
+  return options.glob === undefined ? [] : Array.isArray(options.glob) ? options.glob : [options.glob]
+}
+
+/**
+ * GNU grep command approximating searchTree, for hosts without the agent
+ * Differences: the pattern is run as a POSIX extended regex, .gitignore
+ * files and maxFileSize are not applied. Parse the output with
+ * parseGrepOutput().
+ * @param root - Absolute directory to search
+ * @param options - Search options
+ */
+export function grepCommand(root: string, options: SearchOptions): string {
+  compileSearch(options)
+  const args = ['grep', '-rnIH', '--null', '--exclude-dir=.git']
+  if (!options.hidden) {
+    // '.[!.]*' rather than '.*', which would also exclude the '.' being searched
+    args.push(`--exclude-dir=${shellQuote('.[!.]*')}`, `--exclude=${shellQuote('.*')}`)
+  }
+  if (options.ignoreCase) args.push('-i')
+  args.push(options.literal ? '-F' : '-E')
+
+  // --include only sees file names; globs with a '/' are applied when parsing
+  const globs = globList(options)
+  const namesOnly = globs.every(glob => !glob.includes('/'))
+  if (namesOnly) {
+    for (const glob of globs) args.push(`--include=${shellQuote(glob)}`)
+  }
+  args.push('-e', shellQuote(options.pattern), '--', '.')
+
+  // One line more than needed tells parseGrepOutput the search was truncated
+  const limit = namesOnly ? ` | head -n ${(options.maxResults ?? DEFAULT_SEARCH_MAX_RESULTS) + 1}` : ''
+  // Exit status 2 distinguishes a missing directory from "no matches"
+  return `cd ${shellQuote(root)} || exit 2; ${args.join(' ')}${limit}`
+}
+
+/**
+ * Turn the output of grepCommand() into a SearchResult
+ * `filesSearched` counts the files with matches, since grep does not report the rest.
+ */
+export function parseGrepOutput(output: string, options: SearchOptions, pathPrefix = ''): SearchResult {
+  const search = compileSearch(options)
+  const prefix = pathPrefix.replace(/\/+$/, '')
+  const matches: SearchMatch[] = []
+  const files = new Set<string>()
+  let truncated = false
+
+  for (const record of output.split('\n')) {
+    const separator = record.indexOf('\0')
+    const colon = record.indexOf(':', separator + 1)
+    if (separator === -1 || colon === -1) continue
+
+    const path = record.slice(0, separator).replace(/^\.\//, '')
+    if (search.globs.length > 0 && !search.globs.some(glob => glob.match(path))) continue
+    if (matches.length >= search.maxResults) {
+      truncated = true
+      break
+    }
+
+    const text = record.slice(colon + 1).replace(/\r$/, '')
+    files.add(path)
+    matches.push({
+      path: prefix && prefix !== '.' ? `${prefix}/${path}` : path,
+      line: Number(record.slice(separator + 1, colon)),
+      column: (search.lineRegex.exec(text)?.index ?? 0) + 1,
+      text: text.length > MAX_MATCH_TEXT_LENGTH ? text.slice(0, MAX_MATCH_TEXT_LENGTH) : text,
+    })
+  }
+
+  matches.sort((a, b) => (a.path < b.path ? -1 : a.path > b.path ? 1 : a.line - b.line))
+  return { matches, truncated, filesSearched: files.size }
+}
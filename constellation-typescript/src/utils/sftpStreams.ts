@@ -0,0 +1,365 @@
+import { Readable, Writable } from 'stream'
+import type { SFTPWrapper } from 'ssh2'
+
+/** Bytes requested per SFTP read/write (ssh2's fastGet/fastPut default) */
+export const DEFAULT_SFTP_CHUNK_SIZE = 32 * 1024
+
+/** SFTP requests kept in flight per transfer (ssh2's fastGet/fastPut default) */
+export const DEFAULT_SFTP_CONCURRENCY = 64
+
+/** SFTP status code for end of file */
+const SFTP_STATUS_EOF = 1
+
+/**
+ * Tuning for pipelined SFTP transfers
+ * Throughput is roughly chunkSize * concurrency per round-trip, and so is
+ * the memory held by one transfer.
+ */
+export interface SftpTransferOptions {
+  /** Bytes per SFTP read/write request (default: 32 KiB) */
+  chunkSize?: number
+  /** Requests kept in flight (default: 64) */
+  concurrency?: number
+}
+
+export interface SftpReadStreamOptions extends SftpTransferOptions {
+  /** First byte to read (default: 0) */
+  start?: number
+  /** Last byte to read, inclusive like fs.createReadStream (default: end of file) */
+  end?: number
+}
+
+export interface SftpWriteStreamOptions extends SftpTransferOptions {
+  /** Offset of the first byte written (default: 0) */
+  start?: number
+}
+
+type Handle = Buffer
+
+function isEof(error: unknown): boolean {
+  return (error as { code?: unknown } | null)?.code === SFTP_STATUS_EOF
+}
+
+/**
+ * Open a remote file
+ */
+export function openRemoteFile(sftp: SFTPWrapper, path: string, flags: string, mode?: number): Promise<Handle> {
+  return new Promise((resolve, reject) => {
+    const callback = (err: Error | undefined, handle: Handle) => (err ? reject(err) : resolve(handle))
+    if (mode === undefined) {
+      sftp.open(path, flags, callback)
+    } else {
+      sftp.open(path, flags, mode, callback)
+    }
+  })
+}
+
+/**
+ * Close a remote file handle
+ */
+export function closeRemoteFile(sftp: SFTPWrapper, handle: Handle): Promise<void> {
+  return new Promise((resolve, reject) => {
+    sftp.close(handle, (err) => (err ? reject(err) : resolve()))
+  })
+}
+
+/**
+ * Read `length` bytes at `position`; resolves to the bytes actually read
+ * (0 at end of file)
+ */
+function readChunk(sftp: SFTPWrapper, handle: Handle, buffer: Buffer, offset: number, length: number, position: number): Promise<number> {
+  return new Promise((resolve, reject) => {
+    sftp.read(handle, buffer, offset, length, position, (err, bytesRead) => {
+      if (err) {
+        if (isEof(err)) resolve(0)
+        else reject(err)
+      } else {
+        resolve(bytesRead)
+      }
+    })
+  })
+}
+
+function writeChunk(sftp: SFTPWrapper, handle: Handle, buffer: Buffer, position: number): Promise<void> {
+  return new Promise((resolve, reject) => {
+    sftp.write(handle, buffer, 0, buffer.length, position, (err) => (err ? reject(err) : resolve()))
+  })
+}
+
+/**
+ * Fill `target` from the file with up to `concurrency` reads in flight
+ * @returns Bytes read (less than target.length if the file was shorter)
+ */
+export async function readIntoBuffer(
+  sftp: SFTPWrapper,
+  handle: Handle,
+  target: Buffer,
+  position = 0,
+  options: SftpTransferOptions = {}
+): Promise<number> {
+  const chunkSize = options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE
+  const concurrency = options.concurrency ?? DEFAULT_SFTP_CONCURRENCY
+  let nextOffset = 0
+  let eofAt = Infinity
+
+  // Each worker claims the next chunk; short reads finish their own chunk
+  const worker = async () => {
+    while (nextOffset < target.length && nextOffset < eofAt) {
+      const offset = nextOffset
+      const length = Math.min(chunkSize, target.length - offset)
+      nextOffset += length
+
+      let done = 0
+      while (done < length) {
+        const bytesRead = await readChunk(sftp, handle, target, offset + done, length - done, position + offset + done)
+        if (bytesRead === 0) {
+          eofAt = Math.min(eofAt, offset + done)
+          break
+        }
+        done += bytesRead
+      }
+    }
+  }
+
+  await Promise.all(Array.from({ length: Math.max(1, concurrency) }, worker))
+  // Everything before the first end-of-file position has been filled
+  return Math.min(target.length, eofAt)
+}
+
+/**
+ * Write all of `source` with up to `concurrency` writes in flight
+ */
+export async function writeFromBuffer(
+  sftp: SFTPWrapper,
+  handle: Handle,
+  source: Buffer,
+  position = 0,
+  options: SftpTransferOptions = {}
+): Promise<void> {
+  const chunkSize = options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE
+  const concurrency = options.concurrency ?? DEFAULT_SFTP_CONCURRENCY
+  let nextOffset = 0
+
+  const worker = async () => {
+    while (nextOffset < source.length) {
+      const offset = nextOffset
+      const length = Math.min(chunkSize, source.length - offset)
+      nextOffset += length
+      // subarray, not a copy: the source stays untouched until the write completes
+      await writeChunk(sftp, handle, source.subarray(offset, offset + length), position + offset)
+    }
+  }
+
+  await Promise.all(Array.from({ length: Math.max(1, concurrency) }, worker))
+}
+
+interface PendingRead {
+  position: number
+  length: number
+  buffer: Buffer
+  result: Promise<number>
+}
+
+/**
+ * Readable over a remote file that keeps several reads in flight
+ * Chunks are delivered in file order. New reads are only issued while the
+ * consumer keeps up, so memory stays at about chunkSize * concurrency.
+ */
+export class SftpReadStream extends Readable {
+  private readonly chunkSize: number
+  private readonly concurrency: number
+  /** Exclusive end offset */
+  private readonly endOffset: number
+  private nextPosition: number
+  private readonly queue: PendingRead[] = []
+  private draining = false
+  private finished = false
+
+  constructor(
+    private readonly sftp: SFTPWrapper,
+    private readonly handle: Handle,
+    options: SftpReadStreamOptions = {},
+    private readonly onClose?: () => void
+  ) {
+    super({ highWaterMark: (options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE) * (options.concurrency ?? DEFAULT_SFTP_CONCURRENCY) })
+    this.chunkSize = options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE
+    this.concurrency = Math.max(1, options.concurrency ?? DEFAULT_SFTP_CONCURRENCY)
+    this.nextPosition = options.start ?? 0
+    this.endOffset = options.end === undefined ? Infinity : options.end + 1
+  }
+
+  override _read(): void {
+    this.fill()
+    void this.drain()
+  }
+
+  override _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    this.finished = true
+    // In-flight reads complete into buffers nobody looks at; closing the
+    // handle afterwards is safe because SFTP processes requests in order
+    closeRemoteFile(this.sftp, this.handle)
+      .catch(() => {})
+      .finally(() => {
+        this.onClose?.()
+        callback(error)
+      })
+  }
+
+  private issue(position: number, length: number): PendingRead {
+    const buffer = Buffer.allocUnsafe(length)
+    const result = readChunk(this.sftp, this.handle, buffer, 0, length, position)
+    // Reads still queued when the stream ends early are never awaited
+    result.catch(() => {})
+    return { position, length, buffer, result }
+  }
+
+  private fill(): void {
+    while (!this.finished && this.queue.length < this.concurrency && this.nextPosition < this.endOffset) {
+      const length = Math.min(this.chunkSize, this.endOffset - this.nextPosition)
+      this.queue.push(this.issue(this.nextPosition, length))
+      this.nextPosition += length
+    }
+  }
+
+  /**
+   * Deliver completed reads in order until the consumer asks us to stop
+   */
+  private async drain(): Promise<void> {
+    if (this.draining) return
+    this.draining = true
+
+    try {
+      while (!this.finished && this.queue.length > 0) {
+        const head = this.queue[0]!
+        const bytesRead = await head.result
+        if (this.finished) return
+
+        if (bytesRead === 0) {
+          // End of file: later reads are past it too
+          this.finished = true
+          this.queue.length = 0
+          this.push(null)
+          return
+        }
+
+        if (bytesRead < head.length) {
+          // Short read: fetch the rest of this chunk before moving on
+          this.queue[0] = this.issue(head.position + bytesRead, head.length - bytesRead)
+        } else {
+          this.queue.shift()
+        }
+
+        const more = this.push(head.buffer.subarray(0, bytesRead))
+        this.fill()
+        if (!more) return
+      }
+
+      if (!this.finished && this.queue.length === 0 && this.nextPosition >= this.endOffset) {
+        this.finished = true
+        this.push(null)
+      }
+    } catch (error) {
+      this.destroy(error as Error)
+    } finally {
+      this.draining = false
+    }
+  }
+}
+
+/**
+ * Writable to a remote file that keeps several writes in flight
+ * Each write callback fires as soon as there is room for more requests,
+ * so a fast source is throttled to chunkSize * concurrency bytes in flight.
+ */
+export class SftpWriteStream extends Writable {
+  private readonly chunkSize: number
+  private readonly concurrency: number
+  private position: number
+  private inFlight = 0
+  private failure: Error | null = null
+  private waiters: Array<() => void> = []
+  private handleClosed = false
+
+  constructor(
+    private readonly sftp: SFTPWrapper,
+    private readonly handle: Handle,
+    options: SftpWriteStreamOptions = {},
+    private readonly onClose?: () => void
+  ) {
+    super({ highWaterMark: options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE })
+    this.chunkSize = options.chunkSize ?? DEFAULT_SFTP_CHUNK_SIZE
+    this.concurrency = Math.max(1, options.concurrency ?? DEFAULT_SFTP_CONCURRENCY)
+    this.position = options.start ?? 0
+  }
+
+  /** Bytes accepted so far */
+  get bytesWritten(): number {
+    return this.position
+  }
+
+  override _write(chunk: Buffer, _encoding: BufferEncoding, callback: (error?: Error | null) => void): void {
+    this.writeChunked(chunk).then(() => callback(), callback)
+  }
+
+  override _final(callback: (error?: Error | null) => void): void {
+    this.settle()
+      .then(() => this.closeHandle())
+      .then(() => callback(), callback)
+  }
+
+  override _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    this.settle()
+      .catch(() => {})
+      .then(() => this.closeHandle())
+      .catch(() => {})
+      .finally(() => {
+        this.onClose?.()
+        callback(error)
+      })
+  }
+
+  private async writeChunked(chunk: Buffer): Promise<void> {
+    for (let offset = 0; offset < chunk.length; offset += this.chunkSize) {
+      while (this.inFlight >= this.concurrency) {
+        await new Promise<void>((resolve) => this.waiters.push(resolve))
+      }
+      if (this.failure) throw this.failure
+
+      const piece = chunk.subarray(offset, offset + this.chunkSize)
+      const position = this.position
+      this.position += piece.length
+      this.inFlight++
+
+      writeChunk(this.sftp, this.handle, piece, position)
+        .catch((error: Error) => {
+          this.failure ??= error
+        })
+        .finally(() => {
+          this.inFlight--
+          this.wake()
+        })
+    }
+    if (this.failure) throw this.failure
+  }
+
+  /** Let everyone waiting on a free slot re-check */
+  private wake(): void {
+    const waiters = this.waiters
+    this.waiters = []
+    for (const waiter of waiters) waiter()
+  }
+
+  /** Wait for every in-flight write; rejects with the first failure */
+  private async settle(): Promise<void> {
+    while (this.inFlight > 0) {
+      await new Promise<void>((resolve) => this.waiters.push(resolve))
+    }
+    if (this.failure) throw this.failure
+  }
+
+  private async closeHandle(): Promise<void> {
+    if (this.handleClosed) return
+    this.handleClosed = true
+    await closeRemoteFile(this.sftp, this.handle)
+  }
+}
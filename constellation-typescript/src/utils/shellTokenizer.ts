@@ -0,0 +1,224 @@
+/**
+ * Kinds of token produced by tokenizeCommand
+ * - word: an argument, with quotes and escapes removed
+ * - operator: a control or redirection operator (`|`, `&&`, `;`, `2>`, newline, ...)
+ * - heredoc: the literal body of a here-document
+ */
+export type ShellTokenType = 'word' | 'operator' | 'heredoc'
+
+export interface ShellToken {
+  type: ShellTokenType
+  /** Unquoted word, operator text or heredoc body */
+  value: string
+  /** Offset of the token's first character in the command */
+  start: number
+  /** Offset just past the token's last character */
+  end: number
+}
+
+/** Longest first, so `&&` wins over `&` */
+const OPERATORS = ['<<-', '&&', '||', ';;', '<<', '>>', '>&', '<&', '&>', '>|', '|&', '|', '&', ';', '<', '>', '(', ')', '\n']
+
+/** Characters that can start an operator, for a cheap first check */
+const OPERATOR_START = new Set(OPERATORS.map(operator => operator[0]!))
+
+/** Characters escaped by a backslash inside double quotes */
+const DOUBLE_QUOTE_ESCAPES = new Set(['$', '`', '"', '\\'])
+
+interface PendingHeredoc {
+  delimiter: string
+  stripTabs: boolean
+}
+
+function matchOperator(command: string, index: number): string | null {
+  if (!OPERATOR_START.has(command[index]!)) return null
+  for (const operator of OPERATORS) {
+    if (command.startsWith(operator, index)) return operator
+  }
+  return null
+}
+
+function isBlank(char: string): boolean {
+  return char === ' ' || char === '\t' || char === '\r'
+}
+
+/**
+ * Find the end of a `$(...)`, `${...}` or backtick substitution starting at `index`
+ * @returns Offset just past the substitution (end of input if unterminated)
+ */
+function skipSubstitution(command: string, index: number): number {
+  if (command[index] === '`') {
+    for (let i = index + 1; i < command.length; i++) {
+      if (command[i] === '\\') i++
+      else if (command[i] === '`') return i + 1
+    }
+    return command.length
+  }
+
+  const open = command[index + 1]!
+  const close = open === '(' ? ')' : '}'
+  let depth = 1
+  for (let i = index + 2; i < command.length; i++) {
+    const char = command[i]
+    if (char === '\\') {
+      i++
+    } else if (char === "'") {
+      const end = command.indexOf("'", i + 1)
+      if (end === -1) return command.length
+      i = end
+    } else if (char === '$' && (command[i + 1] === '(' || command[i + 1] === '{')) {
+      i = skipSubstitution(command, i) - 1
+    } else if (char === '`') {
+      i = skipSubstitution(command, i) - 1
+    } else if (char === open) {
+      depth++
+    } else if (char === close && --depth === 0) {
+      return i + 1
+    }
+  }
+  return command.length
+}
+
+/**
+ * Read one word starting at `index`
+ * Substitutions are kept verbatim (they are not expanded) so that later
+ * checks still see them.
+ */
+function readWord(command: string, index: number): { value: string; end: number } {
+  let value = ''
+  let i = index
+
+  while (i < command.length) {
+    const char = command[i]!
+    if (isBlank(char) || matchOperator(command, i)) break
+
+    if (char === '\\') {
+      // Backslash-newline is a line continuation and disappears
+      if (command[i + 1] !== '\n') value += command[i + 1] ?? ''
+      i += 2
+    } else if (char === "'") {
+      const end = command.indexOf("'", i + 1)
+      const stop = end === -1 ? command.length : end
+      value += command.slice(i + 1, stop)
+      i = stop + 1
+    } else if (char === '"') {
+      i++
+      while (i < command.length && command[i] !== '"') {
+        const inner = command[i]!
+        if (inner === '\\' && (DOUBLE_QUOTE_ESCAPES.has(command[i + 1]!) || command[i + 1] === '\n')) {
+          if (command[i + 1] !== '\n') value += command[i + 1]
+          i += 2
+        } else if (inner === '`' || (inner === '$' && (command[i + 1] === '(' || command[i + 1] === '{'))) {
+          const end = skipSubstitution(command, i)
+          value += command.slice(i, end)
+          i = end
+        } else {
+          value += inner
+          i++
+        }
+      }
+      i++
+    } else if (char === '`' || (char === '$' && (command[i + 1] === '(' || command[i + 1] === '{'))) {
+      const end = skipSubstitution(command, i)
+      value += command.slice(i, end)
+      i = end
+    } else {
+      value += char
+      i++
+    }
+  }
+
+  return { value, end: Math.min(i, command.length) }
+}
+
+/**
+ * Read the bodies of the heredocs opened on the line that just ended
+ * @returns Offset just past the last delimiter line
+ */
+function readHeredocs(command: string, index: number, pending: PendingHeredoc[], tokens: ShellToken[]): number {
+  let i = index
+  for (const { delimiter, stripTabs } of pending) {
+    const start = i
+    let body = ''
+    while (i < command.length) {
+      const newline = command.indexOf('\n', i)
+      const lineEnd = newline === -1 ? command.length : newline
+      const line = command.slice(i, lineEnd)
+      i = newline === -1 ? command.length : newline + 1
+
+      const text = stripTabs ? line.replace(/^\t+/, '') : line
+      if (text === delimiter) break
+      body += `${text}\n`
+    }
+    tokens.push({ type: 'heredoc', value: body, start, end: i })
+  }
+  pending.length = 0
+  return i
+}
+
+/**
+ * Split a shell command into words, operators and heredoc bodies in a
+ * single pass, following POSIX quoting rules
+ *
+ * Handles single and double quotes, backslash escapes, line continuations,
+ * comments, `$(...)` / `${...}` / backtick substitutions (kept verbatim),
+ * IO numbers (`2>`), and heredocs (the body becomes one 'heredoc' token,
+ * not commands). Parameters are never expanded. Unterminated quotes run to
+ * the end of the input instead of failing, since the shell will reject the
+ * command anyway.
+ *
+ * @param command - The command to tokenize
+ * @returns Tokens in input order
+ */
+export function tokenizeCommand(command: string): ShellToken[] {
+  const tokens: ShellToken[] = []
+  const pendingHeredocs: PendingHeredoc[] = []
+  let i = 0
+
+  while (i < command.length) {
+    const char = command[i]!
+
+    if (isBlank(char)) {
+      i++
+      continue
+    }
+    if (char === '\\' && command[i + 1] === '\n') {
+      i += 2
+      continue
+    }
+    if (char === '#') {
+      while (i < command.length && command[i] !== '\n') i++
+      continue
+    }
+
+    const operator = matchOperator(command, i)
+    if (operator) {
+      tokens.push({ type: 'operator', value: operator, start: i, end: i + operator.length })
+      i += operator.length
+      if (operator === '\n' && pendingHeredocs.length > 0) {
+        i = readHeredocs(command, i, pendingHeredocs, tokens)
+      }
+      continue
+    }
+
+    const start = i
+    const word = readWord(command, i)
+    i = word.end
+
+    // A bare number directly before a redirection is its file descriptor
+    const redirection = /^\d+$/.test(command.slice(start, i)) ? matchOperator(command, i) : null
+    if (redirection && (redirection[0] === '<' || redirection[0] === '>')) {
+      tokens.push({ type: 'operator', value: command.slice(start, i) + redirection, start, end: i + redirection.length })
+      i += redirection.length
+      continue
+    }
+
+    const previous = tokens[tokens.length - 1]
+    if (previous?.type === 'operator' && (previous.value.endsWith('<<') || previous.value.endsWith('<<-'))) {
+      pendingHeredocs.push({ delimiter: word.value, stripTabs: previous.value.endsWith('<<-') })
+    }
+    tokens.push({ type: 'word', value: word.value, start, end: i })
+  }
+
+  return tokens
+}
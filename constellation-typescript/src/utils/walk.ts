@@ -0,0 +1,238 @@
+import type { Dirent, Stats } from 'fs'
+import { lstat, readdir, stat } from 'fs/promises'
+import { join } from 'path'
+import { Minimatch } from 'minimatch'
+import { runTasks, shellQuote } from './search.js'
+
+/** Default number of entries returned by a walk */
+export const DEFAULT_WALK_MAX_ENTRIES = 100_000
+
+/** File type bits for the `%y` letters printed by find */
+const FIND_TYPE_BITS: Record<string, number> = { f: 0o100000, d: 0o040000, l: 0o120000 }
+
+/** Characters that make a pattern a glob rather than a plain name */
+const GLOB_SYNTAX = /[*?[\]{}!]/
+
+/**
+ * Options for a recursive directory listing
+ */
+export interface WalkOptions {
+  /** Directory to walk, relative to the workspace (default: the workspace root) */
+  path?: string
+  /**
+   * Entries to skip together with their contents. Patterns containing '*'
+   * are globs matched against the path relative to the walked directory;
+   * other patterns match a name or path at any depth, e.g. 'node_modules'
+   * or 'src/generated'.
+   */
+  excludes?: string[]
+  /** Levels to descend; 1 lists only the directory's own entries (default: unlimited) */
+  maxDepth?: number
+  /** Include size, mtime and mode of every entry (default: false) */
+  withStats?: boolean
+  /** Stop after this many entries (default: 100000) */
+  maxEntries?: number
+}
+
+export type WalkEntryType = 'file' | 'directory' | 'symlink' | 'other'
+
+/**
+ * One entry of a walk; symlinks are reported, not followed
+ */
+export interface WalkEntry {
+  /** '/'-separated path relative to the walked directory */
+  path: string
+  type: WalkEntryType
+  /** Size in bytes (withStats only) */
+  size?: number
+  /** Modification time in milliseconds since the epoch (withStats only) */
+  mtimeMs?: number
+  /** File type and permission bits, as in Stats.mode (withStats only) */
+  mode?: number
+}
+
+/**
+ * Result of a walk
+ */
+export interface WalkResult {
+  /** Entries in depth-first order with siblings sorted by name, each directory before its contents */
+  entries: WalkEntry[]
+  /** Whether the walk stopped at maxEntries */
+  truncated: boolean
+}
+
+/**
+ * Compile exclude patterns once for a whole walk
+ * Plain names become a set lookup; everything else is a precompiled
+ * Minimatch. Contents of an excluded directory are never visited, so only
+ * the entry itself has to be tested.
+ * @returns Whether the entry at `path` (relative to the walked directory) is excluded
+ */
+export function compileExcludes(patterns: readonly string[]): (path: string) => boolean {
+  const names = new Set<string>()
+  const matchers: Minimatch[] = []
+  for (const pattern of patterns) {
+    if (pattern.includes('*')) {
+      matchers.push(new Minimatch(pattern, { dot: true }))
+    } else if (!pattern.includes('/') && !GLOB_SYNTAX.test(pattern)) {
+      names.add(pattern)
+    } else {
+      matchers.push(new Minimatch(pattern, { dot: true }), new Minimatch(`**/${pattern}`, { dot: true }))
+    }
+  }
+
+  if (names.size === 0 && matchers.length === 0) return () => false
+  return (path) => {
+    if (names.size > 0 && names.has(path.slice(path.lastIndexOf('/') + 1))) return true
+    return matchers.some(matcher => matcher.match(path))
+  }
+}
+
+function entryType(entry: Dirent | Stats): WalkEntryType {
+  if (entry.isFile()) return 'file'
+  if (entry.isDirectory()) return 'directory'
+  if (entry.isSymbolicLink()) return 'symlink'
+  return 'other'
+}
+
+/** Depth-first order: '/' sorts before every other character */
+function comparePaths(a: WalkEntry, b: WalkEntry): number {
+  const left = a.path.replaceAll('/', '\0')
+  const right = b.path.replaceAll('/', '\0')
+  return left < right ? -1 : left > right ? 1 : 0
+}
+
+/**
+ * List everything below `root` in one call
+ *
+ * Directories are read in parallel with a bounded number of operations in
+ * flight, using the entry types readdir already returns. Stats are only
+ * taken with `withStats`, one lstat per entry alongside the directory reads.
+ * Unreadable directories are skipped.
+ *
+ * @param root - Absolute directory to walk
+ * @param options - Excludes, depth and limits (`options.path` is ignored; pass the resolved directory as `root`)
+ * @throws When `root` is not a readable directory
+ */
+export async function walkTree(root: string, options: WalkOptions = {}): Promise<WalkResult> {
+  if (!(await stat(root)).isDirectory()) {
+    throw Object.assign(new Error(`Not a directory: ${root}`), { code: 'ENOTDIR' })
+  }
+
+  const excluded = compileExcludes(options.excludes ?? [])
+  const maxDepth = options.maxDepth ?? Infinity
+  const maxEntries = options.maxEntries ?? DEFAULT_WALK_MAX_ENTRIES
+  const entries: WalkEntry[] = []
+  let truncated = false
+
+  await runTasks<{ path: string; depth: number }>(
+    [{ path: '', depth: 0 }],
+    async (task, queue) => {
+      let dirents: Dirent[]
+      try {
+        dirents = await readdir(join(root, task.path), { withFileTypes: true })
+      } catch {
+        return
+      }
+
+      const kept: Array<{ path: string; dirent: Dirent }> = []
+      for (const dirent of dirents) {
+        const path = task.path ? `${task.path}/${dirent.name}` : dirent.name
+        if (!excluded(path)) kept.push({ path, dirent })
+      }
+      const stats = options.withStats
+        ? await Promise.all(kept.map(({ path }) => lstat(join(root, path)).catch(() => null)))
+        : null
+
+      for (let i = 0; i < kept.length; i++) {
+        if (entries.length >= maxEntries) {
+          truncated = true
+          return
+        }
+
+        const { path, dirent } = kept[i]!
+        const entry: WalkEntry = { path, type: entryType(dirent) }
+        if (stats) {
+          const entryStats = stats[i]
+          // Removed since the directory was read
+          if (!entryStats) continue
+          entry.size = entryStats.size
+          entry.mtimeMs = entryStats.mtimeMs
+          entry.mode = entryStats.mode
+        }
+        entries.push(entry)
+
+        if (entry.type === 'directory' && task.depth + 1 < maxDepth) {
+          queue({ path, depth: task.depth + 1 })
+        }
+      }
+    },
+    () => truncated
+  )
+
+  entries.sort(comparePaths)
+  return { entries, truncated }
+}
+
+/**
+ * GNU find command approximating walkTree, for hosts without the agent
+ * Plain-name excludes are pruned by find; the other patterns are applied
+ * by parseWalkOutput(), which should be used to read the output.
+ * @param root - Absolute directory to walk
+ * @param options - Walk options
+ */
+export function walkCommand(root: string, options: WalkOptions): string {
+  const args = ['find', '.', '-mindepth', '1']
+  if (options.maxDepth !== undefined) args.push('-maxdepth', String(Math.max(1, Math.floor(options.maxDepth))))
+
+  const names = (options.excludes ?? []).filter(pattern => !pattern.includes('/') && !GLOB_SYNTAX.test(pattern))
+  if (names.length > 0) {
+    args.push('\\(', names.map(name => `-name ${shellQuote(name)}`).join(' -o '), '\\)', '-prune', '-o')
+  }
+  args.push('-printf', shellQuote('%y\\t%s\\t%T@\\t%m\\t%P\\0'))
+
+  const limit = (options.maxEntries ?? DEFAULT_WALK_MAX_ENTRIES) + 1
+  // Exit status 2 distinguishes a missing directory from an empty one
+  return `cd ${shellQuote(root)} || exit 2; ${args.join(' ')} | head -z -n ${limit}`
+}
+
+/**
+ * Turn the output of walkCommand() into a WalkResult
+ */
+export function parseWalkOutput(output: string, options: WalkOptions): WalkResult {
+  const excluded = compileExcludes(options.excludes ?? [])
+  const maxEntries = options.maxEntries ?? DEFAULT_WALK_MAX_ENTRIES
+  const records = output.split('\0').filter(record => record !== '')
+  const truncated = records.length > maxEntries
+
+  const parsed: WalkEntry[] = []
+  for (const record of records.slice(0, maxEntries)) {
+    const fields = record.split('\t')
+    if (fields.length < 5) continue
+    const [kind, size, mtime, mode] = fields as [string, string, string, string]
+    const path = fields.slice(4).join('\t')
+    const type: WalkEntryType = kind === 'f' ? 'file' : kind === 'd' ? 'directory' : kind === 'l' ? 'symlink' : 'other'
+
+    const entry: WalkEntry = { path, type }
+    if (options.withStats) {
+      entry.size = Number(size)
+      entry.mtimeMs = Math.round(Number(mtime) * 1000)
+      entry.mode = (FIND_TYPE_BITS[kind] ?? 0) | parseInt(mode, 8)
+    }
+    parsed.push(entry)
+  }
+  parsed.sort(comparePaths)
+
+  // Parents sort before their contents, so a dropped directory is known before its entries
+  const dropped = new Set<string>()
+  const entries = parsed.filter((entry) => {
+    const slash = entry.path.lastIndexOf('/')
+    if ((slash !== -1 && dropped.has(entry.path.slice(0, slash))) || excluded(entry.path)) {
+      dropped.add(entry.path)
+      return false
+    }
+    return true
+  })
+
+  return { entries, truncated }
+}
@@ -0,0 +1,208 @@
+import { Readable } from 'stream'
+import { HeadTailBuffer } from '../utils/HeadTailBuffer.js'
+import { getLogger } from '../utils/logger.js'
+
+/** Default bytes of stdout and stderr (each) kept for ExecStream.result */
+export const DEFAULT_EXEC_STREAM_RETAIN_BYTES = 64 * 1024
+
+/** Default number of chunks buffered before the command is paused */
+const DEFAULT_EXEC_STREAM_HIGH_WATER_MARK = 16
+
+/**
+ * A piece of command output
+ */
+export interface ExecStreamChunk {
+  stream: 'stdout' | 'stderr'
+  data: Buffer
+}
+
+/**
+ * Final state of a streamed command
+ */
+export interface ExecStreamResult {
+  /** Exit code, or null when the command was killed by a signal */
+  exitCode: number | null
+  /** Signal that terminated the command, if any */
+  signal: string | null
+  /** Retained stdout (head and tail, see ExecStreamOptions.retainBytes) */
+  stdout: string
+  /** Retained stderr (head and tail) */
+  stderr: string
+  /** Whether the middle of stdout or stderr was dropped */
+  truncated: boolean
+}
+
+/**
+ * Options for Workspace.execStream
+ */
+export interface ExecStreamOptions {
+  /** Custom environment variables for this specific command execution */
+  env?: Record<string, string | undefined>
+  /**
+   * Bytes of stdout and stderr (each) kept for `result`, split between the
+   * start and the end of the output (default: 64 KiB). Streamed chunks are
+   * not affected.
+   */
+  retainBytes?: number
+  /** Chunks buffered for a slow consumer before the command is paused (default: 16) */
+  highWaterMark?: number
+}
+
+/**
+ * Live output of a running command
+ *
+ * An object-mode Readable of {@link ExecStreamChunk}s, so it can be consumed
+ * with `for await`, piped, or converted with `Readable.toWeb()`. When the
+ * consumer falls behind, the command's stdout/stderr are paused, which
+ * blocks the process on its pipe instead of buffering output in memory.
+ *
+ * Destroying the stream (including breaking out of a `for await` loop)
+ * kills the command. A non-zero exit is reported through `result`, not as
+ * a stream error; errors are reserved for failures to run the command.
+ * To only wait for `result`, call `resume()` to discard the chunks.
+ */
+export class ExecStream extends Readable {
+  /** Resolves when the command exits and its output has been delivered */
+  readonly result: Promise<ExecStreamResult>
+
+  private readonly stdoutRetained: HeadTailBuffer
+  private readonly stderrRetained: HeadTailBuffer
+  private sources: Readable[] = []
+  private kill: (() => void) | null = null
+  /** Sources plus the exit event still outstanding */
+  private pendingEnds = 0
+  private exit: { code: number | null; signal: string | null } | null = null
+  private settled = false
+  private resolveResult!: (result: ExecStreamResult) => void
+  private rejectResult!: (error: Error) => void
+
+  constructor(options: Pick<ExecStreamOptions, 'retainBytes' | 'highWaterMark'> = {}) {
+    super({ objectMode: true, highWaterMark: options.highWaterMark ?? DEFAULT_EXEC_STREAM_HIGH_WATER_MARK })
+
+    const retainBytes = options.retainBytes ?? DEFAULT_EXEC_STREAM_RETAIN_BYTES
+    const headBytes = Math.ceil(retainBytes / 2)
+    this.stdoutRetained = new HeadTailBuffer({ headBytes, tailBytes: retainBytes - headBytes })
+    this.stderrRetained = new HeadTailBuffer({ headBytes, tailBytes: retainBytes - headBytes })
+
+    this.result = new Promise((resolve, reject) => {
+      this.resolveResult = resolve
+      this.rejectResult = reject
+    })
+    // Consumers that only iterate see failures as stream errors instead
+    this.result.catch(() => {})
+  }
+
+  /**
+   * Create a stream for a command that was skipped (e.g. a dangerous command
+   * handled by onDangerousOperation): no output, exit code 0
+   */
+  static empty(): ExecStream {
+    const stream = new ExecStream()
+    stream.pendingEnds = 1
+    stream.exited(0, null)
+    return stream
+  }
+
+  /**
+   * Connect the running command (used by workspace implementations)
+   * @param stdout - Command stdout
+   * @param stderr - Command stderr
+   * @param kill - Terminates the command
+   */
+  attach(stdout: Readable, stderr: Readable, kill: () => void): void {
+    this.kill = kill
+    this.sources = [stdout, stderr]
+    this.pendingEnds = this.sources.length + 1
+
+    for (const [name, source, retained] of [
+      ['stdout', stdout, this.stdoutRetained],
+      ['stderr', stderr, this.stderrRetained],
+    ] as const) {
+      source.on('data', (data: Buffer) => {
+        retained.append(data)
+        if (this.destroyed) return
+        if (!this.push({ stream: name, data } satisfies ExecStreamChunk)) {
+          this.pauseSources()
+        }
+      })
+
+      let ended = false
+      const onEnd = () => {
+        if (ended) return
+        ended = true
+        this.sourceEnded()
+      }
+      source.once('end', onEnd)
+      source.once('close', onEnd)
+    }
+  }
+
+  /**
+   * Record the command's exit status (used by workspace implementations)
+   */
+  exited(code: number | null, signal: string | null): void {
+    if (this.exit) return
+    this.exit = { code, signal }
+    this.sourceEnded()
+  }
+
+  /**
+   * Fail the stream: the command could not be run or its channel broke
+   * (used by workspace implementations)
+   */
+  fail(error: Error): void {
+    if (this.settled) return
+    this.settled = true
+    this.terminate()
+    this.rejectResult(error)
+    this.destroy(error)
+  }
+
+  override _read(): void {
+    for (const source of this.sources) {
+      source.resume()
+    }
+  }
+
+  override _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    if (!this.settled) {
+      // The consumer went away; don't leave the command running unattended
+      this.terminate()
+    }
+    // Output is no longer delivered, so stop applying backpressure
+    for (const source of this.sources) {
+      source.resume()
+    }
+    callback(error)
+  }
+
+  private terminate(): void {
+    try {
+      this.kill?.()
+    } catch (error) {
+      getLogger().debug('[ExecStream] Failed to terminate command', error)
+    }
+  }
+
+  private pauseSources(): void {
+    for (const source of this.sources) {
+      source.pause()
+    }
+  }
+
+  private sourceEnded(): void {
+    if (--this.pendingEnds > 0 || this.settled || !this.exit) return
+    this.settled = true
+
+    this.resolveResult({
+      exitCode: this.exit.code,
+      signal: this.exit.signal,
+      stdout: this.stdoutRetained.toString(),
+      stderr: this.stderrRetained.toString(),
+      truncated: this.stdoutRetained.truncated || this.stderrRetained.truncated,
+    })
+    if (!this.destroyed) {
+      this.push(null)
+    }
+  }
+}
@@ -1,14 +1,41 @@
 import type { Dirent, Stats } from 'fs'
-import { join } from 'path'
+import { join, relative, sep } from 'path'
+import type { Readable } from 'stream'
 import type { LocalBackend } from '../backends/LocalBackend.js'
 import { ERROR_CODES } from '../constants.js'
 import type { OperationLogEntry, OperationsLogger, OperationType } from '../logging/types.js'
 import { shouldLogOperation } from '../logging/types.js'
-import { isCommandSafe, isDangerous } from '../safety.js'
+import { analyzeCommand } from '../safety.js'
 import { DangerousOperationError, FileSystemError } from '../types.js'
+import { applyEditsToFile, EditNoMatchError, editGrowth, type ApplyEditsOptions, type ApplyEditsResult, type TextEdit } from '../utils/applyEdits.js'
+import { ChangeFeed, watchChanges, type WatchEvent, type WatchOptions, type WorkspaceWatcher } from '../utils/ChangeFeed.js'
+import { HeadTailBuffer, execOutputLimits } from '../utils/HeadTailBuffer.js'
 import { getLogger } from '../utils/logger.js'
+import { incrementCounter, recordDuration, startTimer } from '../utils/metrics.js'
+import { LocalWorkspaceUtils } from '../utils/LocalWorkspaceUtils.js'
+import { buildInterceptEnv, getInterceptLibrary } from '../utils/nativeLibrary.js'
 import { checkSymlinkSafety } from '../utils/pathValidator.js'
-import { BaseWorkspace, type ExecOptions, type WorkspaceConfig } from './Workspace.js'
+import { searchTree, type SearchOptions, type SearchResult } from '../utils/search.js'
+import { SEARCH_INDEX_DIRECTORY, TrigramIndex } from '../utils/TrigramIndex.js'
+import { quotaViolation, UsageTracker, type WorkspaceUsage } from '../utils/UsageTracker.js'
+import { walkTree, type WalkOptions, type WalkResult } from '../utils/walk.js'
+import { ExecStream, type ExecStreamOptions } from './ExecStream.js'
+import { ShellWorkerPool } from './ShellWorkerPool.js'
+import {
+  BaseWorkspace,
+  type ExecOptions,
+  type ReadStreamOptions,
+  type SyncOperationsPolicy,
+  type WorkspaceConfig,
+  type WorkspacePromises,
+} from './Workspace.js'
+
+/** Labels of the timed operations in the workspace operation metric */
+const METRIC_LABELS = {
+  exec: { backend: 'local', op: 'exec' },
+  readFile: { backend: 'local', op: 'readFile' },
+  writeFile: { backend: 'local', op: 'writeFile' },
+} as const
 
 /**
  * Local filesystem workspace implementation
@@ -17,6 +44,19 @@ import { BaseWorkspace, type ExecOptions, type WorkspaceConfig } from './Workspa
 export class LocalWorkspace extends BaseWorkspace {
   declare readonly backend: LocalBackend
   private readonly operationsLogger?: OperationsLogger
+  /** libintercept.so path when LD_PRELOAD confinement is enabled (Linux only) */
+  private readonly interceptLibrary: string | null
+  /** Content index used by search() when config.searchIndex is set */
+  private readonly searchIndex: TrigramIndex | null
+  private readonly syncOperations: SyncOperationsPolicy
+  /** Sync methods already reported under the 'warn' policy */
+  private readonly syncWarnings = new Set<string>()
+  /** Warm shells for exec() when config.shellWorkers is set */
+  private readonly shellWorkers: ShellWorkerPool | null
+  /** Environment the shell workers were started with */
+  private workerBaseEnv: Record<string, string | undefined> | null = null
+  /** Byte limit for this workspace from config.quotaBytes */
+  private readonly quotaBytes?: number
 
   constructor(
     backend: LocalBackend,
@@ -27,6 +67,36 @@ export class LocalWorkspace extends BaseWorkspace {
   ) {
     super(backend, userId, workspaceName, workspacePath, config)
     this.operationsLogger = config?.operationsLogger
+    this.interceptLibrary = process.platform === 'linux' ? getInterceptLibrary() : null
+    this.searchIndex = config?.searchIndex ? TrigramIndex.for(workspacePath) : null
+    this.syncOperations = config?.syncOperations ?? 'allow'
+    this.quotaBytes = config?.quotaBytes
+    this.shellWorkers = config?.shellWorkers
+      ? new ShellWorkerPool(config.shellWorkers, () => this.backend.spawnProcess(this.backend.getShell(), ['-s'], {
+          cwd: this.workspacePath,
+          stdio: ['pipe', 'pipe', 'pipe'],
+          env: (this.workerBaseEnv ??= this.buildEnvironment()),
+        }))
+      : null
+  }
+
+  /**
+   * Apply WorkspaceConfig.syncOperations before a blocking call
+   */
+  private checkSyncAllowed(method: string): void {
+    if (this.syncOperations === 'allow') return
+
+    if (this.syncOperations === 'deny') {
+      throw new FileSystemError(
+        `${method} blocks the event loop and is disabled for this workspace; use workspace.promises instead`,
+        ERROR_CODES.INVALID_CONFIGURATION,
+        method
+      )
+    }
+    if (!this.syncWarnings.has(method)) {
+      this.syncWarnings.add(method)
+      getLogger().warn(`${method} blocks the event loop (workspace: ${this.workspacePath}); use workspace.promises instead`)
+    }
   }
 
   /**
@@ -76,60 +146,32 @@ export class LocalWorkspace extends BaseWorkspace {
   async exec(command: string, options?: ExecOptions): Promise<string | Buffer> {
     const encoding = options?.encoding ?? 'utf8'
     const startTime = Date.now()
+    const timer = startTimer()
     const shouldLogExec = this.shouldLog('exec')
 
     if (!command.trim()) {
       throw new FileSystemError('Command cannot be empty', ERROR_CODES.EMPTY_COMMAND)
     }
 
-    // Comprehensive safety check
-    const safetyCheck = isCommandSafe(command)
-    if (!safetyCheck.safe) {
-      // Special handling for preventDangerous option
-      if (this.backend.options.preventDangerous && isDangerous(command)) {
-        if (this.backend.options.onDangerousOperation) {
-          this.backend.options.onDangerousOperation(command)
-          return ''
-        } else {
-          throw new DangerousOperationError(command)
-        }
-      }
-
-      // For other safety violations, always throw
-      throw new FileSystemError(
-        safetyCheck.reason || 'Command failed safety check',
-        ERROR_CODES.DANGEROUS_OPERATION,
-        command
-      )
+    if (!this.checkCommand(command)) {
+      return ''
     }
 
-    const shell = this.detectShell()
-    const env = this.buildEnvironment(options?.env)
+    const limits = execOutputLimits(
+      options?.maxBufferedBytes,
+      encoding === 'utf8' ? this.backend.options.maxOutputLength : undefined
+    )
 
     return new Promise((resolve, reject) => {
-      const child = this.backend.spawnProcess(shell, ['-c', command], {
-        cwd: this.workspacePath,
-        stdio: ['pipe', 'pipe', 'pipe'],
-        env,
-      })
-
-      // Collect output based on encoding mode
-      const stdoutChunks: Buffer[] = []
-      const stderrChunks: Buffer[] = []
-
-      child.stdout?.on('data', (data) => {
-        stdoutChunks.push(data)
-      })
-
-      child.stderr?.on('data', (data) => {
-        stderrChunks.push(data)
-      })
+      // Collect output (bounded when a limit applies)
+      const stdoutCollected = new HeadTailBuffer(limits)
+      const stderrCollected = new HeadTailBuffer(limits)
 
-      child.on('close', (code) => {
-        const stdoutBuffer = Buffer.concat(stdoutChunks)
-        const stderrBuffer = Buffer.concat(stderrChunks)
-        const stdoutStr = stdoutBuffer.toString('utf-8').trim()
-        const stderrStr = stderrBuffer.toString('utf-8').trim()
+      const finish = (code: number | null) => {
+        recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.exec)
+        const stdoutBuffer = stdoutCollected.toBuffer()
+        const stdoutStr = stdoutCollected.toString('utf-8').trim()
+        const stderrStr = stderrCollected.toString('utf-8').trim()
 
         if (code === 0) {
           if (encoding === 'buffer') {
@@ -154,7 +196,8 @@ export class LocalWorkspace extends BaseWorkspace {
 
             if (this.backend.options.maxOutputLength && output.length > this.backend.options.maxOutputLength) {
               const truncatedLength = this.backend.options.maxOutputLength - 50
-              output = `${output.substring(0, truncatedLength)}\n\n... [Output truncated. Full output was ${output.length} characters, showing first ${truncatedLength}]`
+              const fullLength = stdoutCollected.truncated ? `${stdoutCollected.totalBytes} bytes` : `${output.length} characters`
+              output = `${output.substring(0, truncatedLength)}\n\n... [Output truncated. Full output was ${fullLength}, showing first ${truncatedLength} characters]`
             }
 
             // Log before resolving
@@ -201,9 +244,9 @@ export class LocalWorkspace extends BaseWorkspace {
 
           reject(error)
         }
-      })
+      }
 
-      child.on('error', (err) => {
+      const fail = (err: Error) => {
         getLogger().error(`Command execution error in workspace: ${this.workspacePath}, cwd: ${this.workspacePath}`, err)
         const wrappedError = this.wrapError(err, 'Execute command', ERROR_CODES.EXEC_ERROR, command)
 
@@ -220,30 +263,142 @@ export class LocalWorkspace extends BaseWorkspace {
         }
 
         reject(wrappedError)
+      }
+
+      const pooled = this.shellWorkers?.run({
+        command,
+        cwd: this.workspacePath,
+        env: options?.env && this.workerEnvironment(options.env),
+        stdout: stdoutCollected,
+        stderr: stderrCollected,
       })
+      if (pooled) {
+        pooled.then(finish, fail)
+        return
+      }
+
+      const child = this.backend.spawnProcess(this.backend.getShell(), ['-c', command], {
+        cwd: this.workspacePath,
+        stdio: ['pipe', 'pipe', 'pipe'],
+        env: this.buildEnvironment(options?.env),
+      })
+
+      child.stdout?.on('data', (data) => {
+        stdoutCollected.append(data)
+      })
+
+      child.stderr?.on('data', (data) => {
+        stderrCollected.append(data)
+      })
+
+      child.on('close', finish)
+      child.on('error', fail)
     })
   }
 
   /**
-   * Detect the best available shell for command execution
+   * Stop the workspace's shell workers (see WorkspaceConfig.shellWorkers)
+   * Commands still running on them fail; later exec() calls spawn a shell
+   * per command.
    */
-  private detectShell(): string {
-    if (this.backend.options.shell === 'bash') {
-      return 'bash'
-    } else if (this.backend.options.shell === 'sh') {
-      return 'sh'
-    } else if (this.backend.options.shell === 'auto') {
-      // Auto-detection: prefer bash if available, fall back to sh
-      try {
-        this.backend.execSyncCommand('command -v bash', { stdio: 'ignore' })
-        return 'bash'
-      } catch {
-        return 'sh'
+  closeShellWorkers(): void {
+    this.shellWorkers?.close()
+  }
+
+  async execStream(command: string, options?: ExecStreamOptions): Promise<ExecStream> {
+    const startTime = Date.now()
+
+    if (!command.trim()) {
+      throw new FileSystemError('Command cannot be empty', ERROR_CODES.EMPTY_COMMAND)
+    }
+
+    if (!this.checkCommand(command)) {
+      return ExecStream.empty()
+    }
+
+    // Run in its own process group so killing it also stops the shell's
+    // children, which would otherwise keep the output pipes open
+    const ownGroup = process.platform !== 'win32'
+    const child = this.backend.spawnProcess(this.backend.getShell(), ['-c', command], {
+      cwd: this.workspacePath,
+      stdio: ['ignore', 'pipe', 'pipe'],
+      env: this.buildEnvironment(options?.env),
+      detached: ownGroup,
+    })
+
+    const stream = new ExecStream(options)
+    stream.attach(child.stdout!, child.stderr!, () => {
+      if (ownGroup && child.pid !== undefined) {
+        process.kill(-child.pid, 'SIGTERM')
+      } else {
+        child.kill('SIGTERM')
+      }
+    })
+
+    child.on('close', (code, signal) => {
+      stream.exited(code, signal)
+    })
+
+    child.on('error', (err) => {
+      getLogger().error(`Command execution error in workspace: ${this.workspacePath}, cwd: ${this.workspacePath}`, err)
+      stream.fail(this.wrapError(err, 'Execute command', ERROR_CODES.EXEC_ERROR, command))
+    })
+
+    if (this.shouldLog('exec')) {
+      stream.result.then((result) => this.logOperation({
+        timestamp: new Date(),
+        operation: 'exec',
+        command,
+        stdout: result.stdout.trim(),
+        stderr: result.stderr.trim(),
+        exitCode: result.exitCode ?? undefined,
+        success: result.exitCode === 0,
+        durationMs: Date.now() - startTime,
+      }), (error: Error) => this.logOperation({
+        timestamp: new Date(),
+        operation: 'exec',
+        command,
+        success: false,
+        error: error.message,
+        durationMs: Date.now() - startTime,
+      })).catch((err) => {
+        getLogger().error('Failed to log operation', err)
+      })
+    }
+
+    return stream
+  }
+
+  /**
+   * Run the safety checks for a command
+   * @returns false when a dangerous command was handed to onDangerousOperation
+   *   instead of running
+   * @throws {DangerousOperationError} When the command is dangerous and no handler is set
+   * @throws {FileSystemError} When the command fails any other safety check
+   */
+  private checkCommand(command: string): boolean {
+    // Comprehensive safety check (one pass also tells us whether it is dangerous)
+    const safetyCheck = analyzeCommand(command)
+    if (safetyCheck.safe) {
+      return true
+    }
+
+    // Special handling for preventDangerous option
+    if (this.backend.options.preventDangerous && safetyCheck.dangerous) {
+      if (this.backend.options.onDangerousOperation) {
+        this.backend.options.onDangerousOperation(command)
+        return false
+      } else {
+        throw new DangerousOperationError(command)
       }
     }
 
-    // Fallback for any unexpected shell value
-    return 'sh'
+    // For other safety violations, always throw
+    throw new FileSystemError(
+      safetyCheck.reason || 'Command failed safety check',
+      ERROR_CODES.DANGEROUS_OPERATION,
+      command
+    )
   }
 
   /**
@@ -257,7 +412,7 @@ export class LocalWorkspace extends BaseWorkspace {
       // Start with minimal environment, including common npm/node locations
       PATH: '/opt/homebrew/bin:/usr/local/bin:/usr/bin:/bin:/opt/homebrew/opt/node/bin:/usr/local/opt/node/bin',
       USER: process.env.USER,
-      SHELL: this.detectShell(),
+      SHELL: this.backend.getShell(),
       // Force working directory
       PWD: this.workspacePath,
       TMPDIR: join(this.workspacePath, '.tmp'),
@@ -285,9 +440,29 @@ export class LocalWorkspace extends BaseWorkspace {
       Object.assign(safeEnv, validatedExecEnv)
     }
 
+    // Confine the whole process tree at the libc level (set last so it cannot be overridden)
+    if (this.interceptLibrary) {
+      Object.assign(safeEnv, buildInterceptEnv(this.interceptLibrary, this.workspacePath))
+    }
+
     return safeEnv
   }
 
+  /**
+   * Variables a shell worker sets or unsets for one command: the per-call
+   * variables after the same validation buildEnvironment() applies, minus
+   * anything equal to the worker's own environment
+   */
+  private workerEnvironment(execEnv: Record<string, string | undefined>): Record<string, string | undefined> {
+    this.workerBaseEnv ??= this.buildEnvironment()
+    const env = this.buildEnvironment(execEnv)
+    const changes: Record<string, string | undefined> = {}
+    for (const name of Object.keys(env)) {
+      if (env[name] !== this.workerBaseEnv[name]) changes[name] = env[name]
+    }
+    return changes
+  }
+
   /**
    * Blocked environment variables that could lead to code injection
    */
@@ -375,6 +550,40 @@ export class LocalWorkspace extends BaseWorkspace {
     return validated
   }
 
+  /**
+   * Reject a write that would take the workspace or the user past a quota
+   * @param fullPath - Resolved path of the file being written
+   * @param size - New size of the file, or the bytes it grows by when
+   *   `relativeGrowth` is set
+   * @throws {FileSystemError} QUOTA_EXCEEDED when a quota would be exceeded
+   */
+  private async checkQuota(fullPath: string, size: number, command: string, relativeGrowth = false): Promise<void> {
+    const userQuotaBytes = this.backend.options.userQuotaBytes
+    if (this.quotaBytes === undefined && userQuotaBytes === undefined) return
+
+    const tracker = UsageTracker.for(this.workspacePath)
+    const usage = await tracker.usage()
+    const growth = relativeGrowth ? size : size - tracker.sizeOf(this.usagePath(fullPath))
+    const userUsage = userQuotaBytes !== undefined
+      ? await UsageTracker.forUser(LocalWorkspaceUtils.getUserWorkspacePath(this.userId))
+      : null
+
+    const violation = quotaViolation(usage, growth, this.quotaBytes, userUsage, userQuotaBytes)
+    if (violation) {
+      incrementCounter('constellation_quota_rejections', { backend: 'local' })
+      throw new FileSystemError(violation, ERROR_CODES.QUOTA_EXCEEDED, command)
+    }
+  }
+
+  /** Tell the usage tracker, if running, about a file this workspace wrote */
+  private recordUsage(fullPath: string, size: number): void {
+    UsageTracker.peek(this.workspacePath)?.record(this.usagePath(fullPath), size)
+  }
+
+  private usagePath(fullPath: string): string {
+    return relative(this.workspacePath, fullPath).split(sep).join('/')
+  }
+
   async write(path: string, content: string | Buffer): Promise<void> {
     const startTime = Date.now()
     this.validatePath(path)
@@ -393,6 +602,8 @@ export class LocalWorkspace extends BaseWorkspace {
     }
 
     const fullPath = this.resolvePath(path)
+    const size = Buffer.isBuffer(content) ? content.length : Buffer.byteLength(content, 'utf-8')
+    await this.checkQuota(fullPath, size, `write ${path}`)
 
     try {
       // Create parent directories if they don't exist
@@ -407,6 +618,8 @@ export class LocalWorkspace extends BaseWorkspace {
       } else {
         await this.backend.writeFileAsync(fullPath, content, 'utf-8')
       }
+      this.searchIndex?.markDirty(relative(this.workspacePath, fullPath))
+      this.recordUsage(fullPath, size)
 
       if (this.shouldLog('write')) {
         await this.logOperation({
@@ -651,6 +864,7 @@ export class LocalWorkspace extends BaseWorkspace {
 
   async readFile(path: string, encoding?: NodeJS.BufferEncoding | null): Promise<string | Buffer> {
     const startTime = Date.now()
+    const timer = startTimer()
     this.validatePath(path)
 
     // Check symlink safety
@@ -673,6 +887,7 @@ export class LocalWorkspace extends BaseWorkspace {
         result = await this.backend.readFileAsync(fullPath)
       }
 
+      recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.readFile)
       if (this.shouldLog('readFile')) {
         await this.logOperation({
           timestamp: new Date(),
@@ -699,8 +914,55 @@ export class LocalWorkspace extends BaseWorkspace {
     }
   }
 
+  async createReadStream(path: string, options: ReadStreamOptions = {}): Promise<Readable> {
+    const startTime = Date.now()
+    this.validatePath(path)
+    this.validateReadRange(path, options)
+
+    // Check symlink safety
+    const symlinkCheck = checkSymlinkSafety(this.workspacePath, path)
+    if (!symlinkCheck.safe) {
+      throw new FileSystemError(
+        `Cannot read file: ${symlinkCheck.reason}`,
+        ERROR_CODES.PATH_ESCAPE_ATTEMPT,
+        `read ${path}`
+      )
+    }
+
+    const fullPath = this.resolvePath(path)
+
+    try {
+      const stream = await this.backend.createReadStreamAsync(fullPath, options)
+
+      if (this.shouldLog('read')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'read',
+          command: path,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return stream
+    } catch (error) {
+      if (this.shouldLog('read')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'read',
+          command: path,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw this.wrapError(error, 'Read file', ERROR_CODES.READ_FAILED, `read ${path}`)
+    }
+  }
+
   async writeFile(path: string, content: string | Buffer, encoding: NodeJS.BufferEncoding = 'utf-8'): Promise<void> {
     const startTime = Date.now()
+    const timer = startTimer()
     this.validatePath(path)
 
     // Check symlink safety for parent directories
@@ -717,6 +979,8 @@ export class LocalWorkspace extends BaseWorkspace {
     }
 
     const fullPath = this.resolvePath(path)
+    const size = Buffer.isBuffer(content) ? content.length : Buffer.byteLength(content, encoding)
+    await this.checkQuota(fullPath, size, `writeFile ${path}`)
 
     try {
       // Create parent directories if they don't exist
@@ -731,7 +995,10 @@ export class LocalWorkspace extends BaseWorkspace {
       } else {
         await this.backend.writeFileAsync(fullPath, content, encoding as 'utf-8')
       }
+      this.searchIndex?.markDirty(relative(this.workspacePath, fullPath))
+      this.recordUsage(fullPath, size)
 
+      recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.writeFile)
       if (this.shouldLog('writeFile')) {
         await this.logOperation({
           timestamp: new Date(),
@@ -756,10 +1023,193 @@ export class LocalWorkspace extends BaseWorkspace {
     }
   }
 
+  async search(options: SearchOptions): Promise<SearchResult> {
+    const startTime = Date.now()
+    const searchPath = options.path ?? '.'
+    this.validatePath(searchPath)
+
+    // Check symlink safety
+    const symlinkCheck = checkSymlinkSafety(this.workspacePath, searchPath)
+    if (!symlinkCheck.safe) {
+      throw new FileSystemError(
+        `Cannot search directory: ${symlinkCheck.reason}`,
+        ERROR_CODES.PATH_ESCAPE_ATTEMPT,
+        `search ${searchPath}`
+      )
+    }
+
+    const fullPath = this.resolvePath(searchPath)
+
+    try {
+      const prefix = relative(this.workspacePath, fullPath).split(sep).join('/')
+      const result = this.searchIndex
+        ? await this.searchIndex.search(prefix, options)
+        : await searchTree(fullPath, options, prefix)
+
+      if (this.shouldLog('search')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'search',
+          command: `${options.pattern} ${searchPath}`,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('search')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'search',
+          command: `${options.pattern} ${searchPath}`,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw this.wrapError(error, 'Search', ERROR_CODES.READ_FAILED, `search ${searchPath}`, false)
+    }
+  }
+
+  async walk(options: WalkOptions = {}): Promise<WalkResult> {
+    const startTime = Date.now()
+    const walkPath = options.path ?? '.'
+    this.validatePath(walkPath)
+
+    // Check symlink safety
+    const symlinkCheck = checkSymlinkSafety(this.workspacePath, walkPath)
+    if (!symlinkCheck.safe) {
+      throw new FileSystemError(
+        `Cannot walk directory: ${symlinkCheck.reason}`,
+        ERROR_CODES.PATH_ESCAPE_ATTEMPT,
+        `walk ${walkPath}`
+      )
+    }
+
+    const fullPath = this.resolvePath(walkPath)
+
+    try {
+      const result = await walkTree(fullPath, options)
+
+      if (this.shouldLog('walk')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'walk',
+          command: walkPath,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('walk')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'walk',
+          command: walkPath,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw this.wrapError(error, 'Walk directory', ERROR_CODES.READ_FAILED, `walk ${walkPath}`, false)
+    }
+  }
+
+  async applyEdits(path: string, edits: TextEdit[], options: ApplyEditsOptions = {}): Promise<ApplyEditsResult> {
+    const startTime = Date.now()
+    this.validatePath(path)
+
+    // Check symlink safety
+    const symlinkCheck = checkSymlinkSafety(this.workspacePath, path)
+    if (!symlinkCheck.safe) {
+      throw new FileSystemError(
+        `Cannot edit file: ${symlinkCheck.reason}`,
+        ERROR_CODES.PATH_ESCAPE_ATTEMPT,
+        `edit ${path}`
+      )
+    }
+
+    const fullPath = this.resolvePath(path)
+    if (!options.dryRun) {
+      await this.checkQuota(fullPath, editGrowth(edits), `edit ${path}`, true)
+    }
+
+    try {
+      const result = await applyEditsToFile(fullPath, edits, options, path)
+      if (result.changed && !options.dryRun) {
+        this.searchIndex?.markDirty(relative(this.workspacePath, fullPath))
+      }
+
+      if (this.shouldLog('edit')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'edit',
+          command: path,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('edit')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'edit',
+          command: path,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      if (error instanceof EditNoMatchError) {
+        throw new FileSystemError(error.message, ERROR_CODES.EDIT_NOT_FOUND, `edit ${path}`)
+      }
+      throw this.wrapError(error, 'Edit file', ERROR_CODES.WRITE_FAILED, `edit ${path}`)
+    }
+  }
+
+  async watch(path: string, options: WatchOptions, listener: (event: WatchEvent) => void): Promise<WorkspaceWatcher> {
+    this.validatePath(path)
+
+    const symlinkCheck = checkSymlinkSafety(this.workspacePath, path)
+    if (!symlinkCheck.safe) {
+      throw new FileSystemError(
+        `Cannot watch path: ${symlinkCheck.reason}`,
+        ERROR_CODES.PATH_ESCAPE_ATTEMPT,
+        `watch ${path}`
+      )
+    }
+
+    const watchPath = relative(this.workspacePath, this.resolvePath(path)).split(sep).join('/')
+    try {
+      // One recursive watch of the workspace serves every watcher and the search index
+      return await watchChanges(ChangeFeed.forDirectory(this.workspacePath), watchPath, options, listener, SEARCH_INDEX_DIRECTORY)
+    } catch (error) {
+      throw this.wrapError(error, 'Watch', ERROR_CODES.WATCH_FAILED, `watch ${path}`)
+    }
+  }
+
+  async usage(): Promise<WorkspaceUsage> {
+    try {
+      return await UsageTracker.for(this.workspacePath).usage()
+    } catch (error) {
+      throw this.wrapError(error, 'Usage', ERROR_CODES.READ_FAILED, 'usage')
+    }
+  }
+
   async delete(): Promise<void> {
     const startTime = Date.now()
     try {
-      await this.backend.removeAsync(this.workspacePath, { recursive: true, force: true })
+      this.shellWorkers?.close()
+      await this.searchIndex?.close(false)
+      ChangeFeed.closeDirectory(this.workspacePath)
+      UsageTracker.peek(this.workspacePath)?.close()
+      // Renamed away at once; the files are removed in the background
+      await this.backend.trashAsync(this.workspacePath)
 
       if (this.shouldLog('delete')) {
         await this.logOperation({
@@ -828,6 +1278,7 @@ export class LocalWorkspace extends BaseWorkspace {
 
   // Synchronous filesystem methods for Codebuff compatibility
   existsSync(path: string): boolean {
+    this.checkSyncAllowed('existsSync')
     const startTime = Date.now()
     this.validatePath(path)
     const fullPath = this.resolvePath(path)
@@ -847,6 +1298,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   mkdirSync(path: string, options?: { recursive?: boolean }): void {
+    this.checkSyncAllowed('mkdirSync')
     const startTime = Date.now()
     this.validatePath(path)
 
@@ -893,6 +1345,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   readdirSync(path: string, options?: { withFileTypes?: boolean }): string[] | Dirent[] {
+    this.checkSyncAllowed('readdirSync')
     const startTime = Date.now()
     this.validatePath(path)
     const fullPath = this.resolvePath(path)
@@ -932,6 +1385,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   readFileSync(path: string, encoding?: NodeJS.BufferEncoding | null): string | Buffer {
+    this.checkSyncAllowed('readFileSync')
     const startTime = Date.now()
     this.validatePath(path)
 
@@ -983,6 +1437,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   statSync(path: string): Stats {
+    this.checkSyncAllowed('statSync')
     const startTime = Date.now()
     this.validatePath(path)
     const fullPath = this.resolvePath(path)
@@ -1017,6 +1472,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   writeFileSync(path: string, content: string | Buffer, encoding: NodeJS.BufferEncoding = 'utf-8'): void {
+    this.checkSyncAllowed('writeFileSync')
     const startTime = Date.now()
     this.validatePath(path)
 
@@ -1074,7 +1530,7 @@ export class LocalWorkspace extends BaseWorkspace {
   }
 
   // Promises API for Codebuff compatibility
-  promises = {
+  promises: WorkspacePromises = {
     readdir: async (path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]> => {
       this.validatePath(path)
       const fullPath = this.resolvePath(path)
@@ -1087,7 +1543,12 @@ export class LocalWorkspace extends BaseWorkspace {
       } catch (error) {
         throw this.wrapError(error, 'Read directory (async)', ERROR_CODES.READ_FAILED, `readdir ${path}`)
       }
-    }
+    },
+    readFile: (path, encoding) => this.readFile(path, encoding),
+    writeFile: (path, content, encoding) => this.writeFile(path, content, encoding),
+    stat: (path) => this.stat(path),
+    mkdir: (path, options) => this.mkdir(path, options),
+    exists: (path) => this.exists(path),
   }
 
   /**
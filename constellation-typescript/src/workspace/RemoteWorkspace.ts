@@ -1,10 +1,49 @@
 import type { Dirent, Stats } from 'fs'
+import { posix } from 'path'
+import type { Readable } from 'stream'
 import type { RemoteBackend } from '../backends/RemoteBackend.js'
 import { ERROR_CODES } from '../constants.js'
 import type { OperationLogEntry, OperationsLogger, OperationType } from '../logging/types.js'
 import { shouldLogOperation } from '../logging/types.js'
 import { FileSystemError } from '../types.js'
-import { BaseWorkspace, type ExecOptions, type WorkspaceConfig } from './Workspace.js'
+import { editGrowth, type ApplyEditsOptions, type ApplyEditsResult, type TextEdit } from '../utils/applyEdits.js'
+import { ChangeFeed, watchChanges, type WatchEvent, type WatchOptions, type WorkspaceWatcher } from '../utils/ChangeFeed.js'
+import { getLogger } from '../utils/logger.js'
+import { incrementCounter, recordDuration, startTimer } from '../utils/metrics.js'
+import { MetadataCache, type CachedMetadata } from '../utils/MetadataCache.js'
+import type { SearchOptions, SearchResult } from '../utils/search.js'
+import { SEARCH_INDEX_DIRECTORY } from '../utils/TrigramIndex.js'
+import { quotaViolation, type WorkspaceUsage } from '../utils/UsageTracker.js'
+import type { WalkOptions, WalkResult } from '../utils/walk.js'
+import type { ExecStream, ExecStreamOptions } from './ExecStream.js'
+import {
+  BaseWorkspace,
+  type BatchOperation,
+  type BatchResult,
+  type ExecOptions,
+  type ReadStreamOptions,
+  type WorkspaceConfig,
+  type WorkspacePromises,
+} from './Workspace.js'
+
+/** Operation types batch entries are logged as */
+const BATCH_LOG_OPERATIONS: Record<BatchOperation['op'], OperationType> = {
+  read: 'readFile',
+  write: 'writeFile',
+  stat: 'stat',
+  exists: 'exists',
+  readdir: 'readdir',
+}
+
+/** Labels of the timed operations in the workspace operation metric */
+const METRIC_LABELS = {
+  exec: { backend: 'remote', op: 'exec' },
+  readFile: { backend: 'remote', op: 'readFile' },
+  writeFile: { backend: 'remote', op: 'writeFile' },
+} as const
+
+/** How long to wait before asking the agent for a change watcher again after it could not start one */
+const WATCH_RETRY_MS = 30_000
 
 /**
  * Remote filesystem workspace implementation
@@ -14,6 +53,18 @@ export class RemoteWorkspace extends BaseWorkspace {
   declare readonly backend: RemoteBackend
   private readonly operationsLogger?: OperationsLogger
 
+  /** exists/stat/readdir cache, when enabled with WorkspaceConfig.metadataCache */
+  private readonly metadataCache?: MetadataCache
+  /** Whether the agent keeps a search index for this workspace (WorkspaceConfig.searchIndex) */
+  private readonly searchIndex: boolean
+  /** Agent change events for the workspace tree, shared by watch() and the metadata cache */
+  private readonly changeFeed: ChangeFeed
+  private stopWatching: (() => void) | null = null
+  private watchPending = false
+  private watchRetryAt = 0
+  /** Byte limit for this workspace from config.quotaBytes */
+  private readonly quotaBytes?: number
+
   constructor(
     backend: RemoteBackend,
     userId: string,
@@ -23,6 +74,110 @@ export class RemoteWorkspace extends BaseWorkspace {
   ) {
     super(backend, userId, workspaceName, workspacePath, config)
     this.operationsLogger = config?.operationsLogger
+    this.searchIndex = config?.searchIndex ?? false
+    this.quotaBytes = config?.quotaBytes
+    if (config?.metadataCache) {
+      this.metadataCache = new MetadataCache(config.metadataCache === true ? {} : config.metadataCache)
+    }
+    this.changeFeed = new ChangeFeed(async (emit, end) => {
+      const stop = await this.backend.watchTree(this.workspacePath, (event) => {
+        if (event.closed) {
+          end()
+        } else {
+          emit(event.paths && event.paths.map(path => posix.relative(this.workspacePath, path)))
+        }
+      })
+      if (!stop) {
+        throw new Error('watching needs the remote agent')
+      }
+      return stop
+    })
+  }
+
+  /**
+   * Answer a metadata lookup from the cache, or load and cache it
+   * Without a cache this is just `load()`.
+   */
+  private async cachedMetadata<K extends keyof CachedMetadata>(
+    kind: K,
+    remotePath: string,
+    load: () => Promise<CachedMetadata[K]>
+  ): Promise<CachedMetadata[K]> {
+    const cache = this.metadataCache
+    if (!cache) return load()
+
+    this.watchForChanges(cache)
+
+    const hit = cache.get(kind, remotePath)
+    if (hit !== undefined) return hit
+
+    const ticket = cache.ticket()
+    const value = await load()
+    cache.set(kind, remotePath, value, ticket)
+    return value
+  }
+
+  /**
+   * List a directory as Dirents in one round trip
+   * With the metadata cache, the entries' stats arrive in the same reply and
+   * prime the cache, so the stat calls that usually follow a listing are free.
+   */
+  private async listEntries(remotePath: string): Promise<Dirent[]> {
+    const cache = this.metadataCache
+    if (!cache) {
+      return (await this.backend.listDirectoryEntries(remotePath)).map(entry => entry.dirent)
+    }
+
+    this.watchForChanges(cache)
+    const ticket = cache.ticket()
+    const entries = await this.backend.listDirectoryEntries(remotePath, true)
+
+    cache.set('readdir', remotePath, entries.map(entry => entry.dirent.name), ticket)
+    for (const { dirent, stats } of entries) {
+      // lstat results only stand in for stat when the entry is not a symlink
+      if (!stats || stats.isSymbolicLink()) continue
+      const path = posix.join(remotePath, dirent.name)
+      cache.set('stat', path, stats, ticket)
+      cache.set('exists', path, true, ticket)
+    }
+    return entries.map(entry => entry.dirent)
+  }
+
+  /**
+   * Start the remote change watcher for the metadata cache in the background
+   * Until it is running, entries use the short unwatched TTL.
+   */
+  private watchForChanges(cache: MetadataCache): void {
+    if (this.stopWatching || this.watchPending || Date.now() < this.watchRetryAt) return
+    this.watchPending = true
+
+    this.changeFeed.subscribe((event) => {
+      if (event.paths) {
+        for (const path of event.paths) cache.invalidate(posix.join(this.workspacePath, path))
+        return
+      }
+      // Lost the watcher (e.g. reconnect) or came back after losing it; the
+      // feed restarts on its own, and entries use the short TTL until then
+      cache.watched = this.changeFeed.active && !event.closed
+      cache.clear()
+      if (event.closed) {
+        this.stopWatching = null
+      }
+    }).then((stop) => {
+      if (stop) {
+        // Changes made before the watch started were not reported
+        this.stopWatching = stop
+        cache.watched = true
+        cache.clear()
+      } else {
+        this.watchRetryAt = Date.now() + WATCH_RETRY_MS
+      }
+    }, (error) => {
+      getLogger().debug('[RemoteWorkspace] Failed to start metadata watcher', error)
+      this.watchRetryAt = Date.now() + WATCH_RETRY_MS
+    }).finally(() => {
+      this.watchPending = false
+    })
   }
 
   /**
@@ -50,6 +205,7 @@ export class RemoteWorkspace extends BaseWorkspace {
   async exec(command: string, options?: ExecOptions): Promise<string | Buffer> {
     const encoding = options?.encoding ?? 'utf8'
     const startTime = Date.now()
+    const timer = startTimer()
 
     if (!command.trim()) {
       throw new FileSystemError('Command cannot be empty', ERROR_CODES.EMPTY_COMMAND)
@@ -63,8 +219,12 @@ export class RemoteWorkspace extends BaseWorkspace {
     try {
       // Use RemoteBackend's SSH execution method
       // (This is a RemoteBackend-specific method, not part of the FileSystemBackend interface)
-      const result = await this.backend.execInWorkspace(this.workspacePath, command, encoding, mergedEnv)
+      // Commands can change any file, so cached metadata is dropped before and after
+      this.metadataCache?.clear()
+      const result = await this.backend.execInWorkspace(this.workspacePath, command, encoding, mergedEnv, options?.maxBufferedBytes)
+        .finally(() => this.metadataCache?.clear())
 
+      recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.exec)
       if (this.shouldLog('exec')) {
         await this.logOperation({
           timestamp: new Date(),
@@ -92,14 +252,87 @@ export class RemoteWorkspace extends BaseWorkspace {
     }
   }
 
+  async execStream(command: string, options?: ExecStreamOptions): Promise<ExecStream> {
+    const startTime = Date.now()
+
+    if (!command.trim()) {
+      throw new FileSystemError('Command cannot be empty', ERROR_CODES.EMPTY_COMMAND)
+    }
+
+    // Merge workspace-level env with per-call env (per-call takes precedence)
+    const mergedEnv = options?.env
+      ? { ...this.customEnv, ...options.env }
+      : this.customEnv
+
+    this.metadataCache?.clear()
+    const stream = await this.backend.execStreamInWorkspace(this.workspacePath, command, { ...options, env: mergedEnv })
+    if (this.metadataCache) {
+      stream.result.finally(() => this.metadataCache?.clear()).catch(() => {})
+    }
+
+    if (this.shouldLog('exec')) {
+      stream.result.then((result) => this.logOperation({
+        timestamp: new Date(),
+        operation: 'exec',
+        command,
+        stdout: result.stdout.trim(),
+        stderr: result.stderr.trim(),
+        exitCode: result.exitCode ?? undefined,
+        success: result.exitCode === 0,
+        durationMs: Date.now() - startTime,
+      }), (error: Error) => this.logOperation({
+        timestamp: new Date(),
+        operation: 'exec',
+        command,
+        success: false,
+        error: error.message,
+        durationMs: Date.now() - startTime,
+      })).catch((err) => {
+        getLogger().error('Failed to log operation', err)
+      })
+    }
+
+    return stream
+  }
+
+  /** Whether writes need a quota check first */
+  private get quotaEnforced(): boolean {
+    return this.quotaBytes !== undefined || this.backend.options.userQuotaBytes !== undefined
+  }
+
+  /**
+   * Reject a write that would take the workspace or the user past a quota
+   * Costs one agent round trip (a find without the agent) per write.
+   * @param remotePath - Resolved path of the file being written
+   * @param size - New size of the file, or the bytes it grows by when
+   *   `relativeGrowth` is set
+   * @throws {FileSystemError} QUOTA_EXCEEDED when a quota would be exceeded
+   */
+  private async checkQuota(remotePath: string, size: number, command: string, relativeGrowth = false): Promise<void> {
+    if (!this.quotaEnforced) return
+
+    const userQuotaBytes = this.backend.options.userQuotaBytes
+    const file = relativeGrowth ? undefined : posix.relative(this.workspacePath, remotePath)
+    const report = await this.backend.workspaceUsage(this.workspacePath, file, userQuotaBytes !== undefined)
+    const growth = relativeGrowth ? size : size - (report.fileSize ?? 0)
+
+    const violation = quotaViolation(report, growth, this.quotaBytes, report.user ?? null, userQuotaBytes)
+    if (violation) {
+      incrementCounter('constellation_quota_rejections', { backend: 'remote' })
+      throw new FileSystemError(violation, ERROR_CODES.QUOTA_EXCEEDED, command)
+    }
+  }
+
   async write(path: string, content: string | Buffer): Promise<void> {
     const startTime = Date.now()
     this.validatePath(path)
     const remotePath = this.resolvePath(path)
+    await this.checkQuota(remotePath, Buffer.isBuffer(content) ? content.length : Buffer.byteLength(content), `write ${path}`)
 
     try {
       // Use SFTP to write file
       await this.backend.writeFile(remotePath, content)
+        .finally(() => this.metadataCache?.invalidate(remotePath))
 
       if (this.shouldLog('write')) {
         await this.logOperation({
@@ -134,6 +367,7 @@ export class RemoteWorkspace extends BaseWorkspace {
     try {
       // Use SSH exec to create directory
       await this.backend.createDirectory(remotePath, recursive)
+        .finally(() => this.metadataCache?.invalidateWithAncestors(remotePath))
 
       if (this.shouldLog('mkdir')) {
         await this.logOperation({
@@ -167,6 +401,7 @@ export class RemoteWorkspace extends BaseWorkspace {
     try {
       // Use SSH exec to touch file
       await this.backend.touchFile(remotePath)
+        .finally(() => this.metadataCache?.invalidate(remotePath))
 
       if (this.shouldLog('touch')) {
         await this.logOperation({
@@ -198,7 +433,7 @@ export class RemoteWorkspace extends BaseWorkspace {
     const remotePath = this.resolvePath(path)
 
     try {
-      const result = await this.backend.pathExists(remotePath)
+      const result = await this.cachedMetadata('exists', remotePath, () => this.backend.pathExists(remotePath))
 
       if (this.shouldLog('exists')) {
         await this.logOperation({
@@ -237,7 +472,7 @@ export class RemoteWorkspace extends BaseWorkspace {
     const remotePath = this.resolvePath(path)
 
     try {
-      const result = await this.backend.pathStat(remotePath)
+      const result = await this.cachedMetadata('stat', remotePath, () => this.backend.pathStat(remotePath))
 
       if (this.shouldLog('stat')) {
         await this.logOperation({
@@ -270,16 +505,10 @@ export class RemoteWorkspace extends BaseWorkspace {
     this.validatePath(path)
     const remotePath = this.resolvePath(path)
 
-    if (options?.withFileTypes) {
-      // Remote backend doesn't support withFileTypes, so we need to throw
-      throw new FileSystemError(
-        'withFileTypes option is not supported for remote workspaces',
-        ERROR_CODES.INVALID_CONFIGURATION
-      )
-    }
-
     try {
-      const result = await this.backend.listDirectory(remotePath)
+      const result = options?.withFileTypes
+        ? await this.listEntries(remotePath)
+        : await this.cachedMetadata('readdir', remotePath, () => this.backend.listDirectory(remotePath))
 
       if (this.shouldLog('readdir')) {
         await this.logOperation({
@@ -309,6 +538,7 @@ export class RemoteWorkspace extends BaseWorkspace {
 
   async readFile(path: string, encoding?: NodeJS.BufferEncoding | null): Promise<string | Buffer> {
     const startTime = Date.now()
+    const timer = startTimer()
     this.validatePath(path)
     const remotePath = this.resolvePath(path)
 
@@ -320,6 +550,7 @@ export class RemoteWorkspace extends BaseWorkspace {
         result = await this.backend.readFile(remotePath)
       }
 
+      recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.readFile)
       if (this.shouldLog('readFile')) {
         await this.logOperation({
           timestamp: new Date(),
@@ -346,15 +577,55 @@ export class RemoteWorkspace extends BaseWorkspace {
     }
   }
 
+  async createReadStream(path: string, options: ReadStreamOptions = {}): Promise<Readable> {
+    const startTime = Date.now()
+    this.validatePath(path)
+    this.validateReadRange(path, options)
+    const remotePath = this.resolvePath(path)
+
+    try {
+      // Pipelined SFTP reads, paused while the consumer is behind
+      const stream = await this.backend.createReadStream(remotePath, { start: options.start, end: options.end })
+
+      if (this.shouldLog('read')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'read',
+          command: path,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return stream
+    } catch (error) {
+      if (this.shouldLog('read')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'read',
+          command: path,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw error
+    }
+  }
+
   async writeFile(path: string, content: string | Buffer, encoding: NodeJS.BufferEncoding = 'utf-8'): Promise<void> {
     const startTime = Date.now()
+    const timer = startTimer()
     this.validatePath(path)
     const remotePath = this.resolvePath(path)
+    await this.checkQuota(remotePath, Buffer.isBuffer(content) ? content.length : Buffer.byteLength(content, encoding), `writeFile ${path}`)
 
     try {
       // Remote backend's writeFile handles both string and Buffer with encoding
       await this.backend.writeFile(remotePath, content, encoding)
+        .finally(() => this.metadataCache?.invalidate(remotePath))
 
+      recordDuration('constellation_workspace_operation', timer, METRIC_LABELS.writeFile)
       if (this.shouldLog('writeFile')) {
         await this.logOperation({
           timestamp: new Date(),
@@ -379,12 +650,203 @@ export class RemoteWorkspace extends BaseWorkspace {
     }
   }
 
+  async batch(operations: BatchOperation[]): Promise<BatchResult[]> {
+    // Writes under a quota go through writeFile() to be checked one by one
+    if (this.quotaEnforced && operations.some(operation => operation.op === 'write')) {
+      return super.batch(operations)
+    }
+
+    const startTime = Date.now()
+    const results: Array<BatchResult | undefined> = new Array(operations.length)
+    const remoteOperations: BatchOperation[] = []
+    const remoteIndexes: number[] = []
+
+    operations.forEach((operation, index) => {
+      try {
+        this.validatePath(operation.path)
+        remoteOperations.push({ ...operation, path: this.resolvePath(operation.path) })
+        remoteIndexes.push(index)
+      } catch (error) {
+        results[index] = { ok: false, error: error as Error }
+      }
+    })
+
+    // Without the agent, fall back to individual calls pipelined over the shared SFTP session
+    const remoteResults = remoteOperations.length > 0
+      ? await this.backend.batchOperations(remoteOperations)
+      : []
+    if (!remoteResults) {
+      return super.batch(operations)
+    }
+
+    for (const operation of remoteOperations) {
+      if (operation.op === 'write') this.metadataCache?.invalidate(operation.path)
+    }
+
+    remoteResults.forEach((result, i) => {
+      results[remoteIndexes[i]!] = result
+    })
+
+    const durationMs = Date.now() - startTime
+    for (const [index, operation] of operations.entries()) {
+      const result = results[index]!
+      const logOperation = BATCH_LOG_OPERATIONS[operation.op]
+      if (this.shouldLog(logOperation)) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: logOperation,
+          command: operation.path,
+          success: result.ok,
+          error: result.ok ? undefined : result.error.message,
+          durationMs,
+        })
+      }
+    }
+
+    return results as BatchResult[]
+  }
+
+  async search(options: SearchOptions): Promise<SearchResult> {
+    const startTime = Date.now()
+    const searchPath = options.path ?? '.'
+    this.validatePath(searchPath)
+    const remotePath = this.resolvePath(searchPath)
+
+    try {
+      const prefix = remotePath === this.workspacePath ? '' : remotePath.slice(this.workspacePath.length + 1)
+      const result = await this.backend.searchFiles(remotePath, options, prefix, this.searchIndex ? this.workspacePath : undefined)
+
+      if (this.shouldLog('search')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'search',
+          command: `${options.pattern} ${searchPath}`,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('search')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'search',
+          command: `${options.pattern} ${searchPath}`,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw error
+    }
+  }
+
+  async walk(options: WalkOptions = {}): Promise<WalkResult> {
+    const startTime = Date.now()
+    const walkPath = options.path ?? '.'
+    this.validatePath(walkPath)
+    const remotePath = this.resolvePath(walkPath)
+
+    try {
+      const result = await this.backend.walkTree(remotePath, options)
+
+      if (this.shouldLog('walk')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'walk',
+          command: walkPath,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('walk')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'walk',
+          command: walkPath,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw error
+    }
+  }
+
+  async applyEdits(path: string, edits: TextEdit[], options: ApplyEditsOptions = {}): Promise<ApplyEditsResult> {
+    const startTime = Date.now()
+    this.validatePath(path)
+    const remotePath = this.resolvePath(path)
+    if (!options.dryRun) {
+      await this.checkQuota(remotePath, editGrowth(edits), `edit ${path}`, true)
+    }
+
+    try {
+      const result = await this.backend.applyEdits(remotePath, edits, options, path)
+        .finally(() => this.metadataCache?.invalidate(remotePath))
+
+      if (this.shouldLog('edit')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'edit',
+          command: path,
+          success: true,
+          durationMs: Date.now() - startTime,
+        })
+      }
+
+      return result
+    } catch (error) {
+      if (this.shouldLog('edit')) {
+        await this.logOperation({
+          timestamp: new Date(),
+          operation: 'edit',
+          command: path,
+          success: false,
+          error: error instanceof Error ? error.message : String(error),
+          durationMs: Date.now() - startTime,
+        })
+      }
+      throw error
+    }
+  }
+
+  async watch(path: string, options: WatchOptions, listener: (event: WatchEvent) => void): Promise<WorkspaceWatcher> {
+    this.validatePath(path)
+    const watchPath = posix.relative(this.workspacePath, this.resolvePath(path))
+    try {
+      return await watchChanges(this.changeFeed, watchPath, options, listener, SEARCH_INDEX_DIRECTORY)
+    } catch (error) {
+      throw new FileSystemError(
+        `Watch failed: ${error instanceof Error ? error.message : String(error)}`,
+        ERROR_CODES.WATCH_FAILED,
+        `watch ${path}`
+      )
+    }
+  }
+
+  async usage(): Promise<WorkspaceUsage> {
+    const { bytes, files } = await this.backend.workspaceUsage(this.workspacePath)
+    return { bytes, files }
+  }
+
   async delete(): Promise<void> {
     const startTime = Date.now()
+    this.stopWatching = null
+    // Ends watch() callers too, with a closed event
+    this.changeFeed.close()
+    if (this.metadataCache) {
+      this.metadataCache.watched = false
+      this.metadataCache.clear()
+    }
 
     try {
-      // Delete the entire workspace directory
-      await this.backend.deleteDirectory(this.workspacePath)
+      // Renamed away at once; the files are removed in the background on the host
+      await this.backend.trashDirectory(this.workspacePath)
 
       if (this.shouldLog('delete')) {
         await this.logOperation({
@@ -488,20 +950,21 @@ export class RemoteWorkspace extends BaseWorkspace {
   }
 
   // Promises API for Codebuff compatibility
-  promises = {
+  promises: WorkspacePromises = {
     readdir: async (path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]> => {
       this.validatePath(path)
       const remotePath = this.resolvePath(path)
 
       if (options?.withFileTypes) {
-        // Remote backend doesn't support withFileTypes, so we need to throw
-        throw new FileSystemError(
-          'withFileTypes option is not supported for remote workspaces',
-          ERROR_CODES.INVALID_CONFIGURATION
-        )
+        return this.listEntries(remotePath)
       }
 
-      return this.backend.listDirectory(remotePath)
-    }
+      return this.cachedMetadata('readdir', remotePath, () => this.backend.listDirectory(remotePath))
+    },
+    readFile: (path, encoding) => this.readFile(path, encoding),
+    writeFile: (path, content, encoding) => this.writeFile(path, content, encoding),
+    stat: (path) => this.stat(path),
+    mkdir: (path, options) => this.mkdir(path, options),
+    exists: (path) => this.exists(path),
   }
 }
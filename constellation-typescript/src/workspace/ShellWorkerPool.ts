@@ -0,0 +1,247 @@
+import type { ChildProcess } from 'child_process'
+import { randomBytes } from 'crypto'
+import { ERROR_CODES } from '../constants.js'
+import { FileSystemError } from '../types.js'
+import type { HeadTailBuffer } from '../utils/HeadTailBuffer.js'
+import { shellQuote } from '../utils/search.js'
+
+/** Variable names a worker can export; others make the command fall back to a fresh shell */
+const ENV_NAME = /^[A-Za-z_][A-Za-z0-9_]*$/
+
+/** Longest exit status line: three digits and a newline */
+const MAX_STATUS_LENGTH = 4
+
+const EMPTY = Buffer.alloc(0)
+
+/**
+ * One command for a shell worker
+ */
+export interface ShellCommand {
+  command: string
+  /** Directory to run in */
+  cwd: string
+  /** Variables to set, or unset when undefined, on top of the worker's environment */
+  env?: Record<string, string | undefined>
+  stdout: HeadTailBuffer
+  stderr: HeadTailBuffer
+}
+
+/**
+ * Whether a worker can run a command with these variables
+ */
+export function canExportEnv(env: Record<string, string | undefined> | undefined): boolean {
+  return !env || Object.keys(env).every(name => ENV_NAME.test(name))
+}
+
+/**
+ * Output of one worker stream up to an end-of-command marker
+ * Bytes that could be the start of a marker split across chunks are held
+ * back until the next chunk shows whether they are.
+ */
+class MarkedOutput {
+  sink: HeadTailBuffer | null = null
+  /** Bytes after the marker once it was seen, null before */
+  trailer: Buffer | null = null
+  private held = EMPTY
+
+  constructor(private readonly marker: Buffer) {}
+
+  reset(sink: HeadTailBuffer): void {
+    this.sink = sink
+    this.trailer = null
+    this.held = EMPTY
+  }
+
+  push(chunk: Buffer): void {
+    if (!this.sink) return
+    if (this.trailer) {
+      this.trailer = Buffer.concat([this.trailer, chunk]).subarray(0, MAX_STATUS_LENGTH)
+      return
+    }
+
+    const data = this.held.length > 0 ? Buffer.concat([this.held, chunk]) : chunk
+    const index = data.indexOf(this.marker)
+    if (index === -1) {
+      const keep = Math.min(data.length, this.marker.length - 1)
+      this.sink.append(data.subarray(0, data.length - keep))
+      // Copy, so the held bytes don't pin a large chunk
+      this.held = Buffer.from(data.subarray(data.length - keep))
+      return
+    }
+    this.sink.append(data.subarray(0, index))
+    this.trailer = Buffer.from(data.subarray(index + this.marker.length, index + this.marker.length + MAX_STATUS_LENGTH))
+    this.held = EMPTY
+  }
+}
+
+/**
+ * A long-lived shell that runs one command at a time from its stdin
+ *
+ * Each command runs in a subshell, so `cd`, variable assignments, `exit`
+ * and traps end with it and the next command starts from the worker's
+ * environment in the workspace directory. After the subshell, the worker
+ * prints a marker with a random per-worker token on stdout, followed by the
+ * exit status, and one on stderr; output is whatever came before them.
+ */
+class ShellWorker {
+  private readonly token = randomBytes(16).toString('hex')
+  private readonly stdout: MarkedOutput
+  private readonly stderr: MarkedOutput
+  private current: { resolve: (code: number) => void; reject: (error: Error) => void } | null = null
+  exited = false
+
+  constructor(private readonly child: ChildProcess, private readonly onExit: (worker: ShellWorker) => void) {
+    // Our printf puts a newline before each marker, so output not ending in
+    // one is still recognised; the newline is not part of the output
+    this.stdout = new MarkedOutput(Buffer.from(`\n${this.token} `))
+    this.stderr = new MarkedOutput(Buffer.from(`\n${this.token}\n`))
+
+    child.stdout!.on('data', (chunk: Buffer) => {
+      this.stdout.push(chunk)
+      this.settle()
+    })
+    child.stderr!.on('data', (chunk: Buffer) => {
+      this.stderr.push(chunk)
+      this.settle()
+    })
+    // Writes to a worker that just died fail here; 'exit' reports it
+    child.stdin!.on('error', () => {})
+    child.on('error', error => this.exit(error))
+    // 'exit' rather than 'close': orphaned children of a command may keep the pipes open
+    child.on('exit', (code, signal) => this.exit(new FileSystemError(
+      `Shell worker exited (${signal ?? `code ${code}`}) while running a command`,
+      ERROR_CODES.EXEC_ERROR
+    )))
+    this.setRef(false)
+  }
+
+  run(command: ShellCommand): Promise<number> {
+    if (this.exited) {
+      return Promise.reject(new FileSystemError('Shell worker has exited', ERROR_CODES.EXEC_ERROR, command.command))
+    }
+    this.stdout.reset(command.stdout)
+    this.stderr.reset(command.stderr)
+
+    const lines = [`( cd ${shellQuote(command.cwd)} || exit 126`]
+    for (const [name, value] of Object.entries(command.env ?? {})) {
+      lines.push(value === undefined ? `unset ${name}` : `export ${name}=${shellQuote(value)}`)
+    }
+    // eval keeps a command with a syntax error from swallowing the markers
+    lines.push(
+      `eval ${shellQuote(command.command)}`,
+      ') </dev/null',
+      `printf '\\n%s %d\\n' ${this.token} $?`,
+      `printf '\\n%s\\n' ${this.token} >&2`,
+      ''
+    )
+
+    return new Promise((resolve, reject) => {
+      this.current = { resolve, reject }
+      // Keep the process alive while a command runs, not while idle
+      this.setRef(true)
+      this.child.stdin!.write(lines.join('\n'))
+    })
+  }
+
+  kill(): void {
+    if (this.exited) return
+    this.child.kill('SIGKILL')
+  }
+
+  private settle(): void {
+    if (!this.current) return
+    const status = this.stdout.trailer
+    const newline = status?.indexOf(0x0a) ?? -1
+    if (newline === -1 || !this.stderr.trailer) return
+
+    const { resolve } = this.current
+    this.current = null
+    this.stdout.sink = null
+    this.stderr.sink = null
+    this.setRef(false)
+    resolve(Number(status!.subarray(0, newline).toString()))
+  }
+
+  private exit(error: Error): void {
+    if (this.exited) return
+    this.exited = true
+    this.current?.reject(error)
+    this.current = null
+    this.onExit(this)
+  }
+
+  private setRef(ref: boolean): void {
+    for (const stream of [this.child.stdin, this.child.stdout, this.child.stderr]) {
+      const handle = stream as unknown as { ref?: () => void; unref?: () => void } | null
+      if (ref) handle?.ref?.()
+      else handle?.unref?.()
+    }
+    if (ref) this.child.ref()
+    else this.child.unref()
+  }
+}
+
+/**
+ * Warm shells that run exec() commands without spawning a process each time
+ *
+ * Workers start on first use, up to `maxWorkers`, and are reused. When all
+ * of them are busy, run() returns null and the caller spawns a shell as
+ * usual, so concurrency isn't capped at the pool size. A worker that dies
+ * (killed, or a command that killed its parent) fails its command and is
+ * replaced on a later call.
+ *
+ * Commands get /dev/null as stdin. Background jobs that are still writing
+ * when the command finishes may have their output attributed to the
+ * worker's next command.
+ */
+export class ShellWorkerPool {
+  private readonly workers = new Set<ShellWorker>()
+  private readonly idle: ShellWorker[] = []
+  private closed = false
+
+  /**
+   * @param maxWorkers - Most workers kept at once
+   * @param spawnWorker - Start a shell reading commands from stdin, with piped stdio
+   */
+  constructor(private readonly maxWorkers: number, private readonly spawnWorker: () => ChildProcess) {}
+
+  /** Workers running or idle */
+  get size(): number {
+    return this.workers.size
+  }
+
+  /**
+   * Run a command on an idle worker, starting one if the pool has room
+   * @returns Exit status, or null when no worker is free
+   * @throws {FileSystemError} When the worker dies while running the command
+   */
+  run(command: ShellCommand): Promise<number> | null {
+    if (this.closed || !canExportEnv(command.env)) return null
+
+    let worker = this.idle.pop()
+    if (!worker) {
+      if (this.workers.size >= this.maxWorkers) return null
+      worker = new ShellWorker(this.spawnWorker(), exited => {
+        this.workers.delete(exited)
+        const index = this.idle.indexOf(exited)
+        if (index !== -1) this.idle.splice(index, 1)
+      })
+      this.workers.add(worker)
+    }
+
+    const running = worker
+    return running.run(command).finally(() => {
+      if (!running.exited && !this.closed) this.idle.push(running)
+    })
+  }
+
+  /**
+   * Kill every worker; commands still running on them fail
+   */
+  close(): void {
+    this.closed = true
+    for (const worker of this.workers) worker.kill()
+    this.workers.clear()
+    this.idle.length = 0
+  }
+}
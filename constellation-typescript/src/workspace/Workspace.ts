@@ -1,9 +1,18 @@
 import type { Dirent, Stats } from 'fs'
+import type { Readable } from 'stream'
 import type { FileSystemBackend } from '../backends/types.js'
 import { ERROR_CODES } from '../constants.js'
 import type { OperationsLogger } from '../logging/types.js'
 import { FileSystemError } from '../types.js'
+import type { MetadataCacheOptions } from '../utils/MetadataCache.js'
+import { runInKeyOrder } from '../utils/pathOrdering.js'
 import { resolvePathSafely } from '../utils/pathValidator.js'
+import type { ApplyEditsOptions, ApplyEditsResult, TextEdit } from '../utils/applyEdits.js'
+import type { WatchEvent, WatchOptions, WorkspaceWatcher } from '../utils/ChangeFeed.js'
+import type { SearchOptions, SearchResult } from '../utils/search.js'
+import type { WorkspaceUsage } from '../utils/UsageTracker.js'
+import type { WalkOptions, WalkResult } from '../utils/walk.js'
+import type { ExecStream, ExecStreamOptions } from './ExecStream.js'
 
 /**
  * Options for the exec command
@@ -13,6 +22,22 @@ export interface ExecOptions {
   encoding?: 'utf8' | 'buffer'
   /** Custom environment variables for this specific command execution */
   env?: Record<string, string | undefined>
+  /**
+   * Keep at most this many bytes of stdout and of stderr while the command
+   * runs: the first and last halves, with the middle dropped. Without it,
+   * text output is still bounded by the backend's maxOutputLength.
+   */
+  maxBufferedBytes?: number
+}
+
+/**
+ * Byte range for createReadStream, inclusive like fs.createReadStream
+ */
+export interface ReadStreamOptions {
+  /** First byte to read (default: 0) */
+  start?: number
+  /** Last byte to read, inclusive (default: end of file) */
+  end?: number
 }
 
 /**
@@ -24,8 +49,106 @@ export interface WorkspaceConfig {
 
   /** Optional operations logger for tracking workspace operations */
   operationsLogger?: OperationsLogger
+
+  /**
+   * Cache exists/stat/readdir results (remote workspaces only; default: off).
+   * The cache is invalidated by the workspace's own writes and commands, and
+   * by a change watcher on the remote host when the agent is available.
+   */
+  metadataCache?: boolean | MetadataCacheOptions
+
+  /**
+   * Keep a trigram index of file contents so search() reads only the files
+   * that can match (default: off). Stored in `.constellationfs/` in the
+   * workspace and kept current by a file watcher. Remote workspaces need the
+   * agent.
+   */
+  searchIndex?: boolean
+
+  /**
+   * What the blocking *Sync methods do (local workspaces only; default: 'allow').
+   * 'warn' logs the first call of each method, 'deny' throws so that one
+   * tenant can't stall the event loop for everyone else. `workspace.promises`
+   * has non-blocking versions of all of them.
+   */
+  syncOperations?: SyncOperationsPolicy
+
+  /**
+   * Keep up to this many warm shells that run exec() commands without
+   * spawning a process each time (local workspaces only; default: 0, a new
+   * shell per command). Each command runs in a subshell of a worker, so
+   * cwd and environment changes don't carry over; its stdin is /dev/null.
+   * When every worker is busy, commands spawn a shell as usual.
+   */
+  shellWorkers?: number
+
+  /**
+   * Reject writes that would grow the workspace beyond this many bytes
+   * (apparent file sizes; default: no quota). write(), writeFile() and
+   * applyEdits() fail with QUOTA_EXCEEDED; commands and the *Sync methods
+   * are counted in usage() but not stopped.
+   *
+   * Usage is kept current from a recursive watcher on the workspace (on the
+   * remote host with the agent). When the tree can't be watched, e.g. because
+   * the inotify watch limit is reached, a warning is logged and quota checks
+   * walk the whole tree again, at most every 10 seconds. Remote workspaces
+   * without the agent walk it with find on every checked write.
+   */
+  quotaBytes?: number
 }
 
+export type SyncOperationsPolicy = 'allow' | 'warn' | 'deny'
+
+/**
+ * Promise-based counterparts of the sync methods, shaped like Node's fs.promises
+ * Prefer these on servers: they never block the event loop.
+ */
+export interface WorkspacePromises {
+  /**
+   * Read directory contents
+   * @param path - Relative path to the directory within the workspace
+   * @param options - Options for reading directory
+   * @returns Promise resolving to array of directory entries
+   */
+  readdir(path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]>
+
+  /** Same as Workspace.readFile */
+  readFile(path: string, encoding?: NodeJS.BufferEncoding | null): Promise<string | Buffer>
+
+  /** Same as Workspace.writeFile */
+  writeFile(path: string, content: string | Buffer, encoding?: NodeJS.BufferEncoding): Promise<void>
+
+  /** Same as Workspace.stat */
+  stat(path: string): Promise<Stats>
+
+  /** Same as Workspace.mkdir */
+  mkdir(path: string, options?: { recursive?: boolean }): Promise<void>
+
+  /** Same as Workspace.exists */
+  exists(path: string): Promise<boolean>
+}
+
+/**
+ * A single operation in a workspace batch
+ */
+export type BatchOperation =
+  | { op: 'read'; path: string; encoding?: NodeJS.BufferEncoding | null }
+  | { op: 'write'; path: string; content: string | Buffer; encoding?: NodeJS.BufferEncoding }
+  | { op: 'stat'; path: string }
+  | { op: 'exists'; path: string }
+  | { op: 'readdir'; path: string }
+
+/**
+ * Outcome of one batch operation. Failures are reported per operation
+ * rather than rejecting the whole batch.
+ *
+ * `value` is the file contents for 'read', Stats for 'stat', a boolean for
+ * 'exists', entry names for 'readdir' and undefined for 'write'.
+ */
+export type BatchResult =
+  | { ok: true; value: string | Buffer | Stats | boolean | string[] | undefined }
+  | { ok: false; error: Error }
+
 /**
  * Workspace interface representing an isolated directory environment
  * for executing commands and file operations
@@ -54,6 +177,17 @@ export interface Workspace {
    */
   exec(command: string, options?: ExecOptions): Promise<string | Buffer>
 
+  /**
+   * Execute a shell command and stream its output as it is produced
+   * Memory use is bounded: a slow consumer pauses the command, and only
+   * `retainBytes` of each stream is kept for the final result.
+   * @param command - The shell command to execute
+   * @param options - Environment variables, retention and buffering limits
+   * @returns Promise resolving to the running command's output stream
+   * @throws {FileSystemError} When the command is empty or fails the safety check
+   */
+  execStream(command: string, options?: ExecStreamOptions): Promise<ExecStream>
+
   /**
    * Write content to a file
    * @param path - Relative path to the file within the workspace
@@ -114,6 +248,18 @@ export interface Workspace {
    */
   readFile(path: string, encoding?: NodeJS.BufferEncoding | null): Promise<string | Buffer>
 
+  /**
+   * Open a stream over the raw bytes of a file
+   * Data is read in chunks as the consumer pulls it, so memory use does not
+   * depend on the file size. The file is opened before the promise resolves,
+   * so a missing file fails here rather than mid-stream.
+   * @param path - Relative path to the file within the workspace
+   * @param options - Byte range to read, e.g. for HTTP Range requests
+   * @returns Promise resolving to a Readable of Buffers
+   * @throws {FileSystemError} When the range is invalid or the file cannot be opened
+   */
+  createReadStream(path: string, options?: ReadStreamOptions): Promise<Readable>
+
   /**
    * Write file contents
    * @param path - Relative path to the file within the workspace
@@ -123,6 +269,80 @@ export interface Workspace {
    */
   writeFile(path: string, content: string | Buffer, encoding?: NodeJS.BufferEncoding): Promise<void>
 
+  /**
+   * Run several file operations in one call
+   * Operations on different paths are pipelined; operations on the same path
+   * run in submission order. Remote workspaces send the whole batch to the
+   * remote agent in a single round-trip when it is available.
+   * @param operations - Operations to run
+   * @returns Promise resolving to one result per operation, in the same order
+   */
+  batch(operations: BatchOperation[]): Promise<BatchResult[]>
+
+  /**
+   * Search file contents for lines matching a pattern
+   * Runs in-process (on the remote host through the agent for remote
+   * workspaces) instead of forking grep, skips binary files and honours
+   * .gitignore files by default.
+   * @param options - Pattern, directory, globs and limits
+   * @returns Promise resolving to structured matches sorted by path and line
+   * @throws {FileSystemError} When the pattern is invalid or the directory cannot be read
+   */
+  search(options: SearchOptions): Promise<SearchResult>
+
+  /**
+   * List a directory tree in one call
+   * Walks in parallel on the host (on the remote host through the agent for
+   * remote workspaces) instead of a readdir and stat per entry. Symlinks are
+   * reported, not followed.
+   * @param options - Directory, exclude patterns, depth and whether to include stats
+   * @returns Promise resolving to entries in depth-first order, relative to the walked directory
+   * @throws {FileSystemError} When the directory cannot be read
+   */
+  walk(options?: WalkOptions): Promise<WalkResult>
+
+  /**
+   * Replace exact text in a file
+   * Edits apply in order, each to the first occurrence of its oldText in the
+   * result of the previous ones; line endings are normalized to LF. The file
+   * is edited on the host (on the remote host through the agent for remote
+   * workspaces, so only the edits and the diff cross the network) and
+   * replaced atomically.
+   * @param path - File to edit
+   * @param edits - Replacements to apply
+   * @param options - dryRun to only compute the diff
+   * @returns Promise resolving to a unified diff of the change
+   * @throws {FileSystemError} EDIT_NOT_FOUND when an oldText does not occur; the file is left unchanged
+   */
+  applyEdits(path: string, edits: TextEdit[], options?: ApplyEditsOptions): Promise<ApplyEditsResult>
+
+  /**
+   * Watch a file or directory for changes made by anyone, including commands
+   * Changes are collected over `debounceMs` and delivered as one batch of
+   * workspace-relative paths. A batch with `paths: null` means the watcher
+   * lost track (too many changes, or a reconnect) and the caller should
+   * re-read what it cares about. Local workspaces use a recursive fs.watch
+   * (inotify on Linux); remote workspaces stream events from the agent. One
+   * watcher per workspace tree is shared with the search index and metadata
+   * cache.
+   * @param path - File or directory to watch
+   * @param options - Recursion and debounce window
+   * @param listener - Receives each batch; the last one has `closed: true`
+   * @returns Promise resolving to a handle that stops the watch
+   * @throws {FileSystemError} WATCH_FAILED when the tree can't be watched
+   *   (e.g. a remote host without the agent)
+   */
+  watch(path: string, options: WatchOptions, listener: (event: WatchEvent) => void): Promise<WorkspaceWatcher>
+
+  /**
+   * Disk usage of the workspace
+   * Scanned once, then kept current from the workspace's own writes and its
+   * change watcher, so repeated calls don't walk the tree. Remote workspaces
+   * track usage on the host through the agent and fall back to `du`.
+   * @returns Promise resolving to the total apparent size and file count
+   */
+  usage(): Promise<WorkspaceUsage>
+
   /**
    * Delete the entire workspace directory
    * @returns Promise that resolves when the workspace is deleted
@@ -183,15 +403,7 @@ export interface Workspace {
   /**
    * Promises API for compatibility with Node.js fs.promises
    */
-  promises: {
-    /**
-     * Read directory contents
-     * @param path - Relative path to the directory within the workspace
-     * @param options - Options for reading directory
-     * @returns Promise resolving to array of directory entries
-     */
-    readdir(path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]>
-  }
+  promises: WorkspacePromises
 }
 
 /**
@@ -249,8 +461,71 @@ export abstract class BaseWorkspace implements Workspace {
     }
   }
 
+  /**
+   * Validate a createReadStream byte range
+   * @throws {FileSystemError} When start or end is not a non-negative integer, or end is before start
+   */
+  protected validateReadRange(path: string, options: ReadStreamOptions): void {
+    const { start, end } = options
+    const valid = (value: number | undefined) => value === undefined || (Number.isSafeInteger(value) && value >= 0)
+    if (!valid(start) || !valid(end) || (end !== undefined && end < (start ?? 0))) {
+      throw new FileSystemError(
+        `Invalid byte range: start=${start ?? 0}, end=${end ?? 'EOF'}`,
+        ERROR_CODES.READ_FAILED,
+        `read ${path}`
+      )
+    }
+  }
+
+  /**
+   * Run a batch of operations through the regular workspace methods, so
+   * validation and operation logging apply to each one individually.
+   * Subclasses override this when the backend has a cheaper bulk path.
+   */
+  async batch(operations: BatchOperation[]): Promise<BatchResult[]> {
+    const settled = await runInKeyOrder(
+      operations,
+      (operation) => this.batchKey(operation.path),
+      (operation) => this.runBatchOperation(operation)
+    )
+    return settled.map(toBatchResult)
+  }
+
+  /**
+   * Ordering key for a batch operation: the resolved path, or the raw path
+   * when it does not resolve (that operation fails on its own anyway)
+   */
+  protected batchKey(path: string): string {
+    try {
+      return this.resolvePath(path)
+    } catch {
+      return path
+    }
+  }
+
+  private async runBatchOperation(operation: BatchOperation): Promise<unknown> {
+    switch (operation.op) {
+      case 'read':
+        return this.readFile(operation.path, operation.encoding)
+      case 'write':
+        return this.writeFile(operation.path, operation.content, operation.encoding)
+      case 'stat':
+        return this.stat(operation.path)
+      case 'exists':
+        return this.exists(operation.path)
+      case 'readdir':
+        return this.readdir(operation.path)
+      default:
+        throw new FileSystemError(
+          `Unknown batch operation: ${String((operation as { op?: unknown }).op)}`,
+          ERROR_CODES.INVALID_CONFIGURATION
+        )
+    }
+  }
+
   // Abstract methods that must be implemented by concrete workspace types
   abstract exec(command: string, options?: ExecOptions): Promise<string | Buffer>
+  abstract execStream(command: string, options?: ExecStreamOptions): Promise<ExecStream>
   abstract write(path: string, content: string | Buffer): Promise<void>
   abstract mkdir(path: string, options?: { recursive?: boolean }): Promise<void>
   abstract touch(path: string): Promise<void>
@@ -259,7 +534,13 @@ export abstract class BaseWorkspace implements Workspace {
   abstract stat(path: string): Promise<Stats>
   abstract readdir(path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]>
   abstract readFile(path: string, encoding?: NodeJS.BufferEncoding | null): Promise<string | Buffer>
+  abstract createReadStream(path: string, options?: ReadStreamOptions): Promise<Readable>
   abstract writeFile(path: string, content: string | Buffer, encoding?: NodeJS.BufferEncoding): Promise<void>
+  abstract search(options: SearchOptions): Promise<SearchResult>
+  abstract walk(options?: WalkOptions): Promise<WalkResult>
+  abstract applyEdits(path: string, edits: TextEdit[], options?: ApplyEditsOptions): Promise<ApplyEditsResult>
+  abstract watch(path: string, options: WatchOptions, listener: (event: WatchEvent) => void): Promise<WorkspaceWatcher>
+  abstract usage(): Promise<WorkspaceUsage>
   abstract delete(): Promise<void>
   abstract list(): Promise<string[]>
 
@@ -270,7 +551,16 @@ export abstract class BaseWorkspace implements Workspace {
   abstract readFileSync(path: string, encoding?: NodeJS.BufferEncoding | null): string | Buffer
   abstract statSync(path: string): Stats
   abstract writeFileSync(path: string, content: string | Buffer, encoding?: NodeJS.BufferEncoding): void
-  abstract promises: {
-    readdir(path: string, options?: { withFileTypes?: boolean }): Promise<string[] | Dirent[]>
+  abstract promises: WorkspacePromises
+}
+
+/**
+ * Convert a settled promise into a batch result
+ */
+export function toBatchResult(outcome: PromiseSettledResult<unknown>): BatchResult {
+  if (outcome.status === 'fulfilled') {
+    return { ok: true, value: outcome.value as Extract<BatchResult, { ok: true }>['value'] }
   }
+  const reason = outcome.reason
+  return { ok: false, error: reason instanceof Error ? reason : new Error(String(reason)) }
 }
@@ -0,0 +1,370 @@
+import { createHash } from 'crypto'
+import { mkdir, mkdtemp, readFile, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { Duplex, PassThrough } from 'stream'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { AgentClient } from '../src/agent/AgentClient.js'
+import { AgentServer } from '../src/agent/AgentServer.js'
+import { encodeBody, supportedCompressions, type AgentCompression } from '../src/agent/compression.js'
+import {
+  AgentError,
+  AGENT_PROTOCOL_VERSION,
+  encodeFrame,
+  FRAME_TYPES,
+  FrameDecoder,
+  type AgentWatchEvent
+} from '../src/agent/protocol.js'
+import { TRASH_DIRECTORY, TrashReaper } from '../src/utils/TrashReaper.js'
+
+/**
+ * Create a connected pair of duplex streams (client side, server side)
+ */
+function createStreamPair(): { clientSide: Duplex; serverInput: PassThrough; serverOutput: PassThrough } {
+  const serverInput = new PassThrough()
+  const serverOutput = new PassThrough()
+  const clientSide = Duplex.from({ readable: serverOutput, writable: serverInput })
+  return { clientSide, serverInput, serverOutput }
+}
+
+describe('Remote agent', () => {
+  let root: string
+  let server: AgentServer
+  let client: AgentClient
+  let served: Promise<void>
+  let streams: ReturnType<typeof createStreamPair>
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-agent-test-'))
+    server = new AgentServer({ root })
+    streams = createStreamPair()
+    const { clientSide, serverInput, serverOutput } = streams
+    served = server.serve(serverInput, serverOutput)
+    client = new AgentClient(clientSide, { timeoutMs: 5000 })
+  })
+
+  afterEach(async () => {
+    client.close()
+    await served
+    await rm(root, { recursive: true, force: true })
+  })
+
+  describe('protocol', () => {
+    it('should decode frames split across chunks', () => {
+      const encoded = encodeFrame({ id: 7, type: FRAME_TYPES.REQUEST, payload: { op: 'stat' }, body: Buffer.from('abc') })
+      const decoder = new FrameDecoder()
+
+      expect(decoder.push(encoded.subarray(0, 3))).toHaveLength(0)
+      expect(decoder.push(encoded.subarray(3, 20))).toHaveLength(0)
+      const frames = decoder.push(encoded.subarray(20))
+
+      expect(frames).toHaveLength(1)
+      expect(frames[0]!.id).toBe(7)
+      expect(frames[0]!.payload).toEqual({ op: 'stat' })
+      expect(frames[0]!.body?.toString()).toBe('abc')
+    })
+
+    it('should decode several frames from one chunk', () => {
+      const a = encodeFrame({ id: 1, type: FRAME_TYPES.RESPONSE, payload: true })
+      const b = encodeFrame({ id: 2, type: FRAME_TYPES.RESPONSE, payload: false })
+      const frames = new FrameDecoder().push(Buffer.concat([a, b]))
+
+      expect(frames.map(f => f.id)).toEqual([1, 2])
+      expect(frames[1]!.body).toBeUndefined()
+    })
+  })
+
+  describe('compression', () => {
+    /** Bytes the agent writes to the client while `action` runs */
+    async function bytesFromAgent(action: () => Promise<unknown>): Promise<number> {
+      let bytes = 0
+      const count = (chunk: Buffer) => { bytes += chunk.length }
+      const { serverOutput } = streams
+      serverOutput.on('data', count)
+      await action()
+      serverOutput.off('data', count)
+      return bytes
+    }
+
+    it('should negotiate a codec and compress text bodies both ways', async () => {
+      const hello = await client.request<{ compression: string | null }>('hello', { compression: supportedCompressions() })
+      expect(hello.compression).toBe(supportedCompressions()[0])
+      client.enableCompression(hello.compression as AgentCompression)
+
+      const text = Buffer.from('export const value = 42\n'.repeat(20_000))
+      await client.request('writeFile', { path: join(root, 'big.ts') }, text)
+      expect(await readFile(join(root, 'big.ts'))).toEqual(text)
+
+      let response: Buffer | undefined
+      const sent = await bytesFromAgent(async () => {
+        response = (await client.call('readFile', { path: join(root, 'big.ts') })).body
+      })
+      expect(response).toEqual(text)
+      expect(sent).toBeLessThan(text.length / 10)
+    })
+
+    it('should send bodies in compressed formats as they are', async () => {
+      const hello = await client.request<{ compression: AgentCompression }>('hello', { compression: ['deflate'] })
+      client.enableCompression(hello.compression)
+      const png = Buffer.concat([Buffer.from([0x89, 0x50, 0x4e, 0x47]), Buffer.alloc(64 * 1024)])
+      await writeFile(join(root, 'image.png'), png)
+
+      const sent = await bytesFromAgent(() => client.call('readFile', { path: join(root, 'image.png') }))
+      expect(sent).toBeGreaterThan(png.length)
+    })
+
+    it('should stay uncompressed when the client offers nothing', async () => {
+      const hello = await client.request<{ compression: string | null }>('hello')
+      expect(hello.compression).toBeNull()
+      expect(await encodeBody(Buffer.alloc(4096), 'deflate')).toMatchObject({ compressed: true })
+    })
+  })
+
+  describe('operations', () => {
+    it('should answer the handshake with the protocol version', async () => {
+      const hello = await client.request<{ version: number }>('hello')
+      expect(hello.version).toBe(AGENT_PROTOCOL_VERSION)
+    })
+
+    it('should stat files', async () => {
+      await writeFile(join(root, 'file.txt'), 'hello')
+      const stats = await client.request<{ kind: string; size: number }>('stat', { path: join(root, 'file.txt') })
+
+      expect(stats.kind).toBe('file')
+      expect(stats.size).toBe(5)
+    })
+
+    it('should report existence and directories', async () => {
+      await mkdir(join(root, 'dir'))
+
+      expect(await client.request('exists', { path: join(root, 'dir') })).toBe(true)
+      expect(await client.request('exists', { path: join(root, 'missing') })).toBe(false)
+      expect(await client.request('isDirectory', { path: join(root, 'dir') })).toBe(true)
+    })
+
+    it('should create, list and remove directories', async () => {
+      await client.request('mkdir', { path: join(root, 'a/b/c'), recursive: true })
+      await client.request('touch', { path: join(root, 'a/.hidden') })
+
+      const entries = await client.request<string[]>('readdir', { path: join(root, 'a') })
+      expect(entries.sort()).toEqual(['.hidden', 'b'])
+
+      await client.request('rm', { path: join(root, 'a'), recursive: true, force: true })
+      expect(await client.request('exists', { path: join(root, 'a') })).toBe(false)
+    })
+
+    it('should trash a directory and reap it in the background', async () => {
+      await mkdir(join(root, 'doomed', 'deep'), { recursive: true })
+      await writeFile(join(root, 'doomed', 'deep', 'file.txt'), 'bye')
+      const trash = join(root, TRASH_DIRECTORY)
+
+      await client.request('trash', { path: join(root, 'doomed'), trash })
+      expect(await client.request('exists', { path: join(root, 'doomed') })).toBe(false)
+
+      await TrashReaper.for(trash).idle()
+      expect(await client.request('readdir', { path: trash })).toEqual([])
+    })
+
+    it('should return the hash of large files and the content of small ones', async () => {
+      const large = Buffer.alloc(4096, 'x')
+      await writeFile(join(root, 'large.bin'), large)
+      await writeFile(join(root, 'small.txt'), 'hello')
+
+      const hashed = await client.call('digest', { path: join(root, 'large.bin'), inlineBelow: 1024 })
+      expect(hashed.result).toEqual({ hash: createHash('sha256').update(large).digest('hex'), size: 4096 })
+      expect(hashed.body).toBeUndefined()
+
+      const inline = await client.call('digest', { path: join(root, 'small.txt'), inlineBelow: 1024 })
+      expect(inline.result).toEqual({ size: 5 })
+      expect(inline.body?.toString()).toBe('hello')
+    })
+
+    it('should list entries with types and stats in one request', async () => {
+      await mkdir(join(root, 'listed', 'sub'), { recursive: true })
+      await writeFile(join(root, 'listed', 'file.txt'), 'hello')
+
+      const entries = await client.request<Array<{ name: string; kind: string; stats?: { size: number } }>>(
+        'readdirEntries', { path: join(root, 'listed'), withStats: true }
+      )
+      entries.sort((a, b) => a.name.localeCompare(b.name))
+
+      expect(entries).toMatchObject([
+        { name: 'file.txt', kind: 'file', stats: { size: 5 } },
+        { name: 'sub', kind: 'directory' },
+      ])
+      const bare = await client.request<Array<{ stats?: unknown }>>('readdirEntries', { path: join(root, 'listed') })
+      expect(bare.every(entry => entry.stats === undefined)).toBe(true)
+    })
+
+    it('should stat every entry of a directory larger than the stat concurrency', async () => {
+      await mkdir(join(root, 'many'))
+      await Promise.all(Array.from({ length: 100 }, (_, i) => writeFile(join(root, 'many', `f${i}.txt`), 'x'.repeat(i))))
+
+      const entries = await client.request<Array<{ name: string; stats?: { size: number } }>>(
+        'readdirEntries', { path: join(root, 'many'), withStats: true }
+      )
+
+      expect(entries).toHaveLength(100)
+      expect(entries.every(entry => entry.stats?.size === Number(entry.name.slice(1, -4)))).toBe(true)
+    })
+
+    it('should round-trip binary file contents', async () => {
+      const data = Buffer.from([0, 1, 2, 255, 254, 10, 13])
+      await client.call('writeFile', { path: join(root, 'bin') }, data)
+      const { body } = await client.call('readFile', { path: join(root, 'bin') })
+
+      expect(Buffer.compare(body!, data)).toBe(0)
+    })
+
+    it('should handle concurrent requests on one channel', async () => {
+      await Promise.all(Array.from({ length: 20 }, (_, i) => writeFile(join(root, `f${i}`), String(i))))
+      const results = await Promise.all(
+        Array.from({ length: 20 }, (_, i) => client.call('readFile', { path: join(root, `f${i}`) }))
+      )
+
+      expect(results.map(r => r.body!.toString())).toEqual(Array.from({ length: 20 }, (_, i) => String(i)))
+    })
+  })
+
+  describe('batch', () => {
+    it('should run mixed operations and split bodies by entry', async () => {
+      await writeFile(join(root, 'one'), 'first')
+      await writeFile(join(root, 'two'), 'second')
+
+      const { result, body } = await client.call<Array<{ ok: boolean; result?: unknown; bodyLength?: number; code?: string }>>(
+        'batch',
+        {
+          ops: [
+            { op: 'readFile', args: { path: join(root, 'one') } },
+            { op: 'writeFile', args: { path: join(root, 'three') }, bodyLength: 5 },
+            { op: 'readFile', args: { path: join(root, 'three') } },
+            { op: 'stat', args: { path: join(root, 'missing') } },
+            { op: 'readFile', args: { path: join(root, 'two') } },
+          ],
+        },
+        Buffer.from('third')
+      )
+
+      expect(result.map(r => r.ok)).toEqual([true, true, true, false, true])
+      expect(result[3]!.code).toBe('ENOENT')
+      expect(result.map(r => r.bodyLength)).toEqual([5, undefined, 5, undefined, 6])
+      expect(body!.toString()).toBe('firstthirdsecond')
+    })
+
+    it('should reject nested batches and bad body lengths', async () => {
+      const nested = await client.request('batch', { ops: [{ op: 'batch', args: {} }] }).catch(e => e)
+      expect(nested.code).toBe('EINVAL')
+
+      const overrun = await client.request('batch', { ops: [{ op: 'writeFile', args: { path: join(root, 'x') }, bodyLength: 10 }] }).catch(e => e)
+      expect(overrun.code).toBe('EINVAL')
+    })
+  })
+
+  describe('watch', () => {
+    it('should push changed paths until unwatched', async () => {
+      await mkdir(join(root, 'sub'))
+      const { id } = await client.request<{ id: number }>('watch', { path: root })
+      const events: AgentWatchEvent[] = []
+      client.onEvent(id, (payload) => events.push(payload as AgentWatchEvent))
+
+      await writeFile(join(root, 'sub', 'new.txt'), 'hello')
+      await new Promise(resolve => setTimeout(resolve, 200))
+
+      const paths = events.flatMap(e => e.paths ?? [])
+      expect(paths).toContain(join(root, 'sub', 'new.txt'))
+
+      expect(await client.request('unwatch', { id })).toBe(true)
+      expect(await client.request('unwatch', { id })).toBe(false)
+    })
+
+    it('should fail for missing directories', async () => {
+      const error = await client.request('watch', { path: join(root, 'missing') }).catch(e => e)
+      expect(error.code).toBe('ENOENT')
+    })
+  })
+
+  describe('search', () => {
+    it('should search below a directory with prefixed paths', async () => {
+      await mkdir(join(root, 'src'))
+      await writeFile(join(root, 'src', 'a.ts'), 'one\nneedle two\n')
+
+      const result = await client.request<{ matches: Array<{ path: string; line: number }> }>(
+        'search', { path: join(root, 'src'), options: { pattern: 'needle' }, prefix: 'src' }
+      )
+      expect(result.matches).toMatchObject([{ path: 'src/a.ts', line: 2 }])
+
+      const invalid = await client.request('search', { path: root, options: { pattern: '(' } }).catch(e => e)
+      expect(invalid.code).toBe('EINVAL')
+    })
+  })
+
+  describe('walk', () => {
+    it('should list a tree with stats in one request', async () => {
+      await mkdir(join(root, 'src', 'node_modules'), { recursive: true })
+      await writeFile(join(root, 'src', 'index.ts'), 'export {}\n')
+
+      const result = await client.request<{ entries: Array<{ path: string; type: string; size?: number }> }>(
+        'walk', { path: root, options: { excludes: ['node_modules'], withStats: true } }
+      )
+      expect(result.entries).toMatchObject([
+        { path: 'src', type: 'directory' },
+        { path: 'src/index.ts', type: 'file', size: 10 },
+      ])
+    })
+  })
+
+  describe('clone', () => {
+    it('should copy a directory and report an existing target', async () => {
+      await mkdir(join(root, 'template', 'src'), { recursive: true })
+      await writeFile(join(root, 'template', 'src', 'index.ts'), 'export {}\n')
+
+      await client.request('clone', { source: join(root, 'template'), target: join(root, 'copy') })
+      expect(await readFile(join(root, 'copy', 'src', 'index.ts'), 'utf-8')).toBe('export {}\n')
+
+      const error = await client.request('clone', { source: join(root, 'template'), target: join(root, 'copy') }).catch(e => e)
+      expect(error.code).toBe('EEXIST')
+    })
+  })
+
+  describe('applyEdits', () => {
+    it('should edit a file on the host and return the diff', async () => {
+      await writeFile(join(root, 'notes.txt'), 'hello world\n')
+
+      const result = await client.request<{ diff: string; changed: boolean }>(
+        'applyEdits', { path: join(root, 'notes.txt'), edits: [{ oldText: 'world', newText: 'agent' }], label: 'notes.txt' }
+      )
+      expect(result.changed).toBe(true)
+      expect(result.diff).toContain('+hello agent')
+      expect(await readFile(join(root, 'notes.txt'), 'utf-8')).toBe('hello agent\n')
+
+      const error = await client.request('applyEdits', { path: join(root, 'notes.txt'), edits: [{ oldText: 'world', newText: 'x' }] }).catch(e => e)
+      expect(error.code).toBe('ENOMATCH')
+    })
+  })
+
+  describe('errors', () => {
+    it('should forward errno codes', async () => {
+      const error = await client.request('stat', { path: join(root, 'missing') }).catch(e => e)
+
+      expect(error).toBeInstanceOf(AgentError)
+      expect(error.code).toBe('ENOENT')
+    })
+
+    it('should reject unknown operations', async () => {
+      const error = await client.request('format-disk').catch(e => e)
+      expect(error.code).toBe('ENOSYS')
+    })
+
+    it('should reject relative paths and paths outside the root', async () => {
+      expect((await client.request('stat', { path: 'relative' }).catch(e => e)).code).toBe('EINVAL')
+      expect((await client.request('stat', { path: '/etc/passwd' }).catch(e => e)).code).toBe('EACCES')
+      expect((await client.request('stat', { path: `${root}/../x` }).catch(e => e)).code).toBe('EACCES')
+    })
+
+    it('should reject pending and new requests once closed', async () => {
+      client.close()
+      await expect(client.request('hello')).rejects.toThrow('closed')
+      expect(client.closed).toBe(true)
+    })
+  })
+})
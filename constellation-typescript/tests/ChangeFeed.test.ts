@@ -0,0 +1,95 @@
+import { afterEach, describe, expect, it, vi } from 'vitest'
+import { ChangeFeed, watchChanges, type ChangeSource, type WatchEvent } from '../src/utils/ChangeFeed.js'
+
+/** A source driven by the test */
+function fakeSource() {
+  const state = {
+    starts: 0,
+    stops: 0,
+    emit: (_paths: string[] | null) => {},
+    end: () => {},
+  }
+  const source: ChangeSource = async (emit, end) => {
+    state.starts++
+    state.emit = emit
+    state.end = end
+    return () => { state.stops++ }
+  }
+  return { state, source }
+}
+
+describe('ChangeFeed', () => {
+  afterEach(() => {
+    vi.useRealTimers()
+  })
+
+  it('should run one source for all subscribers while any remain', async () => {
+    const { state, source } = fakeSource()
+    const feed = new ChangeFeed(source)
+    const first: WatchEvent[] = []
+    const second: WatchEvent[] = []
+
+    const stopFirst = await feed.subscribe(event => first.push(event))
+    const stopSecond = await feed.subscribe(event => second.push(event))
+    state.emit(['a.txt'])
+
+    expect(state.starts).toBe(1)
+    expect(first).toEqual([{ paths: ['a.txt'] }])
+    expect(second).toEqual([{ paths: ['a.txt'] }])
+
+    stopFirst()
+    expect(state.stops).toBe(0)
+    stopSecond()
+    expect(state.stops).toBe(1)
+    expect(feed.active).toBe(false)
+  })
+
+  it('should report a lost source and restart it', async () => {
+    vi.useFakeTimers()
+    const { state, source } = fakeSource()
+    const feed = new ChangeFeed(source)
+    const events: WatchEvent[] = []
+    await feed.subscribe(event => events.push(event))
+
+    state.end()
+    expect(events).toEqual([{ paths: null }])
+    expect(feed.active).toBe(false)
+
+    await vi.advanceTimersByTimeAsync(1000)
+    expect(state.starts).toBe(2)
+    expect(feed.active).toBe(true)
+    // Changes while the source was down were missed
+    expect(events).toEqual([{ paths: null }, { paths: null }])
+  })
+
+  it('should filter and coalesce changes for a watcher', async () => {
+    vi.useFakeTimers()
+    const { state, source } = fakeSource()
+    const feed = new ChangeFeed(source)
+    const events: WatchEvent[] = []
+    const watcher = await watchChanges(feed, 'src', { recursive: false, debounceMs: 20 }, event => events.push(event), '.constellationfs')
+
+    state.emit(['src/a.ts'])
+    state.emit(['src/deep/b.ts', 'other.ts', '.constellationfs/search-index'])
+    state.emit(['src/a.ts', 'src/c.ts'])
+    expect(events).toEqual([])
+
+    await vi.advanceTimersByTimeAsync(20)
+    expect(events).toEqual([{ paths: ['src/a.ts', 'src/c.ts'] }])
+
+    watcher.close()
+    state.emit(['src/d.ts'])
+    await vi.advanceTimersByTimeAsync(20)
+    expect(events).toHaveLength(1)
+  })
+
+  it('should end watchers with a closed event when the feed closes', async () => {
+    const { source } = fakeSource()
+    const feed = new ChangeFeed(source)
+    const events: WatchEvent[] = []
+    await watchChanges(feed, '', {}, event => events.push(event))
+
+    feed.close()
+    expect(events).toEqual([{ paths: null, closed: true }])
+  })
+})
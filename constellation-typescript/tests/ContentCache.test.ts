@@ -0,0 +1,95 @@
+import { createHash } from 'crypto'
+import { mkdir, mkdtemp, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { ContentCache, hashFile } from '../src/utils/ContentCache.js'
+
+const sha256 = (content: Buffer | string) => createHash('sha256').update(content).digest('hex')
+
+describe('ContentCache', () => {
+  it('should evict the least recently used content beyond its byte limit', () => {
+    const cache = new ContentCache(400)
+    cache.set('host', 'a', Buffer.alloc(100, 'a'))
+    cache.set('host', 'b', Buffer.alloc(100, 'b'))
+    cache.set('host', 'c', Buffer.alloc(100, 'c'))
+    cache.get('host', 'a')
+    cache.set('host', 'd', Buffer.alloc(100, 'd'))
+    cache.set('host', 'e', Buffer.alloc(100, 'e'))
+
+    expect(cache.get('host', 'b')).toBeUndefined()
+    expect(cache.get('host', 'a')?.toString()).toBe('a'.repeat(100))
+    expect(cache.size).toBe(4)
+    expect(cache.usedBytes).toBe(400)
+  })
+
+  it('should not let one large file take over the cache', () => {
+    const cache = new ContentCache(400)
+    cache.set('host', 'small', Buffer.alloc(100))
+    cache.set('host', 'large', Buffer.alloc(101))
+
+    expect(cache.get('host', 'large')).toBeUndefined()
+    expect(cache.get('host', 'small')).toBeDefined()
+  })
+
+  it('should keep scopes apart', () => {
+    const cache = new ContentCache(1_000)
+    cache.set('first-host:22', 'hash', Buffer.from('content'))
+
+    expect(cache.get('second-host:22', 'hash')).toBeUndefined()
+    expect(cache.get('first-host:22', 'hash')?.toString()).toBe('content')
+  })
+
+  it('should copy content in and out', () => {
+    const cache = new ContentCache(1_000)
+    const content = Buffer.from('original')
+    cache.set('host', 'hash', content)
+    content.fill(0)
+    cache.get('host', 'hash')!.fill(0)
+
+    expect(cache.get('host', 'hash')?.toString()).toBe('original')
+  })
+
+  it('should share one cache with the largest requested limit', () => {
+    const cache = ContentCache.shared(1_000)
+
+    expect(ContentCache.shared(100)).toBe(cache)
+    expect(ContentCache.shared(5_000).maxBytes).toBe(Math.max(5_000, cache.maxBytes))
+  })
+})
+
+describe('hashFile', () => {
+  let root: string
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-hash-test-'))
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should give identical files the same hash', async () => {
+    await writeFile(join(root, 'a.bin'), 'same bytes')
+    await writeFile(join(root, 'b.bin'), 'same bytes')
+
+    const a = await hashFile(join(root, 'a.bin'))
+    expect(a).toEqual({ hash: sha256('same bytes'), size: 10 })
+    expect(await hashFile(join(root, 'b.bin'))).toEqual(a)
+  })
+
+  it('should hash changed content again', async () => {
+    const path = join(root, 'file.txt')
+    await writeFile(path, 'before')
+    await hashFile(path)
+    await writeFile(path, 'after!')
+
+    expect((await hashFile(path)).hash).toBe(sha256('after!'))
+  })
+
+  it('should reject directories', async () => {
+    await mkdir(join(root, 'dir'))
+
+    await expect(hashFile(join(root, 'dir'))).rejects.toMatchObject({ code: 'EISDIR' })
+  })
+})
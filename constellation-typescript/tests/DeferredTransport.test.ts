@@ -0,0 +1,107 @@
+import type { Transport } from '@modelcontextprotocol/sdk/shared/transport.js'
+import { existsSync } from 'fs'
+import { join } from 'path'
+import { fileURLToPath } from 'url'
+import { describe, expect, it, vi } from 'vitest'
+import { DeferredTransport } from '../src/mcp/deferredTransport.js'
+import { createLocalConstellationMCPTransportOptions } from '../src/mcp/local-client.js'
+
+function fakeTransport(): Transport & { sent: unknown[] } {
+  const sent: unknown[] = []
+  const transport: Transport & { sent: unknown[] } = {
+    sent,
+    sessionId: 'session-1',
+    start: vi.fn(async () => {}),
+    send: vi.fn(async (message) => {
+      sent.push(message)
+    }),
+    close: vi.fn(async () => {
+      transport.onclose?.()
+    }),
+    setProtocolVersion: vi.fn(),
+  }
+  return transport
+}
+
+describe('DeferredTransport', () => {
+  it('should create the real transport only when started', async () => {
+    const real = fakeTransport()
+    const create = vi.fn(async () => real)
+    const transport = new DeferredTransport(create)
+
+    transport.setProtocolVersion('2025-06-18')
+    expect(create).not.toHaveBeenCalled()
+    expect(transport.sessionId).toBeUndefined()
+
+    await transport.start()
+    expect(create).toHaveBeenCalledTimes(1)
+    expect(real.start).toHaveBeenCalled()
+    expect(real.setProtocolVersion).toHaveBeenCalledWith('2025-06-18')
+    expect(transport.sessionId).toBe('session-1')
+  })
+
+  it('should forward messages both ways', async () => {
+    const real = fakeTransport()
+    const transport = new DeferredTransport(async () => real)
+    const received: unknown[] = []
+    transport.onmessage = (message) => received.push(message)
+    await transport.start()
+
+    const request = { jsonrpc: '2.0' as const, id: 1, method: 'ping' }
+    await transport.send(request)
+    real.onmessage?.({ jsonrpc: '2.0', id: 1, result: {} })
+
+    expect(real.sent).toEqual([request])
+    expect(received).toEqual([{ jsonrpc: '2.0', id: 1, result: {} }])
+  })
+
+  it('should report close and errors of the real transport', async () => {
+    const real = fakeTransport()
+    const transport = new DeferredTransport(async () => real)
+    const onclose = vi.fn()
+    const onerror = vi.fn()
+    transport.onclose = onclose
+    transport.onerror = onerror
+    await transport.start()
+
+    real.onerror?.(new Error('broken pipe'))
+    await transport.close()
+
+    expect(onerror).toHaveBeenCalledWith(new Error('broken pipe'))
+    expect(onclose).toHaveBeenCalledTimes(1)
+  })
+
+  it('should reject sends before start and close without creating a transport', async () => {
+    const create = vi.fn(async () => fakeTransport())
+    const transport = new DeferredTransport(create)
+    const onclose = vi.fn()
+    transport.onclose = onclose
+
+    await expect(transport.send({ jsonrpc: '2.0', id: 1, method: 'ping' })).rejects.toThrow('not started')
+    await transport.close()
+
+    expect(onclose).toHaveBeenCalledTimes(1)
+    expect(create).not.toHaveBeenCalled()
+  })
+})
+
+describe('createLocalConstellationMCPTransportOptions', () => {
+  it('should run the packaged server with Node when it is built, npx otherwise', () => {
+    const options = createLocalConstellationMCPTransportOptions({
+      userId: 'user123',
+      workspace: 'default',
+      workspaceRoot: '/tmp/workspaces',
+    })
+    const serverArgs = ['--workspaceRoot', '/tmp/workspaces', '--userId', 'user123', '--workspace', 'default']
+    const packageRoot = fileURLToPath(new URL('..', import.meta.url))
+
+    if (existsSync(join(packageRoot, 'dist', 'mcp', 'server.js'))) {
+      expect(options).toEqual({
+        command: process.execPath,
+        args: [join(packageRoot, 'bin', 'constellation-fs-mcp.js'), ...serverArgs],
+      })
+    } else {
+      expect(options).toEqual({ command: 'npx', args: ['constellation-fs-mcp', ...serverArgs] })
+    }
+  })
+})
@@ -0,0 +1,124 @@
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { LocalBackend } from '../src/backends/LocalBackend.js'
+import { ConstellationFS } from '../src/config/Config.js'
+import { FileSystemError } from '../src/types.js'
+import { HeadTailBuffer } from '../src/utils/HeadTailBuffer.js'
+import type { ExecStreamChunk } from '../src/workspace/ExecStream.js'
+import type { LocalWorkspace } from '../src/workspace/LocalWorkspace.js'
+
+describe('HeadTailBuffer', () => {
+  it('should keep everything by default', () => {
+    const buffer = new HeadTailBuffer()
+    buffer.append(Buffer.from('hello '))
+    buffer.append(Buffer.from('world'))
+
+    expect(buffer.toString()).toBe('hello world')
+    expect(buffer.truncated).toBe(false)
+    expect(buffer.totalBytes).toBe(11)
+  })
+
+  it('should keep the head and the tail and count what was dropped', () => {
+    const buffer = new HeadTailBuffer({ headBytes: 3, tailBytes: 4 })
+    for (const chunk of ['ab', 'cdef', 'ghij', 'k', 'lmnop']) {
+      buffer.append(Buffer.from(chunk))
+    }
+
+    expect(buffer.head().toString()).toBe('abc')
+    expect(buffer.tail().toString()).toBe('mnop')
+    expect(buffer.omittedBytes).toBe(9)
+    expect(buffer.toString()).toBe('abc\n\n... [9 bytes omitted] ...\n\nmnop')
+  })
+
+  it('should not mark output that fits exactly as truncated', () => {
+    const buffer = new HeadTailBuffer({ headBytes: 2, tailBytes: 2 })
+    buffer.append(Buffer.from('abcd'))
+
+    expect(buffer.truncated).toBe(false)
+    expect(buffer.toString()).toBe('abcd')
+  })
+})
+
+describe('execStream', () => {
+  let backend: LocalBackend
+  let workspace: LocalWorkspace
+
+  beforeEach(async () => {
+    ConstellationFS.setConfig({ workspaceRoot: '/tmp/constellation-fs-test' })
+    backend = new LocalBackend({
+      userId: 'exec-stream-user',
+      type: 'local',
+      shell: 'sh',
+      validateUtils: false,
+      preventDangerous: true,
+    })
+    workspace = (await backend.getWorkspace('exec-stream')) as LocalWorkspace
+  })
+
+  afterEach(async () => {
+    await backend.destroy()
+    ConstellationFS.reset()
+  })
+
+  it('should deliver stdout and stderr chunks as they are produced', async () => {
+    const stream = await workspace.execStream('echo out; echo err >&2')
+    const chunks: ExecStreamChunk[] = []
+    for await (const chunk of stream) {
+      chunks.push(chunk)
+    }
+
+    const text = (name: string) => chunks.filter(c => c.stream === name).map(c => c.data.toString()).join('')
+    expect(text('stdout')).toBe('out\n')
+    expect(text('stderr')).toBe('err\n')
+
+    const result = await stream.result
+    expect(result.exitCode).toBe(0)
+    expect(result.stdout).toBe('out\n')
+  })
+
+  it('should report non-zero exit codes through the result', async () => {
+    const stream = await workspace.execStream('echo failing >&2; exit 3')
+    stream.resume()
+    const result = await stream.result
+
+    expect(result.exitCode).toBe(3)
+    expect(result.stderr).toBe('failing\n')
+  })
+
+  it('should retain only the head and tail of large output', async () => {
+    const stream = await workspace.execStream('seq 1 100000', { retainBytes: 64 })
+    let streamedBytes = 0
+    for await (const chunk of stream) {
+      streamedBytes += (chunk as ExecStreamChunk).data.length
+    }
+    const result = await stream.result
+
+    expect(streamedBytes).toBe(588895)
+    expect(result.truncated).toBe(true)
+    expect(result.stdout.startsWith('1\n2\n3\n')).toBe(true)
+    expect(result.stdout.endsWith('99999\n100000\n')).toBe(true)
+    expect(result.stdout.length).toBeLessThan(200)
+  })
+
+  it('should kill the command when the consumer stops reading', async () => {
+    const stream = await workspace.execStream('yes')
+    for await (const _chunk of stream) {
+      break
+    }
+    const result = await stream.result
+
+    expect(result.signal).toBe('SIGTERM')
+  })
+
+  it('should apply the safety checks before running', async () => {
+    await expect(workspace.execStream('')).rejects.toThrow(FileSystemError)
+    await expect(workspace.execStream('rm -rf /')).rejects.toThrow()
+  })
+
+  it('should bound exec output with maxBufferedBytes', async () => {
+    const output = await workspace.exec('seq 1 100000', { maxBufferedBytes: 32 }) as string
+
+    expect(output).toContain('bytes omitted')
+    expect(output.startsWith('1\n2\n')).toBe(true)
+    expect(output.endsWith('100000')).toBe(true)
+  })
+})
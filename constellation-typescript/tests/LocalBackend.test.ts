@@ -140,6 +140,35 @@ describe('LocalBackend', () => {
     })
   })
 
+  describe('cloneWorkspace', () => {
+    it('should copy a template workspace into a new one', async () => {
+      const template = await backend.getWorkspace('clone-template')
+      await template.mkdir('src')
+      await template.write('src/index.ts', 'export {}')
+      const targetName = `clone-target-${Date.now()}`
+
+      const clone = await backend.cloneWorkspace('clone-template', targetName)
+      try {
+        expect(clone.workspaceName).toBe(targetName)
+        expect(await clone.readFile('src/index.ts', 'utf-8')).toBe('export {}')
+
+        // The copy is independent of its template
+        await clone.write('src/index.ts', 'changed')
+        expect(await template.readFile('src/index.ts', 'utf-8')).toBe('export {}')
+      } finally {
+        await clone.delete()
+      }
+    })
+
+    it('should reject missing sources, existing targets and unsafe names', async () => {
+      await backend.getWorkspace('clone-existing')
+      await expect(backend.cloneWorkspace('no-such-template', `clone-${Date.now()}`))
+        .rejects.toMatchObject({ code: 'WORKSPACE_NOT_FOUND' })
+      await expect(backend.cloneWorkspace('clone-existing', 'clone-existing')).rejects.toThrow(FileSystemError)
+      await expect(backend.cloneWorkspace('clone-existing', '../escape')).rejects.toMatchObject({ code: 'INVALID_CONFIGURATION' })
+    })
+  })
+
   describe('exec via workspace', () => {
     it('should execute simple command', async () => {
       const workspace = await backend.getWorkspace('exec-test')
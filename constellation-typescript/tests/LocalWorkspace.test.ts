@@ -1,4 +1,4 @@
-import { describe, expect, it, beforeEach, afterEach } from 'vitest'
+import { describe, expect, it, beforeEach, afterEach, vi } from 'vitest'
 import { LocalBackend } from '../src/backends/LocalBackend.js'
 import { FileSystemError } from '../src/types.js'
 import type { LocalWorkspace } from '../src/workspace/LocalWorkspace.js'
@@ -515,6 +515,33 @@ describe('LocalWorkspace', () => {
     })
   })
 
+  describe('createReadStream', () => {
+    const collect = async (stream: AsyncIterable<Buffer>): Promise<Buffer> => {
+      const chunks: Buffer[] = []
+      for await (const chunk of stream) chunks.push(chunk)
+      return Buffer.concat(chunks)
+    }
+
+    it('should stream binary contents unchanged', async () => {
+      const data = Buffer.from(Array.from({ length: 300_000 }, (_, i) => (i * 7) & 0xff))
+      await workspace.writeFile('stream.bin', data)
+      expect((await collect(await workspace.createReadStream('stream.bin'))).equals(data)).toBe(true)
+    })
+
+    it('should read an inclusive byte range', async () => {
+      await workspace.write('range.txt', '0123456789')
+      expect((await collect(await workspace.createReadStream('range.txt', { start: 2, end: 5 }))).toString()).toBe('2345')
+      expect((await collect(await workspace.createReadStream('range.txt', { start: 7 }))).toString()).toBe('789')
+    })
+
+    it('should reject missing files, directories and invalid ranges before streaming', async () => {
+      await workspace.mkdir('stream-dir')
+      await expect(workspace.createReadStream('nonexistent.txt')).rejects.toThrow(FileSystemError)
+      await expect(workspace.createReadStream('stream-dir')).rejects.toThrow('EISDIR')
+      await expect(workspace.createReadStream('range.txt', { start: 5, end: 2 })).rejects.toThrow('Invalid byte range')
+    })
+  })
+
   describe('writeFile', () => {
     it('should write file contents', async () => {
       await workspace.writeFile('writefile-test.txt', 'new content')
@@ -627,6 +654,267 @@ describe('LocalWorkspace', () => {
     })
   })
 
+  describe('promises API', () => {
+    it('should mirror the sync methods without blocking', async () => {
+      await workspace.promises.mkdir('promises-dir/nested', { recursive: true })
+      await workspace.promises.writeFile('promises-dir/nested/a.txt', 'async content')
+
+      expect(await workspace.promises.exists('promises-dir/nested/a.txt')).toBe(true)
+      expect(await workspace.promises.readFile('promises-dir/nested/a.txt', 'utf-8')).toBe('async content')
+      expect((await workspace.promises.stat('promises-dir/nested/a.txt')).size).toBe(13)
+      expect(await workspace.promises.readdir('promises-dir/nested')).toEqual(['a.txt'])
+    })
+  })
+
+  describe('syncOperations policy', () => {
+    it('should reject sync calls when denied but keep the async API', async () => {
+      const strict = (await backend.getWorkspace('test-workspace', { syncOperations: 'deny' })) as LocalWorkspace
+      await strict.writeFile('sync-policy.txt', 'x')
+
+      expect(() => strict.readFileSync('sync-policy.txt', 'utf-8')).toThrow(FileSystemError)
+      expect(() => strict.existsSync('sync-policy.txt')).toThrow('existsSync blocks the event loop')
+      expect(await strict.promises.readFile('sync-policy.txt', 'utf-8')).toBe('x')
+      // Workspaces without the policy are unaffected
+      expect(workspace.readFileSync('sync-policy.txt', 'utf-8')).toBe('x')
+    })
+
+    it('should still run sync calls when only warning', async () => {
+      const lenient = (await backend.getWorkspace('test-workspace', { syncOperations: 'warn' })) as LocalWorkspace
+      lenient.writeFileSync('sync-warn.txt', 'y')
+
+      expect(lenient.readFileSync('sync-warn.txt', 'utf-8')).toBe('y')
+      expect(lenient.readFileSync('sync-warn.txt', 'utf-8')).toBe('y')
+    })
+  })
+
+  describe('shell workers', () => {
+    let pooled: LocalWorkspace
+
+    beforeEach(async () => {
+      pooled = (await backend.getWorkspace('test-workspace', { shellWorkers: 2 })) as LocalWorkspace
+    })
+
+    it('should reuse one shell across commands', async () => {
+      const first = await pooled.exec('echo $$')
+      const second = await pooled.exec('echo $$')
+      expect(first).toBe(second)
+      expect(await pooled.exec('printf "no newline"')).toBe('no newline')
+    })
+
+    it('should reset variables between commands', async () => {
+      await pooled.exec('export LEAK=1 && LOCAL=2')
+      expect(await pooled.exec('pwd')).toBe(pooled.workspacePath)
+      expect(await pooled.exec('echo "[$LEAK$LOCAL]"')).toBe('[]')
+      expect(await pooled.exec('echo "$GREETING"', { env: { GREETING: 'hi' } })).toBe('hi')
+      expect(await pooled.exec('echo "[$GREETING]"')).toBe('[]')
+    })
+
+    it('should separate stdout and stderr and report exit codes', async () => {
+      await expect(pooled.exec('echo out; echo err >&2; exit 3')).rejects.toThrow('exit code 3: err')
+      await expect(pooled.exec('echo "unterminated')).rejects.toThrow(FileSystemError)
+      // The worker survives both
+      expect(await pooled.exec('echo ok')).toBe('ok')
+    })
+
+    it('should spawn a shell when every worker is busy', async () => {
+      const results = await Promise.all(Array.from({ length: 5 }, (_, i) => pooled.exec(`sleep 0.1; echo ${i}`)))
+      expect(results).toEqual(['0', '1', '2', '3', '4'])
+    })
+
+    it('should fail the running command and replace a worker that died', async () => {
+      const pid = Number(await pooled.exec('echo $$'))
+      const running = pooled.exec('sleep 5')
+      process.kill(pid, 'SIGKILL')
+      await expect(running).rejects.toThrow('Shell worker exited')
+
+      const replacement = Number(await pooled.exec('echo $$'))
+      expect(replacement).not.toBe(pid)
+    })
+  })
+
+  describe('batch', () => {
+    it('should return results in submission order', async () => {
+      await workspace.writeFile('a.txt', 'alpha')
+      await workspace.mkdir('batch-dir')
+      await workspace.touch('batch-dir/inner.txt')
+
+      const results = await workspace.batch([
+        { op: 'read', path: 'a.txt', encoding: 'utf-8' },
+        { op: 'stat', path: 'batch-dir' },
+        { op: 'exists', path: 'missing.txt' },
+        { op: 'readdir', path: 'batch-dir' },
+      ])
+
+      expect(results.map(r => r.ok)).toEqual([true, true, true, true])
+      expect(results[0]).toEqual({ ok: true, value: 'alpha' })
+      expect(results[1]!.ok && (results[1]!.value as import('fs').Stats).isDirectory()).toBe(true)
+      expect(results[2]).toEqual({ ok: true, value: false })
+      expect(results[3]).toEqual({ ok: true, value: ['inner.txt'] })
+    })
+
+    it('should report failures per operation', async () => {
+      await workspace.writeFile('ok.txt', 'fine')
+
+      const results = await workspace.batch([
+        { op: 'read', path: 'missing.txt' },
+        { op: 'read', path: '../../escape.txt' },
+        { op: 'read', path: 'ok.txt', encoding: 'utf-8' },
+      ])
+
+      expect(results[0]!.ok).toBe(false)
+      expect(results[1]!.ok).toBe(false)
+      expect(!results[1]!.ok && results[1]!.error).toBeInstanceOf(FileSystemError)
+      expect(results[2]).toEqual({ ok: true, value: 'fine' })
+    })
+
+    it('should run operations on the same path in order', async () => {
+      const results = await workspace.batch([
+        { op: 'write', path: 'seq.txt', content: 'first' },
+        { op: 'read', path: 'seq.txt', encoding: 'utf-8' },
+        { op: 'write', path: 'seq.txt', content: Buffer.from('second') },
+        { op: 'read', path: './seq.txt' },
+      ])
+
+      expect(results[1]).toEqual({ ok: true, value: 'first' })
+      expect(results[3]!.ok && (results[3]!.value as Buffer).toString()).toBe('second')
+    })
+  })
+
+  describe('search', () => {
+    it('should report matches relative to the workspace', async () => {
+      await workspace.mkdir('search-src/nested')
+      await workspace.writeFile('search-src/nested/main.ts', 'const answer = 42\n')
+      await workspace.writeFile('search-src/other.md', 'no answer here\n')
+
+      const result = await workspace.search({ pattern: 'answer', path: 'search-src', glob: '*.ts' })
+
+      expect(result.matches).toEqual([{ path: 'search-src/nested/main.ts', line: 1, column: 7, text: 'const answer = 42' }])
+    })
+
+    it('should reject search paths outside the workspace and invalid patterns', async () => {
+      await expect(workspace.search({ pattern: 'x', path: '../..' })).rejects.toThrow(FileSystemError)
+      await expect(workspace.search({ pattern: '[' })).rejects.toThrow(FileSystemError)
+    })
+
+    it('should see its own writes when the search index is enabled', async () => {
+      const indexed = (await backend.getWorkspace('search-indexed', { searchIndex: true })) as LocalWorkspace
+      try {
+        await indexed.writeFile('notes.md', 'first draft\n')
+        expect((await indexed.search({ pattern: 'draft' })).matches).toHaveLength(1)
+
+        await indexed.writeFile('notes.md', 'final version\n')
+        expect((await indexed.search({ pattern: 'draft' })).matches).toEqual([])
+        expect((await indexed.search({ pattern: 'final' })).matches.map(match => match.path)).toEqual(['notes.md'])
+      } finally {
+        await indexed.delete()
+      }
+    })
+  })
+
+  describe('walk', () => {
+    it('should list a subtree depth first with stats', async () => {
+      await workspace.writeFile('walk-src/lib/util.ts', 'export {}\n')
+      await workspace.writeFile('walk-src/index.ts', 'x\n')
+      await workspace.mkdir('walk-src/node_modules/pkg', { recursive: true })
+
+      const { entries, truncated } = await workspace.walk({ path: 'walk-src', excludes: ['node_modules'], withStats: true })
+
+      expect(truncated).toBe(false)
+      expect(entries.map(entry => [entry.path, entry.type])).toEqual([
+        ['index.ts', 'file'],
+        ['lib', 'directory'],
+        ['lib/util.ts', 'file'],
+      ])
+      expect(entries[0]!.size).toBe(2)
+    })
+
+    it('should reject walks outside the workspace', async () => {
+      await expect(workspace.walk({ path: '../..' })).rejects.toThrow(FileSystemError)
+    })
+  })
+
+  describe('applyEdits', () => {
+    it('should edit the file and return a diff', async () => {
+      await workspace.writeFile('edit.txt', 'const a = 1\nconst b = 2\n')
+
+      const result = await workspace.applyEdits('edit.txt', [{ oldText: 'const b = 2', newText: 'const b = 3' }])
+
+      expect(result).toEqual({
+        changed: true,
+        diff: ['--- edit.txt', '+++ edit.txt', '@@ -2,1 +2,1 @@', '-const b = 2', '+const b = 3'].join('\n'),
+      })
+      expect(await workspace.readFile('edit.txt', 'utf-8')).toBe('const a = 1\nconst b = 3\n')
+    })
+
+    it('should not write on dryRun', async () => {
+      await workspace.writeFile('edit.txt', 'original\n')
+
+      const result = await workspace.applyEdits('edit.txt', [{ oldText: 'original', newText: 'changed' }], { dryRun: true })
+
+      expect(result.changed).toBe(true)
+      expect(await workspace.readFile('edit.txt', 'utf-8')).toBe('original\n')
+    })
+
+    it('should fail with EDIT_NOT_FOUND when the text is missing', async () => {
+      await workspace.writeFile('edit.txt', 'original\n')
+
+      const error = await workspace.applyEdits('edit.txt', [{ oldText: 'absent', newText: 'x' }]).catch(e => e)
+
+      expect(error).toBeInstanceOf(FileSystemError)
+      expect(error.code).toBe('EDIT_NOT_FOUND')
+    })
+  })
+
+  describe('watch', () => {
+    it('should report changes made by commands in one batch', async () => {
+      await workspace.mkdir('src')
+      const events: Array<{ paths: string[] | null }> = []
+      const watcher = await workspace.watch('src', { debounceMs: 100 }, event => events.push(event))
+
+      try {
+        await workspace.exec('echo a > src/a.txt && echo b > src/b.txt && echo c > outside.txt')
+        await vi.waitFor(() => expect(events.length).toBeGreaterThan(0), { timeout: 2000 })
+
+        expect(events[0]!.paths).toEqual(expect.arrayContaining(['src/a.txt', 'src/b.txt']))
+        expect(events.flatMap(event => event.paths ?? [])).not.toContain('outside.txt')
+      } finally {
+        watcher.close()
+      }
+    })
+  })
+
+  describe('usage and quotas', () => {
+    it('should count writes and command output', async () => {
+      const fresh = (await backend.getWorkspace('usage-workspace')) as LocalWorkspace
+      try {
+        await fresh.write('a.txt', 'hello')
+        expect(await fresh.usage()).toEqual({ bytes: 5, files: 1 })
+
+        await fresh.exec('printf abc > b.txt')
+        await vi.waitFor(async () => {
+          expect(await fresh.usage()).toEqual({ bytes: 8, files: 2 })
+        }, { timeout: 2000 })
+      } finally {
+        await fresh.delete()
+      }
+    })
+
+    it('should reject writes beyond the workspace quota', async () => {
+      const limited = (await backend.getWorkspace('quota-workspace', { quotaBytes: 10 })) as LocalWorkspace
+      try {
+        await limited.writeFile('a.txt', '12345678')
+        await expect(limited.writeFile('b.txt', '12345')).rejects.toMatchObject({ code: 'QUOTA_EXCEEDED' })
+        expect(await limited.exists('b.txt')).toBe(false)
+
+        // Replacing a file only counts the difference
+        await limited.writeFile('a.txt', '1234567890')
+        expect((await limited.usage()).bytes).toBe(10)
+      } finally {
+        await limited.delete()
+      }
+    })
+  })
+
   describe('integration tests', () => {
     it('should support complete workflow', async () => {
       // Create directory structure
@@ -0,0 +1,66 @@
+import { describe, expect, it } from 'vitest'
+import { Deque, FairQueue, PriorityQueue } from '../src/utils/PriorityQueue.js'
+
+describe('Deque', () => {
+  it('should keep FIFO order across wrap-around and growth', () => {
+    const deque = new Deque<number>(4)
+    const out: number[] = []
+
+    for (let i = 0; i < 3; i++) deque.push(i)
+    out.push(deque.shift()!, deque.shift()!)
+    // Wraps around the end of the ring, then grows past its capacity
+    for (let i = 3; i < 10; i++) deque.push(i)
+    while (deque.length > 0) out.push(deque.shift()!)
+
+    expect(out).toEqual([0, 1, 2, 3, 4, 5, 6, 7, 8, 9])
+    expect(deque.shift()).toBeUndefined()
+  })
+})
+
+describe('PriorityQueue', () => {
+  it('should dequeue interactive items before bulk ones, each in FIFO order', () => {
+    const queue = new PriorityQueue<string>()
+    queue.push('bulk-1', 'bulk')
+    queue.push('read-1')
+    queue.push('bulk-2', 'bulk')
+    queue.push('read-2', 'interactive')
+
+    expect(queue.length).toBe(4)
+    expect([queue.shift(), queue.shift(), queue.shift(), queue.shift()]).toEqual(['read-1', 'read-2', 'bulk-1', 'bulk-2'])
+    expect(queue.shift()).toBeUndefined()
+  })
+
+  it('should drain every item highest priority first', () => {
+    const queue = new PriorityQueue<number>()
+    queue.push(1, 'bulk')
+    queue.push(2)
+
+    expect(queue.drain()).toEqual([2, 1])
+    expect(queue.length).toBe(0)
+  })
+})
+
+describe('FairQueue', () => {
+  it('should take items from each owner in turn', () => {
+    const queue = new FairQueue<string, string>()
+    for (const item of ['a-1', 'a-2', 'a-3']) queue.push('a', item)
+    queue.push('b', 'b-bulk', 'bulk')
+    queue.push('b', 'b-read')
+
+    const out: string[] = []
+    while (queue.length > 0) out.push(queue.shift()!)
+    expect(out).toEqual(['a-1', 'b-read', 'a-2', 'b-bulk', 'a-3'])
+  })
+
+  it('should pass over owners that are not eligible', () => {
+    const queue = new FairQueue<string, number>()
+    queue.push('a', 1)
+    queue.push('b', 2)
+
+    expect(queue.shift(owner => owner !== 'a')).toBe(2)
+    expect(queue.shift(owner => owner !== 'a')).toBeUndefined()
+    expect(queue.length).toBe(1)
+    expect(queue.drain()).toEqual([1])
+    expect(queue.length).toBe(0)
+  })
+})
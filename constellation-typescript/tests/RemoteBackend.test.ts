@@ -1,4 +1,12 @@
+import { randomBytes } from 'crypto'
+import { mkdtemp, readFile, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { Duplex, PassThrough } from 'stream'
 import { afterEach, beforeEach, describe, expect, it, vi } from 'vitest'
+import { AgentClient } from '../src/agent/AgentClient.js'
+import { AgentError } from '../src/agent/protocol.js'
+import { AgentServer } from '../src/agent/AgentServer.js'
 import { RemoteBackend } from '../src/backends/RemoteBackend.js'
 import { ConstellationFS } from '../src/config/Config.js'
 import type { RemoteBackendConfig } from '../src/backends/types.js'
@@ -182,4 +190,583 @@ describe('RemoteBackend', () => {
       expect(backend.options.preventDangerous).toBe(true)
     })
   })
+
+  describe('connection scheduling', () => {
+    /** Channel that stays open until the test closes it */
+    class FakeChannel extends PassThrough {
+      stderr = new PassThrough()
+      constructor(readonly command: string, readonly connectionIndex: number) {
+        super()
+      }
+      signal() {}
+      close() {
+        this.stderr.emit('close')
+        this.emit('close', 0)
+      }
+    }
+
+    /**
+     * Replace the SSH layer with in-memory connections that record every
+     * exec until the test closes its channel
+     */
+    function fakeConnections(backend: RemoteBackend, record = { channels: [] as FakeChannel[], connected: [] as number[], ended: [] as number[] }) {
+      const { channels, connected, ended } = record
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      ;(backend as any).connectSSH = async (connection: any) => {
+        connected.push(connection.index)
+        connection.client = {
+          exec: (command: string, callback: (err: Error | undefined, channel: FakeChannel) => void) => {
+            const channel = new FakeChannel(command, connection.index)
+            channels.push(channel)
+            setImmediate(() => callback(undefined, channel))
+          },
+          end: () => ended.push(connection.index),
+        }
+        connection.isConnected = true
+        return connection.client
+      }
+      return record
+    }
+
+    const tick = () => new Promise(resolve => setTimeout(resolve, 5))
+
+    it('should open extra connections only when the first is busy', async () => {
+      const backend = new RemoteBackend({ ...baseConfig, sshConnections: 3 })
+      const { channels, connected } = fakeConnections(backend)
+
+      const first = backend.execInWorkspace('/workspace', 'echo one')
+      await tick()
+      channels[0]!.close()
+      await first
+
+      const concurrent = [
+        backend.execInWorkspace('/workspace', 'echo a'),
+        backend.execInWorkspace('/workspace', 'echo b'),
+        backend.execInWorkspace('/workspace', 'echo c'),
+      ]
+      await tick()
+
+      expect(connected).toEqual([0, 1, 2])
+      expect(channels.slice(1).map(c => c.connectionIndex).sort()).toEqual([0, 1, 2])
+
+      for (const channel of channels) channel.close()
+      await Promise.all(concurrent)
+      await backend.destroy()
+    })
+
+    it('should queue beyond the channel budget and run interactive work first', async () => {
+      const backend = new RemoteBackend({ ...baseConfig, sshConnections: 2, channelsPerConnection: 1 })
+      const { channels } = fakeConnections(backend)
+
+      const busy = [
+        backend.execInWorkspace('/workspace', 'echo busy-1'),
+        backend.execInWorkspace('/workspace', 'echo busy-2'),
+      ]
+      await tick()
+      expect(channels).toHaveLength(2)
+
+      const bulk = backend.execStreamInWorkspace('/workspace', 'echo bulk')
+      const interactive = backend.execInWorkspace('/workspace', 'echo interactive')
+      await tick()
+      // Both connections are at their budget
+      expect(channels).toHaveLength(2)
+
+      channels[0]!.close()
+      await tick()
+      expect(channels[2]!.command).toContain('echo interactive')
+
+      channels[1]!.close()
+      await tick()
+      expect(channels[3]!.command).toContain('echo bulk')
+
+      channels[2]!.close()
+      const stream = await bulk
+      stream.resume()
+      channels[3]!.close()
+      await Promise.all([...busy, interactive, stream.result])
+      await backend.destroy()
+    })
+
+    /** Two users' backends on the same host, sharing one fake SSH layer */
+    function sharedBackends(options: Partial<RemoteBackendConfig> = {}) {
+      const config = { ...baseConfig, shareConnections: true, ...options }
+      const alice = new RemoteBackend({ ...config, userId: 'alice' })
+      const bob = new RemoteBackend({ ...config, userId: 'bob' })
+      const record = fakeConnections(alice)
+      fakeConnections(bob, record)
+      return { alice, bob, ...record }
+    }
+
+    it('should share connections between backends for the same host', async () => {
+      const { alice, bob, channels, connected, ended } = sharedBackends()
+
+      const first = alice.execInWorkspace('/workspace', 'echo alice')
+      await tick()
+      const second = bob.execInWorkspace('/workspace', 'echo bob')
+      await tick()
+
+      expect(connected).toEqual([0])
+      expect(bob.connected).toBe(true)
+      for (const channel of channels) channel.close()
+      await Promise.all([first, second])
+
+      // The connection outlives the first backend and closes with the last
+      await alice.destroy()
+      await alice.destroy()
+      expect(ended).toEqual([])
+      expect(bob.connected).toBe(true)
+      await bob.destroy()
+      expect(ended).toEqual([0])
+
+      // Backends created after that start over with a new connection
+      const carol = new RemoteBackend({ ...baseConfig, shareConnections: true, userId: 'carol' })
+      expect(carol.connected).toBe(false)
+    })
+
+    it('should not share connections without shareConnections', async () => {
+      const alice = new RemoteBackend({ ...baseConfig, userId: 'alice' })
+      const bob = new RemoteBackend({ ...baseConfig, userId: 'bob' })
+      const record = fakeConnections(alice)
+      fakeConnections(bob, record)
+
+      const runs = [alice.execInWorkspace('/workspace', 'echo a'), bob.execInWorkspace('/workspace', 'echo b')]
+      await tick()
+      expect(record.connected).toEqual([0, 0])
+
+      for (const channel of record.channels) channel.close()
+      await Promise.all(runs)
+      await Promise.all([alice.destroy(), bob.destroy()])
+    })
+
+    it('should hold each user to channelsPerUser', async () => {
+      const { alice, bob, channels } = sharedBackends({ channelsPerConnection: 3, channelsPerUser: 1 })
+
+      const runs = [
+        alice.execInWorkspace('/workspace', 'echo alice-1'),
+        alice.execInWorkspace('/workspace', 'echo alice-2'),
+        bob.execInWorkspace('/workspace', 'echo bob-1'),
+      ]
+      await tick()
+      // A channel is free, but alice is at her quota
+      expect(channels.map(c => c.command.match(/echo (\S+)/)![1]).sort()).toEqual(['alice-1', 'bob-1'])
+
+      channels.find(c => c.command.includes('echo alice-1'))!.close()
+      await tick()
+      expect(channels[2]!.command).toContain('echo alice-2')
+
+      for (const channel of channels) channel.close()
+      await Promise.all(runs)
+      await Promise.all([alice.destroy(), bob.destroy()])
+    })
+
+    it('should take queued operations from each user in turn', async () => {
+      const { alice, bob, channels } = sharedBackends({ channelsPerConnection: 2 })
+
+      const runs = [
+        alice.execInWorkspace('/workspace', 'echo alice-1'),
+        alice.execInWorkspace('/workspace', 'echo alice-2'),
+        alice.execInWorkspace('/workspace', 'echo alice-3'),
+        alice.execInWorkspace('/workspace', 'echo alice-4'),
+        bob.execInWorkspace('/workspace', 'echo bob-1'),
+      ]
+      await tick()
+      expect(channels).toHaveLength(2)
+
+      channels[0]!.close()
+      await tick()
+      channels[1]!.close()
+      await tick()
+      // bob's first operation goes ahead of alice's backlog
+      expect(channels.slice(2).map(c => c.command.match(/echo (\S+)/)![1])).toEqual(['alice-3', 'bob-1'])
+
+      for (const channel of channels) channel.close()
+      await tick()
+      for (const channel of channels) channel.close()
+      await Promise.all(runs)
+      await Promise.all([alice.destroy(), bob.destroy()])
+    })
+  })
+
+  describe('SFTP fallbacks without the agent', () => {
+    function sftpBackend() {
+      const backend = new RemoteBackend(baseConfig)
+      const attrs = (mode: number, size: number) => ({ mode, uid: 1000, gid: 1000, size, atime: 1700000000, mtime: 1700000100 })
+      const sftp = {
+        readdir: vi.fn((_path: string, callback: (err: Error | undefined, list: unknown[]) => void) => {
+          setImmediate(() => callback(undefined, [
+            { filename: '.', longname: '', attrs: attrs(0o40755, 4096) },
+            { filename: 'src', longname: '', attrs: attrs(0o40755, 4096) },
+            { filename: 'odd\nname.txt', longname: '', attrs: attrs(0o100644, 12) },
+            { filename: 'link', longname: '', attrs: attrs(0o120777, 3) },
+          ]))
+        }),
+      }
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      Object.assign(backend as any, {
+        getAgent: async () => null,
+        withSftp: (operation: (session: typeof sftp) => Promise<unknown>) => operation(sftp),
+      })
+      return { backend, sftp }
+    }
+
+    it('should build Dirents and stats from one SFTP readdir', async () => {
+      const { backend, sftp } = sftpBackend()
+
+      const entries = await backend.listDirectoryEntries('/workspace', true)
+
+      expect(sftp.readdir).toHaveBeenCalledTimes(1)
+      expect(entries.map(({ dirent }) => [dirent.name, dirent.isDirectory(), dirent.isSymbolicLink()])).toEqual([
+        ['src', true, false],
+        ['odd\nname.txt', false, false],
+        ['link', false, true],
+      ])
+      expect(entries[1]!.dirent.parentPath).toBe('/workspace')
+      expect(entries[1]!.stats!.isFile()).toBe(true)
+      expect(entries[1]!.stats!.size).toBe(12)
+      expect(entries[1]!.stats!.mtimeMs).toBe(1700000100000)
+    })
+
+    it('should list names without splitting on newlines', async () => {
+      const { backend } = sftpBackend()
+
+      expect(await backend.listDirectory('/workspace')).toEqual(['src', 'odd\nname.txt', 'link'])
+    })
+
+    it('should edit without the agent by uploading a sibling and renaming it over the file', async () => {
+      const { backend } = sftpBackend()
+      const written: Array<[string, string]> = []
+      const sftp = {
+        stat: vi.fn((_path: string, callback: (err: Error | undefined, stats: { mode: number }) => void) => callback(undefined, { mode: 0o100755 })),
+        chmod: vi.fn((_path: string, _mode: number, callback: (err?: Error) => void) => callback()),
+        ext_openssh_rename: vi.fn((_from: string, _to: string, callback: (err?: Error) => void) => callback()),
+        unlink: vi.fn((_path: string, callback: (err?: Error) => void) => callback()),
+      }
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      Object.assign(backend as any, {
+        readFile: async () => Buffer.from('echo old\n'),
+        writeWholeFile: async (_sftp: unknown, path: string, data: Buffer) => { written.push([path, data.toString()]) },
+        withSftp: (operation: (session: typeof sftp) => Promise<unknown>) => operation(sftp),
+      })
+
+      const result = await backend.applyEdits('/workspace/run.sh', [{ oldText: 'old', newText: 'new' }], {}, 'run.sh')
+
+      expect(result.diff).toContain('+echo new')
+      expect(written).toHaveLength(1)
+      const [temp, content] = written[0]!
+      expect(temp).toMatch(/^\/workspace\/\.run\.sh\.edit-[0-9a-f]+$/)
+      expect(content).toBe('echo new\n')
+      expect(sftp.chmod).toHaveBeenCalledWith(temp, 0o755, expect.any(Function))
+      expect(sftp.ext_openssh_rename).toHaveBeenCalledWith(temp, '/workspace/run.sh', expect.any(Function))
+      expect(sftp.unlink).not.toHaveBeenCalled()
+
+      const error = await backend.applyEdits('/workspace/run.sh', [{ oldText: 'absent', newText: 'x' }], {}, 'run.sh').catch(e => e)
+      expect(error.code).toBe('EDIT_NOT_FOUND')
+    })
+  })
+
+  describe('delta writes', () => {
+    let root: string
+    let client: AgentClient
+    let served: Promise<void>
+
+    beforeEach(async () => {
+      root = await mkdtemp(join(tmpdir(), 'constellation-delta-test-'))
+      const serverInput = new PassThrough()
+      const serverOutput = new PassThrough()
+      served = new AgentServer({ root }).serve(serverInput, serverOutput)
+      client = new AgentClient(Duplex.from({ readable: serverOutput, writable: serverInput }), { timeoutMs: 5000 })
+    })
+
+    afterEach(async () => {
+      client.close()
+      await served
+      await rm(root, { recursive: true, force: true })
+    })
+
+    function agentBackend() {
+      const backend = new RemoteBackend(baseConfig)
+      const uploads: number[] = []
+      const requests: Array<{ op: string; bodyLength: number }> = []
+      const request = client.request.bind(client)
+      vi.spyOn(client, 'request').mockImplementation((op, args, body) => {
+        requests.push({ op, bodyLength: body?.length ?? 0 })
+        return request(op, args, body)
+      })
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      Object.assign(backend as any, {
+        getAgent: async () => client,
+        withSftp: (operation: (session: unknown) => Promise<unknown>) => operation({}),
+        writeWholeFile: async (_sftp: unknown, path: string, data: Buffer) => {
+          uploads.push(data.length)
+          await writeFile(path, data)
+        },
+      })
+      return { backend, uploads, requests }
+    }
+
+    it('should send only changed chunks and skip unchanged writes', async () => {
+      const { backend, uploads, requests } = agentBackend()
+      const path = join(root, 'bundle.js')
+      const original = randomBytes(512 * 1024)
+      await writeFile(path, original)
+
+      const modified = Buffer.concat([original.subarray(0, 200_000), Buffer.from('// one line\n'), original.subarray(200_000)])
+      await backend.writeFile(path, modified)
+      expect(await readFile(path)).toEqual(modified)
+      expect(requests.map(r => r.op)).toEqual(['chunkManifest', 'writeDelta'])
+      expect(requests[1]!.bodyLength).toBeLessThan(200 * 1024)
+
+      // The manifest of what was written is remembered; an identical write sends no chunks
+      await backend.writeFile(path, modified)
+      expect(requests.slice(2)).toEqual([{ op: 'writeDelta', bodyLength: 0 }])
+      expect(uploads).toEqual([])
+    })
+
+    it('should refetch the manifest when the file changed behind it, and upload new files whole', async () => {
+      const { backend, uploads, requests } = agentBackend()
+      const path = join(root, 'data.bin')
+      const first = randomBytes(256 * 1024)
+      await backend.writeFile(path, first)
+      expect(uploads).toEqual([first.length])
+
+      const other = Buffer.concat([first.subarray(0, 100_000), randomBytes(10), first.subarray(100_000)])
+      await writeFile(path, other)
+      const next = Buffer.concat([other, Buffer.from('tail')])
+      await backend.writeFile(path, next)
+
+      expect(await readFile(path)).toEqual(next)
+      expect(requests.map(r => r.op)).toEqual(['chunkManifest', 'writeDelta', 'chunkManifest', 'writeDelta'])
+      expect(uploads).toHaveLength(1)
+    })
+
+    it('should upload small files whole', async () => {
+      const { backend, uploads, requests } = agentBackend()
+
+      await backend.writeFile(join(root, 'small.txt'), 'hello')
+
+      expect(requests).toEqual([])
+      expect(uploads).toEqual([5])
+    })
+  })
+
+  describe('read cache', () => {
+    let root: string
+    let client: AgentClient
+    let served: Promise<void>
+
+    beforeEach(async () => {
+      root = await mkdtemp(join(tmpdir(), 'constellation-read-cache-test-'))
+      const serverInput = new PassThrough()
+      const serverOutput = new PassThrough()
+      served = new AgentServer({ root }).serve(serverInput, serverOutput)
+      client = new AgentClient(Duplex.from({ readable: serverOutput, writable: serverInput }), { timeoutMs: 5000 })
+    })
+
+    afterEach(async () => {
+      client.close()
+      await served
+      await rm(root, { recursive: true, force: true })
+    })
+
+    /** Backends of two users on one host, counting the files they download */
+    function cachedBackends(host: string) {
+      const downloads: string[] = []
+      const backend = (userId: string) => {
+        const instance = new RemoteBackend({ ...baseConfig, userId, host, readCacheBytes: 16 * 1024 * 1024 })
+        // eslint-disable-next-line @typescript-eslint/no-explicit-any
+        Object.assign(instance as any, {
+          getAgent: async () => client,
+          withSftp: (operation: (session: unknown) => Promise<unknown>) => operation({}),
+          readWholeFile: async (_sftp: unknown, path: string) => {
+            downloads.push(path)
+            return readFile(path)
+          },
+        })
+        return instance
+      }
+      return { alice: backend('alice'), bob: backend('bob'), downloads }
+    }
+
+    it('should download identical content once across users', async () => {
+      const { alice, bob, downloads } = cachedBackends('cache-share.example.com')
+      const asset = randomBytes(256 * 1024)
+      await writeFile(join(root, 'alice-asset.bin'), asset)
+      await writeFile(join(root, 'bob-asset.bin'), asset)
+
+      expect(await alice.readFile(join(root, 'alice-asset.bin'))).toEqual(asset)
+      expect(await bob.readFile(join(root, 'bob-asset.bin'))).toEqual(asset)
+      expect(await alice.readFile(join(root, 'alice-asset.bin'))).toEqual(asset)
+
+      expect(downloads).toEqual([join(root, 'alice-asset.bin')])
+    })
+
+    it('should download changed content again', async () => {
+      const { alice, downloads } = cachedBackends('cache-change.example.com')
+      const path = join(root, 'data.bin')
+      await writeFile(path, randomBytes(128 * 1024))
+      await alice.readFile(path)
+
+      const changed = randomBytes(128 * 1024)
+      await writeFile(path, changed)
+
+      expect(await alice.readFile(path)).toEqual(changed)
+      expect(downloads).toEqual([path, path])
+    })
+
+    it('should return small files with the hash request', async () => {
+      const { alice, downloads } = cachedBackends('cache-small.example.com')
+      await writeFile(join(root, 'small.txt'), 'hello')
+
+      expect(await alice.readFile(join(root, 'small.txt'), 'utf8')).toBe('hello')
+      expect(downloads).toEqual([])
+    })
+
+    it('should keep callers from changing cached content', async () => {
+      const { alice, bob } = cachedBackends('cache-copy.example.com')
+      const asset = randomBytes(128 * 1024)
+      await writeFile(join(root, 'asset.bin'), asset)
+
+      const first = await alice.readFile(join(root, 'asset.bin'))
+      first.fill(0)
+
+      expect(await bob.readFile(join(root, 'asset.bin'))).toEqual(asset)
+    })
+  })
+
+  describe('watchTree', () => {
+    let root: string
+    let client: AgentClient
+    let served: Promise<void>
+
+    beforeEach(async () => {
+      root = await mkdtemp(join(tmpdir(), 'constellation-watch-tree-test-'))
+      const serverInput = new PassThrough()
+      const serverOutput = new PassThrough()
+      served = new AgentServer({ root }).serve(serverInput, serverOutput)
+      client = new AgentClient(Duplex.from({ readable: serverOutput, writable: serverInput }), { timeoutMs: 5000 })
+    })
+
+    afterEach(async () => {
+      client.close()
+      await served
+      await rm(root, { recursive: true, force: true })
+    })
+
+    it('should drop its close listener when stopped', async () => {
+      const backend = new RemoteBackend(baseConfig)
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      Object.assign(backend as any, { getAgent: async () => client })
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      const closeListeners = (client as any).closeListeners as Set<unknown>
+      const listenersBefore = closeListeners.size
+
+      for (let i = 0; i < 3; i++) {
+        const stop = await backend.watchTree(root, () => {})
+        expect(stop).not.toBeNull()
+        stop!()
+      }
+      expect(closeListeners.size).toBe(listenersBefore)
+
+      const onChange = vi.fn()
+      await backend.watchTree(root, onChange)
+      client.close()
+      expect(onChange).toHaveBeenCalledWith({ paths: null, closed: true })
+    })
+  })
+
+  describe('agents without an operation', () => {
+    /** A backend whose agent answers every request like an older agent that lacks the operation */
+    function olderAgentBackend(fallbacks: Record<string, unknown>) {
+      const backend = new RemoteBackend(baseConfig)
+      const agent = {
+        request: vi.fn(async (op: string) => {
+          throw new AgentError(`Unknown agent operation: ${op}`, 'ENOSYS')
+        }),
+      }
+      // eslint-disable-next-line @typescript-eslint/no-explicit-any
+      Object.assign(backend as any, { getAgent: async () => agent, ...fallbacks })
+      return { backend, agent }
+    }
+
+    it('should search without the agent', async () => {
+      const result = { matches: [], filesSearched: 0, truncated: false }
+      const searchFilesWithoutAgent = vi.fn(async () => result)
+      const { backend, agent } = olderAgentBackend({ searchFilesWithoutAgent })
+
+      expect(await backend.searchFiles('/workspace', { pattern: 'todo' }, 'src')).toBe(result)
+      expect(agent.request).toHaveBeenCalledWith('search', expect.anything())
+      expect(searchFilesWithoutAgent).toHaveBeenCalledWith('/workspace', { pattern: 'todo' }, 'src')
+    })
+
+    it('should walk without the agent', async () => {
+      const result = { entries: [], truncated: false }
+      const walkTreeWithoutAgent = vi.fn(async () => result)
+      const { backend, agent } = olderAgentBackend({ walkTreeWithoutAgent })
+
+      expect(await backend.walkTree('/workspace', { excludes: ['node_modules'] })).toBe(result)
+      expect(agent.request).toHaveBeenCalledWith('walk', expect.anything())
+      expect(walkTreeWithoutAgent).toHaveBeenCalledWith('/workspace', { excludes: ['node_modules'] })
+    })
+
+    it('should list directory entries over SFTP', async () => {
+      const readDirectoryWithSftp = vi.fn(async () => [{ name: 'notes.txt', kind: 'file' }])
+      const { backend, agent } = olderAgentBackend({ readDirectoryWithSftp })
+
+      const entries = await backend.listDirectoryEntries('/workspace')
+
+      expect(agent.request).toHaveBeenCalledWith('readdirEntries', expect.anything())
+      expect(readDirectoryWithSftp).toHaveBeenCalledWith('/workspace')
+      expect(entries.map(({ dirent }) => [dirent.name, dirent.isFile()])).toEqual([['notes.txt', true]])
+    })
+
+    it('should clone workspaces with cp', async () => {
+      const cloneWorkspaceWithoutAgent = vi.fn(async () => {})
+      const { backend, agent } = olderAgentBackend({
+        cloneWorkspaceWithoutAgent,
+        ensureSSHConnection: async () => {},
+        getWorkspace: async (name: string) => ({ workspaceName: name }),
+      })
+
+      expect(await backend.cloneWorkspace('default', 'copy')).toEqual({ workspaceName: 'copy' })
+      expect(agent.request).toHaveBeenCalledWith('clone', expect.anything())
+      expect(cloneWorkspaceWithoutAgent).toHaveBeenCalledWith(
+        expect.stringMatching(/test-remote-user\/default$/),
+        expect.stringMatching(/test-remote-user\/copy$/),
+        'clone default copy'
+      )
+    })
+
+    it('should edit files without the agent', async () => {
+      const result = { diff: '', changed: true }
+      const applyEditsWithoutAgent = vi.fn(async () => result)
+      const { backend, agent } = olderAgentBackend({ applyEditsWithoutAgent })
+      const edits = [{ oldText: 'old', newText: 'new' }]
+
+      expect(await backend.applyEdits('/workspace/run.sh', edits, {}, 'run.sh')).toBe(result)
+      expect(agent.request).toHaveBeenCalledWith('applyEdits', expect.anything())
+      expect(applyEditsWithoutAgent).toHaveBeenCalledWith('/workspace/run.sh', edits, {}, 'run.sh')
+    })
+
+    it('should measure usage with find', async () => {
+      const result = { bytes: 1024, files: 2 }
+      const workspaceUsageWithoutAgent = vi.fn(async () => result)
+      const { backend, agent } = olderAgentBackend({ workspaceUsageWithoutAgent })
+
+      expect(await backend.workspaceUsage('/workspace', 'notes.txt', true)).toBe(result)
+      expect(agent.request).toHaveBeenCalledWith('usage', expect.anything())
+      expect(workspaceUsageWithoutAgent).toHaveBeenCalledWith('/workspace', 'notes.txt', true)
+    })
+
+    it('should trash directories with a detached rm', async () => {
+      const trashDirectoryWithoutAgent = vi.fn(async () => {})
+      const deleteDirectory = vi.fn(async () => {})
+      const { backend, agent } = olderAgentBackend({ trashDirectoryWithoutAgent, deleteDirectory })
+
+      await backend.trashDirectory('/workspace')
+
+      expect(agent.request).toHaveBeenCalledWith('trash', expect.anything())
+      expect(trashDirectoryWithoutAgent).toHaveBeenCalledWith('/workspace', expect.stringMatching(/\/\.constellation-trash$/))
+      expect(deleteDirectory).not.toHaveBeenCalled()
+    })
+  })
 })
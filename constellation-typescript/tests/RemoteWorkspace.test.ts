@@ -1,7 +1,11 @@
+import type { Dirent } from 'fs'
+import { Readable } from 'stream'
 import { beforeEach, describe, expect, it, vi } from 'vitest'
 import { RemoteWorkspace } from '../src/workspace/RemoteWorkspace.js'
 import type { RemoteBackend } from '../src/backends/RemoteBackend.js'
 import { FileSystemError } from '../src/types.js'
+import { ExecStream } from '../src/workspace/ExecStream.js'
+import type { AgentWatchEvent } from '../src/agent/protocol.js'
 
 describe('RemoteWorkspace', () => {
   let mockBackend: RemoteBackend
@@ -22,7 +26,9 @@ describe('RemoteWorkspace', () => {
       },
       connected: true,
       execInWorkspace: vi.fn().mockResolvedValue('command output'),
+      execStreamInWorkspace: vi.fn().mockImplementation(async () => ExecStream.empty()),
       readFile: vi.fn().mockResolvedValue('file content'),
+      createReadStream: vi.fn().mockImplementation(async () => Readable.from([Buffer.from('ranged')])),
       writeFile: vi.fn().mockResolvedValue(undefined),
       createDirectory: vi.fn().mockResolvedValue(undefined),
       touchFile: vi.fn().mockResolvedValue(undefined),
@@ -38,6 +44,19 @@ describe('RemoteWorkspace', () => {
       }),
       listDirectory: vi.fn().mockResolvedValue(['file1.txt', 'file2.txt']),
       deleteDirectory: vi.fn().mockResolvedValue(undefined),
+      trashDirectory: vi.fn().mockResolvedValue(undefined),
+      searchFiles: vi.fn().mockResolvedValue({ matches: [], truncated: false, filesSearched: 0 }),
+      walkTree: vi.fn().mockResolvedValue({ entries: [], truncated: false }),
+      listDirectoryEntries: vi.fn().mockImplementation(async (remotePath: string, withStats?: boolean) => [
+        {
+          dirent: { name: 'file1.txt', parentPath: remotePath, isFile: () => true, isDirectory: () => false },
+          ...(withStats ? { stats: { size: 5, isFile: () => true, isDirectory: () => false, isSymbolicLink: () => false } } : {}),
+        },
+        {
+          dirent: { name: 'lib', parentPath: remotePath, isFile: () => false, isDirectory: () => true },
+          ...(withStats ? { stats: { size: 4096, isFile: () => false, isDirectory: () => true, isSymbolicLink: () => false } } : {}),
+        },
+      ]),
       getWorkspace: vi.fn(),
       listWorkspaces: vi.fn(),
       destroy: vi.fn(),
@@ -78,6 +97,7 @@ describe('RemoteWorkspace', () => {
         workspace.workspacePath,
         'echo "hello"',
         'utf8',
+        undefined,
         undefined
       )
     })
@@ -92,6 +112,7 @@ describe('RemoteWorkspace', () => {
         workspace.workspacePath,
         'cat file.bin',
         'buffer',
+        undefined,
         undefined
       )
     })
@@ -108,8 +129,20 @@ describe('RemoteWorkspace', () => {
         workspace.workspacePath,
         'echo $MY_VAR',
         'utf8',
-        { MY_VAR: 'test' }
+        { MY_VAR: 'test' },
+        undefined
+      )
+    })
+
+    it('should stream commands via backend with merged environment', async () => {
+      const stream = await workspace.execStream('npm install', { env: { CI: '1' }, retainBytes: 1024 })
+
+      expect(mockBackend.execStreamInWorkspace).toHaveBeenCalledWith(
+        workspace.workspacePath,
+        'npm install',
+        { env: { CI: '1' }, retainBytes: 1024 }
       )
+      expect((await stream.result).exitCode).toBe(0)
     })
   })
 
@@ -218,10 +251,11 @@ describe('RemoteWorkspace', () => {
       )
     })
 
-    it('should throw when withFileTypes is requested', async () => {
-      await expect(
-        workspace.readdir('.', { withFileTypes: true })
-      ).rejects.toThrow('withFileTypes option is not supported for remote workspaces')
+    it('should return Dirents when withFileTypes is requested', async () => {
+      const entries = await workspace.readdir('.', { withFileTypes: true }) as Dirent[]
+
+      expect(entries.map(entry => [entry.name, entry.isDirectory()])).toEqual([['file1.txt', false], ['lib', true]])
+      expect(mockBackend.listDirectoryEntries).toHaveBeenCalledWith(workspace.workspacePath)
     })
   })
 
@@ -243,6 +277,17 @@ describe('RemoteWorkspace', () => {
 
       expect(content).toBeInstanceOf(Buffer)
     })
+
+    it('should open ranged read streams through the backend', async () => {
+      const stream = await workspace.createReadStream('file.bin', { start: 10, end: 15 })
+
+      expect(mockBackend.createReadStream).toHaveBeenCalledWith(
+        '/tmp/constellation-fs/users/test-user/test-workspace/file.bin',
+        { start: 10, end: 15 }
+      )
+      expect(Buffer.concat(await stream.toArray()).toString()).toBe('ranged')
+      await expect(workspace.createReadStream('file.bin', { start: -1 })).rejects.toThrow('Invalid byte range')
+    })
   })
 
   describe('writeFile', () => {
@@ -258,10 +303,10 @@ describe('RemoteWorkspace', () => {
   })
 
   describe('delete', () => {
-    it('should delete workspace via backend', async () => {
+    it('should move the workspace to the trash via backend', async () => {
       await workspace.delete()
 
-      expect(mockBackend.deleteDirectory).toHaveBeenCalledWith(workspace.workspacePath)
+      expect(mockBackend.trashDirectory).toHaveBeenCalledWith(workspace.workspacePath)
     })
   })
 
@@ -274,6 +319,39 @@ describe('RemoteWorkspace', () => {
     })
   })
 
+  describe('walk', () => {
+    it('should walk the resolved directory in one backend call', async () => {
+      await workspace.walk({ path: 'src', maxDepth: 2 })
+
+      expect(mockBackend.walkTree).toHaveBeenCalledWith(`${workspace.workspacePath}/src`, { path: 'src', maxDepth: 2 })
+    })
+  })
+
+  describe('search', () => {
+    it('should search the resolved directory with workspace-relative paths', async () => {
+      await workspace.search({ pattern: 'todo', path: 'src/lib' })
+
+      expect(mockBackend.searchFiles).toHaveBeenCalledWith(
+        `${workspace.workspacePath}/src/lib`,
+        { pattern: 'todo', path: 'src/lib' },
+        'src/lib',
+        undefined
+      )
+    })
+
+    it('should ask for the workspace search index when enabled', async () => {
+      const indexed = new RemoteWorkspace(mockBackend, 'test-user', 'indexed', '/remote/indexed', { searchIndex: true })
+      await indexed.search({ pattern: 'todo' })
+
+      expect(mockBackend.searchFiles).toHaveBeenCalledWith('/remote/indexed', { pattern: 'todo' }, '', '/remote/indexed')
+    })
+
+    it('should reject search paths outside the workspace', async () => {
+      await expect(workspace.search({ pattern: 'x', path: '../other' })).rejects.toThrow(FileSystemError)
+      expect(mockBackend.searchFiles).not.toHaveBeenCalled()
+    })
+  })
+
   describe('path validation', () => {
     it('should reject empty paths', async () => {
       await expect(workspace.readFile('', 'utf-8')).rejects.toThrow('Path cannot be empty')
@@ -334,10 +412,116 @@ describe('RemoteWorkspace', () => {
       expect(result).toEqual(['file1.txt', 'file2.txt'])
     })
 
-    it('should throw for promises.readdir with withFileTypes', async () => {
-      await expect(
-        workspace.promises.readdir('.', { withFileTypes: true })
-      ).rejects.toThrow('withFileTypes option is not supported for remote workspaces')
+    it('should provide promises.readdir with withFileTypes', async () => {
+      const entries = await workspace.promises.readdir('subdir', { withFileTypes: true }) as Dirent[]
+
+      expect(entries.map(entry => entry.name)).toEqual(['file1.txt', 'lib'])
+    })
+
+    it('should route the other promises methods to the async operations', async () => {
+      expect(await workspace.promises.readFile('file.txt', 'utf-8')).toBe('file content')
+      await workspace.promises.writeFile('out.txt', 'data')
+
+      expect(mockBackend.writeFile).toHaveBeenCalledWith(`${workspace.workspacePath}/out.txt`, 'data', 'utf-8')
+    })
+  })
+  describe('metadata cache', () => {
+    let cached: RemoteWorkspace
+    let onChange: (event: AgentWatchEvent) => void
+    const root = '/tmp/constellation-fs/users/test-user/test-workspace'
+
+    beforeEach(async () => {
+      Object.assign(mockBackend, {
+        watchTree: vi.fn().mockImplementation(async (_path: string, listener: typeof onChange) => {
+          onChange = listener
+          return () => {}
+        }),
+      })
+      cached = new RemoteWorkspace(mockBackend, 'test-user', 'test-workspace', root, { metadataCache: true })
+      // Let the background watcher start
+      await cached.exists('warmup')
+      await new Promise(resolve => setImmediate(resolve))
+    })
+
+    it('should answer repeated lookups from the cache', async () => {
+      await cached.exists('file.txt')
+      await cached.exists('file.txt')
+      await cached.stat('file.txt')
+      await cached.stat('file.txt')
+      const first = await cached.readdir('dir') as string[]
+      first.push('mutated')
+      const second = await cached.readdir('dir')
+
+      expect(mockBackend.pathExists).toHaveBeenCalledTimes(2) // warmup + file.txt
+      expect(mockBackend.pathStat).toHaveBeenCalledTimes(1)
+      expect(mockBackend.listDirectory).toHaveBeenCalledTimes(1)
+      expect(second).toEqual(['file1.txt', 'file2.txt'])
+      expect(mockBackend.watchTree).toHaveBeenCalledWith(root, expect.any(Function))
+    })
+
+    it('should prime stats from a listing with file types', async () => {
+      await cached.readdir('dir', { withFileTypes: true })
+      const stats = await cached.stat('dir/file1.txt')
+      const names = await cached.readdir('dir')
+
+      expect(mockBackend.listDirectoryEntries).toHaveBeenCalledWith(`${root}/dir`, true)
+      expect(stats.size).toBe(5)
+      expect(await cached.exists('dir/lib')).toBe(true)
+      expect(names).toEqual(['file1.txt', 'lib'])
+      expect(mockBackend.pathStat).not.toHaveBeenCalled()
+      expect(mockBackend.listDirectory).not.toHaveBeenCalled()
+    })
+
+    it('should invalidate the path and its parent listing on own writes', async () => {
+      await cached.exists('dir/file.txt')
+      await cached.readdir('dir')
+      await cached.writeFile('dir/file.txt', 'content')
+      await cached.exists('dir/file.txt')
+      await cached.readdir('dir')
+
+      expect(mockBackend.pathExists).toHaveBeenCalledTimes(3)
+      expect(mockBackend.listDirectory).toHaveBeenCalledTimes(2)
+    })
+
+    it('should invalidate on changes pushed by the watcher', async () => {
+      await cached.stat('a.txt')
+      await cached.stat('b.txt')
+      onChange({ paths: [`${root}/a.txt`] })
+      await cached.stat('a.txt')
+      await cached.stat('b.txt')
+
+      expect(mockBackend.pathStat).toHaveBeenCalledTimes(3)
+    })
+
+    it('should drop everything when a command runs or the watch ends', async () => {
+      await cached.exists('file.txt')
+      await cached.exec('mv file.txt other.txt')
+      await cached.exists('file.txt')
+      onChange({ paths: null, closed: true })
+      await cached.exists('file.txt')
+
+      expect(mockBackend.pathExists).toHaveBeenCalledTimes(4)
+    })
+
+    it('should not cache results that raced with an invalidation', async () => {
+      let finish!: (value: boolean) => void
+      vi.mocked(mockBackend.pathExists).mockImplementationOnce(() => new Promise(resolve => { finish = resolve }))
+
+      const lookup = cached.exists('slow.txt')
+      await new Promise(resolve => setImmediate(resolve))
+      onChange({ paths: [`${root}/slow.txt`] })
+      finish(false)
+      await lookup
+      await cached.exists('slow.txt')
+
+      expect(mockBackend.pathExists).toHaveBeenCalledTimes(3)
+    })
+
+    it('should bypass the cache unless enabled', async () => {
+      await workspace.exists('file.txt')
+      await workspace.exists('file.txt')
+
+      expect(mockBackend.pathExists).toHaveBeenCalledTimes(3)
     })
   })
 })
@@ -0,0 +1,79 @@
+import { describe, expect, it } from 'vitest'
+import { OverloadedError, RequestLimiter } from '../src/utils/RequestLimiter.js'
+
+/** A task that runs until its resolve() is called */
+function deferred() {
+  let resolve!: () => void
+  const promise = new Promise<void>(r => { resolve = r })
+  return { promise, resolve }
+}
+
+describe('RequestLimiter', () => {
+  it('should run at most maxConcurrent tasks and queue the rest', async () => {
+    const limiter = new RequestLimiter({ maxConcurrent: 2, maxQueued: 10 })
+    const gates = [deferred(), deferred(), deferred()]
+    const started: number[] = []
+
+    const runs = gates.map((gate, i) => limiter.run('user', async () => {
+      started.push(i)
+      await gate.promise
+    }))
+    await Promise.resolve()
+
+    expect(started).toEqual([0, 1])
+    expect(limiter.active).toBe(2)
+    expect(limiter.queued).toBe(1)
+
+    gates[0]!.resolve()
+    await runs[0]
+    await Promise.resolve()
+    expect(started).toEqual([0, 1, 2])
+    expect(limiter.active).toBe(2)
+
+    gates[1]!.resolve()
+    gates[2]!.resolve()
+    await Promise.all(runs)
+    expect(limiter.active).toBe(0)
+    expect(limiter.queued).toBe(0)
+  })
+
+  it('should reject with OverloadedError once the queue is full', async () => {
+    const limiter = new RequestLimiter({ maxConcurrent: 1, maxQueued: 1 })
+    const gate = deferred()
+
+    const first = limiter.run('user', () => gate.promise)
+    const second = limiter.run('user', async () => 'queued')
+
+    await expect(limiter.run('user', async () => 'shed')).rejects.toBeInstanceOf(OverloadedError)
+
+    gate.resolve()
+    await first
+    expect(await second).toBe('queued')
+  })
+
+  it('should free the slot when a task throws', async () => {
+    const limiter = new RequestLimiter({ maxConcurrent: 1, maxQueued: 0 })
+
+    await expect(limiter.run('user', async () => { throw new Error('boom') })).rejects.toThrow('boom')
+    expect(limiter.active).toBe(0)
+    expect(await limiter.run('user', async () => 'ok')).toBe('ok')
+  })
+
+  it('should start waiting tasks round-robin across owners', async () => {
+    const limiter = new RequestLimiter({ maxConcurrent: 1, maxQueued: 10 })
+    const gate = deferred()
+    const order: string[] = []
+
+    const blocker = limiter.run('a', () => gate.promise)
+    const runs = [
+      limiter.run('a', async () => { order.push('a1') }),
+      limiter.run('a', async () => { order.push('a2') }),
+      limiter.run('b', async () => { order.push('b1') }),
+    ]
+
+    gate.resolve()
+    await blocker
+    await Promise.all(runs)
+    expect(order).toEqual(['a1', 'b1', 'a2'])
+  })
+})
@@ -0,0 +1,139 @@
+import { mkdtemp, readFile, rm } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { FileOperationLogSink } from '../src/logging/FileOperationLogSink.js'
+import { OtlpOperationLogSink } from '../src/logging/OtlpOperationLogSink.js'
+import { RingBufferOperationsLogger } from '../src/logging/RingBufferOperationsLogger.js'
+import type { OperationLogEntry } from '../src/logging/types.js'
+
+function entry(command: string, overrides: Partial<OperationLogEntry> = {}): OperationLogEntry {
+  return {
+    timestamp: new Date(1700000000000),
+    operation: 'exec',
+    userId: 'user-1',
+    workspaceName: 'default',
+    workspacePath: '/workspaces/user-1/default',
+    command,
+    success: true,
+    durationMs: 12.5,
+    ...overrides,
+  }
+}
+
+/** Sink recording the batches it receives */
+function recordingSink() {
+  const batches: string[][] = []
+  return { batches, write: (entries: readonly OperationLogEntry[]) => { batches.push(entries.map(e => e.command)) } }
+}
+
+describe('RingBufferOperationsLogger', () => {
+  it('should keep the newest records once full', () => {
+    const logger = new RingBufferOperationsLogger({ capacity: 3 })
+    for (let i = 0; i < 5; i++) logger.log(entry(`echo ${i}`))
+
+    expect(logger.length).toBe(3)
+    expect(logger.getEntries().map(e => e.command)).toEqual(['echo 2', 'echo 3', 'echo 4'])
+  })
+
+  it('should round-trip every field', () => {
+    const logger = new RingBufferOperationsLogger()
+    const failed = entry('cat missing', { success: false, exitCode: 1, stdout: '', stderr: 'No such file\n', error: 'exit 1' })
+    logger.log(failed)
+    logger.log(entry('/notes.txt', { operation: 'readFile' }))
+
+    const [first, second] = logger.getEntries()
+    expect(first).toEqual(failed)
+    expect(second).toEqual(entry('/notes.txt', { operation: 'readFile' }))
+    expect(second).not.toHaveProperty('stdout')
+    expect(second).not.toHaveProperty('exitCode')
+  })
+
+  it('should truncate output at maxOutputBytes without splitting characters', () => {
+    const logger = new RingBufferOperationsLogger({ maxOutputBytes: 8 })
+    logger.log(entry('build', { stdout: 'ééééé', stderr: 'short' }))
+
+    const [logged] = logger.getEntries()
+    expect(logged!.stdout).toBe('éééé\n... [truncated, 5 characters in total]')
+    expect(logged!.stderr).toBe('short')
+  })
+
+  it('should drain to the sinks in batches and count records replaced before draining', async () => {
+    const sink = recordingSink()
+    const logger = new RingBufferOperationsLogger({ capacity: 4, batchSize: 2, flushIntervalMs: 0, sinks: [sink] })
+
+    logger.log(entry('a'))
+    await logger.flush()
+    for (const command of ['b', 'c', 'd', 'e', 'f', 'g']) logger.log(entry(command))
+    await logger.close()
+
+    expect(sink.batches).toEqual([['a'], ['d', 'e'], ['f', 'g']])
+    expect(logger.dropped).toBe(2)
+  })
+
+  it('should drain on its own once a batch is waiting', async () => {
+    const sink = recordingSink()
+    const logger = new RingBufferOperationsLogger({ batchSize: 2, flushIntervalMs: 0, sinks: [sink] })
+
+    logger.log(entry('a'))
+    logger.log(entry('b'))
+    await new Promise(resolve => setImmediate(resolve))
+    await logger.flush()
+
+    expect(sink.batches).toEqual([['a', 'b']])
+  })
+
+  it('should keep draining to other sinks when one fails', async () => {
+    const sink = recordingSink()
+    const logger = new RingBufferOperationsLogger({
+      flushIntervalMs: 0,
+      sinks: [{ write: () => { throw new Error('disk full') } }, sink],
+    })
+
+    logger.log(entry('a'))
+    await logger.flush()
+
+    expect(sink.batches).toEqual([['a']])
+  })
+})
+
+describe('FileOperationLogSink', () => {
+  let dir: string
+
+  beforeEach(async () => {
+    dir = await mkdtemp(join(tmpdir(), 'oplog-'))
+  })
+
+  afterEach(async () => {
+    await rm(dir, { recursive: true, force: true })
+  })
+
+  it('should append each batch as JSON Lines', async () => {
+    const path = join(dir, 'operations.jsonl')
+    const sink = new FileOperationLogSink(path)
+
+    await sink.write([entry('a'), entry('b')])
+    await sink.write([entry('c', { stdout: 'line\n' })])
+
+    const lines = (await readFile(path, 'utf-8')).trimEnd().split('\n').map(line => JSON.parse(line))
+    expect(lines.map(line => line.command)).toEqual(['a', 'b', 'c'])
+    expect(lines[2].stdout).toBe('line\n')
+  })
+})
+
+describe('OtlpOperationLogSink', () => {
+  it('should map records to OTLP log records', () => {
+    const sink = new OtlpOperationLogSink({ url: 'http://collector:4318/v1/logs', serviceName: 'agents' })
+
+    // eslint-disable-next-line @typescript-eslint/no-explicit-any
+    const request = sink.exportRequest([entry('npm test', { success: false, exitCode: 1 })]) as any
+    const [resourceLogs] = request.resourceLogs
+    const [record] = resourceLogs.scopeLogs[0].logRecords
+
+    expect(resourceLogs.resource.attributes).toEqual([{ key: 'service.name', value: { stringValue: 'agents' } }])
+    expect(record.timeUnixNano).toBe('1700000000000000000')
+    expect(record.severityText).toBe('ERROR')
+    expect(record.body).toEqual({ stringValue: 'exec: npm test' })
+    expect(record.attributes).toContainEqual({ key: 'process.exit_code', value: { intValue: '1' } })
+  })
+})
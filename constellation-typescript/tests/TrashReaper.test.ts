@@ -0,0 +1,72 @@
+import { mkdir, mkdtemp, readdir, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { moveToTrash, TRASH_DIRECTORY, trashCommand, TrashReaper } from '../src/utils/TrashReaper.js'
+
+describe('TrashReaper', () => {
+  let root: string
+  let trash: string
+
+  const tree = async (path: string, files: number) => {
+    await mkdir(join(path, 'nested', 'deeper'), { recursive: true })
+    for (let i = 0; i < files; i++) {
+      await writeFile(join(path, i % 2 ? 'nested' : 'nested/deeper', `file-${i}.txt`), String(i))
+    }
+  }
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-trash-test-'))
+    trash = join(root, TRASH_DIRECTORY)
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should move a directory away at once and empty the trash later', async () => {
+    await tree(join(root, 'workspace'), 50)
+
+    await moveToTrash(join(root, 'workspace'), trash)
+    expect(await readdir(root)).toEqual([TRASH_DIRECTORY])
+    expect(await readdir(trash)).toHaveLength(1)
+
+    await TrashReaper.for(trash).idle()
+    expect(await readdir(trash)).toEqual([])
+  })
+
+  it('should reap what an earlier process left in the trash', async () => {
+    await tree(join(trash, 'leftover.1.abcd'), 10)
+    await tree(join(root, 'workspace'), 10)
+
+    await moveToTrash(join(root, 'workspace'), trash)
+    await TrashReaper.for(trash).idle()
+
+    expect(await readdir(trash)).toEqual([])
+  })
+
+  it('should stay within its removal rate', async () => {
+    const throttledTrash = join(root, 'throttled')
+    const reaper = TrashReaper.for(throttledTrash, { entriesPerSecond: 20 })
+    await tree(join(throttledTrash, 'big'), 30)
+
+    const started = Date.now()
+    reaper.schedule()
+    await reaper.idle()
+
+    // 30 files and 4 directories at 20 per second take more than one second window
+    expect(Date.now() - started).toBeGreaterThanOrEqual(900)
+    expect(await readdir(throttledTrash)).toEqual([])
+  })
+
+  it('should ignore a directory that is already gone', async () => {
+    await expect(moveToTrash(join(root, 'missing'), trash)).resolves.toBeUndefined()
+  })
+
+  it('should build a shell fallback that detaches the removal', () => {
+    const command = trashCommand('/workspaces/alice/project', '/workspaces/.constellation-trash')
+
+    expect(command).toContain(`mv '/workspaces/alice/project' '/workspaces/.constellation-trash/project.`)
+    expect(command).toMatch(/nohup .*nice -n 19 rm -rf .* <\/dev\/null >\/dev\/null 2>&1 &/)
+  })
+})
@@ -0,0 +1,100 @@
+import { mkdir, mkdtemp, readFile, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { dirname, join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { searchTree } from '../src/utils/search.js'
+import {
+  SEARCH_INDEX_DIRECTORY,
+  signatureMayContain,
+  trigramSignature,
+  TrigramIndex
+} from '../src/utils/TrigramIndex.js'
+
+describe('TrigramIndex', () => {
+  let root: string
+  let index: TrigramIndex
+
+  const files = async (contents: Record<string, string | Buffer>) => {
+    for (const [path, content] of Object.entries(contents)) {
+      await mkdir(dirname(join(root, path)), { recursive: true })
+      await writeFile(join(root, path), content)
+    }
+  }
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-index-test-'))
+    index = TrigramIndex.for(root)
+  })
+
+  afterEach(async () => {
+    await index.close(false)
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should never rule out a file that contains the text', () => {
+    const text = 'The quick brown fox jumps over the lazy dog'
+    const signature = trigramSignature(Buffer.from(text))
+
+    for (let i = 0; i + 3 <= text.length; i++) {
+      expect(signatureMayContain(signature, text.slice(i, i + 8))).toBe(true)
+    }
+    expect(signatureMayContain(signature, 'QUICK BROWN')).toBe(true)
+    expect(signatureMayContain(trigramSignature(Buffer.alloc(0)), 'abc')).toBe(false)
+  })
+
+  it('should return the same matches as a full walk while reading fewer files', async () => {
+    const contents: Record<string, string> = {
+      '.gitignore': 'build/\n',
+      'src/server.ts': 'export function handleRequest(req) {}\n',
+      'src/routes/api.ts': 'router.get("/", HandleRequest)\n',
+      'build/server.js': 'function handleRequest() {}\n',
+      '.hidden/notes.txt': 'handleRequest\n',
+    }
+    for (let i = 0; i < 50; i++) contents[`docs/page${i}.md`] = `# Page ${i}\n\nNothing to see.\n`
+    await files(contents)
+
+    for (const options of [{ pattern: 'handleRequest' }, { pattern: 'handlerequest', ignoreCase: true }]) {
+      const indexed = await index.search('', options)
+      const walked = await searchTree(root, options)
+      expect(indexed.matches).toEqual(walked.matches)
+      expect(indexed.filesSearched).toBeLessThan(walked.filesSearched)
+    }
+
+    const scoped = await index.search('src/routes', { pattern: 'Request' })
+    expect(scoped.matches.map(match => match.path)).toEqual(['src/routes/api.ts'])
+  })
+
+  it('should pick up changes reported through markDirty', async () => {
+    await files({ 'a.txt': 'alpha\n', 'b.txt': 'beta\n' })
+    expect((await index.search('', { pattern: 'gamma' })).matches).toEqual([])
+
+    await files({ 'b.txt': 'gamma\n', 'new/c.txt': 'gamma ray\n' })
+    index.markDirty('b.txt')
+    index.markDirty('new/c.txt')
+    const result = await index.search('', { pattern: 'gamma' })
+
+    expect(result.matches.map(match => match.path)).toEqual(['b.txt', 'new/c.txt'])
+  })
+
+  it('should persist signatures across instances', async () => {
+    await files({ 'src/main.ts': 'const marker = 1\n' })
+    await index.search('', { pattern: 'marker' })
+    await index.close()
+
+    const stored = await readFile(join(root, SEARCH_INDEX_DIRECTORY, 'search-index'))
+    expect(stored.subarray(0, 4).toString('latin1')).toBe('CFTI')
+
+    index = TrigramIndex.for(root)
+    const result = await index.search('', { pattern: 'marker' })
+    expect(result.matches.map(match => match.path)).toEqual(['src/main.ts'])
+    expect(index.size).toBe(1)
+  })
+
+  it('should fall back to a walk for queries it cannot narrow', async () => {
+    await files({ '.env': 'SECRET=1\n', 'a.txt': 'ab\n' })
+
+    expect((await index.search('', { pattern: 'SECRET', hidden: true })).matches).toHaveLength(1)
+    expect((await index.search('', { pattern: 'a.' })).matches).toHaveLength(1)
+    expect(index.size).toBe(0)
+  })
+})
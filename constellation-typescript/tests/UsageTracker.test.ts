@@ -0,0 +1,120 @@
+import { mkdir, mkdtemp, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { dirname, join } from 'path'
+import { afterEach, beforeEach, describe, expect, it, vi } from 'vitest'
+import { parseUsageOutput, quotaViolation, UsageTracker } from '../src/utils/UsageTracker.js'
+
+describe('UsageTracker', () => {
+  let root: string
+  let tracker: UsageTracker
+
+  const files = async (contents: Record<string, string>) => {
+    for (const [path, content] of Object.entries(contents)) {
+      await mkdir(dirname(join(root, path)), { recursive: true })
+      await writeFile(join(root, path), content)
+    }
+  }
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-usage-test-'))
+    tracker = UsageTracker.for(root)
+  })
+
+  afterEach(async () => {
+    tracker.close()
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should count the tree on the first call', async () => {
+    await files({ 'a.txt': 'hello', 'src/b.txt': 'abc', 'src/deep/c.txt': '' })
+
+    expect(await tracker.usage()).toEqual({ bytes: 8, files: 3 })
+    expect(tracker.sizeOf('src/b.txt')).toBe(3)
+    expect(tracker.sizeOf('missing.txt')).toBe(0)
+  })
+
+  it('should apply recorded writes without rescanning', async () => {
+    await files({ 'a.txt': 'hello' })
+    await tracker.usage()
+
+    await writeFile(join(root, 'a.txt'), 'hello world')
+    tracker.record('a.txt', 11)
+
+    expect(await tracker.usage()).toEqual({ bytes: 11, files: 1 })
+  })
+
+  it('should follow changes reported by the watcher', async () => {
+    await files({ 'keep.txt': 'keep', 'gone/a.txt': 'aaaa', 'gone/b.txt': 'bb' })
+    expect(await tracker.usage()).toEqual({ bytes: 10, files: 3 })
+
+    await rm(join(root, 'gone'), { recursive: true })
+    await files({ 'new/c.txt': 'ccc' })
+
+    await vi.waitFor(async () => {
+      expect(await tracker.usage()).toEqual({ bytes: 7, files: 2 })
+    }, { timeout: 2000 })
+  })
+
+  it('should close idle trackers and scan again when asked later', async () => {
+    await files({ 'a.txt': 'hello' })
+    await tracker.usage()
+
+    UsageTracker.closeIdle(60_000)
+    expect(UsageTracker.peek(root)).toBe(tracker)
+
+    UsageTracker.closeIdle(0)
+    expect(UsageTracker.peek(root)).toBeUndefined()
+
+    await files({ 'b.txt': 'abc' })
+    tracker = UsageTracker.for(root)
+    expect(await tracker.usage()).toEqual({ bytes: 8, files: 2 })
+  })
+
+  it('should treat a missing root as empty', async () => {
+    const missing = UsageTracker.for(join(root, 'missing'))
+    try {
+      expect(await missing.usage()).toEqual({ bytes: 0, files: 0 })
+    } finally {
+      missing.close()
+    }
+  })
+
+  it('should add up the workspaces of a user', async () => {
+    const first = UsageTracker.for(join(root, 'first'))
+    const second = UsageTracker.for(join(root, 'second'))
+    try {
+      await files({ 'first/a.txt': 'aa', 'second/b.txt': 'bbb' })
+      expect(await UsageTracker.forUser(root)).toEqual({ bytes: 5, files: 2 })
+    } finally {
+      first.close()
+      second.close()
+    }
+  })
+})
+
+describe('quotaViolation', () => {
+  it('should allow writes that fit or do not grow', () => {
+    const usage = { bytes: 90, files: 1 }
+    expect(quotaViolation(usage, 10, 100, null, undefined)).toBeNull()
+    expect(quotaViolation({ bytes: 200, files: 1 }, -5, 100, null, undefined)).toBeNull()
+    expect(quotaViolation(usage, 1_000, undefined, null, undefined)).toBeNull()
+  })
+
+  it('should report the quota that a write exceeds', () => {
+    const usage = { bytes: 90, files: 1 }
+    expect(quotaViolation(usage, 11, 100, null, undefined)).toMatch(/^Workspace quota exceeded/)
+    expect(quotaViolation(usage, 11, 1_000, { bytes: 500, files: 3 }, 510)).toMatch(/^User quota exceeded/)
+  })
+})
+
+describe('parseUsageOutput', () => {
+  it('should read the lines of usageCommand', () => {
+    expect(parseUsageOutput('120 4\n', undefined, false)).toEqual({ bytes: 120, files: 4 })
+    expect(parseUsageOutput('120 4\n20\n900 12\n', 'a.txt', true)).toEqual({
+      bytes: 120,
+      files: 4,
+      fileSize: 20,
+      user: { bytes: 900, files: 12 },
+    })
+  })
+})
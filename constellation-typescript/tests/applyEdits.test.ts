@@ -0,0 +1,98 @@
+import { chmod, mkdtemp, readdir, readFile, rm, stat, symlink, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { applyEditsToContent, applyEditsToFile, createUnifiedDiff, EditNoMatchError } from '../src/utils/applyEdits.js'
+
+describe('applyEditsToContent', () => {
+  it('should apply edits in order to the result of the previous ones', () => {
+    const { content, changed } = applyEditsToContent(Buffer.from('alpha beta gamma\n'), [
+      { oldText: 'beta', newText: 'BETA' },
+      { oldText: 'BETA gamma', newText: 'delta' },
+      { oldText: 'alpha', newText: 'a' },
+    ], 'file.txt')
+
+    expect(content.toString()).toBe('a delta\n')
+    expect(changed).toBe(true)
+  })
+
+  it('should find text that spans earlier replacements', () => {
+    const { content } = applyEditsToContent(Buffer.from('one two three'), [
+      { oldText: 'two', newText: '2' },
+      { oldText: 'one 2 th', newText: 'X' },
+    ], 'file.txt')
+
+    expect(content.toString()).toBe('Xree')
+  })
+
+  it('should normalize CRLF in the content and the edits', () => {
+    const { content } = applyEditsToContent(Buffer.from('first\r\nsecond\r\n'), [
+      { oldText: 'first\r\nsecond', newText: 'only\r\none' },
+    ], 'file.txt')
+
+    expect(content.toString()).toBe('only\none\n')
+  })
+
+  it('should throw EditNoMatchError when oldText is missing', () => {
+    expect(() => applyEditsToContent(Buffer.from('content'), [{ oldText: 'missing', newText: 'x' }], 'file.txt'))
+      .toThrow(EditNoMatchError)
+  })
+
+  it('should report no change when the edits are identity replacements', () => {
+    const { changed, diff } = applyEditsToContent(Buffer.from('same\n'), [{ oldText: 'same', newText: 'same' }], 'file.txt')
+
+    expect(changed).toBe(false)
+    expect(diff).toBe(createUnifiedDiff('', '', 'file.txt'))
+  })
+
+  it('should number hunks by their line in the file', () => {
+    const lines = Array.from({ length: 10_000 }, (_, i) => `line ${i + 1}`)
+    const { diff } = applyEditsToContent(Buffer.from(lines.join('\n')), [
+      { oldText: 'line 5000\n', newText: 'changed\n' },
+    ], 'big.txt')
+
+    expect(diff).toBe(['--- big.txt', '+++ big.txt', '@@ -5000,1 +5000,1 @@', '-line 5000', '+changed'].join('\n'))
+  })
+})
+
+describe('applyEditsToFile', () => {
+  let root: string
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-edit-test-'))
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should replace the file atomically, keeping its mode and symlinks', async () => {
+    const file = join(root, 'run.sh')
+    await writeFile(file, '#!/bin/sh\necho old\n')
+    await chmod(file, 0o750)
+    await symlink('run.sh', join(root, 'link'))
+
+    const result = await applyEditsToFile(join(root, 'link'), [{ oldText: 'old', newText: 'new' }], {}, 'link')
+
+    expect(result.changed).toBe(true)
+    expect(await readFile(file, 'utf-8')).toBe('#!/bin/sh\necho new\n')
+    expect((await stat(file)).mode & 0o777).toBe(0o750)
+    // No temporary file is left behind
+    expect((await readdir(root)).sort()).toEqual(['link', 'run.sh'])
+  })
+
+  it('should leave the file untouched on dryRun or a missing match', async () => {
+    const file = join(root, 'file.txt')
+    await writeFile(file, 'keep me\n')
+
+    const result = await applyEditsToFile(file, [{ oldText: 'keep', newText: 'drop' }], { dryRun: true }, 'file.txt')
+    expect(result.diff).toContain('+drop me')
+    await expect(applyEditsToFile(file, [
+      { oldText: 'keep', newText: 'drop' },
+      { oldText: 'missing', newText: 'x' },
+    ], {}, 'file.txt')).rejects.toThrow(EditNoMatchError)
+
+    expect(await readFile(file, 'utf-8')).toBe('keep me\n')
+    expect(await readdir(root)).toEqual(['file.txt'])
+  })
+})
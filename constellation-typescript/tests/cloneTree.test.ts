@@ -0,0 +1,61 @@
+import { chmod, lstat, mkdir, mkdtemp, readdir, readFile, readlink, rm, stat, symlink, utimes, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { cloneCommand, cloneTree } from '../src/utils/cloneTree.js'
+
+describe('cloneTree', () => {
+  let root: string
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-clone-test-'))
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  it('should copy files, modes, mtimes and symlinks but not the search index', async () => {
+    const source = join(root, 'source')
+    await mkdir(join(source, 'bin'), { recursive: true })
+    await mkdir(join(source, '.constellationfs'))
+    await writeFile(join(source, '.constellationfs', 'search-index'), 'index')
+    await writeFile(join(source, 'bin', 'run.sh'), '#!/bin/sh\n')
+    await chmod(join(source, 'bin', 'run.sh'), 0o755)
+    await utimes(join(source, 'bin', 'run.sh'), new Date(1_000_000), new Date(2_000_000))
+    await symlink('bin/run.sh', join(source, 'run'))
+    await chmod(join(source, 'bin'), 0o555)
+
+    const target = join(root, 'target')
+    await cloneTree(source, target)
+
+    expect(await readFile(join(target, 'bin', 'run.sh'), 'utf-8')).toBe('#!/bin/sh\n')
+    expect((await stat(join(target, 'bin', 'run.sh'))).mode & 0o777).toBe(0o755)
+    expect((await stat(join(target, 'bin', 'run.sh'))).mtimeMs).toBe(2_000_000)
+    expect((await stat(join(target, 'bin'))).mode & 0o777).toBe(0o555)
+    expect(await readlink(join(target, 'run'))).toBe('bin/run.sh')
+    expect(await readdir(target)).not.toContain('.constellationfs')
+    // No staging directory is left behind
+    expect((await readdir(root)).sort()).toEqual(['source', 'target'])
+
+    await chmod(join(source, 'bin'), 0o755)
+    await chmod(join(target, 'bin'), 0o755)
+  })
+
+  it('should refuse a missing source or an existing target', async () => {
+    await mkdir(join(root, 'source'))
+    await mkdir(join(root, 'taken'))
+
+    await expect(cloneTree(join(root, 'missing'), join(root, 'copy'))).rejects.toMatchObject({ code: 'ENOENT' })
+    await expect(cloneTree(join(root, 'source'), join(root, 'taken'))).rejects.toMatchObject({ code: 'EEXIST' })
+    await expect(lstat(join(root, 'copy'))).rejects.toThrow()
+  })
+
+  it('should quote paths in the fallback command', () => {
+    const command = cloneCommand("/w/it's", '/w/copy')
+
+    expect(command).toContain(`test -d '/w/it'\\''s' || exit 3`)
+    expect(command).toContain('cp -a --reflink=auto')
+    expect(command).toContain(`mv -T '/w/.copy.clone-`)
+  })
+})
@@ -0,0 +1,48 @@
+import { randomBytes } from 'crypto'
+import { describe, expect, it } from 'vitest'
+import {
+  assembleDelta,
+  buildManifest,
+  chunkContent,
+  DELTA_MAX_CHUNK,
+  DELTA_MIN_CHUNK,
+  planDelta
+} from '../src/utils/deltaSync.js'
+
+describe('deltaSync', () => {
+  const original = randomBytes(1024 * 1024)
+
+  it('should cover the content with chunks within the size bounds', () => {
+    const chunks = chunkContent(original)
+
+    expect(chunks.reduce((total, chunk) => total + chunk.length, 0)).toBe(original.length)
+    for (const chunk of chunks.slice(0, -1)) {
+      expect(chunk.length).toBeGreaterThanOrEqual(DELTA_MIN_CHUNK)
+      expect(chunk.length).toBeLessThanOrEqual(DELTA_MAX_CHUNK)
+    }
+    expect(chunkContent(original)).toEqual(chunks)
+  })
+
+  it('should only resend the chunks around an insertion', () => {
+    const modified = Buffer.concat([original.subarray(0, 500_000), Buffer.from('inserted line\n'), original.subarray(500_000)])
+    const chunks = chunkContent(modified)
+
+    const delta = planDelta(modified, chunks, buildManifest(original))
+
+    expect(delta.body.length).toBeLessThan(3 * DELTA_MAX_CHUNK)
+    expect(assembleDelta(original, delta.chunks, delta.body).equals(modified)).toBe(true)
+  })
+
+  it('should fail with ESTALE when the base lacks a referenced chunk', () => {
+    const delta = planDelta(original, chunkContent(original), buildManifest(original))
+
+    expect(delta.body.length).toBe(0)
+    let error: NodeJS.ErrnoException | undefined
+    try {
+      assembleDelta(randomBytes(4096), delta.chunks, delta.body)
+    } catch (e) {
+      error = e as NodeJS.ErrnoException
+    }
+    expect(error?.code).toBe('ESTALE')
+  })
+})
@@ -0,0 +1,139 @@
+import { spawnSync } from 'child_process'
+import { mkdirSync, mkdtempSync, rmSync, writeFileSync } from 'fs'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { afterAll, beforeAll, describe, expect, it } from 'vitest'
+// @ts-expect-error - plain JS module without type declarations
+import { buildNative } from '../cli/build-native.js'
+import { INTERCEPT_ROOT_ENV } from '../src/utils/nativeLibrary.js'
+
+const hasCompiler = process.platform === 'linux' && spawnSync(process.env.CC || 'cc', ['--version']).status === 0
+
+/** Starts `cat <file>` with an emptied environment, through posix_spawn or clearenv() + system() */
+const SPAWN_SOURCE = `
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+int main(int argc, char **argv) {
+  char *args[] = {"cat", argv[2], NULL};
+  char *env[] = {NULL};
+  char command[4096];
+  pid_t pid;
+  int status = 0;
+
+  if (argc < 3) return 2;
+  if (strcmp(argv[1], "spawn") == 0) {
+    if (posix_spawn(&pid, "/bin/cat", NULL, NULL, args, env) != 0) return 2;
+    waitpid(pid, &status, 0);
+  } else {
+    snprintf(command, sizeof(command), "cat %s", argv[2]);
+    clearenv();
+    status = system(command);
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 2;
+}
+`
+
+describe.skipIf(!hasCompiler)('LD_PRELOAD intercept library', () => {
+  let tempDir: string
+  let library: string
+  let workspace: string
+  let secret: string
+  let spawnHelper: string
+
+  /** Run a program confined to the workspace */
+  const runProgram = (file: string, args: string[]) => {
+    const result = spawnSync(file, args, {
+      cwd: workspace,
+      encoding: 'utf-8',
+      env: { ...process.env, LD_PRELOAD: library, [INTERCEPT_ROOT_ENV]: workspace },
+    })
+    return { status: result.status, stdout: result.stdout, stderr: result.stderr }
+  }
+
+  /** Run a shell command confined to the workspace */
+  const run = (command: string) => runProgram('sh', ['-c', command])
+
+  beforeAll(async () => {
+    tempDir = mkdtempSync(join(tmpdir(), 'constellation-intercept-'))
+    library = await buildNative({ output: join(tempDir, 'lib') })
+
+    spawnHelper = join(tempDir, 'lib', 'spawn-helper')
+    writeFileSync(`${spawnHelper}.c`, SPAWN_SOURCE)
+    const compiled = spawnSync(process.env.CC || 'cc', ['-o', spawnHelper, `${spawnHelper}.c`], { encoding: 'utf-8' })
+    if (compiled.status !== 0) {
+      throw new Error(`Failed to build the spawn helper: ${compiled.stderr}`)
+    }
+
+    workspace = join(tempDir, 'users', 'alice', 'default')
+    mkdirSync(join(workspace, 'src', 'deep'), { recursive: true })
+    writeFileSync(join(workspace, 'notes.txt'), 'inside')
+
+    const other = join(tempDir, 'users', 'bob', 'default')
+    mkdirSync(other, { recursive: true })
+    secret = join(other, 'secret.txt')
+    writeFileSync(secret, 'SECRET')
+  }, 60_000)
+
+  afterAll(() => {
+    rmSync(tempDir, { recursive: true, force: true })
+  })
+
+  it('should run commands inside the workspace', () => {
+    expect(run('cat notes.txt && cd src && pwd')).toMatchObject({ status: 0, stdout: `inside${workspace}/src\n` })
+    expect(run('find . -name notes.txt')).toMatchObject({ status: 0, stdout: './notes.txt\n' })
+  })
+
+  it('should deny parent directory escapes', () => {
+    const result = run('cd src/deep && cat ../../../../bob/default/secret.txt')
+    expect(result.status).not.toBe(0)
+    expect(result.stdout).not.toContain('SECRET')
+  })
+
+  it('should map absolute paths outside the root into the workspace', () => {
+    expect(run('cat /notes.txt')).toMatchObject({ status: 0, stdout: 'inside' })
+    const result = run(`cat ${secret}`)
+    expect(result.status).not.toBe(0)
+    expect(result.stdout).not.toContain('SECRET')
+  })
+
+  it('should deny writes to system directories', () => {
+    expect(run('touch /etc/constellation-test').status).not.toBe(0)
+  })
+
+  it('should deny escapes through /proc and links', () => {
+    expect(run(`cat /proc/self/root${secret}`).stdout).not.toContain('SECRET')
+    expect(run(`ln -s ${secret} link && cat link`).stdout).not.toContain('SECRET')
+    expect(run('ln /etc/hostname hardlink').status).not.toBe(0)
+  })
+
+  it.each([
+    ['LD_PRELOAD', 'LD_PRELOAD='],
+    ['the workspace root', `${INTERCEPT_ROOT_ENV}=/`],
+    ['the writable prefixes', 'CONSTELLATION_INTERCEPT_WRITABLE=/'],
+    ['the read-only prefixes', 'CONSTELLATION_INTERCEPT_READONLY=/'],
+    ['the whole environment', 'env -i'],
+  ])('should stay confined when a command overrides %s', (_name, override) => {
+    const result = run(`${override} cat ${secret}`)
+    expect(result.status).not.toBe(0)
+    expect(result.stdout).not.toContain('SECRET')
+    expect(run(`${override} sh -c 'echo pwned > ${secret}.new'`).status).not.toBe(0)
+  })
+
+  it.each([
+    ['posix_spawn with an empty environment', 'spawn'],
+    ['system() after clearenv()', 'system'],
+  ])('should stay confined in children started by %s', (_name, mode) => {
+    const result = runProgram(spawnHelper, [mode, secret])
+    expect(result.status).not.toBe(0)
+    expect(result.stdout).not.toContain('SECRET')
+  })
+
+  it('should refuse to run with an unusable workspace root', () => {
+    const result = spawnSync('true', { env: { ...process.env, LD_PRELOAD: library, [INTERCEPT_ROOT_ENV]: '/' } })
+    expect(result.status).toBe(126)
+  })
+})
@@ -0,0 +1,99 @@
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { analyzeCommand } from '../src/safety.js'
+import {
+  formatPrometheusMetrics,
+  getMetrics,
+  Histogram,
+  incrementCounter,
+  observe,
+  recordDuration,
+  resetMetrics,
+  setMetricsEnabled,
+  startTimer
+} from '../src/utils/metrics.js'
+
+describe('Histogram', () => {
+  it('should estimate quantiles within 1%', () => {
+    const histogram = new Histogram('latency')
+    // 0.01ms to 1000ms in even steps
+    for (let i = 1; i <= 100_000; i++) histogram.record(i / 100)
+
+    const snapshot = histogram.snapshot()
+    expect(snapshot.count).toBe(100_000)
+    expect(snapshot.minMs).toBe(0.01)
+    expect(snapshot.maxMs).toBe(1000)
+    for (const [quantile, expected] of [[0.5, 500], [0.99, 990], [0.999, 999]] as const) {
+      expect(Math.abs(histogram.quantile(quantile) - expected) / expected).toBeLessThan(0.01)
+    }
+  })
+
+  it('should report exact values below 128 microseconds', () => {
+    const histogram = new Histogram('latency')
+    histogram.record(0.005)
+    histogram.record(0.1)
+
+    expect(histogram.quantile(0.5)).toBe(0.005)
+    expect(histogram.quantile(1)).toBe(0.1)
+  })
+})
+
+describe('metrics registry', () => {
+  beforeEach(() => {
+    resetMetrics()
+  })
+
+  afterEach(() => {
+    setMetricsEnabled(false)
+    resetMetrics()
+  })
+
+  it('should record nothing while disabled', () => {
+    setMetricsEnabled(false)
+    const timer = startTimer()
+    recordDuration('constellation_test', timer)
+    observe('constellation_test', 5)
+    incrementCounter('constellation_test')
+    analyzeCommand('ls -la')
+
+    expect(timer).toBe(0)
+    expect(getMetrics()).toEqual({ enabled: false, histograms: [], counters: [] })
+  })
+
+  it('should keep one series per label set', () => {
+    setMetricsEnabled(true)
+    observe('constellation_agent_request', 2, { op: 'stat' })
+    observe('constellation_agent_request', 4, { op: 'stat' })
+    observe('constellation_agent_request', 8, { op: 'readdir' })
+    incrementCounter('constellation_pool_acquire', { result: 'hit' })
+    incrementCounter('constellation_pool_acquire', { result: 'hit' }, 2)
+
+    const { histograms, counters } = getMetrics()
+    expect(histograms.map(h => [h.labels.op, h.count, h.sumMs])).toEqual([['stat', 2, 6], ['readdir', 1, 8]])
+    expect(counters).toEqual([{ name: 'constellation_pool_acquire', labels: { result: 'hit' }, value: 3 }])
+  })
+
+  it('should time instrumented hot paths once enabled', () => {
+    setMetricsEnabled(true)
+    analyzeCommand('ls -la')
+    analyzeCommand('rm -rf /')
+
+    const safety = getMetrics().histograms.find(h => h.name === 'constellation_safety_check')
+    expect(safety?.count).toBe(2)
+  })
+
+  it('should render the Prometheus text format', () => {
+    setMetricsEnabled(true)
+    observe('constellation_sftp_operation', 1.5)
+    observe('constellation_agent_request', 2, { op: 'say "hi"' })
+    incrementCounter('constellation_pool_acquire', { result: 'miss' })
+
+    const text = formatPrometheusMetrics()
+    const lines = text.trimEnd().split('\n')
+    expect(lines[0]).toBe('# TYPE constellation_agent_request_seconds summary')
+    expect(lines).toContain('constellation_agent_request_seconds{op="say \\"hi\\"",quantile="0.99"} 0.002')
+    expect(lines).toContain('constellation_sftp_operation_seconds_sum 0.0015')
+    expect(lines).toContain('constellation_sftp_operation_seconds_count 1')
+    expect(lines).toContain('# TYPE constellation_pool_acquire_total counter')
+    expect(lines).toContain('constellation_pool_acquire_total{result="miss"} 1')
+  })
+})
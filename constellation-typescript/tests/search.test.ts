@@ -0,0 +1,156 @@
+import { mkdir, mkdtemp, rm, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { dirname, join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { IgnoreFile, isIgnored } from '../src/utils/gitignore.js'
+import {
+  grepCommand,
+  parseGrepOutput,
+  requiredLiteral,
+  searchTree,
+  SearchPatternError
+} from '../src/utils/search.js'
+
+describe('content search', () => {
+  let root: string
+
+  const files = async (contents: Record<string, string | Buffer>) => {
+    for (const [path, content] of Object.entries(contents)) {
+      await mkdir(dirname(join(root, path)), { recursive: true })
+      await writeFile(join(root, path), content)
+    }
+  }
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-search-test-'))
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  describe('searchTree', () => {
+    it('should return matches with line and column, sorted by path', async () => {
+      await files({
+        'src/b.ts': 'const x = 1\nexport function handler() {}\n',
+        'src/a.ts': 'function main() {\n  return handler()\n}\n',
+        'README.md': 'nothing here\n',
+      })
+
+      const result = await searchTree(root, { pattern: 'handler\\(' })
+
+      expect(result.matches).toEqual([
+        { path: 'src/a.ts', line: 2, column: 10, text: '  return handler()' },
+        { path: 'src/b.ts', line: 2, column: 17, text: 'export function handler() {}' },
+      ])
+      expect(result.truncated).toBe(false)
+      expect(result.filesSearched).toBe(3)
+    })
+
+    it('should honour .gitignore files, hidden files and binary detection', async () => {
+      await files({
+        '.gitignore': 'node_modules\n/dist\n*.log\n!keep.log\n',
+        'node_modules/pkg/index.js': 'needle',
+        'dist/out.js': 'needle',
+        'lib/dist/kept.js': 'needle',
+        'debug.log': 'needle',
+        'keep.log': 'needle',
+        '.cache/hidden.txt': 'needle',
+        'image.bin': Buffer.from('needle\0needle'),
+        'packages/app/.gitignore': 'generated/\n',
+        'packages/app/generated/x.ts': 'needle',
+      })
+
+      const paths = (await searchTree(root, { pattern: 'needle' })).matches.map(m => m.path)
+      expect(paths).toEqual(['keep.log', 'lib/dist/kept.js'])
+
+      const everything = await searchTree(root, { pattern: 'needle', gitignore: false, hidden: true })
+      expect(everything.matches).toHaveLength(7)
+    })
+
+    it('should filter by glob and stop at maxResults', async () => {
+      await files({
+        'a.ts': 'hit\nhit\nhit\n',
+        'deep/b.ts': 'hit\n',
+        'c.js': 'hit\n',
+      })
+
+      const ts = await searchTree(root, { pattern: 'hit', glob: '*.ts' })
+      expect(new Set(ts.matches.map(m => m.path))).toEqual(new Set(['a.ts', 'deep/b.ts']))
+
+      const limited = await searchTree(root, { pattern: 'hit', maxResults: 2 })
+      expect(limited.matches).toHaveLength(2)
+      expect(limited.truncated).toBe(true)
+    })
+
+    it('should support literal, case-insensitive and anchored patterns', async () => {
+      await files({ 'f.txt': 'a.b\naxb\nHello world\nworld hello\n' })
+
+      expect((await searchTree(root, { pattern: 'a.b', literal: true })).matches.map(m => m.line)).toEqual([1])
+      expect((await searchTree(root, { pattern: 'hello', ignoreCase: true })).matches.map(m => m.line)).toEqual([3, 4])
+      expect((await searchTree(root, { pattern: '^world' })).matches.map(m => m.line)).toEqual([4])
+      // \s must not join two lines into one match
+      expect((await searchTree(root, { pattern: 'axb\\s+Hello' })).matches).toEqual([])
+    })
+
+    it('should prefix reported paths', async () => {
+      await files({ 'x.txt': 'hit' })
+      const result = await searchTree(root, { pattern: 'hit' }, 'sub/dir')
+      expect(result.matches[0]!.path).toBe('sub/dir/x.txt')
+    })
+
+    it('should reject empty and invalid patterns', async () => {
+      await expect(searchTree(root, { pattern: '' })).rejects.toBeInstanceOf(SearchPatternError)
+      await expect(searchTree(root, { pattern: '(' })).rejects.toThrow('Invalid search pattern')
+    })
+  })
+
+  describe('requiredLiteral', () => {
+    it('should find text every match must contain', () => {
+      expect(requiredLiteral('foo')).toBe('foo')
+      expect(requiredLiteral('\\bfunction\\s+(\\w+)')).toBe('function')
+      expect(requiredLiteral('hello\\.world')).toBe('hello.world')
+      expect(requiredLiteral('ab{2,3}cde')).toBe('cde')
+      expect(requiredLiteral('colou?r')).toBe('colo')
+    })
+
+    it('should give up on alternation and patterns without literals', () => {
+      expect(requiredLiteral('foo|bar')).toBeNull()
+      expect(requiredLiteral('[a-z]+\\d*')).toBeNull()
+    })
+  })
+
+  describe('gitignore', () => {
+    it('should apply negations and directory-only rules', () => {
+      const rules = [new IgnoreFile('build/\n*.tmp\n!important.tmp\n', ''), new IgnoreFile('/local.tmp\n', 'sub')]
+
+      expect(isIgnored(rules, 'build', true)).toBe(true)
+      expect(isIgnored(rules, 'build', false)).toBe(false)
+      expect(isIgnored(rules, 'a/b/c.tmp', false)).toBe(true)
+      expect(isIgnored(rules, 'a/important.tmp', false)).toBe(false)
+      expect(isIgnored(rules, 'sub/local.tmp', false)).toBe(true)
+    })
+  })
+
+  describe('grep fallback', () => {
+    it('should quote the pattern and directory', () => {
+      const command = grepCommand("/work/it's", { pattern: "don't", glob: '*.ts', ignoreCase: true })
+      expect(command).toContain("cd '/work/it'\\''s' || exit 2;")
+      expect(command).toContain("-e 'don'\\''t'")
+      expect(command).toContain("--include='*.ts'")
+      expect(command).toContain('-i')
+    })
+
+    it('should parse NUL-separated output', () => {
+      const output = './src/a.ts\x002:  call(x)\n./b:c.ts\x001:call\n'
+      const result = parseGrepOutput(output, { pattern: 'call' }, 'ws')
+
+      expect(result.matches).toEqual([
+        { path: 'ws/b:c.ts', line: 1, column: 1, text: 'call' },
+        { path: 'ws/src/a.ts', line: 2, column: 3, text: '  call(x)' },
+      ])
+      expect(result.filesSearched).toBe(2)
+      expect(parseGrepOutput(output, { pattern: 'call', maxResults: 1 }).truncated).toBe(true)
+    })
+  })
+})
@@ -1,5 +1,6 @@
 import { describe, expect, it } from 'vitest'
-import { parseCommand, isCommandSafe, isEscapingWorkspace } from '../src/safety.js'
+import { analyzeCommand, parseCommand, isCommandSafe, isDangerous, isEscapingWorkspace } from '../src/safety.js'
+import { tokenizeCommand } from '../src/utils/shellTokenizer.js'
 import { isPathEscaping, validatePaths } from '../src/utils/pathValidator.js'
 
 describe('Command Parser Security', () => {
@@ -80,6 +81,71 @@ describe('Command Parser Security', () => {
       expect(isCommandSafe('grep pattern file.txt').safe).toBe(true)
     })
   })
+
+  describe('analyzeCommand', () => {
+    it('should tell dangerous commands from workspace escapes', () => {
+      expect(analyzeCommand('sudo ls')).toMatchObject({ safe: false, dangerous: true })
+      expect(analyzeCommand('cat ../secret')).toMatchObject({ safe: false, dangerous: false })
+      expect(analyzeCommand('ls -la')).toEqual({ safe: true, dangerous: false })
+    })
+
+    it('should match anchored patterns on the whole leading word', () => {
+      expect(isDangerous('su -')).toBe(true)
+      expect(isDangerous('sudo-like-tool --help')).toBe(true)
+      expect(isDangerous('sum file.txt')).toBe(false)
+      expect(isDangerous('sshfs-helper')).toBe(false)
+      expect(isDangerous('mv ../a b')).toBe(true)
+      expect(isDangerous('echo hi && ln -s /etc x')).toBe(true)
+      expect(isDangerous('gcloud storage rsync gs://a gs://b')).toBe(false)
+    })
+
+    it('should honour custom allowed patterns, including flags and alternations', () => {
+      expect(isDangerous('SSH host', { allowedPatterns: [/^ssh\s+host$/i] })).toBe(false)
+      expect(isDangerous('reboot', { allowedPatterns: [/^nothing\b|reboot/] })).toBe(false)
+      expect(isDangerous('(halt)', { allowedPatterns: [/^\((halt)\)$/] })).toBe(false)
+      expect(isDangerous('killall node', { allowedPatterns: [/^pkill\b/] })).toBe(true)
+    })
+
+    it('should keep returning the cached verdict for repeated commands', () => {
+      const first = analyzeCommand('cd /tmp')
+      expect(analyzeCommand('cd /tmp')).toBe(first)
+    })
+  })
+})
+
+describe('tokenizeCommand', () => {
+  const values = (command: string) => tokenizeCommand(command).map(token => token.value)
+
+  it('should split words and operators', () => {
+    expect(values('ls -la|grep x&&echo ok;true')).toEqual(['ls', '-la', '|', 'grep', 'x', '&&', 'echo', 'ok', ';', 'true'])
+    expect(values('make 2>&1 >> build.log')).toEqual(['make', '2>&', '1', '>>', 'build.log'])
+  })
+
+  it('should remove quotes and escapes', () => {
+    expect(values(`echo 'a b' "c \\"d\\"" e\\ f`)).toEqual(['echo', 'a b', 'c "d"', 'e f'])
+    expect(parseCommand(`grep -r "two words" src`).args).toEqual(['-r', 'two words', 'src'])
+  })
+
+  it('should keep substitutions verbatim as part of a word', () => {
+    expect(values('echo $(ls "a b" | wc -l) `date` ${HOME}x')).toEqual(['echo', '$(ls "a b" | wc -l)', '`date`', '${HOME}x'])
+  })
+
+  it('should skip comments and line continuations', () => {
+    expect(values('echo a \\\n  b # trailing comment')).toEqual(['echo', 'a', 'b'])
+  })
+
+  it('should read heredoc bodies as a single token', () => {
+    const tokens = tokenizeCommand("cat > out.txt << 'EOF'\nrm -rf / | sh\nEOF\necho done")
+    expect(tokens.map(token => token.type)).toEqual(['word', 'operator', 'word', 'operator', 'word', 'operator', 'heredoc', 'word', 'word'])
+    expect(tokens[6]!.value).toBe('rm -rf / | sh\n')
+    expect(tokens[7]!.value).toBe('echo')
+  })
+
+  it('should report source offsets', () => {
+    const command = 'cat  "my file"'
+    const [, file] = tokenizeCommand(command)
+    expect(command.slice(file!.start, file!.end)).toBe('"my file"')
+  })
 })
 
 describe('Path Validator Security', () => {
@@ -0,0 +1,188 @@
+import { Readable } from 'stream'
+import { pipeline } from 'stream/promises'
+import type { SFTPWrapper } from 'ssh2'
+import { describe, expect, it } from 'vitest'
+import {
+  readIntoBuffer,
+  SftpReadStream,
+  SftpWriteStream,
+  writeFromBuffer
+} from '../src/utils/sftpStreams.js'
+
+/**
+ * In-memory SFTP server with asynchronous, out-of-order replies
+ */
+class FakeSftp {
+  file = Buffer.alloc(0)
+  inFlight = 0
+  maxInFlight = 0
+  closed = 0
+  /** Largest number of bytes returned by one read (simulates server limits) */
+  maxReadBytes = Infinity
+
+  private reply(callback: () => void): void {
+    this.inFlight++
+    this.maxInFlight = Math.max(this.maxInFlight, this.inFlight)
+    setTimeout(() => {
+      this.inFlight--
+      callback()
+    }, Math.random() * 3)
+  }
+
+  read(_handle: Buffer, buffer: Buffer, offset: number, length: number, position: number, cb: (err: Error | undefined, bytesRead: number) => void): void {
+    this.reply(() => {
+      if (position >= this.file.length) {
+        cb(Object.assign(new Error('EOF'), { code: 1 }), 0)
+        return
+      }
+      const bytes = Math.min(length, this.maxReadBytes, this.file.length - position)
+      this.file.copy(buffer, offset, position, position + bytes)
+      cb(undefined, bytes)
+    })
+  }
+
+  write(_handle: Buffer, buffer: Buffer, offset: number, length: number, position: number, cb: (err?: Error) => void): void {
+    const data = Buffer.from(buffer.subarray(offset, offset + length))
+    this.reply(() => {
+      if (this.file.length < position + length) {
+        const grown = Buffer.alloc(position + length)
+        this.file.copy(grown)
+        this.file = grown
+      }
+      data.copy(this.file, position)
+      cb()
+    })
+  }
+
+  close(_handle: Buffer, cb: (err?: Error) => void): void {
+    this.closed++
+    setImmediate(() => cb())
+  }
+
+  get sftp(): SFTPWrapper {
+    return this as unknown as SFTPWrapper
+  }
+}
+
+function randomBytes(length: number): Buffer {
+  const data = Buffer.alloc(length)
+  for (let i = 0; i < length; i++) data[i] = (i * 31 + (i >> 7)) & 0xff
+  return data
+}
+
+const handle = Buffer.from('h')
+
+describe('pipelined SFTP transfers', () => {
+  describe('readIntoBuffer', () => {
+    it('should fill the buffer with bounded concurrency', async () => {
+      const fake = new FakeSftp()
+      fake.file = randomBytes(100_000)
+      const target = Buffer.alloc(100_000)
+
+      const bytesRead = await readIntoBuffer(fake.sftp, handle, target, 0, { chunkSize: 1000, concurrency: 8 })
+
+      expect(bytesRead).toBe(100_000)
+      expect(target.equals(fake.file)).toBe(true)
+      expect(fake.maxInFlight).toBe(8)
+    })
+
+    it('should complete short reads and stop at end of file', async () => {
+      const fake = new FakeSftp()
+      fake.file = randomBytes(5_500)
+      fake.maxReadBytes = 300
+      const target = Buffer.alloc(8_000)
+
+      const bytesRead = await readIntoBuffer(fake.sftp, handle, target, 0, { chunkSize: 1000, concurrency: 4 })
+
+      expect(bytesRead).toBe(5_500)
+      expect(target.subarray(0, bytesRead).equals(fake.file)).toBe(true)
+    })
+  })
+
+  describe('writeFromBuffer', () => {
+    it('should write every chunk at the right offset', async () => {
+      const fake = new FakeSftp()
+      const data = randomBytes(77_777)
+
+      await writeFromBuffer(fake.sftp, handle, data, 0, { chunkSize: 4096, concurrency: 16 })
+
+      expect(fake.file.equals(data)).toBe(true)
+      expect(fake.maxInFlight).toBe(16)
+    })
+  })
+
+  describe('SftpReadStream', () => {
+    it('should deliver the file in order and close the handle', async () => {
+      const fake = new FakeSftp()
+      fake.file = randomBytes(50_000)
+      fake.maxReadBytes = 700
+
+      const chunks: Buffer[] = []
+      for await (const chunk of new SftpReadStream(fake.sftp, handle, { chunkSize: 1024, concurrency: 6 })) {
+        chunks.push(chunk as Buffer)
+      }
+
+      expect(Buffer.concat(chunks).equals(fake.file)).toBe(true)
+      expect(fake.maxInFlight).toBeLessThan(7)
+      expect(fake.closed).toBe(1)
+    })
+
+    it('should read an inclusive byte range', async () => {
+      const fake = new FakeSftp()
+      fake.file = randomBytes(10_000)
+
+      const chunks: Buffer[] = []
+      for await (const chunk of new SftpReadStream(fake.sftp, handle, { start: 100, end: 5_099, chunkSize: 512 })) {
+        chunks.push(chunk as Buffer)
+      }
+
+      expect(Buffer.concat(chunks).equals(fake.file.subarray(100, 5_100))).toBe(true)
+    })
+
+    it('should stop issuing reads while the consumer is paused', async () => {
+      const fake = new FakeSftp()
+      fake.file = randomBytes(1_000_000)
+      let reads = 0
+      const read = fake.read.bind(fake)
+      fake.read = (...args: Parameters<FakeSftp['read']>) => {
+        reads++
+        read(...args)
+      }
+
+      const stream = new SftpReadStream(fake.sftp, handle, { chunkSize: 1000, concurrency: 4 })
+      stream.once('data', () => stream.pause())
+      await new Promise(resolve => setTimeout(resolve, 100))
+
+      // highWaterMark (chunkSize * concurrency) plus the reads in flight, not the whole file
+      expect(reads).toBeLessThan(20)
+      stream.destroy()
+    })
+  })
+
+  describe('SftpWriteStream', () => {
+    it('should write a piped source with bounded concurrency', async () => {
+      const fake = new FakeSftp()
+      const data = randomBytes(200_000)
+      const source = Readable.from((function* () {
+        for (let i = 0; i < data.length; i += 3000) yield data.subarray(i, i + 3000)
+      })())
+
+      const output = new SftpWriteStream(fake.sftp, handle, { chunkSize: 1024, concurrency: 8 })
+      await pipeline(source, output)
+
+      expect(fake.file.equals(data)).toBe(true)
+      expect(fake.maxInFlight).toBeLessThan(9)
+      expect(output.bytesWritten).toBe(200_000)
+      expect(fake.closed).toBe(1)
+    })
+
+    it('should surface write failures', async () => {
+      const fake = new FakeSftp()
+      fake.write = (_h, _b, _o, _l, _p, cb) => setImmediate(() => cb(new Error('disk full')))
+
+      const output = new SftpWriteStream(fake.sftp, handle, { chunkSize: 10, concurrency: 2 })
+      await expect(pipeline(Readable.from([randomBytes(100)]), output)).rejects.toThrow('disk full')
+      expect(fake.closed).toBe(1)
+    })
+  })
+})
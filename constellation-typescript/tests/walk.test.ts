@@ -0,0 +1,115 @@
+import { mkdir, mkdtemp, rm, symlink, writeFile } from 'fs/promises'
+import { tmpdir } from 'os'
+import { dirname, join } from 'path'
+import { afterEach, beforeEach, describe, expect, it } from 'vitest'
+import { compileExcludes, parseWalkOutput, walkCommand, walkTree } from '../src/utils/walk.js'
+
+describe('directory walk', () => {
+  let root: string
+
+  const files = async (contents: Record<string, string>) => {
+    for (const [path, content] of Object.entries(contents)) {
+      await mkdir(dirname(join(root, path)), { recursive: true })
+      await writeFile(join(root, path), content)
+    }
+  }
+
+  beforeEach(async () => {
+    root = await mkdtemp(join(tmpdir(), 'constellation-walk-test-'))
+  })
+
+  afterEach(async () => {
+    await rm(root, { recursive: true, force: true })
+  })
+
+  describe('compileExcludes', () => {
+    it('should match plain names at any depth and globs against the relative path', () => {
+      const excluded = compileExcludes(['node_modules', '*.log', 'src/generated'])
+
+      expect(excluded('node_modules')).toBe(true)
+      expect(excluded('packages/a/node_modules')).toBe(true)
+      expect(excluded('debug.log')).toBe(true)
+      expect(excluded('logs/debug.log')).toBe(false)
+      expect(excluded('src/generated')).toBe(true)
+      expect(excluded('lib/src/generated')).toBe(true)
+      expect(excluded('src/index.ts')).toBe(false)
+    })
+  })
+
+  describe('walkTree', () => {
+    it('should list entries depth first and skip excluded directories', async () => {
+      await files({
+        'b.txt': 'bb',
+        'a/z.txt': 'z',
+        'a/m/deep.txt': 'deep',
+        'a-b/file.txt': 'f',
+        'node_modules/pkg/index.js': 'x',
+      })
+      await symlink(join(root, 'a'), join(root, 'link'))
+
+      const { entries, truncated } = await walkTree(root, { excludes: ['node_modules'], withStats: true })
+
+      expect(truncated).toBe(false)
+      expect(entries.map(entry => `${entry.type} ${entry.path}`)).toEqual([
+        'directory a',
+        'directory a/m',
+        'file a/m/deep.txt',
+        'file a/z.txt',
+        'directory a-b',
+        'file a-b/file.txt',
+        'file b.txt',
+        'symlink link',
+      ])
+      expect(entries.find(entry => entry.path === 'b.txt')).toMatchObject({ size: 2 })
+      expect(entries[0]!.mode! & 0o170000).toBe(0o040000)
+    })
+
+    it('should honour maxDepth and maxEntries', async () => {
+      await files({ 'one/two/three.txt': '3', 'top.txt': 't' })
+
+      const shallow = await walkTree(root, { maxDepth: 1 })
+      expect(shallow.entries.map(entry => entry.path)).toEqual(['one', 'top.txt'])
+      expect(shallow.entries[0]!.size).toBeUndefined()
+
+      const limited = await walkTree(root, { maxEntries: 2 })
+      expect(limited.entries).toHaveLength(2)
+      expect(limited.truncated).toBe(true)
+    })
+
+    it('should reject a path that is not a directory', async () => {
+      await files({ 'file.txt': 'x' })
+      await expect(walkTree(join(root, 'file.txt'))).rejects.toMatchObject({ code: 'ENOTDIR' })
+    })
+  })
+
+  describe('find fallback', () => {
+    it('should prune plain names in the command', () => {
+      const command = walkCommand('/srv/ws', { excludes: ['node_modules', '*.log'], maxDepth: 3 })
+
+      expect(command).toContain("cd '/srv/ws' || exit 2;")
+      expect(command).toContain("-maxdepth 3 \\( -name 'node_modules' \\) -prune -o -printf")
+      expect(command).not.toContain('*.log')
+    })
+
+    it('should parse find output and apply the remaining excludes', () => {
+      const output = [
+        'f\t12\t1700000000.5\t644\tz.txt',
+        'd\t4096\t1700000000\t755\tbuild',
+        'f\t3\t1700000000\t600\tbuild/out.log',
+        'f\t1\t1700000000\t644\tbuild/keep.txt',
+        'd\t4096\t1700000000\t755\tcache.log',
+        'f\t1\t1700000000\t644\tcache.log/inner.txt',
+      ].join('\0') + '\0'
+
+      const result = parseWalkOutput(output, { excludes: ['*.log'], withStats: true })
+
+      expect(result.truncated).toBe(false)
+      expect(result.entries).toEqual([
+        { path: 'build', type: 'directory', size: 4096, mtimeMs: 1700000000000, mode: 0o40755 },
+        { path: 'build/keep.txt', type: 'file', size: 1, mtimeMs: 1700000000000, mode: 0o100644 },
+        { path: 'build/out.log', type: 'file', size: 3, mtimeMs: 1700000000000, mode: 0o100600 },
+        { path: 'z.txt', type: 'file', size: 12, mtimeMs: 1700000000500, mode: 0o100644 },
+      ])
+    })
+  })
+})
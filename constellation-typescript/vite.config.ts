@@ -13,15 +13,18 @@ export default defineConfig({
     lib: {
       entry: {
         index: path.resolve(__dirname, 'src/index.ts'),
+        local: path.resolve(__dirname, 'src/local.ts'),
+        remote: path.resolve(__dirname, 'src/remote.ts'),
         'mcp/index': path.resolve(__dirname, 'src/mcp/index.ts'),
         'mcp/server': path.resolve(__dirname, 'src/mcp/server.ts'),
+        'agent/main': path.resolve(__dirname, 'src/agent/main.ts'),
       },
       formats: ['es', 'cjs']
     },
     sourcemap: true,
     rollupOptions: {
       external: [
-        'fs', 'fs/promises', 'path', 'child_process', 'os', 'url', 'crypto',
+        'fs', 'fs/promises', 'path', 'child_process', 'os', 'url', 'crypto', 'net', 'stream', 'stream/promises',
         'ssh2', 'node-fuse-bindings', 'util', 'events',
         '@modelcontextprotocol/sdk/server/mcp.js',
         '@modelcontextprotocol/sdk/server/stdio.js',
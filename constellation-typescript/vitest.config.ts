@@ -6,6 +6,9 @@ export default defineConfig({
     environment: 'node',
     globals: true,
     include: ['tests/**/*.test.ts', 'src/**/*.test.ts'],
+    benchmark: {
+      include: ['bench/**/*.bench.ts'],
+    },
     env: {
       CONSTELLATIONFS_APP_ID: 'test-app'
     }
@@ -1,6 +1,31 @@
 import { NextRequest, NextResponse } from 'next/server'
+import { Readable } from 'stream'
 import { createFileSystem, initConstellationFS } from '../../../lib/constellation-init'
 
+/**
+ * Parse a single `bytes=` range against the file size
+ * Returns null to serve the whole file (no header, or a multi-range request
+ * we don't support) and 'unsatisfiable' for a range outside the file.
+ */
+function parseRange(header: string | null, size: number): { start: number; end: number } | null | 'unsatisfiable' {
+  const match = header?.match(/^bytes=(\d*)-(\d*)$/)
+  if (!match || (!match[1] && !match[2])) return null
+
+  let start: number
+  let end: number
+  if (!match[1]) {
+    // Suffix range: the last N bytes
+    start = Math.max(0, size - Number(match[2]))
+    end = size - 1
+  } else {
+    start = Number(match[1])
+    end = match[2] ? Math.min(Number(match[2]), size - 1) : size - 1
+  }
+
+  if (start >= size || end < start) return 'unsatisfiable'
+  return { start, end }
+}
+
 export async function GET(request: NextRequest) {
   try {
     const { searchParams } = new URL(request.url)
@@ -19,25 +44,42 @@ export async function GET(request: NextRequest) {
     // Create FileSystem instance
     const fs = createFileSystem(sessionId)
 
-    // Get workspace and read file content
     const workspace = await fs.getWorkspace('default')
-    const content = await workspace.readFile(filePath, 'utf-8') as string
+    const { size } = await workspace.stat(filePath)
 
     // Get filename from path
     const filename = filePath.split('/').pop() || 'download.txt'
+    const headers: Record<string, string> = {
+      'Content-Type': 'application/octet-stream',
+      'Content-Disposition': `attachment; filename="${filename}"`,
+      'Accept-Ranges': 'bytes',
+    }
 
-    // Return file as download
-    return new NextResponse(content, {
-      headers: {
-        'Content-Type': 'application/octet-stream',
-        'Content-Disposition': `attachment; filename="${filename}"`,
-      },
-    })
+    const range = parseRange(request.headers.get('range'), size)
+    if (range === 'unsatisfiable') {
+      return new NextResponse(null, { status: 416, headers: { ...headers, 'Content-Range': `bytes */${size}` } })
+    }
+
+    // Stream the raw bytes so binaries survive and memory stays at one chunk
+    const stream = await workspace.createReadStream(filePath, range ?? {})
+    const body = Readable.toWeb(stream) as ReadableStream<Uint8Array>
+
+    if (range) {
+      return new NextResponse(body, {
+        status: 206,
+        headers: {
+          ...headers,
+          'Content-Length': String(range.end - range.start + 1),
+          'Content-Range': `bytes ${range.start}-${range.end}/${size}`,
+        },
+      })
+    }
+    return new NextResponse(body, { headers: { ...headers, 'Content-Length': String(size) } })
 
   } catch (error) {
     console.error('Download error:', error)
-    return NextResponse.json({ 
-      error: error instanceof Error ? error.message : 'Download failed' 
+    return NextResponse.json({
+      error: error instanceof Error ? error.message : 'Download failed'
     }, { status: 500 })
   }
-}
\ No newline at end of file
+}
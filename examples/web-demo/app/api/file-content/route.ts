@@ -2,6 +2,9 @@ import { NextRequest, NextResponse } from 'next/server'
 import { createFileSystem, initConstellationFS } from '../../../lib/constellation-init'
 import type { FileSystem } from 'constellationfs'
 
+// Larger files are offered through /api/download instead of inlined as JSON
+const MAX_PREVIEW_BYTES = 5 * 1024 * 1024
+
 // Cache FileSystem instances for better performance
 const fsCache = new Map<string, FileSystem>()
 
@@ -52,6 +55,10 @@ export async function GET(request: NextRequest) {
 
     try {
       const workspace = await fs.getWorkspace('default')
+      const { size } = await workspace.stat(filePath)
+      if (size > MAX_PREVIEW_BYTES) {
+        return NextResponse.json({ error: `File is too large to preview (${size} bytes); download it instead` }, { status: 413 })
+      }
       const content = await workspace.readFile(filePath, 'utf-8')
       
       const readTime = Date.now() - readStartTime
@@ -0,0 +1,56 @@
+import { NextRequest } from 'next/server'
+import { createFileSystem, initConstellationFS } from '../../../../lib/constellation-init'
+
+/**
+ * Server-Sent Events stream of workspace changes, so the file explorer
+ * refreshes when commands change files instead of polling the listing
+ */
+export async function GET(request: NextRequest) {
+  const { searchParams } = new URL(request.url)
+  const sessionId = searchParams.get('sessionId')
+
+  if (!sessionId) {
+    return new Response('SessionId is required', { status: 400 })
+  }
+
+  initConstellationFS()
+  const fs = createFileSystem(sessionId)
+  const workspace = await fs.getWorkspace('default')
+
+  const stream = new ReadableStream({
+    async start(controller) {
+      const send = (data: unknown) => {
+        try {
+          controller.enqueue(`data: ${JSON.stringify(data)}\n\n`)
+        } catch {
+          // Client already gone
+        }
+      }
+
+      try {
+        const watcher = await workspace.watch('.', { debounceMs: 250 }, (event) => {
+          send({ type: 'change', paths: event.paths })
+          if (event.closed) controller.close()
+        })
+        request.signal.addEventListener('abort', () => {
+          watcher.close()
+          fs.destroy().catch(() => {})
+        })
+        send({ type: 'connected' })
+      } catch (error) {
+        // No watcher on this backend (e.g. remote host without the agent); the explorer keeps manual refresh
+        send({ type: 'unavailable', message: (error as Error).message })
+        controller.close()
+        await fs.destroy()
+      }
+    },
+  })
+
+  return new Response(stream, {
+    headers: {
+      'Content-Type': 'text/event-stream',
+      'Cache-Control': 'no-cache',
+      'Connection': 'keep-alive',
+    },
+  })
+}
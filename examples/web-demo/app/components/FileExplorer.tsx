@@ -55,6 +55,21 @@ export default function FileExplorer({ sessionId, onFileSelect, selectedFile }:
     fetchFileSystem()
   }, [sessionId])
 
+  useEffect(() => {
+    // Refresh when files change in the workspace, including through commands
+    const params = new URLSearchParams({ sessionId })
+    const events = new EventSource(`/api/filesystem/watch?${params}`)
+    events.onmessage = (message) => {
+      const data = JSON.parse(message.data)
+      if (data.type === 'change') {
+        fetchFileSystem()
+      } else if (data.type === 'unavailable') {
+        events.close()
+      }
+    }
+    return () => events.close()
+  }, [sessionId])
+
   useEffect(() => {
     // Listen for filesystem updates from chat
     const handleUpdate = () => {